@@ -0,0 +1,129 @@
+// hl7_bench: micro and macro benchmarks for the generation pipeline.
+//
+// Usage: hl7_bench [config.xml] [iterations] [--json FILE] [--dicom FILE] [--filter TEXT]
+//   --json    where to write the results (default hl7_bench.json) for comparing runs
+//   --dicom   sample DICOM file for the dicom/* group (skipped without it)
+//   --filter  only run benchmarks whose name contains TEXT, e.g. "validate/sax2"
+// The config must point <CdaXsdPath> at the CDA schema for the validate/* group.
+// DatabaseService runs against the stub ODBC layer in StubOdbc.cpp, never a real server.
+
+#include <iostream>
+#include <string>
+#include <map>
+#include <ctime>
+#include <unistd.h>
+
+#include "BenchSupport.h"
+#include "config_manager/ConfigManager.h"
+#include "hl7_generator/HL7MessageGenerator.h"
+#include "tracing/Tracer.h"
+
+namespace {
+
+std::string utcTimestamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc{};
+    gmtime_r(&now, &utc);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return buffer;
+}
+
+std::string hostName() {
+    char buffer[256] = {0};
+    gethostname(buffer, sizeof(buffer) - 1);
+    return buffer;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchContext context;
+    context.configFilePath = "config/hl7_config.xml";
+    std::string jsonPath = "hl7_bench.json";
+    std::string filter;
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (arg == "--dicom" && i + 1 < argc) {
+            context.dicomPath = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (positional == 0) {
+            context.configFilePath = arg;
+            ++positional;
+        } else if (positional == 1) {
+            context.iterations = std::stoi(arg);
+            ++positional;
+        } else {
+            std::cerr << "Usage: hl7_bench [config.xml] [iterations] [--json FILE] [--dicom FILE] [--filter TEXT]" << std::endl;
+            return 1;
+        }
+    }
+
+    HL7MessageGenerator::initializeXerces();
+
+    ConfigManager configManager;
+    bool loaded;
+    {
+        QuietScope quiet;
+        loaded = configManager.loadConfig(context.configFilePath);
+    }
+    if (!loaded) {
+        std::cerr << "FATAL: Failed to load configuration from '" << context.configFilePath << "'." << std::endl;
+        return 1;
+    }
+
+    BenchReport report;
+    report.setFilter(filter);
+    context.configManager = &configManager;
+    context.report = &report;
+
+    context.patient.patientID = "P001";
+    context.patient.name = "Jan Kowalski";
+    context.patient.dateOfBirth = "19800101";
+    context.patient.sex = "M";
+
+    context.study.studyInstanceUID = "1.2.826.0.1.3680043.2.1125.1";
+    context.study.patientId = context.patient.patientID;
+    context.study.accessionNumber = "A123";
+    context.study.studyDate = "20240501";
+    context.study.studyTime = "101500";
+    context.study.modality = "NM";
+    context.study.studyDescription = "Bone scan";
+
+    std::cout << "Running benchmarks (" << context.iterations << " iterations each)..." << std::endl;
+    runConfigBenchmarks(context);
+    runDatabaseBenchmarks(context);
+    runDataSourceBenchmarks(context);
+    runRecordBenchmarks(context);
+    runDicomBenchmarks(context);
+    runGenerationBenchmarks(context);
+    runMediaBenchmarks(context);
+    runValidationBenchmarks(context);
+
+    report.printTable(std::cout);
+
+    std::map<std::string, std::string> run;
+    run["timestamp"] = utcTimestamp();
+    run["host"] = hostName();
+    run["config"] = context.configFilePath;
+    run["iterations"] = std::to_string(context.iterations);
+    run["filter"] = filter;
+#ifdef __VERSION__
+    run["compiler"] = __VERSION__;
+#endif
+#ifdef NDEBUG
+    run["build"] = "release";
+#else
+    run["build"] = "debug";
+#endif
+    run["tracing"] = Tracer::compiledIn() ? "compiled-in" : "off";
+    bool written = report.writeJson(jsonPath, run);
+
+    HL7MessageGenerator::terminateXerces();
+    return written ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include "BenchSupport.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+
+namespace {
+
+std::string jsonString(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+long peakRssKb() {
+    struct rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+BenchResult& BenchReport::measure(const std::string& name, int iterations, const std::function<bool()>& body, int warmup) {
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations > 0 ? iterations : 1;
+
+    std::vector<double> samples;
+    samples.reserve(result.iterations);
+    {
+        QuietScope quiet;
+        for (int i = 0; i < warmup; ++i) {
+            body();
+        }
+        for (int i = 0; i < result.iterations; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = body();
+            samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            result.ok = result.ok && ok;
+        }
+    }
+
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    std::sort(samples.begin(), samples.end());
+    result.meanUs = sum / samples.size();
+    result.minUs = samples.front();
+    result.maxUs = samples.back();
+    result.p50Us = samples[(samples.size() - 1) / 2];
+    result.p99Us = samples[static_cast<size_t>((samples.size() - 1) * 0.99)];
+    return add(result);
+}
+
+BenchResult& BenchReport::add(const BenchResult& result) {
+    results.push_back(result);
+    return results.back();
+}
+
+void BenchReport::skip(const std::string& name, const std::string& reason) {
+    skipped.emplace_back(name, reason);
+}
+
+bool BenchReport::selected(const std::string& name) const {
+    return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void BenchReport::printTable(std::ostream& out) const {
+    out << "\n" << std::left << std::setw(40) << "benchmark" << std::right << std::setw(7) << "iters"
+        << std::setw(13) << "mean us" << std::setw(13) << "p50 us" << std::setw(13) << "p99 us"
+        << std::setw(11) << "bytes" << "\n";
+    for (const BenchResult& r : results) {
+        out << std::left << std::setw(40) << r.name << std::right << std::setw(7) << r.iterations
+            << std::fixed << std::setprecision(1)
+            << std::setw(13) << r.meanUs << std::setw(13) << r.p50Us << std::setw(13) << r.p99Us
+            << std::setw(11) << r.bytes << (r.ok ? "" : "  FAILED");
+        for (const auto& e : r.extra) {
+            out << "  " << e.first << "=" << std::setprecision(2) << e.second;
+        }
+        out << "\n";
+    }
+    for (const auto& s : skipped) {
+        out << std::left << std::setw(40) << s.first << " skipped: " << s.second << "\n";
+    }
+    out << std::flush;
+}
+
+bool BenchReport::writeJson(const std::string& path, const std::map<std::string, std::string>& run) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not write benchmark results to " << path << std::endl;
+        return false;
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"run\": {";
+    bool first = true;
+    for (const auto& field : run) {
+        out << (first ? "" : ", ") << jsonString(field.first) << ": " << jsonString(field.second);
+        first = false;
+    }
+    out << "},\n  \"results\": [";
+    first = true;
+    for (const BenchResult& r : results) {
+        out << (first ? "\n" : ",\n") << "    {\"name\": " << jsonString(r.name)
+            << ", \"iterations\": " << r.iterations << ", \"ok\": " << (r.ok ? "true" : "false")
+            << ", \"meanUs\": " << r.meanUs << ", \"p50Us\": " << r.p50Us << ", \"p99Us\": " << r.p99Us
+            << ", \"minUs\": " << r.minUs << ", \"maxUs\": " << r.maxUs << ", \"bytes\": " << r.bytes;
+        for (const auto& e : r.extra) {
+            out << ", " << jsonString(e.first) << ": " << e.second;
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n  ],\n  \"skipped\": [";
+    first = true;
+    for (const auto& s : skipped) {
+        out << (first ? "" : ", ") << "{\"name\": " << jsonString(s.first) << ", \"reason\": " << jsonString(s.second) << "}";
+        first = false;
+    }
+    out << "]\n}\n";
+    if (!out.good()) {
+        std::cerr << "Error: Failed writing benchmark results to " << path << std::endl;
+        return false;
+    }
+    std::cout << "Benchmark results written to " << path << std::endl;
+    return true;
+}
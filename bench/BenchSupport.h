@@ -0,0 +1,86 @@
+#ifndef BENCHSUPPORT_H
+#define BENCHSUPPORT_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <streambuf>
+#include <iostream>
+
+#include "config_manager/ConfigManager.h"
+#include "models/Patient.h"
+#include "models/Study.h"
+
+// Redirects std::cout/std::cerr into a null buffer while timing so per-document logging
+// does not dominate the measurement.
+class QuietScope {
+public:
+    QuietScope() : coutBuf(std::cout.rdbuf(nullptr)), cerrBuf(std::cerr.rdbuf(nullptr)) {}
+    ~QuietScope() {
+        std::cout.rdbuf(coutBuf);
+        std::cerr.rdbuf(cerrBuf);
+    }
+private:
+    std::streambuf* coutBuf;
+    std::streambuf* cerrBuf;
+};
+
+struct BenchResult {
+    std::string name;       // "<group>/<case>", e.g. "validate/sax2/p1000"
+    int iterations = 0;
+    double meanUs = 0.0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double minUs = 0.0;
+    double maxUs = 0.0;
+    size_t bytes = 0;       // Payload size per iteration, if meaningful
+    bool ok = true;         // False if any iteration failed (e.g. a document did not validate)
+    std::map<std::string, double> extra; // Additional figures (rows fetched, RSS growth, ...)
+};
+
+// Collects results and writes them as a table and as JSON for comparing runs over time
+class BenchReport {
+public:
+    // Runs `body` `iterations` times (after `warmup` untimed runs) with logging silenced.
+    // `body` returns false to mark the result as failed.
+    BenchResult& measure(const std::string& name, int iterations, const std::function<bool()>& body, int warmup = 1);
+    BenchResult& add(const BenchResult& result);
+    void skip(const std::string& name, const std::string& reason);
+
+    bool selected(const std::string& name) const; // Matches the --filter substring
+    void setFilter(const std::string& substring) { filter = substring; }
+
+    void printTable(std::ostream& out) const;
+    bool writeJson(const std::string& path, const std::map<std::string, std::string>& run) const;
+
+private:
+    std::vector<BenchResult> results;
+    std::vector<std::pair<std::string, std::string>> skipped;
+    std::string filter;
+};
+
+// Shared inputs for all benchmark groups
+struct BenchContext {
+    std::string configFilePath;
+    std::string dicomPath;   // Optional sample DICOM file for the dicom/* group
+    int iterations = 20;
+    ConfigManager* configManager = nullptr;
+    Patient patient;
+    Study study;
+    BenchReport* report = nullptr;
+};
+
+// Benchmark groups, one per source file
+void runGenerationBenchmarks(BenchContext& context);
+void runValidationBenchmarks(BenchContext& context);
+void runDicomBenchmarks(BenchContext& context);
+void runConfigBenchmarks(BenchContext& context);
+void runDatabaseBenchmarks(BenchContext& context);
+void runDataSourceBenchmarks(BenchContext& context);
+void runRecordBenchmarks(BenchContext& context);
+void runMediaBenchmarks(BenchContext& context);
+
+long peakRssKb();
+
+#endif // BENCHSUPPORT_H
@@ -0,0 +1,23 @@
+// config/*: parsing the configuration file and publishing a snapshot from it
+
+#include <memory>
+
+#include "BenchSupport.h"
+#include "config_manager/ConfigManager.h"
+#include "config_manager/ConfigSnapshot.h"
+
+void runConfigBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+    if (report.selected("config/loadConfig")) {
+        report.measure("config/loadConfig", context.iterations, [&] {
+            ConfigManager manager;
+            return manager.loadConfig(context.configFilePath);
+        });
+    }
+    if (report.selected("config/createSnapshot")) {
+        report.measure("config/createSnapshot", context.iterations, [&] {
+            std::shared_ptr<const ConfigSnapshot> snapshot = context.configManager->createSnapshot(2);
+            return snapshot != nullptr;
+        });
+    }
+}
@@ -0,0 +1,172 @@
+// db/*: DatabaseService query and fetch loops against the in-process stub ODBC layer
+// (StubOdbc.cpp), so the cost measured is statement handling and row conversion, not
+// the network or the server.
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "BenchSupport.h"
+#include "StubOdbc.h"
+#include "db_connector/DatabaseService.h"
+#include "data_source/InMemoryPatientStudySource.h"
+#include "data_source/LatencyInjectingSource.h"
+#include "data_source/PatientStudySnapshot.h"
+
+void runDatabaseBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+
+    DatabaseService db;
+    {
+        QuietScope quiet;
+        db.connect("stub", "", "");
+    }
+
+    const size_t rowCounts[] = {1, 100, 10000};
+    for (size_t rows : rowCounts) {
+        stubOdbcConfigure(rows, 0);
+        std::string suffix = "/rows" + std::to_string(rows);
+
+        if (report.selected("db/getAllPatients" + suffix)) {
+            unsigned long before = stubOdbcRowsFetched();
+            BenchResult& result = report.measure("db/getAllPatients" + suffix, context.iterations, [&] {
+                return db.getAllPatients().size() == rows;
+            });
+            result.extra["rowsPerIteration"] = static_cast<double>(stubOdbcRowsFetched() - before) / (result.iterations + 1);
+        }
+        if (report.selected("db/searchPatients" + suffix)) {
+            report.measure("db/searchPatients" + suffix, context.iterations, [&] {
+                return db.searchPatients("Kowalski").size() == rows;
+            });
+        }
+        if (report.selected("db/getStudiesForPatient" + suffix)) {
+            report.measure("db/getStudiesForPatient" + suffix, context.iterations, [&] {
+                return db.getStudiesForPatient(context.patient.patientID).size() == rows;
+            });
+        }
+    }
+
+    stubOdbcConfigure(1, 0);
+    if (report.selected("db/getPatientById")) {
+        report.measure("db/getPatientById", context.iterations, [&] {
+            return !db.getPatientById(context.patient.patientID).patientID.empty();
+        });
+    }
+    if (report.selected("db/getStudyByUid")) {
+        report.measure("db/getStudyByUid", context.iterations, [&] {
+            return !db.getStudyByUid(context.study.studyInstanceUID).studyInstanceUID.empty();
+        });
+    }
+
+    QuietScope quiet;
+    db.disconnect();
+}
+
+// source/*: the in-memory PatientStudySource (what generation benchmarks and profiling
+// runs read from instead of a database), snapshot loading, and the latency decorator's
+// accuracy against its configured delay.
+void runDataSourceBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+
+    const size_t patientCount = 10000;
+    const size_t studiesPerPatient = 4;
+    std::vector<Patient> patients;
+    std::vector<Study> studies;
+    for (size_t i = 0; i < patientCount; ++i) {
+        Patient p = context.patient;
+        p.patientID = "P" + std::to_string(i);
+        p.name = "Pacjent " + std::to_string(i) + " Wiśniewski";
+        for (size_t j = 0; j < studiesPerPatient; ++j) {
+            Study s = context.study;
+            s.studyInstanceUID = "2.25." + std::to_string(i * studiesPerPatient + j);
+            s.patientId = p.patientID;
+            studies.push_back(s);
+        }
+        patients.push_back(p);
+    }
+    std::shared_ptr<const PatientStudySnapshot> snapshot = PatientStudySnapshot::fromRecords(patients, studies);
+    InMemoryPatientStudySource memory(snapshot);
+    const std::string lastPatient = "P" + std::to_string(patientCount - 1);
+    const std::string lastStudy = "2.25." + std::to_string(patientCount * studiesPerPatient - 1);
+
+    if (report.selected("source/memory/getStudyByUid")) {
+        report.measure("source/memory/getStudyByUid", context.iterations * 100, [&] {
+            return !memory.getStudyByUid(lastStudy).studyInstanceUID.empty();
+        });
+    }
+    if (report.selected("source/memory/getStudiesForPatient")) {
+        report.measure("source/memory/getStudiesForPatient", context.iterations * 100, [&] {
+            return memory.getStudiesForPatient(lastPatient).size() == studiesPerPatient;
+        });
+    }
+    if (report.selected("source/memory/searchPatients/rows10000")) {
+        report.measure("source/memory/searchPatients/rows10000", context.iterations, [&] {
+            return memory.searchPatients("Pacjent 999").size() == 11; // 999 and 9990-9999
+        });
+    }
+
+    const std::string loadCsvName = "source/snapshot/loadCsv/rows50000";
+    const std::string loadBinaryName = "source/snapshot/loadBinary/rows50000";
+    if (report.selected(loadCsvName) || report.selected(loadBinaryName)) {
+        char directoryTemplate[] = "/tmp/hl7_bench_snapshotXXXXXX";
+        if (!mkdtemp(directoryTemplate)) {
+            report.skip("source/snapshot", "cannot create a temporary directory");
+        } else {
+            const std::string directory = directoryTemplate;
+            {
+                std::ofstream patientsCsv(directory + "/Patients.csv");
+                patientsCsv << "pat_id,pat_name,pat_birth_dt,pat_gender_code\n";
+                for (const Patient& p : patients) {
+                    patientsCsv << p.patientID << ",\"" << p.name << "\"," << p.dateOfBirth << "," << p.sex << "\n";
+                }
+                std::ofstream studiesCsv(directory + "/Studies.csv");
+                studiesCsv << "study_uid,pat_id,acc_num,study_dt,study_tm,mod,study_desc,ref_phys_name\n";
+                for (const Study& s : studies) {
+                    studiesCsv << s.studyInstanceUID << "," << s.patientId << "," << s.accessionNumber << "," << s.studyDate << ","
+                               << s.studyTime << "," << s.modality << ",\"" << s.studyDescription << "\",\"" << s.referringPhysicianName << "\"\n";
+                }
+            }
+            const std::string cachePath = directory + "/snapshot.bin";
+            if (report.selected(loadCsvName)) {
+                report.measure(loadCsvName, context.iterations, [&] {
+                    std::remove(cachePath.c_str()); // Force the CSV path
+                    std::shared_ptr<const PatientStudySnapshot> loaded = PatientStudySnapshot::load(directory);
+                    return loaded && loaded->studyCount() == studies.size();
+                });
+            } else {
+                QuietScope quiet;
+                PatientStudySnapshot::load(directory); // Writes snapshot.bin
+            }
+            if (report.selected(loadBinaryName)) {
+                report.measure(loadBinaryName, context.iterations, [&] {
+                    std::shared_ptr<const PatientStudySnapshot> loaded = PatientStudySnapshot::load(directory); // Uses snapshot.bin
+                    return loaded && loaded->studyCount() == studies.size();
+                });
+            }
+            std::remove(cachePath.c_str());
+            std::remove((directory + "/Patients.csv").c_str());
+            std::remove((directory + "/Studies.csv").c_str());
+            rmdir(directory.c_str());
+        }
+    }
+
+    // The decorator should add the configured delay and little else
+    const int delaysUs[] = {100, 1000};
+    for (int delayUs : delaysUs) {
+        std::string name = "source/latency/getStudyByUid/base" + std::to_string(delayUs) + "us";
+        if (!report.selected(name)) {
+            continue;
+        }
+        LatencyOptions latency;
+        latency.baseUs = delayUs;
+        LatencyInjectingSource slow(std::unique_ptr<PatientStudySource>(new InMemoryPatientStudySource(snapshot)), latency);
+        BenchResult& result = report.measure(name, context.iterations, [&] {
+            return !slow.getStudyByUid(lastStudy).studyInstanceUID.empty();
+        });
+        result.extra["overheadUs"] = result.meanUs - delayUs;
+    }
+}
@@ -0,0 +1,46 @@
+// dicom/*: loading a DICOM file and extracting the patient and study header fields
+
+#include <string>
+
+#include "BenchSupport.h"
+#include "dicom_parser/DicomParser.h"
+
+void runDicomBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+    if (context.dicomPath.empty()) {
+        report.skip("dicom/*", "no --dicom FILE given");
+        return;
+    }
+
+    if (report.selected("dicom/loadFile")) {
+        report.measure("dicom/loadFile", context.iterations, [&] {
+            DicomParser parser;
+            return parser.loadFile(context.dicomPath);
+        });
+    }
+    if (report.selected("dicom/loadFile+headers")) {
+        report.measure("dicom/loadFile+headers", context.iterations, [&] {
+            DicomParser parser;
+            if (!parser.loadFile(context.dicomPath)) {
+                return false;
+            }
+            Patient patient = parser.getPatientInfo();
+            Study study = parser.getStudyInfo();
+            return !patient.patientID.empty() || !study.studyInstanceUID.empty();
+        });
+    }
+
+    DicomParser parser;
+    bool loaded;
+    {
+        QuietScope quiet;
+        loaded = parser.loadFile(context.dicomPath);
+    }
+    if (loaded && report.selected("dicom/headers")) {
+        report.measure("dicom/headers", context.iterations, [&] {
+            Patient patient = parser.getPatientInfo();
+            Study study = parser.getStudyInfo();
+            return !patient.patientID.empty() || !study.studyInstanceUID.empty();
+        });
+    }
+}
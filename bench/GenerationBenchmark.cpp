@@ -0,0 +1,100 @@
+// generate/*: building the CDA document, on its own and fused with validation, and
+// with streamed series/instance entries for large dynamic studies
+
+#include <string>
+
+#include "BenchSupport.h"
+#include "hl7_generator/HL7MessageGenerator.h"
+#include "config_manager/ConfigSnapshot.h"
+
+namespace {
+
+// A dynamic NM study: one series of `instances` single-frame images, made up on the fly
+class DynamicStudyReader : public StudyContentReader {
+public:
+    explicit DynamicStudyReader(size_t instanceCount) : instances(instanceCount) {}
+    void rewind() { seriesDone = false; next = 0; }
+
+    bool nextSeries(Series& series) override {
+        if (seriesDone) return false;
+        seriesDone = true;
+        series.seriesInstanceUID = "1.2.826.0.1.3680043.9.7.1";
+        series.modality = "NM";
+        series.seriesDate = "20240501";
+        series.seriesTime = "101500";
+        return true;
+    }
+    bool nextInstance(Instance& instance) override {
+        if (next >= instances) return false;
+        ++next;
+        instance.sopInstanceUID = "1.2.826.0.1.3680043.9.7.1." + std::to_string(next);
+        instance.sopClassUID = "1.2.840.10008.5.1.4.1.1.20";
+        instance.contentDate = "20240501";
+        instance.contentTime = "101500";
+        return true;
+    }
+
+private:
+    size_t instances;
+    bool seriesDone = false;
+    size_t next = 0;
+};
+
+} // namespace
+
+void runGenerationBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+    ConfigStore configStore(context.configManager->createSnapshot(1));
+    HL7MessageGenerator generator(configStore);
+
+    std::string message;
+    if (report.selected("generate/generateORUMessage")) {
+        BenchResult& result = report.measure("generate/generateORUMessage", context.iterations, [&] {
+            message = generator.generateORUMessage(context.patient, context.study);
+            return !message.empty();
+        });
+        result.bytes = message.size();
+    }
+
+    // Time per entry should stay flat as the study grows, and memory beyond the output text constant
+    const size_t instanceCounts[] = {1000, 10000, 50000};
+    for (size_t instances : instanceCounts) {
+        std::string name = "generate/entries/instances" + std::to_string(instances);
+        if (!report.selected(name)) {
+            continue;
+        }
+        DynamicStudyReader reader(instances);
+        long rssBefore = peakRssKb();
+        BenchResult& result = report.measure(name, context.iterations, [&] {
+            reader.rewind();
+            message = generator.generateORUMessage(context.patient, context.study, &reader);
+            return message.find("</entry>") != std::string::npos;
+        });
+        result.bytes = message.size();
+        result.extra["usPerEntry"] = result.meanUs / instances;
+        result.extra["peakRssGrowthKb"] = static_cast<double>(peakRssKb() - rssBefore);
+    }
+
+    if (context.configManager->getConfig().cdaXsdPath.empty()) {
+        report.skip("generate/separate-validate", "<CdaXsdPath> is not configured");
+        report.skip("generate/generateAndValidate", "<CdaXsdPath> is not configured");
+        return;
+    }
+    // Serialize then re-parse for validation vs validating while serializing (warm grammar)
+    if (report.selected("generate/separate-validate")) {
+        report.measure("generate/separate-validate", context.iterations, [&] {
+            message = generator.generateORUMessage(context.patient, context.study);
+            return generator.validateMessageWithXSD(message, XSDValidationMode::Sax2);
+        });
+    }
+    if (report.selected("generate/generateAndValidate")) {
+        BenchResult& result = report.measure("generate/generateAndValidate", context.iterations, [&] {
+            return generator.generateAndValidate(context.patient, context.study, message);
+        });
+        result.bytes = message.size();
+    }
+    {
+        QuietScope quiet;
+        generator.finishValidation(); // Before the caller terminates Xerces
+    }
+}
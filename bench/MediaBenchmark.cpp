@@ -0,0 +1,167 @@
+// media/*: the key-image pipeline behind observationMedia. Base64 is measured per kernel
+// on an 8 MiB buffer (the size of a full-resolution multi-frame export) and checked
+// against the scalar output; the PNG and key-image cases use a synthetic 16-bit NM frame.
+// media/counts/* sums that frame per count kernel (checked against the scalar sums) and
+// times the count analysis of a 16-frame 1024x1024 study with four regions.
+// media/tac/* computes the time-activity curves of a 180-frame 128x128 renogram.
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BenchSupport.h"
+#include "hl7_generator/Base64.h"
+#include "imaging/CountAnalysis.h"
+#include "imaging/TimeActivity.h"
+#include "imaging/PngEncoder.h"
+
+namespace {
+
+// A hot spot over a noisy background, like a planar scintigraphy frame
+ImageFrame makeFrame(std::uint32_t size) {
+    ImageFrame frame;
+    frame.width = frame.height = size;
+    frame.samples.resize(static_cast<size_t>(size) * size);
+    std::uint32_t noise = 12345;
+    for (std::uint32_t y = 0; y < size; ++y) {
+        for (std::uint32_t x = 0; x < size; ++x) {
+            double dx = x - size * 0.4;
+            double dy = y - size * 0.6;
+            noise = noise * 1103515245u + 12345u;
+            frame.samples[static_cast<size_t>(y) * size + x] =
+                static_cast<std::int32_t>(30 + 1500 * std::exp(-(dx * dx + dy * dy) / (0.01 * size * size)) + (noise >> 27));
+        }
+    }
+    return frame;
+}
+
+} // namespace
+
+void runMediaBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+
+    std::vector<unsigned char> payload(8 << 20);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<unsigned char>((i * 2654435761u) >> 13);
+    }
+    std::string expected;
+    appendBase64(expected, payload.data(), payload.size(), Base64Kernel::Scalar);
+    std::string encoded;
+    encoded.reserve(expected.size());
+
+    for (Base64Kernel kernel : {Base64Kernel::Scalar, Base64Kernel::Ssse3, Base64Kernel::Avx2}) {
+        std::string name = std::string("media/base64/") + base64KernelName(kernel) + "/8MiB";
+        if (!report.selected(name)) {
+            continue;
+        }
+        if (!base64KernelSupported(kernel)) {
+            report.skip(name, "not supported by this CPU");
+            continue;
+        }
+        BenchResult& result = report.measure(name, context.iterations, [&] {
+            encoded.clear();
+            appendBase64(encoded, payload.data(), payload.size(), kernel);
+            return encoded.size() == expected.size();
+        });
+        result.ok = result.ok && encoded == expected;
+        result.bytes = payload.size();
+        result.extra["MBps"] = result.meanUs > 0 ? payload.size() / result.meanUs : 0.0;
+        result.extra["selected"] = kernel == bestBase64Kernel() ? 1.0 : 0.0;
+    }
+
+    ImageFrame frame = makeFrame(256);
+    RenderedImage rendered;
+    renderFrame(frame, 256, rendered);
+    if (report.selected("media/png/256")) {
+        size_t pngBytes = 0;
+        BenchResult& result = report.measure("media/png/256", context.iterations, [&] {
+            pngBytes = 0;
+            return encodePng(rendered, [&pngBytes](const unsigned char*, size_t size) { pngBytes += size; });
+        });
+        result.bytes = pngBytes;
+    }
+
+    // What StudyEntryWriter does per key image: downscale, window, PNG, base64 into the document
+    ImageFrame large = makeFrame(1024);
+    if (report.selected("media/keyimage/1024to256")) {
+        std::string document;
+        BenchResult& result = report.measure("media/keyimage/1024to256", context.iterations, [&] {
+            document.clear();
+            renderFrame(large, 256, rendered);
+            Base64Encoder base64(document);
+            bool ok = encodePng(rendered, [&base64](const unsigned char* data, size_t size) { base64.write(data, size); });
+            base64.finish();
+            return ok;
+        });
+        result.bytes = document.size();
+    }
+
+    RegionCounts expectedCounts = countFrame(large, CountKernel::Scalar);
+    for (CountKernel kernel : {CountKernel::Scalar, CountKernel::Sse2, CountKernel::Avx2}) {
+        std::string name = std::string("media/counts/") + countKernelName(kernel) + "/1024";
+        if (!report.selected(name)) {
+            continue;
+        }
+        if (!countKernelSupported(kernel)) {
+            report.skip(name, "not supported by this CPU");
+            continue;
+        }
+        RegionCounts counts;
+        BenchResult& result = report.measure(name, context.iterations, [&] {
+            counts = countFrame(large, kernel);
+            return counts.pixels == large.samples.size();
+        });
+        result.ok = result.ok && counts.sum == expectedCounts.sum && counts.max == expectedCounts.max;
+        result.bytes = large.samples.size() * sizeof(std::int32_t);
+        result.extra["MBps"] = result.meanUs > 0 ? result.bytes / result.meanUs : 0.0;
+        result.extra["selected"] = kernel == bestCountKernel() ? 1.0 : 0.0;
+    }
+
+    // A whole study as StudyEntryWriter analyses it: the frame, two kidneys, background, a ratio
+    if (report.selected("media/counts/study/1024x16")) {
+        std::vector<Roi> regions = {
+            Roi::ellipse("Left kidney", 0.55, 0.35, 0.2, 0.3, 1024, 1024),
+            Roi::ellipse("Right kidney", 0.25, 0.35, 0.2, 0.3, 1024, 1024),
+            Roi::rectangle("Background", 0.4, 0.7, 0.2, 0.1, 1024, 1024),
+            Roi::rectangle("Whole field", 0, 0, 1, 1, 1024, 1024),
+        };
+        double ratio = 0;
+        BenchResult& result = report.measure("media/counts/study/1024x16", context.iterations, [&] {
+            std::int64_t left = 0;
+            std::int64_t right = 0;
+            for (int frameIndex = 0; frameIndex < 16; ++frameIndex) {
+                countFrame(large);
+                left += countRegion(large, regions[0]).sum;
+                right += countRegion(large, regions[1]).sum;
+                countRegion(large, regions[2]);
+                countRegion(large, regions[3]);
+            }
+            ratio = right > 0 ? static_cast<double>(left) / right : 0.0;
+            return right > 0;
+        });
+        result.bytes = 16 * large.samples.size() * sizeof(std::int32_t);
+        result.extra["ratio"] = ratio;
+    }
+
+    // Frames are copied from one decoded frame, so this measures the counting and threading
+    if (report.selected("media/tac/128x180")) {
+        ImageFrame renogramFrame = makeFrame(128);
+        std::vector<Roi> regions = {
+            Roi::ellipse("Left kidney", 0.55, 0.35, 0.2, 0.3, 128, 128),
+            Roi::ellipse("Right kidney", 0.25, 0.35, 0.2, 0.3, 128, 128),
+            Roi::rectangle("Background", 0.4, 0.7, 0.2, 0.1, 128, 128),
+        };
+        FrameLoaderFactory openLoader = [&renogramFrame](unsigned) -> FrameLoader {
+            return [&renogramFrame](size_t, ImageFrame& frame) {
+                frame = renogramFrame;
+                return true;
+            };
+        };
+        std::vector<TimeActivityCurve> curves;
+        BenchResult& result = report.measure("media/tac/128x180", context.iterations, [&] {
+            return computeTimeActivityCurves(openLoader, 180, regions, 0, curves);
+        });
+        result.bytes = 180 * renogramFrame.samples.size() * sizeof(std::int32_t);
+    }
+}
@@ -0,0 +1,149 @@
+// records/*: memory and conversion cost of CompactRecordBatch against plain Patient/Study
+// structs, on fully populated synthetic rows shaped like the production tables (64-bit
+// random 2.25 UIDs, four studies per patient, physicians and descriptions from small pools).
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <malloc.h>
+
+#include "BenchSupport.h"
+#include "models/CompactRecords.h"
+
+namespace {
+
+// Bytes in use on the malloc heap, or -1 where that cannot be read
+long long heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return static_cast<long long>(info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+class Lcg {
+public:
+    explicit Lcg(std::uint64_t seed) : state(seed) {}
+    std::uint64_t next() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return state >> 11;
+    }
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+    std::string digits(size_t count) {
+        std::string text;
+        for (size_t i = 0; i < count; ++i) text += static_cast<char>('0' + below(10));
+        return text;
+    }
+private:
+    std::uint64_t state;
+};
+
+void makeRows(size_t patientCount, size_t studiesPerPatient, std::vector<Patient>& patients, std::vector<Study>& studies) {
+    static const char* givenNames[] = {"Anna", "Maria", "Katarzyna", "Małgorzata", "Agnieszka", "Piotr", "Krzysztof", "Andrzej", "Tomasz", "Paweł"};
+    static const char* surnames[] = {"Nowak", "Kowalski", "Wiśniewski", "Wójcik", "Kowalczyk", "Kamiński", "Lewandowski", "Zieliński", "Szymański", "Woźniak", "Dąbrowski", "Kozłowski"};
+    static const char* cities[] = {"Warszawa", "Kraków", "Łódź", "Wrocław", "Poznań", "Gdańsk", "Szczecin", "Bydgoszcz", "Lublin", "Białystok"};
+    static const char* states[] = {"mazowieckie", "małopolskie", "łódzkie", "dolnośląskie", "wielkopolskie", "pomorskie", "zachodniopomorskie", "lubelskie"};
+    static const char* modalities[] = {"NM", "NM", "NM", "PT", "CT", "MR"};
+    static const char* descriptions[] = {"Scyntygrafia kości całego ciała", "Scyntygrafia perfuzyjna mięśnia sercowego SPECT",
+                                         "Scyntygrafia tarczycy", "Scyntygrafia dynamiczna nerek", "Scyntygrafia płuc perfuzyjna",
+                                         "Scyntygrafia przytarczyc", "PET/CT FDG całego ciała", "Limfoscyntygrafia"};
+    Lcg rng(20240501);
+    for (size_t i = 0; i < patientCount; ++i) {
+        Patient p;
+        p.patientID = "PAT" + std::to_string(1000000 + i);
+        p.name = std::string(givenNames[rng.below(10)]) + " " + surnames[rng.below(12)];
+        p.dateOfBirth = std::to_string(1930 + rng.below(90)) + "0" + std::to_string(1 + rng.below(9)) + std::to_string(10 + rng.below(18));
+        p.sex = rng.below(2) ? "F" : "M";
+        p.addressStreet = "ul. " + std::string(surnames[rng.below(12)]) + "a " + std::to_string(1 + rng.below(120)) + "/" + std::to_string(1 + rng.below(40));
+        p.addressCity = cities[rng.below(10)];
+        p.addressState = states[rng.below(8)];
+        p.addressZip = rng.digits(2) + "-" + rng.digits(3);
+        p.addressCountry = "PL";
+        p.phoneNumber = "+48 " + rng.digits(3) + " " + rng.digits(3) + " " + rng.digits(3);
+        for (size_t j = 0; j < studiesPerPatient; ++j) {
+            Study s;
+            s.studyInstanceUID = "2.25." + std::to_string(1 + rng.below(9)) + rng.digits(37);
+            s.patientId = p.patientID;
+            s.accessionNumber = "ACC" + rng.digits(9);
+            s.studyDate = std::to_string(2015 + rng.below(11)) + "0" + std::to_string(1 + rng.below(9)) + std::to_string(10 + rng.below(18));
+            s.studyTime = std::to_string(10 + rng.below(9)) + rng.digits(4);
+            s.modality = modalities[rng.below(6)];
+            s.studyDescription = descriptions[rng.below(8)];
+            s.referringPhysicianName = "lek. " + std::string(givenNames[rng.below(10)]) + " " + surnames[rng.below(12)] + "-" + surnames[rng.below(12)];
+            s.performingPhysicianName = "dr n. med. " + std::string(givenNames[rng.below(10)]) + " " + surnames[rng.below(12)];
+            studies.push_back(s);
+        }
+        patients.push_back(p);
+    }
+}
+
+} // namespace
+
+void runRecordBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+
+    const size_t patientCount = 25000;
+    const size_t studiesPerPatient = 4;
+    const std::string memoryName = "records/memory/studies" + std::to_string(patientCount * studiesPerPatient);
+    const bool wantMemory = report.selected(memoryName);
+    if (!wantMemory && !report.selected("records/toStudy") && !report.selected("records/add/studies10000")) {
+        return;
+    }
+
+    // Heap growth of each representation, so allocator block overhead is counted too
+    std::vector<Patient> patients;
+    std::vector<Study> studies;
+    long long before = heapInUse();
+    patients.reserve(patientCount);
+    studies.reserve(patientCount * studiesPerPatient);
+    makeRows(patientCount, studiesPerPatient, patients, studies);
+    long long structBytes = heapInUse() - before;
+
+    CompactRecordBatch batch;
+    before = heapInUse();
+    batch.reserve(patients.size(), studies.size());
+    for (const Patient& p : patients) batch.add(p);
+    for (const Study& s : studies) batch.add(s);
+    batch.shrinkToFit();
+    long long compactBytes = heapInUse() - before;
+
+    if (wantMemory) {
+        if (before < 0) {
+            report.skip(memoryName, "heap statistics need glibc 2.33 or later");
+        } else {
+            BenchResult result;
+            result.name = memoryName;
+            result.iterations = 1;
+            bool roundTrips = true;
+            for (size_t i = 0; i < studies.size() && roundTrips; i += 97) {
+                Study s = batch.toStudy(batch.studies()[i]);
+                roundTrips = s.studyInstanceUID == studies[i].studyInstanceUID && s.studyDate == studies[i].studyDate &&
+                             s.studyTime == studies[i].studyTime && s.referringPhysicianName == studies[i].referringPhysicianName;
+            }
+            double studyCount = static_cast<double>(studies.size());
+            result.extra["structBytesPerStudy"] = structBytes / studyCount;
+            result.extra["compactBytesPerStudy"] = compactBytes / studyCount;
+            result.extra["compactAccountedBytesPerStudy"] = batch.memoryBytes() / studyCount;
+            result.extra["reduction"] = compactBytes > 0 ? static_cast<double>(structBytes) / compactBytes : 0.0;
+            result.ok = roundTrips && result.extra["reduction"] >= 4.0; // The target for the compact layout
+            report.add(result);
+        }
+    }
+
+    if (report.selected("records/toStudy")) {
+        size_t next = 0;
+        report.measure("records/toStudy", context.iterations * 1000, [&] {
+            next = (next + 7919) % studies.size();
+            return !batch.toStudy(batch.studies()[next]).studyInstanceUID.empty();
+        });
+    }
+    if (report.selected("records/add/studies10000")) {
+        report.measure("records/add/studies10000", context.iterations, [&] {
+            CompactRecordBatch fresh;
+            fresh.reserve(0, 10000);
+            for (size_t i = 0; i < 10000; ++i) fresh.add(studies[i]);
+            return fresh.studies().size() == 10000;
+        });
+    }
+}
@@ -0,0 +1,163 @@
+#include "StubOdbc.h"
+#include <sql.h>
+#include <sqlext.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+size_t rowsPerQuery = 100;
+unsigned executeLatencyMicros = 0;
+std::atomic<unsigned long> rowsFetched(0);
+
+const int MAX_COLUMNS = 16;
+
+struct StubColumn {
+    SQLSMALLINT targetType = 0;
+    SQLPOINTER target = nullptr;
+    SQLLEN bufferLength = 0;
+    SQLLEN* indicator = nullptr;
+};
+
+struct StubHandle {
+    SQLSMALLINT type;
+    StubColumn columns[MAX_COLUMNS + 1];
+    size_t rowsLeft = 0;
+    size_t row = 0;
+};
+
+void simulateRoundTrip() {
+    if (executeLatencyMicros > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(executeLatencyMicros));
+    }
+}
+
+// Deterministic, plausible values: short buffers get dates / codes, long ones names and IDs
+void fillColumn(const StubColumn& column, SQLUSMALLINT number, size_t row) {
+    if (!column.target || column.targetType != SQL_C_CHAR || column.bufferLength <= 0) {
+        return;
+    }
+    char value[128];
+    if (column.bufferLength <= 2) {
+        std::snprintf(value, sizeof(value), "%c", row % 2 ? 'F' : 'M');
+    } else if (column.bufferLength <= 16) {
+        std::snprintf(value, sizeof(value), "2024%02zu%02zu", row % 12 + 1, row % 28 + 1);
+    } else if (number == 1) {
+        std::snprintf(value, sizeof(value), "1.2.826.0.1.3680043.10.543.%zu", row + 1);
+    } else {
+        std::snprintf(value, sizeof(value), "Value%u Row%zu Kowalski", number, row + 1);
+    }
+    size_t length = std::strlen(value);
+    size_t capacity = static_cast<size_t>(column.bufferLength) - 1;
+    if (length > capacity) length = capacity;
+    std::memcpy(column.target, value, length);
+    static_cast<char*>(column.target)[length] = '\0';
+    if (column.indicator) *column.indicator = static_cast<SQLLEN>(length);
+}
+
+SQLRETURN startResultSet(SQLHSTMT statement) {
+    if (!statement) return SQL_INVALID_HANDLE;
+    StubHandle* handle = static_cast<StubHandle*>(statement);
+    simulateRoundTrip();
+    handle->rowsLeft = rowsPerQuery;
+    handle->row = 0;
+    return SQL_SUCCESS;
+}
+
+} // namespace
+
+void stubOdbcConfigure(size_t rows, unsigned latencyMicros) {
+    rowsPerQuery = rows;
+    executeLatencyMicros = latencyMicros;
+}
+
+unsigned long stubOdbcRowsFetched() {
+    return rowsFetched.load(std::memory_order_relaxed);
+}
+
+extern "C" {
+
+SQLRETURN SQL_API SQLAllocHandle(SQLSMALLINT HandleType, SQLHANDLE, SQLHANDLE* OutputHandle) {
+    StubHandle* handle = new StubHandle();
+    handle->type = HandleType;
+    *OutputHandle = handle;
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLFreeHandle(SQLSMALLINT, SQLHANDLE Handle) {
+    delete static_cast<StubHandle*>(Handle);
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLSetEnvAttr(SQLHENV, SQLINTEGER, SQLPOINTER, SQLINTEGER) {
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLDriverConnect(SQLHDBC, SQLHWND, SQLCHAR*, SQLSMALLINT, SQLCHAR*, SQLSMALLINT, SQLSMALLINT*, SQLUSMALLINT) {
+    simulateRoundTrip();
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLDisconnect(SQLHDBC) {
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLFreeStmt(SQLHSTMT StatementHandle, SQLUSMALLINT) {
+    if (StatementHandle) static_cast<StubHandle*>(StatementHandle)->rowsLeft = 0;
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLPrepare(SQLHSTMT, SQLCHAR*, SQLINTEGER) {
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLBindParameter(SQLHSTMT, SQLUSMALLINT, SQLSMALLINT, SQLSMALLINT, SQLSMALLINT, SQLULEN, SQLSMALLINT, SQLPOINTER, SQLLEN, SQLLEN*) {
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLExecute(SQLHSTMT StatementHandle) {
+    return startResultSet(StatementHandle);
+}
+
+SQLRETURN SQL_API SQLExecDirect(SQLHSTMT StatementHandle, SQLCHAR*, SQLINTEGER) {
+    return startResultSet(StatementHandle);
+}
+
+SQLRETURN SQL_API SQLBindCol(SQLHSTMT StatementHandle, SQLUSMALLINT ColumnNumber, SQLSMALLINT TargetType,
+                             SQLPOINTER TargetValue, SQLLEN BufferLength, SQLLEN* StrLen_or_Ind) {
+    if (!StatementHandle || ColumnNumber < 1 || ColumnNumber > MAX_COLUMNS) return SQL_ERROR;
+    StubColumn& column = static_cast<StubHandle*>(StatementHandle)->columns[ColumnNumber];
+    column.targetType = TargetType;
+    column.target = TargetValue;
+    column.bufferLength = BufferLength;
+    column.indicator = StrLen_or_Ind;
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLFetch(SQLHSTMT StatementHandle) {
+    StubHandle* handle = static_cast<StubHandle*>(StatementHandle);
+    if (!handle) return SQL_INVALID_HANDLE;
+    if (handle->rowsLeft == 0) return SQL_NO_DATA;
+    for (SQLUSMALLINT number = 1; number <= MAX_COLUMNS; ++number) {
+        fillColumn(handle->columns[number], number, handle->row);
+    }
+    --handle->rowsLeft;
+    ++handle->row;
+    rowsFetched.fetch_add(1, std::memory_order_relaxed);
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLGetDiagField(SQLSMALLINT, SQLHANDLE, SQLSMALLINT, SQLSMALLINT, SQLPOINTER DiagInfo, SQLSMALLINT, SQLSMALLINT*) {
+    if (DiagInfo) *static_cast<SQLLEN*>(DiagInfo) = 0;
+    return SQL_SUCCESS;
+}
+
+SQLRETURN SQL_API SQLGetDiagRec(SQLSMALLINT, SQLHANDLE, SQLSMALLINT, SQLCHAR*, SQLINTEGER*, SQLCHAR*, SQLSMALLINT, SQLSMALLINT*) {
+    return SQL_NO_DATA;
+}
+
+} // extern "C"
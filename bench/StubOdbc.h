@@ -0,0 +1,15 @@
+#ifndef STUBODBC_H
+#define STUBODBC_H
+
+#include <cstddef>
+
+// hl7_bench links this in-process stand-in for the ODBC driver manager: its SQL*
+// definitions take precedence over libodbc's, so DatabaseService runs unchanged
+// against synthetic result sets and the fetch loops can be timed without a server.
+//
+// Every query returns `rowsPerQuery` rows (single-row lookups stop after the first
+// fetch); `executeLatencyMicros` simulates a network round trip per execute.
+void stubOdbcConfigure(size_t rowsPerQuery, unsigned executeLatencyMicros);
+unsigned long stubOdbcRowsFetched();
+
+#endif // STUBODBC_H
@@ -0,0 +1,116 @@
+// validate/*: DOM vs SAX2 XSD validation of generated CDA reports of varying size, a cold
+// grammar (compiled from the XSD files or loaded from the grammar cache) vs a warm one,
+// and the fast structural check vs full XSD validation of an already built tree.
+// Reports are inflated with extra narrative paragraphs to simulate large studies.
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "BenchSupport.h"
+#include "hl7_generator/HL7MessageGenerator.h"
+#include "config_manager/ConfigSnapshot.h"
+#include "xsd_validator/FastCdaChecker.h"
+#include "xsd_validator/XSDValidator.h"
+#include "pugixml.hpp"
+
+namespace {
+
+// Appends `paragraphs` narrative paragraphs to the report section
+std::string inflateReport(const std::string& message, size_t paragraphs) {
+    pugi::xml_document doc;
+    if (!doc.load_string(message.c_str())) {
+        return message;
+    }
+    pugi::xml_node textNode = doc.child("ClinicalDocument").child("component")
+                                 .child("structuredBody").child("component")
+                                 .child("section").child("text");
+    for (size_t i = 0; i < paragraphs; ++i) {
+        std::string line = "Frame " + std::to_string(i) + ": uniform tracer distribution, no focal uptake.";
+        textNode.append_child("paragraph").text().set(line.c_str());
+    }
+    std::stringstream ss;
+    doc.save(ss, "  ", pugi::format_default, pugi::encoding_utf8);
+    return ss.str();
+}
+
+} // namespace
+
+void runValidationBenchmarks(BenchContext& context) {
+    BenchReport& report = *context.report;
+    const AppConfig& config = context.configManager->getConfig();
+    if (config.cdaXsdPath.empty()) {
+        report.skip("validate/*", "<CdaXsdPath> is not configured");
+        return;
+    }
+
+    ConfigStore configStore(context.configManager->createSnapshot(1));
+    HL7MessageGenerator generator(configStore);
+    std::string baseMessage;
+    {
+        QuietScope quiet;
+        baseMessage = generator.generateORUMessage(context.patient, context.study);
+    }
+
+    const std::vector<size_t> paragraphCounts = {0, 100, 1000, 10000};
+    for (size_t paragraphs : paragraphCounts) {
+        std::string message = inflateReport(baseMessage, paragraphs);
+        const struct {
+            const char* label;
+            XSDValidationMode mode;
+        } modes[] = {{"sax2", XSDValidationMode::Sax2}, {"dom", XSDValidationMode::Dom}};
+        for (const auto& mode : modes) {
+            std::string name = std::string("validate/") + mode.label + "/p" + std::to_string(paragraphs);
+            if (!report.selected(name)) continue;
+            long rssBefore = peakRssKb();
+            BenchResult& result = report.measure(name, context.iterations, [&] {
+                return generator.validateMessageWithXSD(message, mode.mode);
+            });
+            result.bytes = message.size();
+            result.extra["peakRssGrowthKb"] = static_cast<double>(peakRssKb() - rssBefore);
+        }
+    }
+
+    // Cold grammar: what the first document of a process pays. Few iterations, each slow.
+    int coldIterations = std::max(1, std::min(context.iterations, 5));
+    pugi::xml_document doc;
+    doc.load_string(baseMessage.c_str());
+    if (report.selected("validate/grammar-cold-compile")) {
+        report.measure("validate/grammar-cold-compile", coldIterations, [&] {
+            XSDValidator validator(config.cdaXsdPath);
+            std::string serialized;
+            return validator.validate(doc, serialized);
+        }, 0);
+    }
+    if (!config.grammarCachePath.empty() && report.selected("validate/grammar-cold-cache")) {
+        {
+            QuietScope quiet;
+            XSDValidator primer(config.cdaXsdPath, config.grammarCachePath); // Make sure the cache file exists
+        }
+        report.measure("validate/grammar-cold-cache", coldIterations, [&] {
+            XSDValidator validator(config.cdaXsdPath, config.grammarCachePath);
+            std::string serialized;
+            return validator.validate(doc, serialized);
+        }, 0);
+    }
+
+    // Warm grammar: one long-lived validator, as in the application
+    XSDValidator warmValidator(config.cdaXsdPath, config.grammarCachePath);
+    std::string serialized;
+    if (report.selected("validate/grammar-warm")) {
+        BenchResult& result = report.measure("validate/grammar-warm", context.iterations, [&] {
+            serialized.clear();
+            return warmValidator.validate(doc, serialized);
+        });
+        result.bytes = baseMessage.size();
+    }
+
+    // Tiered validation: the fast structural check on the same tree
+    FastCdaChecker fastChecker;
+    if (report.selected("validate/fast-check")) {
+        report.measure("validate/fast-check", context.iterations, [&] {
+            return fastChecker.check(doc);
+        });
+    }
+}
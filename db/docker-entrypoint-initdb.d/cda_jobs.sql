@@ -0,0 +1,51 @@
+-- Copy of cda_jobs.sql for Docker automatic initialization
+-- Work queue for distributed CDA generation (HL7Generator --worker).
+-- Any number of workers claim pending jobs with FOR UPDATE SKIP LOCKED, so no job is
+-- handed to two workers and no coordinator is needed. A claimed job is leased: if its
+-- worker dies, the lease expires and the next worker to look puts it back to 'pending'.
+-- Safe to run more than once.
+
+CREATE TABLE IF NOT EXISTS cda_jobs (
+    job_id BIGSERIAL PRIMARY KEY,
+    study_uid VARCHAR(255) NOT NULL,
+    status VARCHAR(16) NOT NULL DEFAULT 'pending'
+        CHECK (status IN ('pending', 'running', 'done', 'failed')),
+    priority INT NOT NULL DEFAULT 0,            -- Higher first
+    attempts INT NOT NULL DEFAULT 0,            -- Claims so far
+    max_attempts INT NOT NULL DEFAULT 3,        -- 'failed' once a claim with attempts = max_attempts fails
+    available_at TIMESTAMPTZ NOT NULL DEFAULT now(), -- Not claimed before this (retry backoff)
+    lease_owner VARCHAR(255),                   -- Worker holding the job while 'running'
+    lease_expires_at TIMESTAMPTZ,
+    last_error TEXT,
+    output_path TEXT,
+    created_at TIMESTAMPTZ NOT NULL DEFAULT now(),
+    updated_at TIMESTAMPTZ NOT NULL DEFAULT now(),
+    finished_at TIMESTAMPTZ
+);
+
+-- Claim order; only pending rows are indexed, so the index stays small as jobs finish
+CREATE INDEX IF NOT EXISTS cda_jobs_claim_idx ON cda_jobs (priority DESC, job_id) WHERE status = 'pending';
+-- Expired lease scan
+CREATE INDEX IF NOT EXISTS cda_jobs_lease_idx ON cda_jobs (lease_expires_at) WHERE status = 'running';
+-- At most one open job per study; enqueue with ON CONFLICT DO NOTHING
+CREATE UNIQUE INDEX IF NOT EXISTS cda_jobs_open_study_idx ON cda_jobs (study_uid) WHERE status IN ('pending', 'running');
+
+-- Wakes idle workers (LISTEN cda_jobs) once per enqueuing statement
+CREATE OR REPLACE FUNCTION cda_jobs_notify() RETURNS trigger AS $$
+BEGIN
+    PERFORM pg_notify('cda_jobs', '');
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+DROP TRIGGER IF EXISTS cda_jobs_enqueued ON cda_jobs;
+CREATE TRIGGER cda_jobs_enqueued AFTER INSERT ON cda_jobs
+    FOR EACH STATEMENT EXECUTE FUNCTION cda_jobs_notify();
+
+-- Enqueue examples:
+--   INSERT INTO cda_jobs (study_uid) SELECT study_uid FROM Studies
+--       ON CONFLICT (study_uid) WHERE status IN ('pending', 'running') DO NOTHING;
+--   INSERT INTO cda_jobs (study_uid, priority) VALUES ('S001', 10)
+--       ON CONFLICT (study_uid) WHERE status IN ('pending', 'running') DO NOTHING;
+-- Progress:
+--   SELECT status, count(*) FROM cda_jobs GROUP BY status;
@@ -0,0 +1,309 @@
+#include "BatchRunner.h"
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../hl7_generator/HL7MessageGenerator.h"
+#include "../metrics/Metrics.h"
+#include "../output/AsyncWriter.h"
+#include "../output/DocumentBundle.h"
+#include "../output/OutputIndex.h"
+#include "../output/OutputLayout.h"
+#include "../tracing/Tracer.h"
+
+namespace {
+
+bool fileExists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+// bundles/bundle-<run start>-<pid>-<sequence>; unique across runs, including resumed ones
+std::string bundleRelativePath(const std::string& runStamp, unsigned long sequence, const std::string& extension) {
+    char name[96];
+    std::snprintf(name, sizeof(name), "bundles/bundle-%s-%ld-%06lu", runStamp.c_str(), static_cast<long>(getpid()), sequence);
+    return name + extension;
+}
+
+// A study added to the bundle being filled, journaled once the bundle is durable
+struct BundledStudy {
+    std::string studyUid;
+    std::string entryName;
+    std::string inputHash;
+    bool redoneMissing;
+};
+
+} // namespace
+
+void BatchSummary::print(std::ostream& out) const {
+    out << "--- Batch summary" << (interrupted ? " (interrupted)" : "") << " ---" << std::endl;
+    out << " Studies visited:   " << studies << std::endl;
+    out << " Skipped (done):    " << skipped << std::endl;
+    out << " Unchanged:         " << unchanged << " (same inputs as the indexed document)" << std::endl;
+    out << " Generated:         " << generated << " in " << seconds << " s";
+    if (seconds > 0) {
+        out << " (" << static_cast<double>(generated) / seconds << " docs/s)";
+    }
+    out << std::endl;
+    out << "  of which redone:  " << redoneMissing + redoneUnjournaled << " (" << redoneMissing << " journaled but missing, "
+        << redoneUnjournaled << " written but not journaled before the previous run stopped)" << std::endl;
+    out << " Failed:            " << failed << std::endl;
+    out << " Journal syncs:     " << journalSyncs << std::endl;
+    if (journalFailures > 0) {
+        out << " Journal failures:  " << journalFailures << " (not recorded as done; --resume generates those studies again)" << std::endl;
+    }
+    if (compressionFormat != "" && compressionFormat != "none") {
+        out << " Compression:       " << compressionFormat << ", " << compression.inputBytes / (1024.0 * 1024.0) << " MB -> "
+            << compression.outputBytes / (1024.0 * 1024.0) << " MB (ratio " << compression.ratio() << ", "
+            << compression.megabytesPerSecond() << " MB/s)" << std::endl;
+    }
+    if (bundles > 0) {
+        out << " Bundles written:   " << bundles << std::endl;
+    }
+    if (segments > 0) {
+        out << " Segments written:  " << segments << " (" << storedBytes / (1024.0 * 1024.0) << " MB stored for "
+            << documentBytes / (1024.0 * 1024.0) << " MB of documents)" << std::endl;
+    }
+}
+
+BatchRunner::BatchRunner(const ConfigStore& store, PatientStudySource& source, const BatchOptions& options)
+    : configStore(store), source(source), options(options) {
+}
+
+bool BatchRunner::run(BatchSummary& summary, const std::function<bool()>& shouldStop) {
+    CheckpointJournal journal(options.journalPath, options.journalGroupSize, options.journalSyncIntervalMs);
+    if (!journal.open(options.resume)) {
+        return false;
+    }
+    std::cout << "Batch run: journal " << journal.getPath() << (options.resume ? " (resuming)" : " (new)") << std::endl;
+    OutputIndex index(options.indexPath);
+    if (!index.open()) {
+        return false;
+    }
+    std::unique_ptr<SegmentWriter> segmentWriter;
+    std::unordered_map<std::string, std::string> segmentHashes; // Input hashes of appended, not yet durable records
+    if (options.segments) {
+        SegmentWriterOptions segmentOptions = options.segmentOptions;
+        segmentOptions.groupSize = options.journalGroupSize;
+        segmentOptions.syncIntervalMs = options.journalSyncIntervalMs;
+        const std::string outputDirectory = configStore.current()->config.outputPath;
+        segmentWriter.reset(new SegmentWriter(segmentOptions, [&](const std::string& studyUid, const SegmentLocation& location) {
+            // The record is durable: journal it, and index it relative to the output path when it is below it
+            if (!journal.record(studyUid, location.segmentPath, true)) {
+                ++summary.journalFailures;
+            }
+            std::string segmentPath = location.segmentPath;
+            std::string prefix = OutputLayout::join(outputDirectory, "");
+            if (!outputDirectory.empty() && segmentPath.compare(0, prefix.size(), prefix) == 0) {
+                segmentPath.erase(0, prefix.size());
+            }
+            auto hash = segmentHashes.find(studyUid);
+            index.record(studyUid, segmentPath + "#" + std::to_string(location.offset), hash != segmentHashes.end() ? hash->second : "");
+            if (hash != segmentHashes.end()) {
+                segmentHashes.erase(hash);
+            }
+        }));
+        if (!segmentWriter->open()) {
+            return false;
+        }
+    }
+    // Files are journaled from the writer's completions, on its commit thread
+    std::mutex resultMutex; // Journal and summary counters
+    AsyncWriter writer(options.writerOptions);
+    if (!segmentWriter) {
+        writer.start();
+    }
+
+    // Files sink: compression on this (the generating) thread, optionally into bundles
+    DocumentCompressor compressor(options.compression);
+    if (!segmentWriter && !compressor.open()) {
+        writer.stop();
+        return false;
+    }
+    const bool bundling = !segmentWriter && options.bundleSize > 0;
+    DocumentBundle bundle(compressor);
+    std::vector<BundledStudy> bundled;
+    unsigned long bundleSequence = 0;
+    char runStamp[32];
+    std::time_t startTime = std::time(nullptr);
+    std::strftime(runStamp, sizeof(runStamp), "%Y%m%d-%H%M%S", std::localtime(&startTime));
+    auto submitBundle = [&] {
+        if (bundle.empty()) {
+            return;
+        }
+        const std::string outputDirectory = configStore.current()->config.outputPath;
+        const std::string bundleRelative = bundleRelativePath(runStamp, ++bundleSequence, bundle.extension());
+        const std::string bundlePath = OutputLayout::join(outputDirectory, bundleRelative);
+        auto studies = std::make_shared<std::vector<BundledStudy>>();
+        studies->swap(bundled);
+        auto written = [&, studies, bundleRelative, bundlePath](bool durable) {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            if (!durable) {
+                summary.failed += studies->size();
+                std::cerr << "Batch run: cannot write bundle " << bundlePath << std::endl;
+                return;
+            }
+            ++summary.bundles;
+            for (const BundledStudy& entry : *studies) {
+                ++summary.generated;
+                summary.redoneMissing += entry.redoneMissing ? 1 : 0;
+                if (!journal.record(entry.studyUid, bundlePath, true)) {
+                    ++summary.journalFailures;
+                }
+                index.record(entry.studyUid, bundleRelative + "#" + entry.entryName, entry.inputHash);
+            }
+        };
+        if (!bundle.finish() || !OutputLayout::createParentDirectories(outputDirectory, bundleRelative) ||
+            !writer.submit(bundlePath, std::move(bundle.data()), written)) {
+            written(false);
+        }
+        bundle.clear();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    HL7MessageGenerator generator(configStore);
+
+    std::vector<Patient> patients = source.getAllPatients();
+    std::cout << "Batch run: " << patients.size() << " patients." << std::endl;
+    for (const Patient& patient : patients) {
+        if (summary.interrupted) {
+            break;
+        }
+        for (const Study& study : source.getStudiesForPatient(patient.patientID)) {
+            if (shouldStop()) {
+                summary.interrupted = true;
+                break;
+            }
+            ++summary.studies;
+
+            std::string journaledPath;
+            bool journaled;
+            {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                const std::string* entry = journal.completedOutput(study.studyInstanceUID);
+                journaled = entry != nullptr;
+                if (journaled) {
+                    journaledPath = *entry;
+                }
+            }
+            if (journaled && fileExists(journaledPath)) {
+                ++summary.skipped;
+                continue;
+            }
+
+            std::shared_ptr<const ConfigSnapshot> snapshot = configStore.current();
+            const AppConfig& config = snapshot->config;
+            std::string relativePath = OutputLayout(config.outputScheme, config.outputHashLevels).relativePath(patient, study);
+            const std::string entryName = relativePath;
+            if (!bundling) {
+                relativePath += compressor.extension();
+            }
+            std::string outputPath = OutputLayout::join(config.outputPath, relativePath);
+            bool redoneMissing = journaled;
+            bool redoneUnjournaled = !segmentWriter && !bundling && !journaled && options.resume && fileExists(outputPath);
+
+            HL7_TRACE_SCOPE_DETAIL("batchStudy", study.studyInstanceUID);
+            const std::string outputKey = OutputIndex::outputSettingsKey(config, segmentWriter ? "segments" : bundling ? "bundles" : "files");
+            std::unique_ptr<StudyContentReader> content = source.openStudyContent(study.studyInstanceUID);
+            const std::string inputHash = generator.inputHash(patient, study, content.get(), outputKey);
+            if (!options.force) {
+                std::string indexedPath, indexedHash, documentFile;
+                if (index.lookup(study.studyInstanceUID, indexedPath, &indexedHash) && indexedHash == inputHash &&
+                    !(documentFile = OutputIndex::documentFile(config.outputPath, indexedPath)).empty()) {
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    ++summary.unchanged;
+                    Metrics::instance().documentsUnchanged.add();
+                    if (!journal.record(study.studyInstanceUID, documentFile, true)) {
+                        ++summary.journalFailures;
+                    }
+                    continue;
+                }
+            }
+            std::string document;
+            content = source.openStudyContent(study.studyInstanceUID); // The hash read the first one to the end
+            if (!generator.generateAndValidate(patient, study, document, content.get())) {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                ++summary.failed;
+                std::cerr << "Batch run: study " << study.studyInstanceUID << " failed generation or validation." << std::endl;
+                continue;
+            }
+            if (segmentWriter) {
+                segmentHashes[study.studyInstanceUID] = inputHash;
+                if (!segmentWriter->append(study.studyInstanceUID, generator.lastDocumentId(), document)) {
+                    segmentHashes.erase(study.studyInstanceUID);
+                    ++summary.failed;
+                    std::cerr << "Batch run: cannot append study " << study.studyInstanceUID << " to a segment." << std::endl;
+                    continue;
+                }
+                ++summary.generated;
+                summary.redoneMissing += redoneMissing ? 1 : 0;
+                continue; // Journaled and indexed once durable
+            }
+            if (bundling) {
+                if (!bundle.add(entryName, document)) {
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    ++summary.failed;
+                    continue;
+                }
+                bundled.push_back(BundledStudy{study.studyInstanceUID, entryName, inputHash, redoneMissing});
+                if (bundle.entries() >= options.bundleSize) {
+                    submitBundle();
+                }
+                continue; // Journaled and indexed once its bundle is durable
+            }
+            if (compressor.enabled()) {
+                std::string compressed;
+                if (!compressor.compress(document, compressed)) {
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    ++summary.failed;
+                    continue;
+                }
+                document.swap(compressed);
+            }
+            const std::string studyUid = study.studyInstanceUID;
+            auto written = [&, studyUid, relativePath, outputPath, inputHash, redoneMissing, redoneUnjournaled](bool durable) {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (!durable) {
+                    ++summary.failed;
+                    std::cerr << "Batch run: cannot write " << outputPath << std::endl;
+                    return;
+                }
+                ++summary.generated;
+                summary.redoneMissing += redoneMissing ? 1 : 0;
+                summary.redoneUnjournaled += redoneUnjournaled ? 1 : 0;
+                if (!journal.record(studyUid, outputPath, true)) {
+                    ++summary.journalFailures;
+                }
+                index.record(studyUid, relativePath, inputHash);
+            };
+            if (!OutputLayout::createParentDirectories(config.outputPath, relativePath) ||
+                !writer.submit(outputPath, std::move(document), written)) {
+                written(false);
+            }
+        }
+    }
+    submitBundle(); // The last, partial bundle
+    writer.stop(); // Writes and commits what is queued, journaling it
+    summary.compressionFormat = compressor.formatName();
+    summary.compression = compressor.stats();
+
+    if (segmentWriter) {
+        segmentWriter->close(); // Commits the last group, which journals it
+        summary.segments = segmentWriter->stats().segments;
+        summary.documentBytes = segmentWriter->stats().originalBytes;
+        summary.storedBytes = segmentWriter->stats().storedBytes;
+    }
+    if (!journal.close()) {
+        ++summary.journalFailures; // The last group
+    }
+    index.close();
+    generator.finishValidation();
+    summary.journalSyncs = journal.syncCount();
+    summary.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <string>
+#include <functional>
+#include <ostream>
+#include "CheckpointJournal.h"
+#include "../output/AsyncWriter.h"
+#include "../output/DocumentCompressor.h"
+#include "../output/SegmentWriter.h"
+#include "../config_manager/ConfigSnapshot.h"
+#include "../data_source/PatientStudySource.h"
+
+struct BatchOptions {
+    std::string journalPath;
+    std::string indexPath; // OutputIndex updated with every document
+    bool resume = false;
+    bool force = false;                 // Regenerate studies whose input hash is unchanged
+    size_t journalGroupSize = 64;
+    int journalSyncIntervalMs = 1000;
+    AsyncWriterOptions writerOptions;   // File per document
+    bool segments = false;              // Append to segment files instead of a file per document
+    SegmentWriterOptions segmentOptions; // groupSize and syncIntervalMs follow the journal's
+    CompressionOptions compression;     // Files sink only; segments have their own
+    size_t bundleSize = 0;              // Files sink: documents per DocumentBundle; 0: a file per document
+};
+
+struct BatchSummary {
+    unsigned long studies = 0;            // Visited
+    unsigned long skipped = 0;            // Journaled with their document present
+    unsigned long unchanged = 0;          // Indexed with the same input hash and their document present
+    unsigned long redoneMissing = 0;      // Journaled, but the document was gone
+    unsigned long redoneUnjournaled = 0;  // Document present without a journal entry (lost uncommitted group)
+    unsigned long generated = 0;          // Written this run, including the redone ones
+    unsigned long failed = 0;
+    unsigned long journalSyncs = 0;
+    unsigned long journalFailures = 0;    // Entries or group commits the journal could not write; --resume redoes those studies
+    unsigned long segments = 0;           // Segment files written (segment sink)
+    std::uint64_t documentBytes = 0;
+    std::uint64_t storedBytes = 0;        // In segments, after compression
+    unsigned long bundles = 0;            // Bundle files written (files sink with a bundle size)
+    std::string compressionFormat;        // Files sink, "none" when not compressed
+    CompressionStats compression;
+    double seconds = 0.0;
+    bool interrupted = false;
+
+    void print(std::ostream& out) const;
+};
+
+// Batch mode (--batch): generates a document for every study of every patient in the
+// data source into the output path, journaling each one (CheckpointJournal) so that a
+// run restarted with --resume skips what is done. Documents are placed by the configured
+// OutputLayout and written by an AsyncWriter while the next ones are generated; a study
+// is journaled and recorded in the OutputIndex once its file is durable. Paths are fixed
+// per study, so a redone study overwrites its earlier document. With <Compression>, each
+// document is compressed before it is queued (and gets the format's extension), or,
+// with a bundle size, added to a compressed tar bundle under <outputPath>/bundles that
+// is written once full; its studies are journaled with the bundle and indexed as
+// "bundles/<bundle>#<entry>".
+//
+// Every document is indexed with its input hash (HL7MessageGenerator::inputHash). Unless
+// forced, a study whose hash matches the indexed one, with that document still present,
+// is not rendered, validated or written again, only journaled, so re-running a batch over
+// unchanged data costs a hash per study.
+//
+// With the segment sink, documents are appended to SegmentWriter segments instead, and a
+// study is journaled and indexed ("<segment>#<offset>") only once its record is durable.
+// A redone study gets a new record; the sidecar of its segment points to the newest.
+class BatchRunner {
+public:
+    BatchRunner(const ConfigStore& store, PatientStudySource& source, const BatchOptions& options);
+
+    // Returns false if the journal cannot be used; `shouldStop` is polled between studies
+    bool run(BatchSummary& summary, const std::function<bool()>& shouldStop);
+
+private:
+    const ConfigStore& configStore;
+    PatientStudySource& source;
+    BatchOptions options;
+};
+
+#endif // BATCHRUNNER_H
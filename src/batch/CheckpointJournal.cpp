@@ -0,0 +1,185 @@
+#include "CheckpointJournal.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../tracing/Tracer.h"
+
+namespace {
+
+const char JOURNAL_HEADER[] = "# HL7Generator checkpoint journal v1\n";
+
+bool writeAll(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool syncPath(const std::string& path, int flags) {
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+std::string parentDirectory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+} // namespace
+
+CheckpointJournal::CheckpointJournal(const std::string& path, size_t groupSize, int syncIntervalMs)
+    : path(path), groupSize(groupSize > 0 ? groupSize : 1), syncInterval(syncIntervalMs), fd(-1), syncs(0) {
+}
+
+CheckpointJournal::~CheckpointJournal() {
+    close();
+}
+
+bool CheckpointJournal::open(bool resume) {
+    close();
+    completed.clear();
+    pending.clear();
+
+    if (resume && !load()) {
+        return false;
+    }
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (resume ? 0 : O_TRUNC);
+    fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open checkpoint journal " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (lseek(fd, 0, SEEK_END) == 0 && (!writeAll(fd, JOURNAL_HEADER) || ::fdatasync(fd) != 0)) {
+        std::cerr << "Error: Cannot write checkpoint journal " << path << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    lastCommit = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool CheckpointJournal::load() {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cout << "No checkpoint journal at " << path << ", starting from the beginning." << std::endl;
+        return true;
+    }
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    // Drop a torn last line (crash in the middle of an append)
+    size_t end = contents.find_last_of('\n');
+    size_t keep = end == std::string::npos ? 0 : end + 1;
+    if (keep < contents.size()) {
+        std::cerr << "Warning: Discarding an incomplete last entry in " << path << "." << std::endl;
+        if (::truncate(path.c_str(), static_cast<off_t>(keep)) != 0) {
+            std::cerr << "Error: Cannot truncate " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    size_t start = 0;
+    size_t malformed = 0;
+    while (start < keep) {
+        size_t newline = contents.find('\n', start);
+        std::string line = contents.substr(start, newline - start);
+        start = newline + 1;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos || tab == 0) {
+            ++malformed;
+            continue;
+        }
+        completed[line.substr(0, tab)] = line.substr(tab + 1);
+    }
+    if (malformed > 0) {
+        std::cerr << "Warning: Ignored " << malformed << " malformed lines in " << path << "." << std::endl;
+    }
+    std::cout << "Checkpoint journal " << path << ": " << completed.size() << " studies already completed." << std::endl;
+    return true;
+}
+
+bool CheckpointJournal::close() {
+    bool committed = true;
+    if (fd >= 0) {
+        committed = commit();
+        ::close(fd);
+        fd = -1;
+    }
+    return committed;
+}
+
+const std::string* CheckpointJournal::completedOutput(const std::string& studyUid) const {
+    auto it = completed.find(studyUid);
+    return it == completed.end() ? nullptr : &it->second;
+}
+
+bool CheckpointJournal::record(const std::string& studyUid, const std::string& outputPath, bool durable) {
+    if (studyUid.find_first_of("\t\n") != std::string::npos || outputPath.find_first_of("\t\n") != std::string::npos) {
+        std::cerr << "Warning: Not journaling study " << studyUid << ": tab or newline in the UID or path." << std::endl;
+        return false;
+    }
+    pending.push_back(PendingEntry{studyUid, outputPath, durable});
+    if (pending.size() >= groupSize || std::chrono::steady_clock::now() - lastCommit >= syncInterval) {
+        return commit();
+    }
+    return true;
+}
+
+bool CheckpointJournal::commit() {
+    lastCommit = std::chrono::steady_clock::now();
+    if (pending.empty() || fd < 0) {
+        return fd >= 0;
+    }
+    HL7_TRACE_SCOPE("journalCommit");
+
+    // Documents (and the directory entries from their renames) first, then the journal
+    // lines that point to them
+    std::set<std::string> directories;
+    std::string lines;
+    for (const PendingEntry& entry : pending) {
+        if (!entry.durable) {
+            if (!syncPath(entry.outputPath, O_RDONLY | O_CLOEXEC)) {
+                std::cerr << "Warning: Could not fsync " << entry.outputPath << ": " << std::strerror(errno) << std::endl;
+            }
+            directories.insert(parentDirectory(entry.outputPath));
+        }
+        lines += entry.studyUid + "\t" + entry.outputPath + "\n";
+    }
+    for (const std::string& directory : directories) {
+        syncPath(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    off_t committedSize = lseek(fd, 0, SEEK_END);
+    if (committedSize < 0 || !writeAll(fd, lines) || ::fdatasync(fd) != 0) {
+        std::cerr << "Error: Cannot append to checkpoint journal " << path << ": " << std::strerror(errno) << std::endl;
+        // Cut off what did reach the file, so the retry does not leave a torn or unsynced copy of the group behind it
+        if (committedSize >= 0 && ::ftruncate(fd, committedSize) != 0) {
+            std::cerr << "Error: Cannot truncate checkpoint journal " << path << ": " << std::strerror(errno) << std::endl;
+        }
+        return false;
+    }
+    for (PendingEntry& entry : pending) {
+        completed[entry.studyUid] = std::move(entry.outputPath);
+    }
+    pending.clear();
+    ++syncs;
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef CHECKPOINTJOURNAL_H
+#define CHECKPOINTJOURNAL_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+
+// Append-only record of the studies a batch run has finished, one
+// "<study UID>\t<output path>" line each, so a restarted run can skip them.
+//
+// Entries are group-committed: record() buffers them, and every `groupSize` entries
+// (or `syncIntervalMs`, whichever comes first) commit() fsyncs the documents they point
+// to (unless the writer already made them durable), then appends the lines and
+// fdatasyncs the journal. A journaled study therefore always has its document on disk;
+// a crash loses at most the last uncommitted group, which is simply generated again. A
+// torn last line is discarded on open, and a failed append is cut off before it is retried.
+class CheckpointJournal {
+public:
+    CheckpointJournal(const std::string& path, size_t groupSize, int syncIntervalMs);
+    ~CheckpointJournal(); // Commits pending entries
+
+    CheckpointJournal(const CheckpointJournal&) = delete;
+    CheckpointJournal& operator=(const CheckpointJournal&) = delete;
+
+    // resume: load the existing entries and append to them; otherwise start an empty journal
+    bool open(bool resume);
+    // Commits pending entries; false when that commit fails
+    bool close();
+
+    // Output path journaled for the study, or nullptr; a hash lookup, O(1) per study
+    const std::string* completedOutput(const std::string& studyUid) const;
+    size_t completedCount() const { return completed.size(); }
+
+    // Call after the document has been written (and renamed into place). durable: the
+    // writer has already fsynced it and its directory, so the commit does not again. False
+    // when the entry is rejected, or when the group commit it triggered fails; the group
+    // then stays pending and is retried with the next commit.
+    bool record(const std::string& studyUid, const std::string& outputPath, bool durable);
+    bool commit();
+
+    const std::string& getPath() const { return path; }
+    unsigned long syncCount() const { return syncs; }
+
+private:
+    std::string path;
+    size_t groupSize;
+    std::chrono::milliseconds syncInterval;
+    int fd;
+
+    std::unordered_map<std::string, std::string> completed; // Study UID -> output path
+    struct PendingEntry {
+        std::string studyUid;
+        std::string outputPath;
+        bool durable;
+    };
+    std::vector<PendingEntry> pending;
+    std::chrono::steady_clock::time_point lastCommit;
+    unsigned long syncs;
+
+    bool load();
+};
+
+#endif // CHECKPOINTJOURNAL_H
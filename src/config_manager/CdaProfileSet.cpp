@@ -0,0 +1,160 @@
+#include "CdaProfileSet.h"
+#include "ConfigManager.h"
+#include <algorithm>
+
+namespace {
+
+const std::uint64_t GOLDEN_RATIO_64 = 0x9E3779B97F4A7C15ull;
+const unsigned MAX_TABLE_BITS = 16;
+
+} // namespace
+
+bool CdaProfileSet::packModality(const std::string& modality, std::uint64_t& key) {
+    // DICOM modality defined terms are short upper-case codes; eight bytes cover all of them
+    if (modality.empty() || modality.size() > 8) {
+        return false;
+    }
+    key = 0;
+    for (unsigned char c : modality) {
+        key = (key << 8) | c;
+    }
+    return true;
+}
+
+size_t CdaProfileSet::slotFor(std::uint64_t key) const {
+    return static_cast<size_t>(((key ^ hashSeed) * GOLDEN_RATIO_64) >> hashShift);
+}
+
+bool CdaProfileSet::buildModalityTable(const std::vector<std::uint64_t>& keys) {
+    // Search for a seed that maps every configured modality to its own slot, growing
+    // the table if needed. The key sets are tiny, so this ends within a few tries.
+    unsigned bits = 1;
+    while ((size_t(1) << bits) < keys.size() * 2) ++bits;
+    for (; bits <= MAX_TABLE_BITS; ++bits) {
+        for (std::uint64_t seed = 1; seed <= 256; ++seed) {
+            hashSeed = seed;
+            hashShift = 64 - bits;
+            std::vector<bool> taken(size_t(1) << bits, false);
+            bool collision = false;
+            for (std::uint64_t key : keys) {
+                size_t slot = slotFor(key);
+                if (taken[slot]) {
+                    collision = true;
+                    break;
+                }
+                taken[slot] = true;
+            }
+            if (!collision) {
+                slots.assign(size_t(1) << bits, ModalitySlot());
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CdaProfileSet::compile(const AppConfig& config, std::string& problem) {
+    profiles.clear();
+    rules.clear();
+    wildcardRules.clear();
+    slots.clear();
+    profiles.reserve(config.cdaProfiles.size() + 1);
+    profiles.push_back(ResolvedCdaProfile::resolve(config, "default"));
+
+    std::vector<std::uint64_t> keys;
+    std::vector<std::vector<std::uint16_t>> rulesByKey;
+    for (const CdaProfileConfig& profileConfig : config.cdaProfiles) {
+        // A profile is the global config with its overrides applied
+        AppConfig merged = config;
+        merged.cdaProfiles.clear();
+        if (!profileConfig.documentTitle.empty()) merged.documentTitle = profileConfig.documentTitle;
+        if (!profileConfig.documentCode.code.empty()) merged.documentCode = profileConfig.documentCode;
+        if (!profileConfig.confidentialityCode.code.empty()) merged.confidentialityCode = profileConfig.confidentialityCode;
+        if (!profileConfig.reportSectionCode.code.empty()) merged.reportSectionCode = profileConfig.reportSectionCode;
+        if (profileConfig.overridesTemplateIds) merged.templateIds = profileConfig.templateIds;
+
+        Rule rule;
+        rule.profileIndex = profiles.size();
+        rule.patternSource = profileConfig.descriptionPattern;
+        if (!rule.patternSource.empty()) {
+            std::regex::flag_type flags = std::regex::ECMAScript | std::regex::optimize;
+            if (profileConfig.descriptionIgnoreCase) flags |= std::regex::icase;
+            try {
+                rule.pattern = std::regex(rule.patternSource, flags);
+            } catch (const std::regex_error& e) {
+                problem = "profile '" + profileConfig.name + "': invalid DescriptionPattern '" + rule.patternSource + "' (" + e.what() + ")";
+                *this = CdaProfileSet();
+                return false;
+            }
+        }
+
+        std::uint16_t ruleIndex = static_cast<std::uint16_t>(rules.size());
+        if (profileConfig.modalities.empty()) {
+            wildcardRules.push_back(ruleIndex);
+        }
+        for (const std::string& modality : profileConfig.modalities) {
+            std::uint64_t key = 0;
+            if (!packModality(modality, key)) {
+                problem = "profile '" + profileConfig.name + "': invalid Modality '" + modality + "'";
+                *this = CdaProfileSet();
+                return false;
+            }
+            size_t k = std::find(keys.begin(), keys.end(), key) - keys.begin();
+            if (k == keys.size()) {
+                keys.push_back(key);
+                rulesByKey.emplace_back();
+            }
+            rulesByKey[k].push_back(ruleIndex);
+            if (!rule.modalities.empty()) rule.modalities += ",";
+            rule.modalities += modality;
+        }
+
+        profiles.push_back(ResolvedCdaProfile::resolve(merged, profileConfig.name));
+        rules.push_back(std::move(rule));
+    }
+
+    if (!keys.empty()) {
+        if (!buildModalityTable(keys)) {
+            problem = "could not build the modality lookup table";
+            *this = CdaProfileSet();
+            return false;
+        }
+        for (size_t k = 0; k < keys.size(); ++k) {
+            ModalitySlot& slot = slots[slotFor(keys[k])];
+            slot.key = keys[k];
+            // Merge modality-specific and wildcard rules so a lookup walks one list in config order
+            std::merge(rulesByKey[k].begin(), rulesByKey[k].end(), wildcardRules.begin(), wildcardRules.end(),
+                       std::back_inserter(slot.rules));
+        }
+    }
+    return true;
+}
+
+const ResolvedCdaProfile& CdaProfileSet::select(const Study& study) const {
+    const std::vector<std::uint16_t>* candidates = &wildcardRules;
+    std::uint64_t key = 0;
+    if (!slots.empty() && packModality(study.modality, key)) {
+        const ModalitySlot& slot = slots[slotFor(key)];
+        if (slot.key == key) {
+            candidates = &slot.rules;
+        }
+    }
+    for (std::uint16_t ruleIndex : *candidates) {
+        const Rule& rule = rules[ruleIndex];
+        if (rule.patternSource.empty() || std::regex_search(study.studyDescription, rule.pattern)) {
+            return profiles[rule.profileIndex];
+        }
+    }
+    return profiles.front();
+}
+
+void CdaProfileSet::dump(std::ostream& out) const {
+    for (const Rule& rule : rules) {
+        out << "Profile '" << profiles[rule.profileIndex].name << "' matches modality "
+            << (rule.modalities.empty() ? "*" : rule.modalities)
+            << ", description " << (rule.patternSource.empty() ? "*" : "/" + rule.patternSource + "/") << "\n";
+    }
+    for (const ResolvedCdaProfile& profile : profiles) {
+        profile.dump(out);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef CDAPROFILESET_H
+#define CDAPROFILESET_H
+
+#include <string>
+#include <vector>
+#include <regex>
+#include <cstdint>
+#include <ostream>
+#include "ResolvedCdaProfile.h"
+#include "../models/Study.h"
+
+struct AppConfig;
+
+// The default CDA profile plus the named <Profiles> from the config, each resolved
+// once into a ResolvedCdaProfile, and the compiled rules that pick one for a study.
+// Selection is a perfect-hash lookup on the modality, which yields the short list of
+// candidate rules for that modality in config order, followed by precompiled
+// description regexes. The first matching rule wins; no match means the default.
+// Immutable after compile(), so one instance can be shared between threads.
+class CdaProfileSet {
+public:
+    CdaProfileSet() = default;
+    CdaProfileSet(CdaProfileSet&&) = default;
+    CdaProfileSet& operator=(CdaProfileSet&&) = default;
+    CdaProfileSet(const CdaProfileSet&) = delete;
+    CdaProfileSet& operator=(const CdaProfileSet&) = delete;
+
+    // Resolves every profile and compiles the match rules. Returns false (with `problem`
+    // set) for an invalid description pattern or modality; the set is then left empty.
+    bool compile(const AppConfig& config, std::string& problem);
+
+    const ResolvedCdaProfile& select(const Study& study) const;
+    const ResolvedCdaProfile& defaultProfile() const { return profiles.front(); }
+    const std::vector<ResolvedCdaProfile>& all() const { return profiles; }
+
+    void dump(std::ostream& out) const;
+
+private:
+    struct Rule {
+        size_t profileIndex;
+        std::string modalities;      // For dump() only
+        std::string patternSource;   // Empty when the rule has no description pattern
+        std::regex pattern;
+    };
+    struct ModalitySlot {
+        std::uint64_t key = 0;       // Packed modality; 0 marks an empty slot
+        std::vector<std::uint16_t> rules; // Rule indices for this modality, including wildcard rules, in config order
+    };
+
+    std::vector<ResolvedCdaProfile> profiles; // [0] is the default profile
+    std::vector<Rule> rules;
+    std::vector<std::uint16_t> wildcardRules; // Rules without a modality restriction
+    std::vector<ModalitySlot> slots;
+    std::uint64_t hashSeed = 0;
+    unsigned hashShift = 64;
+
+    static bool packModality(const std::string& modality, std::uint64_t& key);
+    size_t slotFor(std::uint64_t key) const;
+    bool buildModalityTable(const std::vector<std::uint64_t>& keys);
+};
+
+#endif // CDAPROFILESET_H
@@ -1,4 +1,5 @@
 #include "ConfigManager.h"
+#include "ConfigSnapshot.h"
 #include <iostream>
 
 
@@ -7,8 +8,56 @@ ConfigManager::ConfigManager() : loaded(false) {
     appConfig.odbcDsn = "";
     appConfig.dbUser = "";
     appConfig.dbPassword = "";
+    appConfig.dataSourceType = "odbc";
+    appConfig.dataLatencyBaseUs = 0;
+    appConfig.dataLatencyJitterUs = 0;
+    appConfig.dataLatencyPerRowUs = 0;
+    appConfig.dataLatencySeed = 1;
     appConfig.cdaXsdPath = "";
     appConfig.patientIdRootOid = "";
+    appConfig.validationMode = "sax";
+    appConfig.fullValidationSamplePercent = 100;
+    appConfig.configReloadIntervalMs = 1000;
+    appConfig.keyImageMaxDimension = 256;
+    appConfig.keyImageMaxPerDocument = 8;
+    appConfig.countAnalysisEnabled = false;
+    appConfig.countUseOverlays = true;
+    appConfig.countCodeSystem = "2.25.0.0.0.0";
+    appConfig.dynamicAnalysisEnabled = false;
+    appConfig.dynamicAnalysisThreads = 0;
+    appConfig.dynamicUseOverlays = true;
+    appConfig.dynamicCodeSystem = "2.25.0.0.0.0";
+    appConfig.serverBindAddress = "0.0.0.0";
+    appConfig.serverPort = 8080;
+    appConfig.serverWorkers = 4;
+    appConfig.serverMaxInFlight = 64;
+    appConfig.serverKeepAliveTimeoutMs = 5000;
+    appConfig.serverMaxBatchSize = 100;
+    appConfig.jobWorkers = 2;
+    appConfig.jobBatchSize = 10;
+    appConfig.jobLeaseSeconds = 300;
+    appConfig.jobPollIntervalMs = 5000;
+    appConfig.jobRetryBackoffSeconds = 30;
+    appConfig.outputScheme = "flat";
+    appConfig.outputHashLevels = 2;
+    appConfig.writerThreads = 2;
+    appConfig.writerQueueCapacity = 256;
+    appConfig.writerGroupSize = 64;
+    appConfig.writerSyncIntervalMs = 200;
+    appConfig.writerMaxOpenFiles = 256;
+    appConfig.compressionFormat = "none";
+    appConfig.compressionLevel = 0;
+    appConfig.compressionBundleSize = 0;
+    appConfig.compressionDictionarySamples = 1000;
+    appConfig.compressionDictionarySizeKB = 112;
+    appConfig.batchJournalGroupSize = 64;
+    appConfig.batchJournalSyncIntervalMs = 1000;
+    appConfig.batchSink = "files";
+    appConfig.batchSegmentSizeMB = 1024;
+    appConfig.batchSegmentCompress = false;
+    appConfig.metricsExportIntervalMs = 10000;
+    std::string problem;
+    cdaProfiles.compile(appConfig, problem); // No named profiles yet, cannot fail
 }
 
 ConfigManager::ConfigManager(const std::string& configFilepath) : ConfigManager() {
@@ -56,6 +105,7 @@ bool ConfigManager::loadConfig(const std::string& configFilepath) {
     if (generalNode) {
         appConfig.outputPath = getNodeText(generalNode.child("OutputPath"), getNodeText(generalNode.child("outputPath"), ""));
         appConfig.cdaXsdPath = getNodeText(generalNode.child("CdaXsdPath"), getNodeText(generalNode.child("cdaXsdPath"), ""));
+        appConfig.configReloadIntervalMs = generalNode.child("ConfigReloadIntervalMs").text().as_int(1000);
         // appConfig.patientIdRootOid = getNodeText(generalNode.child("RootOid"), getNodeText(generalNode.child("rootOid"), ""));
         appConfig.realmCode = getNodeText(generalNode.child("RealmCode"));
         appConfig.typeIdExtension = getNodeText(generalNode.child("TypeIdExtension"));
@@ -202,17 +252,399 @@ bool ConfigManager::loadConfig(const std::string& configFilepath) {
         }
     }
 
+    // Named CDA profiles
+    appConfig.cdaProfiles.clear();
+    pugi::xml_node profilesNode = rootNode.child("Profiles");
+    if (profilesNode) {
+        readProfiles(profilesNode);
+    }
+
+    // Validation
+    pugi::xml_node validationNode = rootNode.child("Validation");
+    if (validationNode) {
+        appConfig.validationMode = getNodeText(validationNode.child("Mode"), "sax");
+        appConfig.grammarCachePath = getNodeText(validationNode.child("GrammarCachePath"));
+        appConfig.fullValidationSamplePercent = validationNode.child("FullValidationSamplePercent").text().as_int(100);
+        if (appConfig.fullValidationSamplePercent < 0 || appConfig.fullValidationSamplePercent > 100) {
+            std::cerr << "Warning: FullValidationSamplePercent must be between 0 and 100, using 100." << std::endl;
+            appConfig.fullValidationSamplePercent = 100;
+        }
+    }
+
+    // Key images
+    pugi::xml_node keyImagesNode = rootNode.child("KeyImages");
+    appConfig.keyImageFrames.clear();
+    if (keyImagesNode) {
+        for (pugi::xml_node frameNode : keyImagesNode.children("Frame")) {
+            std::string frame = getNodeText(frameNode);
+            if (frame == "last") {
+                appConfig.keyImageFrames.push_back(0);
+            } else if (frameNode.text().as_int(0) >= 1) {
+                appConfig.keyImageFrames.push_back(frameNode.text().as_int(0));
+            } else {
+                std::cerr << "Warning: Ignoring KeyImages Frame '" << frame << "' (a frame number from 1, or 'last')." << std::endl;
+            }
+        }
+        appConfig.keyImageMaxDimension = keyImagesNode.child("MaxDimension").text().as_int(256);
+        appConfig.keyImageMaxPerDocument = keyImagesNode.child("MaxPerDocument").text().as_int(8);
+        if (appConfig.keyImageMaxDimension < 0) {
+            std::cerr << "Warning: KeyImages MaxDimension must not be negative, using 256." << std::endl;
+            appConfig.keyImageMaxDimension = 256;
+        }
+        if (appConfig.keyImageMaxPerDocument < 0) {
+            appConfig.keyImageMaxPerDocument = 0;
+        }
+    }
+
+    // Count analysis
+    pugi::xml_node countNode = rootNode.child("CountAnalysis");
+    appConfig.countRois.clear();
+    appConfig.countRatios.clear();
+    appConfig.countAnalysisEnabled = false;
+    if (countNode) {
+        appConfig.countAnalysisEnabled = countNode.child("Enabled").text().as_bool(false);
+        appConfig.countUseOverlays = countNode.child("UseOverlays").text().as_bool(true);
+        appConfig.countCodeSystem = getNodeText(countNode.child("CodeSystem"), "2.25.0.0.0.0");
+        readRois(countNode, "CountAnalysis", appConfig.countRois);
+        for (pugi::xml_node ratioNode : countNode.children("Ratio")) {
+            CountRatioConfig ratio;
+            ratio.name = ratioNode.attribute("name").value();
+            ratio.numerator = ratioNode.attribute("numerator").value();
+            ratio.denominator = ratioNode.attribute("denominator").value();
+            if (ratio.numerator.empty() || ratio.denominator.empty()) {
+                std::cerr << "Warning: Ignoring CountAnalysis Ratio '" << ratio.name << "' without a numerator and denominator." << std::endl;
+                continue;
+            }
+            if (ratio.name.empty()) {
+                ratio.name = ratio.numerator + "/" + ratio.denominator;
+            }
+            appConfig.countRatios.push_back(ratio);
+        }
+    }
+
+    // Time-activity curves
+    pugi::xml_node dynamicNode = rootNode.child("DynamicAnalysis");
+    appConfig.dynamicRois.clear();
+    appConfig.dynamicSplitFunctions.clear();
+    appConfig.dynamicAnalysisEnabled = false;
+    if (dynamicNode) {
+        appConfig.dynamicAnalysisEnabled = dynamicNode.child("Enabled").text().as_bool(false);
+        appConfig.dynamicAnalysisThreads = dynamicNode.child("Threads").text().as_int(0);
+        appConfig.dynamicUseOverlays = dynamicNode.child("UseOverlays").text().as_bool(true);
+        appConfig.dynamicCodeSystem = getNodeText(dynamicNode.child("CodeSystem"), "2.25.0.0.0.0");
+        appConfig.dynamicBackgroundRoi = getNodeText(dynamicNode.child("Background"));
+        if (appConfig.dynamicAnalysisThreads < 0) {
+            std::cerr << "Warning: DynamicAnalysis Threads must not be negative, using one per core." << std::endl;
+            appConfig.dynamicAnalysisThreads = 0;
+        }
+        readRois(dynamicNode, "DynamicAnalysis", appConfig.dynamicRois);
+        for (pugi::xml_node splitNode : dynamicNode.children("SplitFunction")) {
+            SplitFunctionConfig split;
+            split.name = splitNode.attribute("name").value();
+            split.left = splitNode.attribute("left").value();
+            split.right = splitNode.attribute("right").value();
+            split.startSeconds = splitNode.attribute("start").as_double(60);
+            split.endSeconds = splitNode.attribute("end").as_double(120);
+            if (split.left.empty() || split.right.empty() || split.endSeconds <= split.startSeconds) {
+                std::cerr << "Warning: Ignoring DynamicAnalysis SplitFunction '" << split.name << "' (needs left and right regions and end after start)." << std::endl;
+                continue;
+            }
+            if (split.name.empty()) {
+                split.name = split.left + "/" + split.right;
+            }
+            appConfig.dynamicSplitFunctions.push_back(split);
+        }
+    }
+
+    // Data source
+    pugi::xml_node dataSourceNode = rootNode.child("DataSource");
+    if (dataSourceNode) {
+        appConfig.dataSourceType = getNodeText(dataSourceNode.child("Type"), "odbc");
+        appConfig.dataSnapshotPath = getNodeText(dataSourceNode.child("SnapshotPath"));
+        appConfig.dataDicomDirectory = getNodeText(dataSourceNode.child("DicomDirectory"));
+        pugi::xml_node latencyNode = dataSourceNode.child("Latency");
+        appConfig.dataLatencyBaseUs = latencyNode.child("BaseUs").text().as_int(0);
+        appConfig.dataLatencyJitterUs = latencyNode.child("JitterUs").text().as_int(0);
+        appConfig.dataLatencyPerRowUs = latencyNode.child("PerRowUs").text().as_int(0);
+        appConfig.dataLatencySeed = latencyNode.child("Seed").text().as_ullong(1);
+        if (appConfig.dataSourceType != "odbc" && appConfig.dataSourceType != "memory") {
+            std::cerr << "Warning: Unknown DataSource Type '" << appConfig.dataSourceType << "', using 'odbc'." << std::endl;
+            appConfig.dataSourceType = "odbc";
+        }
+        if (appConfig.dataSourceType == "memory" && appConfig.dataSnapshotPath.empty()) {
+            std::cerr << "Error: DataSource Type 'memory' needs a SnapshotPath." << std::endl;
+            loaded = false;
+            return false;
+        }
+        if (appConfig.dataLatencyBaseUs < 0 || appConfig.dataLatencyJitterUs < 0 || appConfig.dataLatencyPerRowUs < 0) {
+            std::cerr << "Warning: DataSource Latency values must not be negative, disabling latency injection." << std::endl;
+            appConfig.dataLatencyBaseUs = appConfig.dataLatencyJitterUs = appConfig.dataLatencyPerRowUs = 0;
+        }
+    }
+    if (appConfig.countAnalysisEnabled && appConfig.dataDicomDirectory.empty()) {
+        std::cerr << "Warning: CountAnalysis is enabled but DataSource DicomDirectory is not set, so no frames will be counted." << std::endl;
+    }
+    if (appConfig.dynamicAnalysisEnabled && appConfig.dataDicomDirectory.empty()) {
+        std::cerr << "Warning: DynamicAnalysis is enabled but DataSource DicomDirectory is not set, so no time-activity curves will be written." << std::endl;
+    }
+
+    // Server mode
+    pugi::xml_node serverNode = rootNode.child("Server");
+    if (serverNode) {
+        appConfig.serverBindAddress = getNodeText(serverNode.child("BindAddress"), "0.0.0.0");
+        appConfig.serverPort = serverNode.child("Port").text().as_int(8080);
+        appConfig.serverWorkers = serverNode.child("Workers").text().as_int(4);
+        appConfig.serverMaxInFlight = serverNode.child("MaxInFlight").text().as_int(64);
+        appConfig.serverKeepAliveTimeoutMs = serverNode.child("KeepAliveTimeoutMs").text().as_int(5000);
+        appConfig.serverMaxBatchSize = serverNode.child("MaxBatchSize").text().as_int(100);
+        if (appConfig.serverWorkers < 1) {
+            std::cerr << "Warning: Server Workers must be at least 1, using 1." << std::endl;
+            appConfig.serverWorkers = 1;
+        }
+        if (appConfig.serverMaxInFlight < appConfig.serverWorkers) {
+            std::cerr << "Warning: Server MaxInFlight is below Workers, using " << appConfig.serverWorkers << "." << std::endl;
+            appConfig.serverMaxInFlight = appConfig.serverWorkers;
+        }
+        if (appConfig.serverMaxBatchSize < 1) {
+            appConfig.serverMaxBatchSize = 1;
+        }
+    }
+
+    // Worker mode
+    pugi::xml_node jobsNode = rootNode.child("Jobs");
+    if (jobsNode) {
+        appConfig.jobWorkers = jobsNode.child("Workers").text().as_int(2);
+        appConfig.jobBatchSize = jobsNode.child("BatchSize").text().as_int(10);
+        appConfig.jobLeaseSeconds = jobsNode.child("LeaseSeconds").text().as_int(300);
+        appConfig.jobPollIntervalMs = jobsNode.child("PollIntervalMs").text().as_int(5000);
+        appConfig.jobRetryBackoffSeconds = jobsNode.child("RetryBackoffSeconds").text().as_int(30);
+        appConfig.jobListenConnInfo = getNodeText(jobsNode.child("ListenConnInfo"));
+        if (appConfig.jobWorkers < 1) {
+            std::cerr << "Warning: Jobs Workers must be at least 1, using 1." << std::endl;
+            appConfig.jobWorkers = 1;
+        }
+        if (appConfig.jobBatchSize < 1) {
+            appConfig.jobBatchSize = 1;
+        }
+        if (appConfig.jobLeaseSeconds < 10) {
+            std::cerr << "Warning: Jobs LeaseSeconds below 10, using 10." << std::endl;
+            appConfig.jobLeaseSeconds = 10;
+        }
+        if (appConfig.jobPollIntervalMs < 100) {
+            appConfig.jobPollIntervalMs = 100;
+        }
+        if (appConfig.jobRetryBackoffSeconds < 0) {
+            appConfig.jobRetryBackoffSeconds = 0;
+        }
+    }
+
+    // Output tree
+    pugi::xml_node layoutNode = rootNode.child("OutputLayout");
+    if (layoutNode) {
+        appConfig.outputScheme = getNodeText(layoutNode.child("Scheme"), "flat");
+        appConfig.outputHashLevels = layoutNode.child("HashLevels").text().as_int(2);
+        appConfig.outputIndexPath = getNodeText(layoutNode.child("IndexPath"));
+        if (appConfig.outputScheme != "flat" && appConfig.outputScheme != "hash" && appConfig.outputScheme != "date") {
+            std::cerr << "Warning: Unknown OutputLayout Scheme '" << appConfig.outputScheme << "', using 'flat'." << std::endl;
+            appConfig.outputScheme = "flat";
+        }
+        if (appConfig.outputHashLevels < 1 || appConfig.outputHashLevels > 4) {
+            std::cerr << "Warning: OutputLayout HashLevels must be 1-4, using 2." << std::endl;
+            appConfig.outputHashLevels = 2;
+        }
+    }
+
+    // Document writer
+    pugi::xml_node writerNode = rootNode.child("Writer");
+    if (writerNode) {
+        appConfig.writerThreads = writerNode.child("Threads").text().as_int(2);
+        appConfig.writerQueueCapacity = writerNode.child("QueueCapacity").text().as_int(256);
+        appConfig.writerGroupSize = writerNode.child("GroupSize").text().as_int(64);
+        appConfig.writerSyncIntervalMs = writerNode.child("SyncIntervalMs").text().as_int(200);
+        appConfig.writerMaxOpenFiles = writerNode.child("MaxOpenFiles").text().as_int(256);
+        if (appConfig.writerThreads < 1) {
+            std::cerr << "Warning: Writer Threads must be at least 1, using 1." << std::endl;
+            appConfig.writerThreads = 1;
+        }
+        if (appConfig.writerQueueCapacity < 1) {
+            appConfig.writerQueueCapacity = 1;
+        }
+        if (appConfig.writerGroupSize < 1) {
+            std::cerr << "Warning: Writer GroupSize must be at least 1, using 1." << std::endl;
+            appConfig.writerGroupSize = 1;
+        }
+        if (appConfig.writerSyncIntervalMs < 0) {
+            appConfig.writerSyncIntervalMs = 0;
+        }
+        if (appConfig.writerMaxOpenFiles < 1) {
+            std::cerr << "Warning: Writer MaxOpenFiles must be at least 1, using 256." << std::endl;
+            appConfig.writerMaxOpenFiles = 256;
+        }
+    }
+
+    // Output compression
+    pugi::xml_node compressionNode = rootNode.child("Compression");
+    if (compressionNode) {
+        appConfig.compressionFormat = getNodeText(compressionNode.child("Format"), "none");
+        appConfig.compressionLevel = compressionNode.child("Level").text().as_int(0);
+        appConfig.compressionDictionaryPath = getNodeText(compressionNode.child("DictionaryPath"));
+        appConfig.compressionBundleSize = compressionNode.child("BundleSize").text().as_int(0);
+        appConfig.compressionDictionarySamples = compressionNode.child("DictionarySamples").text().as_int(1000);
+        appConfig.compressionDictionarySizeKB = compressionNode.child("DictionarySizeKB").text().as_int(112);
+        if (appConfig.compressionFormat != "none" && appConfig.compressionFormat != "gzip" && appConfig.compressionFormat != "zstd") {
+            std::cerr << "Warning: Unknown Compression Format '" << appConfig.compressionFormat << "', using 'none'." << std::endl;
+            appConfig.compressionFormat = "none";
+        }
+        if (appConfig.compressionLevel < 0) {
+            std::cerr << "Warning: Compression Level cannot be negative, using the format's default." << std::endl;
+            appConfig.compressionLevel = 0;
+        }
+        if (appConfig.compressionBundleSize < 0) {
+            appConfig.compressionBundleSize = 0;
+        }
+        if (appConfig.compressionDictionarySamples < 1) {
+            std::cerr << "Warning: Compression DictionarySamples must be at least 1, using 1000." << std::endl;
+            appConfig.compressionDictionarySamples = 1000;
+        }
+        if (appConfig.compressionDictionarySizeKB < 1) {
+            std::cerr << "Warning: Compression DictionarySizeKB must be at least 1, using 112." << std::endl;
+            appConfig.compressionDictionarySizeKB = 112;
+        }
+    }
+
+    // Batch mode
+    pugi::xml_node batchNode = rootNode.child("Batch");
+    if (batchNode) {
+        appConfig.batchJournalPath = getNodeText(batchNode.child("JournalPath"));
+        appConfig.batchJournalGroupSize = batchNode.child("JournalGroupSize").text().as_int(64);
+        appConfig.batchJournalSyncIntervalMs = batchNode.child("JournalSyncIntervalMs").text().as_int(1000);
+        appConfig.batchSink = getNodeText(batchNode.child("Sink"), "files");
+        appConfig.batchSegmentDirectory = getNodeText(batchNode.child("SegmentDirectory"));
+        appConfig.batchSegmentSizeMB = batchNode.child("SegmentSizeMB").text().as_int(1024);
+        std::string segmentCompression = getNodeText(batchNode.child("SegmentCompression"), "none");
+        appConfig.batchSegmentCompress = segmentCompression == "zlib";
+        if (appConfig.batchSink != "files" && appConfig.batchSink != "segments") {
+            std::cerr << "Warning: Unknown Batch Sink '" << appConfig.batchSink << "', using 'files'." << std::endl;
+            appConfig.batchSink = "files";
+        }
+        if (segmentCompression != "none" && segmentCompression != "zlib") {
+            std::cerr << "Warning: Unknown Batch SegmentCompression '" << segmentCompression << "', using 'none'." << std::endl;
+        }
+        if (appConfig.batchSegmentSizeMB < 1) {
+            std::cerr << "Warning: Batch SegmentSizeMB must be at least 1, using 1." << std::endl;
+            appConfig.batchSegmentSizeMB = 1;
+        }
+        if (appConfig.batchJournalGroupSize < 1) {
+            std::cerr << "Warning: Batch JournalGroupSize must be at least 1, using 1." << std::endl;
+            appConfig.batchJournalGroupSize = 1;
+        }
+        if (appConfig.batchJournalSyncIntervalMs < 0) {
+            appConfig.batchJournalSyncIntervalMs = 0;
+        }
+    }
+
+    // Metrics
+    pugi::xml_node metricsNode = rootNode.child("Metrics");
+    if (metricsNode) {
+        appConfig.metricsFilePath = getNodeText(metricsNode.child("PrometheusFile"));
+        appConfig.metricsExportIntervalMs = metricsNode.child("ExportIntervalMs").text().as_int(10000);
+    }
+
     std::cout << "Configuration loaded successfully from '" << configFilepath << "'." << std::endl;
     std::cout << " Loaded RealmCode: " << appConfig.realmCode << std::endl;
     std::cout << " Loaded TypeIdExtension: " << appConfig.typeIdExtension << std::endl;
     std::cout << " Loaded DocumentIdRootOid: " << appConfig.documentIdRootOid << std::endl;
     std::cout << " Loaded PatientIdRootOid: " << appConfig.patientIdRootOid << std::endl;
+    std::cout << " Loaded ValidationMode: " << appConfig.validationMode << std::endl;
+    std::cout << " Loaded FullValidationSamplePercent: " << appConfig.fullValidationSamplePercent << std::endl;
+
+    std::string problem;
+    CdaProfileSet compiledProfiles;
+    if (!compiledProfiles.compile(appConfig, problem)) {
+        std::cerr << "Error: Invalid CDA profile configuration in '" << configFilepath << "': " << problem << std::endl;
+        loaded = false;
+        return false;
+    }
+    cdaProfiles = std::move(compiledProfiles);
+    cdaProfiles.dump(std::cout);
 
 
     loaded = true;
     return true;
 }
 
+namespace {
+
+// Settings loadConfig reads that the process only picks up at startup. A reload that
+// changes one is still published, but these keep their old values until a restart, so
+// a field parsed above whose consumer is built once at startup belongs in this list.
+struct RestartRequiredSetting {
+    const char* section; // Named in the reload message; keep a section's fields together
+    bool (*changed)(const AppConfig& before, const AppConfig& after);
+};
+
+#define RESTART_REQUIRED(section, field) \
+    {section, [](const AppConfig& before, const AppConfig& after) { return before.field != after.field; }}
+
+const RestartRequiredSetting RESTART_REQUIRED_SETTINGS[] = {
+    RESTART_REQUIRED("database", odbcDsn),
+    RESTART_REQUIRED("database", dbUser),
+    RESTART_REQUIRED("database", dbPassword),
+    RESTART_REQUIRED("database", dataSourceType),
+    RESTART_REQUIRED("database", dataSnapshotPath),
+    RESTART_REQUIRED("database", dataDicomDirectory),
+    RESTART_REQUIRED("database", dataLatencyBaseUs),
+    RESTART_REQUIRED("database", dataLatencyJitterUs),
+    RESTART_REQUIRED("database", dataLatencyPerRowUs),
+    RESTART_REQUIRED("database", dataLatencySeed),
+    RESTART_REQUIRED("config reload", configReloadIntervalMs),
+    RESTART_REQUIRED("server", serverBindAddress),
+    RESTART_REQUIRED("server", serverPort),
+    RESTART_REQUIRED("server", serverWorkers),
+    RESTART_REQUIRED("server", serverMaxInFlight),
+    RESTART_REQUIRED("server", serverKeepAliveTimeoutMs),
+    RESTART_REQUIRED("server", serverMaxBatchSize),
+    RESTART_REQUIRED("job worker", jobWorkers),
+    RESTART_REQUIRED("job worker", jobBatchSize),
+    RESTART_REQUIRED("job worker", jobLeaseSeconds),
+    RESTART_REQUIRED("job worker", jobPollIntervalMs),
+    RESTART_REQUIRED("job worker", jobRetryBackoffSeconds),
+    RESTART_REQUIRED("job worker", jobListenConnInfo),
+    RESTART_REQUIRED("output index", outputIndexPath),
+    RESTART_REQUIRED("writer", writerThreads),
+    RESTART_REQUIRED("writer", writerQueueCapacity),
+    RESTART_REQUIRED("writer", writerGroupSize),
+    RESTART_REQUIRED("writer", writerSyncIntervalMs),
+    RESTART_REQUIRED("writer", writerMaxOpenFiles),
+    RESTART_REQUIRED("compression", compressionFormat),
+    RESTART_REQUIRED("compression", compressionLevel),
+    RESTART_REQUIRED("compression", compressionDictionaryPath),
+    RESTART_REQUIRED("compression", compressionBundleSize),
+    RESTART_REQUIRED("batch journal and sink", batchJournalPath),
+    RESTART_REQUIRED("batch journal and sink", batchJournalGroupSize),
+    RESTART_REQUIRED("batch journal and sink", batchJournalSyncIntervalMs),
+    RESTART_REQUIRED("batch journal and sink", batchSink),
+    RESTART_REQUIRED("batch journal and sink", batchSegmentDirectory),
+    RESTART_REQUIRED("batch journal and sink", batchSegmentSizeMB),
+    RESTART_REQUIRED("batch journal and sink", batchSegmentCompress),
+    RESTART_REQUIRED("metrics", metricsFilePath),
+    RESTART_REQUIRED("metrics", metricsExportIntervalMs),
+};
+
+#undef RESTART_REQUIRED
+
+} // namespace
+
+std::vector<std::string> ConfigManager::restartRequiredChanges(const AppConfig& before, const AppConfig& after) {
+    std::vector<std::string> sections;
+    for (const RestartRequiredSetting& setting : RESTART_REQUIRED_SETTINGS) {
+        if (setting.changed(before, after) && (sections.empty() || sections.back() != setting.section)) {
+            sections.push_back(setting.section);
+        }
+    }
+    return sections;
+}
+
 bool ConfigManager::loadConfig() {
     if (configFilePath_.empty()) return false;
     return loadConfig(configFilePath_);
@@ -248,3 +680,93 @@ const AppConfig& ConfigManager::getConfig() const {
     }
     return appConfig;
 }
+
+const ResolvedCdaProfile& ConfigManager::getCdaProfile() const {
+    if (!loaded) {
+        std::cerr << "Warning: Accessing CDA profile, but the configuration was not loaded successfully or at all." << std::endl;
+    }
+    return cdaProfiles.defaultProfile();
+}
+
+const CdaProfileSet& ConfigManager::getCdaProfiles() const {
+    return cdaProfiles;
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigManager::createSnapshot(unsigned long version) const {
+    std::shared_ptr<ConfigSnapshot> snapshot = std::make_shared<ConfigSnapshot>();
+    snapshot->config = appConfig;
+    std::string problem;
+    if (!snapshot->profiles.compile(appConfig, problem)) { // Already succeeded in loadConfig
+        std::cerr << "Error: Invalid CDA profile configuration: " << problem << std::endl;
+    }
+    snapshot->version = version;
+    return snapshot;
+}
+
+void ConfigManager::readCodeConfig(const pugi::xml_node& node, CodeConfig& code) {
+    if (!node) return;
+    code.code = getNodeText(node.child("code"));
+    code.codeSystem = getNodeText(node.child("codeSystem"));
+    code.codeSystemName = getNodeText(node.child("codeSystemName"));
+    code.displayName = getNodeText(node.child("displayName"));
+}
+
+void ConfigManager::readRois(const pugi::xml_node& parentNode, const char* section, std::vector<CountRoiConfig>& rois) {
+    for (pugi::xml_node roiNode : parentNode.children("Roi")) {
+        CountRoiConfig roi;
+        roi.name = roiNode.attribute("name").value();
+        std::string shape = roiNode.attribute("shape").value();
+        roi.ellipse = shape == "ellipse";
+        roi.x = roiNode.attribute("x").as_double(0);
+        roi.y = roiNode.attribute("y").as_double(0);
+        roi.width = roiNode.attribute("width").as_double(0);
+        roi.height = roiNode.attribute("height").as_double(0);
+        if (roi.name.empty() || (!shape.empty() && shape != "ellipse" && shape != "rectangle") || roi.width <= 0 || roi.height <= 0) {
+            std::cerr << "Warning: Ignoring " << section << " Roi '" << roi.name << "' (needs a name, shape rectangle or ellipse, and a positive width and height)." << std::endl;
+            continue;
+        }
+        rois.push_back(roi);
+    }
+}
+
+void ConfigManager::readProfiles(const pugi::xml_node& profilesNode) {
+    for (pugi::xml_node profileNode : profilesNode.children("Profile")) {
+        CdaProfileConfig profile;
+        profile.name = profileNode.attribute("name").value();
+        if (profile.name.empty()) {
+            profile.name = "profile" + std::to_string(appConfig.cdaProfiles.size() + 1);
+        }
+
+        pugi::xml_node matchNode = profileNode.child("Match");
+        for (pugi::xml_node modalityNode : matchNode.children("Modality")) {
+            std::string modality = getNodeText(modalityNode);
+            if (!modality.empty()) {
+                profile.modalities.push_back(modality);
+            }
+        }
+        pugi::xml_node patternNode = matchNode.child("DescriptionPattern");
+        profile.descriptionPattern = getNodeText(patternNode);
+        profile.descriptionIgnoreCase = patternNode.attribute("ignoreCase").as_bool(false);
+
+        profile.documentTitle = getNodeText(profileNode.child("DocumentTitle"));
+        readCodeConfig(profileNode.child("DocumentCode"), profile.documentCode);
+        readCodeConfig(profileNode.child("ConfidentialityCode"), profile.confidentialityCode);
+        readCodeConfig(profileNode.child("ReportSectionCode"), profile.reportSectionCode);
+
+        pugi::xml_node templateIdsNode = profileNode.child("TemplateIds");
+        if (templateIdsNode) {
+            profile.overridesTemplateIds = true;
+            for (pugi::xml_node tmplNode : templateIdsNode.children("TemplateId")) {
+                TemplateIdConfig tic;
+                tic.root = getNodeText(tmplNode.child("root"));
+                tic.extension = getNodeText(tmplNode.child("extension"));
+                if (!tic.root.empty()) { // Root is mandatory for a templateId
+                    profile.templateIds.push_back(tic);
+                }
+            }
+        }
+
+        std::cout << " Loaded CDA profile: " << profile.name << std::endl;
+        appConfig.cdaProfiles.push_back(profile);
+    }
+}
@@ -3,7 +3,11 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include "pugixml.hpp"
+#include "CdaProfileSet.h"
+
+struct ConfigSnapshot;
 
 // Structure to hold OID configurations
 struct OidConfig {
@@ -26,13 +30,65 @@ struct TemplateIdConfig {
     std::string extension;
 };
 
+// A named CDA profile (<Profiles><Profile>): match rules plus the header values it
+// overrides. Empty fields inherit the global setting.
+struct CdaProfileConfig {
+    std::string name;
+    std::vector<std::string> modalities;   // Any of these Study::modality values; empty matches every modality
+    std::string descriptionPattern;        // ECMAScript regex searched in Study::studyDescription; empty matches all
+    bool descriptionIgnoreCase = false;
+
+    std::string documentTitle;
+    CodeConfig documentCode;
+    CodeConfig confidentialityCode;
+    CodeConfig reportSectionCode;
+    bool overridesTemplateIds = false;     // True when the profile has its own <TemplateIds>
+    std::vector<TemplateIdConfig> templateIds;
+};
+
+// A count analysis region (<CountAnalysis><Roi>, <DynamicAnalysis><Roi>), in fractions of the image size
+struct CountRoiConfig {
+    std::string name;
+    bool ellipse = false; // shape="ellipse": inscribed in the rectangle
+    double x = 0;
+    double y = 0;
+    double width = 1;
+    double height = 1;
+};
+
+// <CountAnalysis><Ratio>: counts of one region over another's, e.g. left/right kidney
+struct CountRatioConfig {
+    std::string name;
+    std::string numerator;
+    std::string denominator;
+};
+
+// <DynamicAnalysis><SplitFunction>: the left region's share of both regions' counts in a time window
+struct SplitFunctionConfig {
+    std::string name;
+    std::string left;
+    std::string right;
+    double startSeconds = 60;
+    double endSeconds = 120;
+};
+
 // Structure to hold all application configurations
 struct AppConfig {
     std::string odbcDsn;
     std::string dbUser;
     std::string dbPassword;
 
+    // Where patients and studies come from (see PatientStudySourceFactory)
+    std::string dataSourceType;    // "odbc" (default) or "memory"
+    std::string dataSnapshotPath;  // memory: directory with Patients.csv/Studies.csv, or a binary snapshot
+    std::string dataDicomDirectory; // DICOM files whose series and instances go into the documents; empty: none
+    int dataLatencyBaseUs;         // memory: injected per-query delay, to simulate a slow database
+    int dataLatencyJitterUs;
+    int dataLatencyPerRowUs;
+    unsigned long long dataLatencySeed;
+
     std::string outputPath;
+    int configReloadIntervalMs; // How often the config file is checked for changes; 0 disables hot reload
 
     // HL7 Message Defaults
     std::string defaultSendingApplication;
@@ -93,6 +149,84 @@ struct AppConfig {
     CodeConfig reportSectionCode;
     std::string organizationOid;
 
+    // XSD validation settings
+    std::string validationMode; // "sax" (streaming SAX2, default) or "dom"
+    std::string grammarCachePath; // Serialized compiled grammar pool; empty disables the cache
+    int fullValidationSamplePercent; // Share of fast-path-valid documents also checked against the XSD (0-100)
+
+    // Key images embedded in the report section (observationMedia), from instances with a DICOM file
+    std::vector<int> keyImageFrames; // 1-based frame numbers, 0 for the last frame; empty disables key images
+    int keyImageMaxDimension;        // Longest side in pixels after downscaling; 0 keeps the full size
+    int keyImageMaxPerDocument;
+
+    // Count analysis of static NM images (total, region and ratio observations)
+    bool countAnalysisEnabled;
+    std::vector<CountRoiConfig> countRois;
+    std::vector<CountRatioConfig> countRatios;
+    bool countUseOverlays;          // Also count the ROI overlays stored in the image
+    std::string countCodeSystem;    // OID of the local code system for the measurement codes
+
+    // Time-activity curves of dynamic NM images
+    bool dynamicAnalysisEnabled;
+    int dynamicAnalysisThreads;     // Frames are decoded and counted on this many threads; 0: one per core
+    std::vector<CountRoiConfig> dynamicRois;
+    std::string dynamicBackgroundRoi; // Region subtracted from the others, scaled by area; empty: none
+    std::vector<SplitFunctionConfig> dynamicSplitFunctions;
+    bool dynamicUseOverlays;
+    std::string dynamicCodeSystem;
+
+    // HTTP server mode (--server)
+    std::string serverBindAddress;
+    int serverPort;              // Used when --server is given without a port
+    int serverWorkers;           // Worker threads, each with its own DB connection and generator
+    int serverMaxInFlight;       // Requests queued or executing before new ones get 503
+    int serverKeepAliveTimeoutMs;
+    int serverMaxBatchSize;      // Most study UIDs accepted by one POST /cda/batch
+
+    // Worker mode (--worker), see db/cda_jobs.sql
+    int jobWorkers;              // Threads per process, each with its own connections and generator
+    int jobBatchSize;            // Jobs claimed per round trip
+    int jobLeaseSeconds;         // A job whose worker stops renewing it is retried after this
+    int jobPollIntervalMs;       // Idle wait when no notification arrives (or without LISTEN)
+    int jobRetryBackoffSeconds;  // A failed job waits attempts^2 * this before its next attempt
+    std::string jobListenConnInfo; // libpq connection string for LISTEN cda_jobs; empty: poll only
+
+    // Output tree (OutputLayout, OutputIndex)
+    std::string outputScheme;     // flat, hash or date
+    int outputHashLevels;         // Directory levels of the hash scheme
+    std::string outputIndexPath;  // Study UID -> document index; empty: <outputPath>/index.tsv
+
+    // Document writes of worker and batch mode (AsyncWriter)
+    int writerThreads;
+    int writerQueueCapacity;      // Documents waiting to be written before generation blocks
+    int writerGroupSize;          // Files per group fsync
+    int writerSyncIntervalMs;     // Longest a written file waits for its fsync; 0: until its group fills
+    int writerMaxOpenFiles;       // Written files awaiting their group commit, each holding a descriptor
+
+    // Output compression of worker and batch mode (DocumentCompressor)
+    std::string compressionFormat; // none, gzip or zstd
+    int compressionLevel;          // 0: the format's default
+    std::string compressionDictionaryPath; // zstd dictionary, see --train-dictionary
+    int compressionBundleSize;     // Batch files sink: documents per .tar bundle; 0: a file per document
+    int compressionDictionarySamples; // Documents generated by --train-dictionary
+    int compressionDictionarySizeKB;
+
+    // Batch mode (--batch)
+    std::string batchJournalPath; // Checkpoint journal; empty: <outputPath>/.checkpoint
+    int batchJournalGroupSize;    // Completed studies per journal fsync
+    int batchJournalSyncIntervalMs; // Longest a completed study waits for its journal fsync
+    std::string batchSink;        // files (one per document, OutputLayout) or segments (SegmentWriter)
+    std::string batchSegmentDirectory; // empty: <outputPath>/segments
+    int batchSegmentSizeMB;
+    bool batchSegmentCompress;    // zlib per record
+
+    // Metrics
+    std::string metricsFilePath;  // Prometheus text file rewritten periodically; empty disables it
+    int metricsExportIntervalMs;
+
+    // Named profiles, in selection order (first match wins)
+    std::vector<CdaProfileConfig> cdaProfiles;
+
     // Potentially a list of other relevant OIDs
     std::vector<OidConfig> customOids;
 };
@@ -105,6 +239,13 @@ public:
     bool loadConfig(const std::string& configFilepath);
     bool loadConfig();
     const AppConfig& getConfig() const;
+    // Header values with all fallbacks applied; rebuilt by every successful loadConfig
+    const ResolvedCdaProfile& getCdaProfile() const; // The default profile
+    const CdaProfileSet& getCdaProfiles() const;
+    // Copies the loaded configuration into a new immutable snapshot (see ConfigSnapshot.h)
+    std::shared_ptr<const ConfigSnapshot> createSnapshot(unsigned long version) const;
+    // Sections with a changed setting that only takes effect after a restart (e.g. "server")
+    static std::vector<std::string> restartRequiredChanges(const AppConfig& before, const AppConfig& after);
 
     // Getter methods for test compatibility
     std::string getDsn() const;
@@ -116,10 +257,14 @@ public:
 
 private:
     AppConfig appConfig;
+    CdaProfileSet cdaProfiles;
     bool loaded;
     std::string configFilePath_;
 
     std::string getNodeText(const pugi::xml_node& node, const std::string& defaultValue = "");
+    void readCodeConfig(const pugi::xml_node& node, CodeConfig& code);
+    void readRois(const pugi::xml_node& parentNode, const char* section, std::vector<CountRoiConfig>& rois);
+    void readProfiles(const pugi::xml_node& profilesNode);
 };
 
 #endif // CONFIGMANAGER_H
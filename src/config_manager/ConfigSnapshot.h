@@ -0,0 +1,35 @@
+#ifndef CONFIGSNAPSHOT_H
+#define CONFIGSNAPSHOT_H
+
+#include <memory>
+#include <string>
+#include "ConfigManager.h"
+#include "CdaProfileSet.h"
+
+// One immutable generation of the configuration: the parsed AppConfig and the CDA
+// profiles resolved and compiled from it. Snapshots are shared read-only between threads and are
+// never modified after publication; a reload publishes a new one.
+struct ConfigSnapshot {
+    AppConfig config;
+    CdaProfileSet profiles;
+    unsigned long version = 0; // Increases with every published reload
+};
+
+// Holds the current snapshot (RCU style). Readers take a reference once per unit of
+// work and keep using it until they are done, even if a newer snapshot is published
+// in the meantime; the old one is freed when its last reader lets go.
+class ConfigStore {
+public:
+    explicit ConfigStore(std::shared_ptr<const ConfigSnapshot> initial) : snapshot(std::move(initial)) {}
+
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    std::shared_ptr<const ConfigSnapshot> current() const { return std::atomic_load(&snapshot); }
+    void publish(std::shared_ptr<const ConfigSnapshot> next) { std::atomic_store(&snapshot, std::move(next)); }
+
+private:
+    std::shared_ptr<const ConfigSnapshot> snapshot; // Only accessed through std::atomic_load / std::atomic_store
+};
+
+#endif // CONFIGSNAPSHOT_H
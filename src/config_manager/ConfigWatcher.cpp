@@ -0,0 +1,148 @@
+#include "ConfigWatcher.h"
+#include "../xsd_validator/FastCdaChecker.h"
+#include "../metrics/Metrics.h"
+#include "../tracing/Tracer.h"
+#include <iostream>
+#include <system_error>
+
+namespace {
+
+bool isUid(const char* value) {
+    return FastCdaChecker::isOid(value) || FastCdaChecker::isUuid(value) || FastCdaChecker::isRuid(value);
+}
+
+bool checkUid(const char* label, const char* value, std::string& problem) {
+    if (value && !isUid(value)) {
+        problem = std::string(label) + " '" + value + "' is not a valid OID/UUID";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher(const std::string& configFilePath, ConfigStore& store, int pollIntervalMs)
+    : configFilePath(configFilePath), store(store), pollInterval(pollIntervalMs), stopping(false), lastSize(0) {
+    std::error_code ec;
+    lastWriteTime = std::filesystem::last_write_time(configFilePath, ec);
+    lastSize = std::filesystem::file_size(configFilePath, ec);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+}
+
+void ConfigWatcher::start() {
+    if (worker.joinable() || pollInterval.count() <= 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+    worker = std::thread(&ConfigWatcher::run, this);
+    std::cout << "Watching '" << configFilePath << "' for changes every " << pollInterval.count() << " ms." << std::endl;
+}
+
+void ConfigWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void ConfigWatcher::run() {
+    HL7_TRACE_THREAD_NAME("config-watcher");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wakeUp.wait_for(lock, pollInterval, [this] { return stopping; })) {
+        lock.unlock();
+        pollOnce();
+        lock.lock();
+    }
+}
+
+bool ConfigWatcher::pollOnce() {
+    std::error_code ec;
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(configFilePath, ec);
+    if (ec) {
+        return false; // Editors may briefly remove the file while replacing it; try again next time
+    }
+    std::uintmax_t size = std::filesystem::file_size(configFilePath, ec);
+    if (ec || (writeTime == lastWriteTime && size == lastSize)) {
+        return false;
+    }
+    lastWriteTime = writeTime;
+    lastSize = size;
+    return reload();
+}
+
+bool ConfigWatcher::reload() {
+    HL7_TRACE_SCOPE("configReload");
+    std::shared_ptr<const ConfigSnapshot> current = store.current();
+
+    ConfigManager manager;
+    if (!manager.loadConfig(configFilePath)) {
+        std::cerr << "Config reload: '" << configFilePath << "' could not be loaded; keeping version "
+                  << current->version << "." << std::endl;
+        Metrics::instance().configReloadFailures.add();
+        return false;
+    }
+
+    std::shared_ptr<const ConfigSnapshot> next = manager.createSnapshot(current->version + 1);
+    std::string problem;
+    if (!validateSnapshot(*next, problem)) {
+        std::cerr << "Config reload rejected: " << problem << "; keeping version " << current->version << "." << std::endl;
+        Metrics::instance().configReloadFailures.add();
+        return false;
+    }
+
+    for (const std::string& section : ConfigManager::restartRequiredChanges(current->config, next->config)) {
+        std::cout << "Config reload: " << section << " settings changed; they take effect after a restart." << std::endl;
+    }
+
+    store.publish(next);
+    Metrics::instance().configReloads.add();
+    std::cout << "Config reload: published version " << next->version << " from '" << configFilePath << "'." << std::endl;
+    return true;
+}
+
+bool ConfigWatcher::validateSnapshot(const ConfigSnapshot& snapshot, std::string& problem) {
+    for (const ResolvedCdaProfile& profile : snapshot.profiles.all()) {
+        if (!validateProfile(profile, problem)) {
+            problem = "profile '" + std::string(profile.name) + "': " + problem;
+            return false;
+        }
+    }
+
+    const std::string& xsdPath = snapshot.config.cdaXsdPath;
+    std::error_code ec;
+    if (!xsdPath.empty() && !std::filesystem::exists(xsdPath, ec)) {
+        problem = "CdaXsdPath '" + xsdPath + "' does not exist";
+        return false;
+    }
+    return true;
+}
+
+bool ConfigWatcher::validateProfile(const ResolvedCdaProfile& profile, std::string& problem) {
+    for (const auto& templateId : profile.templateIds) {
+        if (!checkUid("templateId root", templateId.root, problem)) return false;
+    }
+    if (!checkUid("DocumentIdRootOid", profile.documentIdRoot, problem) ||
+        !checkUid("PatientIdRootOid", profile.patientIdRoot, problem) ||
+        !checkUid("author id root", profile.authorId.root, problem) ||
+        !checkUid("custodian id root", profile.custodianId.root, problem) ||
+        !checkUid("encounter id root", profile.encounterIdRoot, problem) ||
+        !checkUid("facility id root", profile.facilityId.root, problem) ||
+        !checkUid("DocumentCode codeSystem", profile.documentCode.codeSystem, problem) ||
+        !checkUid("ConfidentialityCode codeSystem", profile.confidentialityCode.codeSystem, problem) ||
+        !checkUid("GenderCodeSystem", profile.genderCodeSystem, problem) ||
+        !checkUid("EncounterTypeCode codeSystem", profile.encounterCode.codeSystem, problem) ||
+        !checkUid("ReportSectionCode codeSystem", profile.reportSectionCode.codeSystem, problem)) {
+        return false;
+    }
+    return true;
+}
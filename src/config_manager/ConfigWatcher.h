@@ -0,0 +1,51 @@
+#ifndef CONFIGWATCHER_H
+#define CONFIGWATCHER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <filesystem>
+#include "ConfigSnapshot.h"
+
+// Watches the config file on a background thread. When it changes, the file is parsed
+// and checked off the hot path and, if it is usable, published to the ConfigStore as a
+// new snapshot. A config that fails to load or validate is reported and ignored, so the
+// process keeps running on the last good snapshot.
+class ConfigWatcher {
+public:
+    ConfigWatcher(const std::string& configFilePath, ConfigStore& store, int pollIntervalMs);
+    ~ConfigWatcher(); // Stops the watcher thread
+
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    void start();
+    void stop();
+
+    // Checks the file once and reloads it if it changed. Returns true when a new snapshot was published.
+    bool pollOnce();
+
+    // Checks that a freshly loaded snapshot can be emitted: well-formed identifiers and an existing XSD
+    static bool validateSnapshot(const ConfigSnapshot& snapshot, std::string& problem);
+    static bool validateProfile(const ResolvedCdaProfile& profile, std::string& problem);
+
+private:
+    std::string configFilePath;
+    ConfigStore& store;
+    std::chrono::milliseconds pollInterval;
+
+    std::thread worker;
+    std::mutex mutex; // Guards `stopping` for the watcher's own sleep; readers never touch it
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    std::filesystem::file_time_type lastWriteTime;
+    std::uintmax_t lastSize;
+
+    void run();
+    bool reload();
+};
+
+#endif // CONFIGWATCHER_H
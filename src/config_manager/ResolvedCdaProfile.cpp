@@ -0,0 +1,175 @@
+#include "ResolvedCdaProfile.h"
+#include "ConfigManager.h"
+
+// Values used when neither the config nor its fallbacks provide one
+const std::string DEFAULT_STRING = "Unknown";
+const std::string DEFAULT_OID_ROOT = "2.25.0.0.0.0"; // Example placeholder OID
+const std::string DEFAULT_CODE = "UNK";
+const std::string DEFAULT_DATE = "19000101";
+const std::string DEFAULT_CODESYSTEM_NULLFLAVOR = "2.16.840.1.113883.5.1008"; // HL7 NullFlavor
+const std::string DEFAULT_DISPLAYNAME = "Unknown";
+const std::string FIXED_TYPEID_ROOT = "2.16.840.1.113883.1.3"; // CDA R2 fixed value for typeId/@root
+const std::string DEFAULT_TYPEID_EXTENSION = "POCD_HD000040"; // Common extension for base CDA
+const std::string DEFAULT_LANGUAGE_CODE = "pl-PL";
+const std::string DEFAULT_CONFIDENTIALITY_CODE = "N"; // Normal
+const std::string DEFAULT_CONFIDENTIALITY_CODESYSTEM = "2.16.840.1.113883.5.25"; // HL7 Confidentiality
+const std::string DEFAULT_REALM_CODE = "PL"; // Default realm
+const std::string DEFAULT_SECTION_CODE = "18748-4"; // LOINC Diagnostic Imaging Report
+const std::string DEFAULT_SECTION_CODESYSTEM = "2.16.840.1.113883.6.1"; // LOINC
+const std::string DEFAULT_SECTION_CODESYSTEM_NAME = "LOINC";
+const std::string DEFAULT_SECTION_DISPLAYNAME = "Diagnostic Imaging Report Section";
+
+const char* ResolvedCdaProfile::intern(const std::string& value) {
+    for (const std::string& existing : strings) {
+        if (existing == value) {
+            return existing.c_str();
+        }
+    }
+    strings.push_back(value);
+    return strings.back().c_str();
+}
+
+const char* ResolvedCdaProfile::firstOf(const std::string& value, const std::string& fallback, const std::string& lastResort) {
+    if (!value.empty()) return intern(value);
+    if (!fallback.empty()) return intern(fallback);
+    return intern(lastResort);
+}
+
+ResolvedCdaProfile ResolvedCdaProfile::resolve(const AppConfig& config, const std::string& profileName) {
+    ResolvedCdaProfile profile;
+    const std::string none;
+
+    profile.name = profile.intern(profileName);
+    profile.unknownText = profile.intern(DEFAULT_STRING);
+    profile.unknownCode = profile.intern(DEFAULT_CODE);
+    profile.unknownDate = profile.intern(DEFAULT_DATE);
+    profile.nullFlavorCodeSystem = profile.intern(DEFAULT_CODESYSTEM_NULLFLAVOR);
+
+    // ClinicalDocument
+    if (!config.cdaXsdPath.empty()) {
+        profile.schemaLocation = profile.intern("urn:hl7-org:v3 " + config.cdaXsdPath);
+    }
+    profile.realmCode = profile.firstOf(config.realmCode, none, DEFAULT_REALM_CODE);
+    profile.typeId.root = profile.intern(FIXED_TYPEID_ROOT);
+    profile.typeId.extension = profile.firstOf(config.typeIdExtension, none, DEFAULT_TYPEID_EXTENSION);
+    for (const auto& tmplId : config.templateIds) {
+        ResolvedId id;
+        id.root = profile.firstOf(tmplId.root, none, DEFAULT_OID_ROOT);
+        id.extension = tmplId.extension.empty() ? nullptr : profile.intern(tmplId.extension); // Optional for templateId
+        profile.templateIds.push_back(id);
+    }
+    profile.documentIdRoot = profile.firstOf(config.documentIdRootOid, config.organizationOid, DEFAULT_OID_ROOT);
+
+    profile.documentCode.code = profile.firstOf(config.documentCode.code, none, DEFAULT_CODE);
+    profile.documentCode.codeSystem = profile.firstOf(config.documentCode.codeSystem, none, DEFAULT_CODESYSTEM_NULLFLAVOR);
+    profile.documentCode.codeSystemName = profile.firstOf(config.documentCode.codeSystemName, none, DEFAULT_STRING);
+    profile.documentCode.displayName = profile.firstOf(config.documentCode.displayName, none, DEFAULT_DISPLAYNAME);
+
+    profile.documentTitle = config.documentTitle.empty() ? nullptr : profile.intern(config.documentTitle);
+
+    const std::string& confCode = config.confidentialityCode.code.empty() ? DEFAULT_CONFIDENTIALITY_CODE : config.confidentialityCode.code;
+    const std::string& confCodeSystem = config.confidentialityCode.codeSystem.empty() ? DEFAULT_CONFIDENTIALITY_CODESYSTEM : config.confidentialityCode.codeSystem;
+    profile.confidentialityCode.code = profile.intern(confCode);
+    profile.confidentialityCode.codeSystem = profile.intern(confCodeSystem);
+    if (!config.confidentialityCode.displayName.empty()) {
+        profile.confidentialityCode.displayName = profile.intern(config.confidentialityCode.displayName);
+    } else if (confCodeSystem == DEFAULT_CONFIDENTIALITY_CODESYSTEM) {
+        if (confCode == "N") profile.confidentialityCode.displayName = profile.intern("Normal");
+        else if (confCode == "R") profile.confidentialityCode.displayName = profile.intern("Restricted");
+        else if (confCode == "V") profile.confidentialityCode.displayName = profile.intern("Very Restricted");
+    }
+
+    profile.languageCode = profile.firstOf(config.languageCode, none, DEFAULT_LANGUAGE_CODE);
+
+    // recordTarget
+    profile.patientIdRoot = profile.firstOf(config.patientIdRootOid, none, DEFAULT_OID_ROOT);
+    profile.genderCodeSystem = profile.firstOf(config.genderCodeSystem, none, DEFAULT_CODESYSTEM_NULLFLAVOR);
+
+    // author
+    profile.authorId.root = profile.firstOf(config.authorIdRootOid, config.organizationOid, DEFAULT_OID_ROOT);
+    profile.authorId.extension = profile.firstOf(config.authorIdExtension, config.defaultSendingApplication, DEFAULT_STRING);
+    profile.authorDeviceManufacturer = profile.firstOf(config.authorDeviceManufacturer, none, DEFAULT_STRING);
+    profile.authorDeviceSoftwareName = profile.firstOf(config.authorDeviceSoftwareName, none, DEFAULT_STRING);
+
+    // custodian: a placeholder root gets a placeholder extension, otherwise the extension is optional
+    profile.custodianId.root = profile.firstOf(config.custodianOrgIdRootOid, config.organizationOid, DEFAULT_OID_ROOT);
+    if (!config.custodianOrgIdExtension.empty()) {
+        profile.custodianId.extension = profile.intern(config.custodianOrgIdExtension);
+    } else if (DEFAULT_OID_ROOT == profile.custodianId.root) {
+        profile.custodianId.extension = profile.unknownText;
+    }
+    profile.custodianName = profile.firstOf(config.custodianOrgName, config.sendingFacility, DEFAULT_STRING);
+
+    // componentOf
+    profile.encounterIdRoot = profile.firstOf(config.encounterIdRootOid, none, DEFAULT_OID_ROOT);
+    if (!config.encounterTypeCode.code.empty()) { // Otherwise the <code> element is omitted
+        profile.encounterCode.code = profile.intern(config.encounterTypeCode.code);
+        profile.encounterCode.codeSystem = profile.firstOf(config.encounterTypeCode.codeSystem, none, DEFAULT_CODESYSTEM_NULLFLAVOR);
+        profile.encounterCode.displayName = profile.firstOf(config.encounterTypeCode.displayName, none, DEFAULT_DISPLAYNAME);
+    }
+    profile.facilityId.root = profile.firstOf(config.locationFacilityIdRootOid, config.organizationOid, DEFAULT_OID_ROOT);
+    if (!config.locationFacilityIdExtension.empty()) {
+        profile.facilityId.extension = profile.intern(config.locationFacilityIdExtension);
+    } else if (DEFAULT_OID_ROOT == profile.facilityId.root) {
+        profile.facilityId.extension = profile.unknownText;
+    }
+    profile.facilityName = profile.firstOf(config.locationFacilityName, config.sendingFacility, DEFAULT_STRING);
+
+    // structuredBody
+    profile.reportSectionCode.code = profile.firstOf(config.reportSectionCode.code, none, DEFAULT_SECTION_CODE);
+    profile.reportSectionCode.codeSystem = profile.firstOf(config.reportSectionCode.codeSystem, none, DEFAULT_SECTION_CODESYSTEM);
+    profile.reportSectionCode.codeSystemName = profile.firstOf(config.reportSectionCode.codeSystemName, none, DEFAULT_SECTION_CODESYSTEM_NAME);
+    profile.reportSectionCode.displayName = profile.firstOf(config.reportSectionCode.displayName, none, DEFAULT_SECTION_DISPLAYNAME);
+
+    return profile;
+}
+
+namespace {
+
+const char* orOmitted(const char* value) {
+    return value ? value : "(omitted)";
+}
+
+void dumpId(std::ostream& out, const char* label, const ResolvedId& id) {
+    out << "  " << label << ": root=" << orOmitted(id.root) << " extension=" << orOmitted(id.extension) << "\n";
+}
+
+void dumpCode(std::ostream& out, const char* label, const ResolvedCode& code) {
+    if (!code.code) {
+        out << "  " << label << ": (omitted)\n";
+        return;
+    }
+    out << "  " << label << ": code=" << code.code << " codeSystem=" << orOmitted(code.codeSystem)
+        << " codeSystemName=" << orOmitted(code.codeSystemName) << " displayName=" << orOmitted(code.displayName) << "\n";
+}
+
+} // namespace
+
+void ResolvedCdaProfile::dump(std::ostream& out) const {
+    out << "Resolved CDA profile '" << name << "':\n";
+    out << "  unknown text / code / date: " << unknownText << " / " << unknownCode << " / " << unknownDate << "\n";
+    out << "  nullFlavor codeSystem: " << nullFlavorCodeSystem << "\n";
+    out << "  schemaLocation: " << orOmitted(schemaLocation) << "\n";
+    out << "  realmCode: " << realmCode << "\n";
+    dumpId(out, "typeId", typeId);
+    for (const auto& templateId : templateIds) {
+        dumpId(out, "templateId", templateId);
+    }
+    out << "  document id root: " << documentIdRoot << "\n";
+    dumpCode(out, "code", documentCode);
+    out << "  title: " << (documentTitle ? documentTitle : "Report - <study description>") << "\n";
+    dumpCode(out, "confidentialityCode", confidentialityCode);
+    out << "  languageCode: " << languageCode << "\n";
+    out << "  patient id root: " << patientIdRoot << "\n";
+    out << "  gender codeSystem: " << genderCodeSystem << "\n";
+    dumpId(out, "author id", authorId);
+    out << "  author device: " << authorDeviceManufacturer << " / " << authorDeviceSoftwareName << "\n";
+    dumpId(out, "custodian id", custodianId);
+    out << "  custodian name: " << custodianName << "\n";
+    out << "  encounter id root: " << encounterIdRoot << "\n";
+    dumpCode(out, "encounter code", encounterCode);
+    dumpId(out, "facility id", facilityId);
+    out << "  facility name: " << facilityName << "\n";
+    dumpCode(out, "report section code", reportSectionCode);
+    out.flush();
+}
@@ -0,0 +1,93 @@
+#ifndef RESOLVEDCDAPROFILE_H
+#define RESOLVEDCDAPROFILE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <ostream>
+
+struct AppConfig;
+
+// A coded value with every fallback applied. Optional attributes are nullptr when omitted.
+struct ResolvedCode {
+    const char* code = nullptr;
+    const char* codeSystem = nullptr;
+    const char* codeSystemName = nullptr;
+    const char* displayName = nullptr;
+};
+
+// An II value; extension is nullptr when omitted
+struct ResolvedId {
+    const char* root = nullptr;
+    const char* extension = nullptr;
+};
+
+// The CDA header values HL7MessageGenerator emits, resolved once from AppConfig.
+// All config fallbacks (e.g. authorIdRootOid -> organizationOid -> default OID) are
+// applied up front and the results kept as interned, null-terminated strings, so
+// building a document does not evaluate fallbacks or create temporary strings.
+// The strings are owned by the profile; it is move-only so they stay put.
+// A new field also needs a line in dump() and in hashProfile (HL7MessageGenerator.cpp),
+// which feeds the input hashes that decide whether a study is regenerated.
+class ResolvedCdaProfile {
+public:
+    ResolvedCdaProfile() = default;
+    ResolvedCdaProfile(ResolvedCdaProfile&&) = default;
+    ResolvedCdaProfile& operator=(ResolvedCdaProfile&&) = default;
+    ResolvedCdaProfile(const ResolvedCdaProfile&) = delete;
+    ResolvedCdaProfile& operator=(const ResolvedCdaProfile&) = delete;
+
+    static ResolvedCdaProfile resolve(const AppConfig& config, const std::string& profileName = "default");
+
+    // Writes every resolved value, i.e. exactly what will be emitted
+    void dump(std::ostream& out) const;
+
+    const char* name = nullptr; // Profile name ("default" or a <Profile name="...">)
+
+    // Placeholders for missing patient / study data
+    const char* unknownText = nullptr;     // Text and II extensions
+    const char* unknownCode = nullptr;     // Coded values (a NullFlavor)
+    const char* unknownDate = nullptr;     // Birth time / study date
+    const char* nullFlavorCodeSystem = nullptr;
+
+    // ClinicalDocument
+    const char* schemaLocation = nullptr; // nullptr when no XSD is configured
+    const char* realmCode = nullptr;
+    ResolvedId typeId;
+    std::vector<ResolvedId> templateIds;
+    const char* documentIdRoot = nullptr;
+    ResolvedCode documentCode;
+    const char* documentTitle = nullptr;  // nullptr: "Report - <study description>"
+    ResolvedCode confidentialityCode;
+    const char* languageCode = nullptr;
+
+    // recordTarget
+    const char* patientIdRoot = nullptr;
+    const char* genderCodeSystem = nullptr;
+
+    // author
+    ResolvedId authorId;
+    const char* authorDeviceManufacturer = nullptr;
+    const char* authorDeviceSoftwareName = nullptr;
+
+    // custodian
+    ResolvedId custodianId;
+    const char* custodianName = nullptr;
+
+    // componentOf
+    const char* encounterIdRoot = nullptr;
+    ResolvedCode encounterCode;            // code is nullptr when the element is omitted
+    ResolvedId facilityId;
+    const char* facilityName = nullptr;
+
+    // structuredBody
+    ResolvedCode reportSectionCode;
+
+private:
+    std::deque<std::string> strings; // Backing storage; deque keeps element addresses stable
+
+    const char* intern(const std::string& value);
+    const char* firstOf(const std::string& value, const std::string& fallback, const std::string& lastResort);
+};
+
+#endif // RESOLVEDCDAPROFILE_H
@@ -0,0 +1,118 @@
+#include "DicomStudyCatalog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include "../dicom_parser/DicomParser.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Series and Instance Numbers are IS strings; missing or malformed ones sort last
+long numberOrder(const std::string& number) {
+    char* end = nullptr;
+    long value = std::strtol(number.c_str(), &end, 10);
+    return end != number.c_str() ? value : 2147483647L;
+}
+
+} // namespace
+
+// Walks one study of a catalog; holds the catalog so it outlives a reload of the factory's copy
+class CatalogStudyReader : public StudyContentReader {
+public:
+    CatalogStudyReader(std::shared_ptr<const DicomStudyCatalog> catalog, const std::vector<DicomStudyCatalog::SeriesEntry>& series)
+        : catalog(std::move(catalog)), series(series) {}
+
+    bool nextSeries(Series& out) override {
+        if (seriesIndex >= series.size()) return false;
+        out = series[seriesIndex++].series;
+        instanceIndex = 0;
+        return true;
+    }
+    bool nextInstance(Instance& out) override {
+        if (seriesIndex == 0) return false;
+        const std::vector<Instance>& instances = series[seriesIndex - 1].instances;
+        if (instanceIndex >= instances.size()) return false;
+        out = instances[instanceIndex++];
+        return true;
+    }
+
+private:
+    std::shared_ptr<const DicomStudyCatalog> catalog;
+    const std::vector<DicomStudyCatalog::SeriesEntry>& series;
+    size_t seriesIndex = 0;
+    size_t instanceIndex = 0;
+};
+
+std::shared_ptr<const DicomStudyCatalog> DicomStudyCatalog::scan(const std::string& directory) {
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<DicomStudyCatalog> catalog(new DicomStudyCatalog());
+    size_t unreadable = 0;
+    try {
+        for (const auto& entry : fs::recursive_directory_iterator(directory, fs::directory_options::skip_permission_denied)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+            const std::string path = entry.path().string();
+            DicomParser parser;
+            if (!parser.loadHeader(path)) {
+                ++unreadable;
+                continue;
+            }
+            Series series = parser.getSeriesInfo();
+            Instance instance = parser.getInstanceInfo();
+            instance.filePath = path; // Key images and analyses load the whole file again when they need its frames
+            if (series.studyInstanceUID.empty() || series.seriesInstanceUID.empty() || instance.sopInstanceUID.empty()) {
+                ++unreadable;
+                continue;
+            }
+            std::vector<SeriesEntry>& studySeries = catalog->studies[series.studyInstanceUID];
+            auto found = std::find_if(studySeries.begin(), studySeries.end(), [&](const SeriesEntry& existing) {
+                return existing.series.seriesInstanceUID == series.seriesInstanceUID;
+            });
+            if (found == studySeries.end()) {
+                studySeries.push_back(SeriesEntry{series, {}});
+                found = studySeries.end() - 1;
+            }
+            found->instances.push_back(std::move(instance));
+            ++catalog->instances;
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error: Cannot scan DICOM directory " << directory << ": " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    for (auto& study : catalog->studies) {
+        std::vector<SeriesEntry>& series = study.second;
+        std::stable_sort(series.begin(), series.end(), [](const SeriesEntry& a, const SeriesEntry& b) {
+            return numberOrder(a.series.seriesNumber) < numberOrder(b.series.seriesNumber);
+        });
+        for (SeriesEntry& entry : series) {
+            std::stable_sort(entry.instances.begin(), entry.instances.end(), [](const Instance& a, const Instance& b) {
+                return numberOrder(a.instanceNumber) < numberOrder(b.instanceNumber);
+            });
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "DICOM catalog " << directory << ": " << catalog->instances << " instances of " << catalog->studies.size()
+              << " studies in " << seconds << " s";
+    if (unreadable > 0) {
+        std::cout << " (" << unreadable << " files skipped: not DICOM, or without study, series or SOP Instance UID)";
+    }
+    std::cout << "." << std::endl;
+    return catalog;
+}
+
+std::unique_ptr<StudyContentReader> DicomStudyCatalog::open(const std::shared_ptr<const DicomStudyCatalog>& catalog,
+                                                            const std::string& studyInstanceUid) {
+    if (!catalog) {
+        return nullptr;
+    }
+    auto study = catalog->studies.find(studyInstanceUid);
+    if (study == catalog->studies.end()) {
+        return nullptr;
+    }
+    return std::unique_ptr<StudyContentReader>(new CatalogStudyReader(catalog, study->second));
+}
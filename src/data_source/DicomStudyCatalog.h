@@ -0,0 +1,45 @@
+#ifndef DICOMSTUDYCATALOG_H
+#define DICOMSTUDYCATALOG_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "StudyContentReader.h"
+
+// Series and instances of every study found under a directory of DICOM files
+// (<DataSource><DicomDirectory>), e.g. an archive export or hl7_datagen --dicom-dir.
+// Patients and studies still come from the PatientStudySource; the catalog adds what
+// the Patients and Studies tables do not have, so the generator can write a study's
+// series organizers and instance entries. Each instance carries the path of its file
+// (Instance::filePath), from which the generator reads key images and count analyses.
+//
+// The directory is scanned once, reading only the attributes of each file. Series are
+// kept in Series Number order and instances in Instance Number order. Immutable after
+// scan(), so one catalog is shared by every source and thread.
+class DicomStudyCatalog {
+public:
+    // Returns nullptr (after logging why) when the directory cannot be read
+    static std::shared_ptr<const DicomStudyCatalog> scan(const std::string& directory);
+
+    // A reader over the study's series and instances; nullptr when no file belongs to it.
+    // The reader keeps the catalog alive.
+    static std::unique_ptr<StudyContentReader> open(const std::shared_ptr<const DicomStudyCatalog>& catalog,
+                                                    const std::string& studyInstanceUid);
+
+    size_t studyCount() const { return studies.size(); }
+    size_t instanceCount() const { return instances; }
+
+private:
+    struct SeriesEntry {
+        Series series;
+        std::vector<Instance> instances;
+    };
+
+    std::unordered_map<std::string, std::vector<SeriesEntry>> studies; // By study UID
+    size_t instances = 0;
+
+    friend class CatalogStudyReader;
+};
+
+#endif // DICOMSTUDYCATALOG_H
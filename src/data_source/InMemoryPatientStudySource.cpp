@@ -0,0 +1,51 @@
+#include "InMemoryPatientStudySource.h"
+#include "../tracing/Tracer.h"
+
+InMemoryPatientStudySource::InMemoryPatientStudySource(std::shared_ptr<const PatientStudySnapshot> snapshot)
+    : snapshot(std::move(snapshot)) {
+}
+
+std::vector<Patient> InMemoryPatientStudySource::getAllPatients() {
+    HL7_TRACE_SCOPE("getAllPatients");
+    std::vector<Patient> result;
+    result.reserve(snapshot->patientCount());
+    for (const CompactPatient& p : snapshot->records.patients()) {
+        result.push_back(snapshot->records.toPatient(p));
+    }
+    return result;
+}
+
+std::vector<Patient> InMemoryPatientStudySource::searchPatients(const std::string& searchTerm) {
+    HL7_TRACE_SCOPE("searchPatients");
+    std::vector<Patient> result;
+    const CompactRecordBatch& records = snapshot->records;
+    for (const CompactPatient& p : records.patients()) {
+        if (records.text(p.name).find(searchTerm) != std::string::npos || records.text(p.patientID).find(searchTerm) != std::string::npos) {
+            result.push_back(records.toPatient(p));
+        }
+    }
+    return result;
+}
+
+Patient InMemoryPatientStudySource::getPatientById(const std::string& patientId) {
+    HL7_TRACE_SCOPE("getPatientById");
+    const CompactPatient* patient = snapshot->findPatient(patientId);
+    return patient ? snapshot->records.toPatient(*patient) : Patient();
+}
+
+std::vector<Study> InMemoryPatientStudySource::getStudiesForPatient(const std::string& patientId) {
+    HL7_TRACE_SCOPE("getStudiesForPatient");
+    std::vector<Study> result;
+    PatientStudySnapshot::StudyRange indices = snapshot->studiesOf(patientId);
+    result.reserve(indices.size());
+    for (std::uint32_t index : indices) {
+        result.push_back(snapshot->records.toStudy(snapshot->records.studies()[index]));
+    }
+    return result;
+}
+
+Study InMemoryPatientStudySource::getStudyByUid(const std::string& studyInstanceUid) {
+    HL7_TRACE_SCOPE("getStudyByUid");
+    const CompactStudy* study = snapshot->findStudy(studyInstanceUid);
+    return study ? snapshot->records.toStudy(*study) : Study();
+}
@@ -0,0 +1,24 @@
+#ifndef INMEMORYPATIENTSTUDYSOURCE_H
+#define INMEMORYPATIENTSTUDYSOURCE_H
+
+#include <memory>
+#include "PatientStudySource.h"
+#include "PatientStudySnapshot.h"
+
+// Serves queries from a shared, immutable snapshot: no driver, no network, no SQL.
+// Used to profile rendering and validation without the database in the picture.
+class InMemoryPatientStudySource : public PatientStudySource {
+public:
+    explicit InMemoryPatientStudySource(std::shared_ptr<const PatientStudySnapshot> snapshot);
+
+    std::vector<Patient> getAllPatients() override;
+    std::vector<Patient> searchPatients(const std::string& searchTerm) override;
+    Patient getPatientById(const std::string& patientId) override;
+    std::vector<Study> getStudiesForPatient(const std::string& patientId) override;
+    Study getStudyByUid(const std::string& studyInstanceUid) override;
+
+private:
+    std::shared_ptr<const PatientStudySnapshot> snapshot;
+};
+
+#endif // INMEMORYPATIENTSTUDYSOURCE_H
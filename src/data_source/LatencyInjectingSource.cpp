@@ -0,0 +1,57 @@
+#include "LatencyInjectingSource.h"
+#include <chrono>
+#include <thread>
+#include "../metrics/Metrics.h"
+
+LatencyInjectingSource::LatencyInjectingSource(std::unique_ptr<PatientStudySource> inner, const LatencyOptions& options, std::uint64_t stream)
+    : inner(std::move(inner)), options(options), rngState(options.seed ^ (stream * 0xD6E8FEB86659FD93ull)) {
+}
+
+void LatencyInjectingSource::delay(size_t rows) {
+    long long micros = options.baseUs + static_cast<long long>(rows) * options.perRowUs;
+    if (options.jitterUs > 0) {
+        std::uint64_t z = (rngState += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        micros += static_cast<long long>(z % static_cast<std::uint64_t>(options.jitterUs));
+    }
+    if (micros > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+}
+
+std::vector<Patient> LatencyInjectingSource::getAllPatients() {
+    ScopedTimer timer(Metrics::instance().dbQuery);
+    std::vector<Patient> result = inner->getAllPatients();
+    delay(result.size());
+    return result;
+}
+
+std::vector<Patient> LatencyInjectingSource::searchPatients(const std::string& searchTerm) {
+    ScopedTimer timer(Metrics::instance().dbQuery);
+    std::vector<Patient> result = inner->searchPatients(searchTerm);
+    delay(result.size());
+    return result;
+}
+
+Patient LatencyInjectingSource::getPatientById(const std::string& patientId) {
+    ScopedTimer timer(Metrics::instance().dbQuery);
+    Patient result = inner->getPatientById(patientId);
+    delay(result.patientID.empty() ? 0 : 1);
+    return result;
+}
+
+std::vector<Study> LatencyInjectingSource::getStudiesForPatient(const std::string& patientId) {
+    ScopedTimer timer(Metrics::instance().dbQuery);
+    std::vector<Study> result = inner->getStudiesForPatient(patientId);
+    delay(result.size());
+    return result;
+}
+
+Study LatencyInjectingSource::getStudyByUid(const std::string& studyInstanceUid) {
+    ScopedTimer timer(Metrics::instance().dbQuery);
+    Study result = inner->getStudyByUid(studyInstanceUid);
+    delay(result.studyInstanceUID.empty() ? 0 : 1);
+    return result;
+}
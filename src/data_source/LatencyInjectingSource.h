@@ -0,0 +1,40 @@
+#ifndef LATENCYINJECTINGSOURCE_H
+#define LATENCYINJECTINGSOURCE_H
+
+#include <cstdint>
+#include <memory>
+#include "PatientStudySource.h"
+
+struct LatencyOptions {
+    int baseUs = 0;           // Added to every query (round trip, planning)
+    int jitterUs = 0;         // Plus a uniform [0, jitterUs) share drawn from a seeded stream
+    int perRowUs = 0;         // Plus this per returned row (fetch and transfer)
+    std::uint64_t seed = 1;
+
+    bool enabled() const { return baseUs > 0 || jitterUs > 0 || perRowUs > 0; }
+};
+
+// Decorator that makes a fast source behave like a slow database: every query sleeps
+// for base + jitter + rows * perRow before returning. The jitter sequence depends only
+// on the seed (and the stream index given per instance), so slow-DB runs repeat exactly.
+// The full call, delay included, is recorded in Metrics::dbQuery, so wrap a source that
+// does not record that histogram itself (the in-memory one, not DatabaseService).
+class LatencyInjectingSource : public PatientStudySource {
+public:
+    LatencyInjectingSource(std::unique_ptr<PatientStudySource> inner, const LatencyOptions& options, std::uint64_t stream = 0);
+
+    std::vector<Patient> getAllPatients() override;
+    std::vector<Patient> searchPatients(const std::string& searchTerm) override;
+    Patient getPatientById(const std::string& patientId) override;
+    std::vector<Study> getStudiesForPatient(const std::string& patientId) override;
+    Study getStudyByUid(const std::string& studyInstanceUid) override;
+
+private:
+    std::unique_ptr<PatientStudySource> inner;
+    LatencyOptions options;
+    std::uint64_t rngState; // splitmix64
+
+    void delay(size_t rows);
+};
+
+#endif // LATENCYINJECTINGSOURCE_H
@@ -0,0 +1,386 @@
+#include "PatientStudySnapshot.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'H', 'L', '7', 'S', 'N', 'A', 'P', '1'};
+const std::uint32_t MAX_FIELD_LENGTH = 1 << 20;
+
+// Minimal RFC 4180 reader: quoted fields may contain separators, quotes ("") and newlines
+class CsvReader {
+public:
+    explicit CsvReader(std::istream& input) : in(input) {}
+
+    bool readRow(std::vector<std::string>& fields) {
+        fields.clear();
+        int c = in.get();
+        if (c == EOF) {
+            return false;
+        }
+        std::string field;
+        bool quoted = false;
+        while (true) {
+            if (quoted) {
+                if (c == EOF) {
+                    fields.push_back(field);
+                    return true; // Unterminated quote: take what we have
+                }
+                if (c == '"') {
+                    if (in.peek() == '"') {
+                        field += '"';
+                        in.get();
+                    } else {
+                        quoted = false;
+                    }
+                } else {
+                    field += static_cast<char>(c);
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == ',') {
+                fields.push_back(field);
+                field.clear();
+            } else if (c == '\n' || c == EOF) {
+                if (!field.empty() && field.back() == '\r') field.pop_back();
+                fields.push_back(field);
+                return true;
+            } else {
+                field += static_cast<char>(c);
+            }
+            c = in.get();
+        }
+    }
+
+private:
+    std::istream& in;
+};
+
+// Reads a CSV file whose header row names the columns; calls onRow with the values
+// of `columns` (in that order) for every data row
+template <typename Callback>
+bool readCsvTable(const std::string& path, const std::vector<std::string>& columns, Callback onRow) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open " << path << std::endl;
+        return false;
+    }
+    CsvReader reader(file);
+    std::vector<std::string> header;
+    if (!reader.readRow(header)) {
+        std::cerr << "Error: " << path << " is empty." << std::endl;
+        return false;
+    }
+    if (!header.empty() && header[0].compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        header[0].erase(0, 3); // UTF-8 BOM
+    }
+
+    std::vector<size_t> positions;
+    for (const std::string& column : columns) {
+        size_t position = 0;
+        while (position < header.size() && header[position] != column) ++position;
+        if (position == header.size()) {
+            std::cerr << "Error: " << path << " has no '" << column << "' column." << std::endl;
+            return false;
+        }
+        positions.push_back(position);
+    }
+
+    std::vector<std::string> fields;
+    std::vector<std::string> values(columns.size());
+    size_t line = 1;
+    while (reader.readRow(fields)) {
+        ++line;
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue; // Blank line
+        }
+        if (fields.size() < header.size()) {
+            std::cerr << "Warning: " << path << " row " << line << " has " << fields.size() << " of " << header.size() << " columns, skipped." << std::endl;
+            continue;
+        }
+        for (size_t i = 0; i < positions.size(); ++i) {
+            values[i] = fields[positions[i]];
+        }
+        onRow(values);
+    }
+    return true;
+}
+
+void writeString(std::ostream& out, std::string_view value) {
+    std::uint32_t length = static_cast<std::uint32_t>(value.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+bool readString(std::istream& in, std::string& value) {
+    std::uint32_t length = 0;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > MAX_FIELD_LENGTH) {
+        return false;
+    }
+    value.resize(length);
+    return length == 0 || static_cast<bool>(in.read(&value[0], length));
+}
+
+bool readCount(std::istream& in, std::uint64_t& count) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&count), sizeof(count)));
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR);
+}
+
+} // namespace
+
+std::string PatientStudySnapshot::csvFingerprint(const std::string& directory) {
+    std::ostringstream fingerprint;
+    for (const char* name : {"Patients.csv", "Studies.csv"}) {
+        struct stat info;
+        std::string path = directory + "/" + name;
+        if (stat(path.c_str(), &info) != 0) {
+            return "";
+        }
+        fingerprint << name << ':' << info.st_size << ':' << info.st_mtime << ';';
+    }
+    return fingerprint.str();
+}
+
+std::shared_ptr<const PatientStudySnapshot> PatientStudySnapshot::load(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<PatientStudySnapshot> snapshot = std::make_shared<PatientStudySnapshot>();
+
+    if (isDirectory(path)) {
+        std::string fingerprint = csvFingerprint(path);
+        if (fingerprint.empty()) {
+            std::cerr << "Error: " << path << " must contain Patients.csv and Studies.csv." << std::endl;
+            return nullptr;
+        }
+        std::string cachePath = path + "/snapshot.bin";
+        if (!snapshot->loadBinary(cachePath, fingerprint)) {
+            *snapshot = PatientStudySnapshot();
+            if (!snapshot->loadCsv(path)) {
+                return nullptr;
+            }
+            if (snapshot->saveBinary(cachePath, fingerprint)) {
+                std::cout << "Snapshot cache written to " << cachePath << std::endl;
+            }
+        }
+    } else if (!snapshot->loadBinary(path, "")) {
+        std::cerr << "Error: Cannot load snapshot file " << path << std::endl;
+        return nullptr;
+    }
+
+    snapshot->buildIndexes();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << snapshot->patientCount() << " patients and " << snapshot->studyCount()
+              << " studies from " << path << " in " << seconds << " s (" << snapshot->memoryBytes() / (1024 * 1024)
+              << " MiB in memory)" << std::endl;
+    return snapshot;
+}
+
+std::shared_ptr<const PatientStudySnapshot> PatientStudySnapshot::fromRecords(std::vector<Patient> patients, std::vector<Study> studies) {
+    std::shared_ptr<PatientStudySnapshot> snapshot = std::make_shared<PatientStudySnapshot>();
+    snapshot->records.reserve(patients.size(), studies.size());
+    for (const Patient& p : patients) {
+        snapshot->records.add(p);
+    }
+    for (const Study& s : studies) {
+        snapshot->records.add(s);
+    }
+    snapshot->buildIndexes();
+    return snapshot;
+}
+
+bool PatientStudySnapshot::loadCsv(const std::string& directory) {
+    bool ok = readCsvTable(directory + "/Patients.csv", {"pat_id", "pat_name", "pat_birth_dt", "pat_gender_code"},
+                           [this](const std::vector<std::string>& v) {
+        Patient p;
+        p.patientID = v[0];
+        p.name = v[1];
+        p.dateOfBirth = v[2];
+        p.sex = v[3];
+        records.add(p);
+    });
+    ok = ok && readCsvTable(directory + "/Studies.csv",
+                            {"study_uid", "pat_id", "acc_num", "study_dt", "study_tm", "mod", "study_desc", "ref_phys_name"},
+                            [this](const std::vector<std::string>& v) {
+        Study s;
+        s.studyInstanceUID = v[0];
+        s.patientId = v[1];
+        s.accessionNumber = v[2];
+        s.studyDate = v[3];
+        s.studyTime = v[4];
+        s.modality = v[5];
+        s.studyDescription = v[6];
+        s.referringPhysicianName = v[7];
+        records.add(s);
+    });
+    return ok;
+}
+
+bool PatientStudySnapshot::loadBinary(const std::string& filePath, const std::string& expectedFingerprint) {
+    std::ifstream in(filePath, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    std::string fingerprint;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || !readString(in, fingerprint)) {
+        std::cerr << "Warning: " << filePath << " is not a snapshot file." << std::endl;
+        return false;
+    }
+    if (!expectedFingerprint.empty() && fingerprint != expectedFingerprint) {
+        return false; // The CSV files changed since the cache was written
+    }
+
+    std::uint64_t count = 0;
+    if (!readCount(in, count)) return false;
+    Patient p;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        if (!readString(in, p.patientID) || !readString(in, p.name) || !readString(in, p.dateOfBirth) || !readString(in, p.sex)) {
+            std::cerr << "Warning: " << filePath << " is truncated." << std::endl;
+            return false;
+        }
+        records.add(p);
+    }
+    if (!readCount(in, count)) return false;
+    Study s;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        if (!readString(in, s.studyInstanceUID) || !readString(in, s.patientId) || !readString(in, s.accessionNumber) ||
+            !readString(in, s.studyDate) || !readString(in, s.studyTime) || !readString(in, s.modality) ||
+            !readString(in, s.studyDescription) || !readString(in, s.referringPhysicianName)) {
+            std::cerr << "Warning: " << filePath << " is truncated." << std::endl;
+            return false;
+        }
+        records.add(s);
+    }
+    return true;
+}
+
+bool PatientStudySnapshot::saveBinary(const std::string& filePath, const std::string& fingerprint) const {
+    std::string tempPath = filePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Warning: Cannot write snapshot " << tempPath << std::endl;
+            return false;
+        }
+        out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        writeString(out, fingerprint);
+        std::uint64_t count = patientCount();
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const CompactPatient& p : records.patients()) {
+            writeString(out, records.text(p.patientID));
+            writeString(out, records.text(p.name));
+            writeString(out, records.date(p.dateOfBirth));
+            writeString(out, records.text(p.sex));
+        }
+        count = studyCount();
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const CompactStudy& s : records.studies()) {
+            writeString(out, records.uid(s.studyInstanceUID));
+            writeString(out, records.text(s.patientId));
+            writeString(out, records.text(s.accessionNumber));
+            writeString(out, records.date(s.studyDate));
+            writeString(out, records.time(s.studyTime));
+            writeString(out, records.text(s.modality));
+            writeString(out, records.text(s.studyDescription));
+            writeString(out, records.text(s.referringPhysicianName));
+        }
+        if (!out.flush()) {
+            std::cerr << "Warning: Failed writing snapshot " << tempPath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        std::cerr << "Warning: Cannot rename " << tempPath << " to " << filePath << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void PatientStudySnapshot::buildIndexes() {
+    records.shrinkToFit();
+    const std::vector<CompactPatient>& patients = records.patients();
+    const std::vector<CompactStudy>& studies = records.studies();
+    size_t duplicates = 0;
+
+    patientBySymbol.assign(records.symbolCount(), 0);
+    for (size_t i = 0; i < patients.size(); ++i) {
+        std::uint32_t& slot = patientBySymbol[patients[i].patientID];
+        if (slot == 0) {
+            slot = static_cast<std::uint32_t>(i + 1);
+        } else {
+            ++duplicates;
+        }
+    }
+
+    // Studies grouped by patient symbol (a counting sort), leaving out duplicate UIDs
+    auto uidOf = [&studies, this](std::uint32_t index) { return records.uidKey(studies[index].studyInstanceUID); };
+    std::vector<bool> indexed(studies.size(), false);
+    studyOffsets.assign(records.symbolCount() + 1, 0);
+    for (size_t i = 0; i < studies.size(); ++i) {
+        std::uint32_t index = static_cast<std::uint32_t>(i);
+        if (studyIndex.insert(index, uidOf(index), uidOf)) {
+            indexed[i] = true;
+            ++studyOffsets[studies[i].patientId + 1];
+        } else {
+            ++duplicates;
+        }
+    }
+    for (size_t symbol = 1; symbol < studyOffsets.size(); ++symbol) {
+        studyOffsets[symbol] += studyOffsets[symbol - 1];
+    }
+    studiesByPatient.assign(studyOffsets.back(), 0);
+    std::vector<std::uint32_t> next(studyOffsets.begin(), studyOffsets.end() - 1);
+    for (size_t i = 0; i < studies.size(); ++i) {
+        if (indexed[i]) {
+            studiesByPatient[next[studies[i].patientId]++] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    if (duplicates > 0) {
+        std::cerr << "Warning: " << duplicates << " duplicate patient IDs / study UIDs in the snapshot; the first row wins." << std::endl;
+    }
+}
+
+const CompactPatient* PatientStudySnapshot::findPatient(const std::string& patientId) const {
+    Symbol symbol = 0;
+    if (patientId.empty() || !records.findSymbol(patientId, symbol) || patientBySymbol[symbol] == 0) {
+        return nullptr;
+    }
+    return &records.patients()[patientBySymbol[symbol] - 1];
+}
+
+const CompactStudy* PatientStudySnapshot::findStudy(const std::string& studyInstanceUid) const {
+    const std::vector<CompactStudy>& studies = records.studies();
+    std::uint32_t index = 0;
+    std::string buffer;
+    bool found = studyIndex.find(CompactRecordBatch::uidKey(studyInstanceUid, buffer), [&studies, this](std::uint32_t i) {
+        return records.uidKey(studies[i].studyInstanceUID);
+    }, index);
+    return found ? &studies[index] : nullptr;
+}
+
+PatientStudySnapshot::StudyRange PatientStudySnapshot::studiesOf(const std::string& patientId) const {
+    Symbol symbol = 0;
+    if (!records.findSymbol(patientId, symbol)) {
+        return StudyRange{nullptr, nullptr};
+    }
+    const std::uint32_t* base = studiesByPatient.data();
+    return StudyRange{base + studyOffsets[symbol], base + studyOffsets[symbol + 1]};
+}
+
+size_t PatientStudySnapshot::memoryBytes() const {
+    return records.memoryBytes() +
+           (patientBySymbol.capacity() + studyOffsets.capacity() + studiesByPatient.capacity()) * sizeof(std::uint32_t) +
+           studyIndex.memoryBytes();
+}
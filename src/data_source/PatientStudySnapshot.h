@@ -0,0 +1,69 @@
+#ifndef PATIENTSTUDYSNAPSHOT_H
+#define PATIENTSTUDYSNAPSHOT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../models/CompactRecords.h"
+
+// Immutable copy of the Patients and Studies tables, shared by every
+// InMemoryPatientStudySource created from it.
+//
+// A snapshot is read from either
+//   - a directory holding Patients.csv and Studies.csv (CSV with a header row naming
+//     the table columns, as written by psql "\copy Patients TO 'Patients.csv' CSV HEADER"
+//     or hl7_datagen --csv), or
+//   - a binary snapshot file written by saveBinary().
+// Loading a CSV directory also writes "<dir>/snapshot.bin", tagged with the sizes and
+// modification times of the CSV files, and later loads use it while they are unchanged.
+//
+// Rows are held as CompactRecordBatch records (roughly a quarter of the memory of
+// Patient/Study structs) and converted back when a caller asks for one.
+class PatientStudySnapshot {
+public:
+    CompactRecordBatch records;   // In file order
+
+    // Study indices of one patient, in file order
+    struct StudyRange {
+        const std::uint32_t* first;
+        const std::uint32_t* last;
+        const std::uint32_t* begin() const { return first; }
+        const std::uint32_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    // Returns nullptr (after logging why) when the path cannot be loaded
+    static std::shared_ptr<const PatientStudySnapshot> load(const std::string& path);
+    // Builds a snapshot from records already in memory (benchmarks, generated data)
+    static std::shared_ptr<const PatientStudySnapshot> fromRecords(std::vector<Patient> patients, std::vector<Study> studies);
+
+    bool saveBinary(const std::string& filePath, const std::string& fingerprint = "") const;
+
+    size_t patientCount() const { return records.patients().size(); }
+    size_t studyCount() const { return records.studies().size(); }
+
+    const CompactPatient* findPatient(const std::string& patientId) const;
+    const CompactStudy* findStudy(const std::string& studyInstanceUid) const;
+    StudyRange studiesOf(const std::string& patientId) const;
+
+    // Records plus indexes
+    size_t memoryBytes() const;
+
+private:
+    // Indexed by the patient ID's symbol: patient index + 1 (0: none), and the first
+    // entry of the patient's studies in studiesByPatient
+    std::vector<std::uint32_t> patientBySymbol;
+    std::vector<std::uint32_t> studyOffsets;
+    std::vector<std::uint32_t> studiesByPatient;
+    CompactHashIndex studyIndex; // By study UID
+
+    bool loadCsv(const std::string& directory);
+    // An empty expectedFingerprint accepts any file
+    bool loadBinary(const std::string& filePath, const std::string& expectedFingerprint);
+    void buildIndexes();
+
+    static std::string csvFingerprint(const std::string& directory);
+};
+
+#endif // PATIENTSTUDYSNAPSHOT_H
@@ -0,0 +1,37 @@
+#ifndef PATIENTSTUDYSOURCE_H
+#define PATIENTSTUDYSOURCE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "DicomStudyCatalog.h"
+#include "../models/Patient.h"
+#include "../models/Study.h"
+
+// Where patients and studies come from. The UI, server mode and batch code depend on
+// this rather than on the ODBC DatabaseService, so the generator can be run (and
+// profiled) against an in-memory snapshot or a deliberately slow source instead.
+// Implementations are not thread-safe; use one instance per thread.
+class PatientStudySource {
+public:
+    virtual ~PatientStudySource() = default;
+
+    virtual std::vector<Patient> getAllPatients() = 0;
+    // Patients whose name or ID contains the term (SQL "LIKE %term%", case-sensitive)
+    virtual std::vector<Patient> searchPatients(const std::string& searchTerm) = 0;
+    virtual Patient getPatientById(const std::string& patientId) = 0;       // Empty Patient if not found
+    virtual std::vector<Study> getStudiesForPatient(const std::string& patientId) = 0;
+    virtual Study getStudyByUid(const std::string& studyInstanceUid) = 0;   // Empty Study if not found
+
+    // Series and instances of a study for the generator, from the DICOM catalog attached
+    // by PatientStudySourceFactory; nullptr when there is none or it has no files for the study
+    std::unique_ptr<StudyContentReader> openStudyContent(const std::string& studyInstanceUid) const {
+        return DicomStudyCatalog::open(studyCatalog, studyInstanceUid);
+    }
+    void setStudyCatalog(std::shared_ptr<const DicomStudyCatalog> catalog) { studyCatalog = std::move(catalog); }
+
+private:
+    std::shared_ptr<const DicomStudyCatalog> studyCatalog;
+};
+
+#endif // PATIENTSTUDYSOURCE_H
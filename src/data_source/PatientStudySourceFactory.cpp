@@ -0,0 +1,71 @@
+#include "PatientStudySourceFactory.h"
+#include <iostream>
+#include "InMemoryPatientStudySource.h"
+#include "../db_connector/DatabaseService.h"
+
+PatientStudySourceFactory::PatientStudySourceFactory(const AppConfig& config)
+    : type(config.dataSourceType), odbcDsn(config.odbcDsn), dbUser(config.dbUser), dbPassword(config.dbPassword),
+      snapshotPath(config.dataSnapshotPath), dicomDirectory(config.dataDicomDirectory) {
+    latency.baseUs = config.dataLatencyBaseUs;
+    latency.jitterUs = config.dataLatencyJitterUs;
+    latency.perRowUs = config.dataLatencyPerRowUs;
+    latency.seed = config.dataLatencySeed;
+}
+
+std::string PatientStudySourceFactory::describe() const {
+    std::string description = type != "memory" ? "ODBC DSN " + odbcDsn : "in-memory snapshot " + snapshotPath;
+    if (type == "memory" && latency.enabled()) {
+        description += " (injected latency " + std::to_string(latency.baseUs) + " us + up to " + std::to_string(latency.jitterUs) +
+                       " us jitter + " + std::to_string(latency.perRowUs) + " us/row)";
+    }
+    if (!dicomDirectory.empty()) {
+        description += ", series and instances from " + dicomDirectory;
+    }
+    return description;
+}
+
+bool PatientStudySourceFactory::loadCatalog(std::shared_ptr<const DicomStudyCatalog>& shared) {
+    if (dicomDirectory.empty()) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    if (!catalog) {
+        catalog = DicomStudyCatalog::scan(dicomDirectory); // Retried by the next create() on failure
+    }
+    shared = catalog;
+    return shared != nullptr;
+}
+
+std::unique_ptr<PatientStudySource> PatientStudySourceFactory::create(size_t stream) {
+    std::shared_ptr<const DicomStudyCatalog> sharedCatalog;
+    if (!loadCatalog(sharedCatalog)) {
+        return nullptr;
+    }
+    if (type != "memory") {
+        std::unique_ptr<DatabaseService> db(new DatabaseService());
+        if (!db->connect(odbcDsn, dbUser, dbPassword)) {
+            return nullptr;
+        }
+        db->setStudyCatalog(sharedCatalog);
+        return std::unique_ptr<PatientStudySource>(db.release());
+    }
+
+    std::shared_ptr<const PatientStudySnapshot> shared;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        if (!snapshot) {
+            snapshot = PatientStudySnapshot::load(snapshotPath); // Retried by the next create() on failure
+        }
+        shared = snapshot;
+    }
+    if (!shared) {
+        return nullptr;
+    }
+
+    std::unique_ptr<PatientStudySource> source(new InMemoryPatientStudySource(shared));
+    if (latency.enabled()) {
+        source.reset(new LatencyInjectingSource(std::move(source), latency, stream));
+    }
+    source->setStudyCatalog(sharedCatalog);
+    return source;
+}
@@ -0,0 +1,46 @@
+#ifndef PATIENTSTUDYSOURCEFACTORY_H
+#define PATIENTSTUDYSOURCEFACTORY_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "PatientStudySource.h"
+#include "PatientStudySnapshot.h"
+#include "LatencyInjectingSource.h"
+#include "../config_manager/ConfigManager.h"
+
+// Creates the PatientStudySource selected by <DataSource><Type>:
+//   odbc   - a connected DatabaseService (the default)
+//   memory - an InMemoryPatientStudySource over <SnapshotPath>, wrapped in a
+//            LatencyInjectingSource when <Latency> asks for a delay
+// With <DicomDirectory>, every source also gets the DicomStudyCatalog of that directory
+// for its studies' series and instances. The memory snapshot and the catalog are loaded
+// once, on first use, and shared by every source created afterwards. create() is thread-safe.
+class PatientStudySourceFactory {
+public:
+    explicit PatientStudySourceFactory(const AppConfig& config);
+
+    // A new source for one thread; `stream` picks that instance's latency jitter sequence.
+    // Returns nullptr (after logging why) when the database or snapshot is unavailable.
+    std::unique_ptr<PatientStudySource> create(size_t stream = 0);
+
+    std::string describe() const; // For log messages
+
+private:
+    std::string type;
+    std::string odbcDsn;
+    std::string dbUser;
+    std::string dbPassword;
+    std::string snapshotPath;
+    std::string dicomDirectory;
+    LatencyOptions latency;
+
+    std::mutex snapshotMutex;
+    std::shared_ptr<const PatientStudySnapshot> snapshot;
+    std::shared_ptr<const DicomStudyCatalog> catalog;
+
+    // Scans <DicomDirectory> on first use; false if it is configured but unreadable
+    bool loadCatalog(std::shared_ptr<const DicomStudyCatalog>& shared);
+};
+
+#endif // PATIENTSTUDYSOURCEFACTORY_H
@@ -0,0 +1,49 @@
+#ifndef STUDYCONTENTREADER_H
+#define STUDYCONTENTREADER_H
+
+#include <utility>
+#include <vector>
+#include "../models/Series.h"
+#include "../models/Instance.h"
+
+// Supplies the series of one study, and the instances of each series, one record at a
+// time. Dynamic acquisitions have thousands of instances, so readers stream them from
+// wherever they live instead of collecting them first.
+class StudyContentReader {
+public:
+    virtual ~StudyContentReader() = default;
+
+    // Moves to the next series; false when there are no more
+    virtual bool nextSeries(Series& series) = 0;
+    // Next instance of the current series; false when the series has no more
+    virtual bool nextInstance(Instance& instance) = 0;
+};
+
+// Reads records already in memory (small studies, tests, benchmarks)
+class VectorStudyContentReader : public StudyContentReader {
+public:
+    void addSeries(const Series& series) { content.emplace_back(series, std::vector<Instance>()); }
+    void addInstance(const Instance& instance) { content.back().second.push_back(instance); } // To the last series
+    void rewind() { seriesIndex = 0; instanceIndex = 0; }
+
+    bool nextSeries(Series& series) override {
+        if (seriesIndex >= content.size()) return false;
+        series = content[seriesIndex++].first;
+        instanceIndex = 0;
+        return true;
+    }
+    bool nextInstance(Instance& instance) override {
+        if (seriesIndex == 0) return false;
+        const std::vector<Instance>& instances = content[seriesIndex - 1].second;
+        if (instanceIndex >= instances.size()) return false;
+        instance = instances[instanceIndex++];
+        return true;
+    }
+
+private:
+    std::vector<std::pair<Series, std::vector<Instance>>> content;
+    size_t seriesIndex = 0;
+    size_t instanceIndex = 0;
+};
+
+#endif // STUDYCONTENTREADER_H
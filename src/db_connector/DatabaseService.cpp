@@ -2,6 +2,8 @@
 #include <iostream>
 #include <stdexcept>
 #include "dicom_parser/DicomParser.h"
+#include "../metrics/Metrics.h"
+#include "../tracing/Tracer.h"
 
 DatabaseService::DatabaseService() : henv(SQL_NULL_HENV), hdbc(SQL_NULL_HDBC), hstmt(SQL_NULL_HSTMT), connected(false) {
     SQLRETURN ret;
@@ -31,6 +33,7 @@ DatabaseService::~DatabaseService() {
 }
 
 bool DatabaseService::connect(const std::string& dsn, const std::string& user, const std::string& password) {
+    HL7_TRACE_SCOPE("connect");
     if (connected) {
         std::cout << "Already connected." << std::endl;
         return true;
@@ -114,6 +117,8 @@ void DatabaseService::handleError(SQLSMALLINT handleType, SQLHANDLE handle, cons
 }
 
 std::vector<Patient> DatabaseService::getAllPatients() {
+    HL7_TRACE_SCOPE("getAllPatients");
+    ScopedTimer timer(Metrics::instance().dbQuery);
     std::vector<Patient> patients;
     if (!connected) {
         std::cerr << "Not connected to database for getAllPatients." << std::endl;
@@ -191,6 +196,8 @@ std::vector<Patient> DatabaseService::getAllPatients() {
 }
 
 std::vector<Patient> DatabaseService::searchPatients(const std::string& searchTerm) {
+    HL7_TRACE_SCOPE("searchPatients");
+    ScopedTimer timer(Metrics::instance().dbQuery);
     std::vector<Patient> patients;
     if (!connected) {
         std::cerr << "Not connected to database for searchPatients." << std::endl;
@@ -294,6 +301,8 @@ std::vector<Patient> DatabaseService::searchPatients(const std::string& searchTe
 }
 
 Patient DatabaseService::getPatientById(const std::string& patientIdToFind) {
+    HL7_TRACE_SCOPE("getPatientById");
+    ScopedTimer timer(Metrics::instance().dbQuery);
     Patient p; // Return empty patient if not found or error
     if (!connected) {
         std::cerr << "Not connected to database for getPatientById." << std::endl;
@@ -383,6 +392,8 @@ Patient DatabaseService::getPatientById(const std::string& patientIdToFind) {
 }
 
 std::vector<Study> DatabaseService::getStudiesForPatient(const std::string& patientID) {
+    HL7_TRACE_SCOPE("getStudiesForPatient");
+    ScopedTimer timer(Metrics::instance().dbQuery);
     std::vector<Study> studies;
     if (!connected) {
         std::cerr << "Not connected to database for getStudiesForPatient." << std::endl;
@@ -498,6 +509,97 @@ std::vector<Study> DatabaseService::getStudiesForPatient(const std::string& pati
     return studies;
 }
 
+Study DatabaseService::getStudyByUid(const std::string& studyInstanceUid) {
+    HL7_TRACE_SCOPE("getStudyByUid");
+    ScopedTimer timer(Metrics::instance().dbQuery);
+    Study s; // Return empty study if not found or error
+    if (!connected) {
+        std::cerr << "Not connected to database for getStudyByUid." << std::endl;
+        return s;
+    }
+    if (studyInstanceUid.empty()) {
+        std::cerr << "Study UID to find is empty." << std::endl;
+        return s;
+    }
+
+    SQLRETURN ret;
+    if (hstmt != SQL_NULL_HSTMT) { 
+        SQLFreeStmt(hstmt, SQL_CLOSE);
+        SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+        hstmt = SQL_NULL_HSTMT;
+    }
+    ret = SQLAllocHandle(SQL_HANDLE_STMT, hdbc, &hstmt);
+    if (ret != SQL_SUCCESS && ret != SQL_SUCCESS_WITH_INFO) {
+        handleError(SQL_HANDLE_DBC, hdbc, "Error allocating statement handle for getStudyByUid");
+        return s;
+    }
+
+    std::string baseQuery = "SELECT study_uid, pat_id, acc_num, study_dt, study_tm, mod, study_desc, ref_phys_name FROM Studies WHERE study_uid = ?";
+
+    ret = SQLPrepare(hstmt, (SQLCHAR*)baseQuery.c_str(), SQL_NTS);
+    if (ret != SQL_SUCCESS && ret != SQL_SUCCESS_WITH_INFO) {
+        handleError(SQL_HANDLE_STMT, hstmt, "Error preparing query for getStudyByUid: " + baseQuery);
+        SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+        hstmt = SQL_NULL_HSTMT;
+        return s;
+    }
+
+    ret = SQLBindParameter(hstmt, 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR, studyInstanceUid.length(), 0, (SQLPOINTER)studyInstanceUid.c_str(), 0, NULL);
+    if (ret != SQL_SUCCESS && ret != SQL_SUCCESS_WITH_INFO) {
+        handleError(SQL_HANDLE_STMT, hstmt, "Error binding parameter for getStudyByUid");
+        SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+        hstmt = SQL_NULL_HSTMT;
+        return s;
+    }
+
+    ret = SQLExecute(hstmt);
+    if (ret != SQL_SUCCESS && ret != SQL_SUCCESS_WITH_INFO) {
+        handleError(SQL_HANDLE_STMT, hstmt, "Error executing prepared query for getStudyByUid");
+        SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+        hstmt = SQL_NULL_HSTMT;
+        return s;
+    }
+
+    SQLCHAR db_studyInstanceUID[256];
+    SQLCHAR db_patId_fk[256];
+    SQLCHAR db_accessionNumber[256];
+    SQLCHAR db_studyDate[11];
+    SQLCHAR db_studyTime[9];
+    SQLCHAR db_modality[16];
+    SQLCHAR db_studyDescription[512];
+    SQLCHAR db_referringPhysicianName[256];
+    SQLLEN len_studyInstanceUID, len_patId_fk, len_accessionNumber, len_studyDate, len_studyTime, len_modality, len_studyDescription, len_referringPhysicianName;
+
+    SQLBindCol(hstmt, 1, SQL_C_CHAR, db_studyInstanceUID, sizeof(db_studyInstanceUID), &len_studyInstanceUID);
+    SQLBindCol(hstmt, 2, SQL_C_CHAR, db_patId_fk, sizeof(db_patId_fk), &len_patId_fk);
+    SQLBindCol(hstmt, 3, SQL_C_CHAR, db_accessionNumber, sizeof(db_accessionNumber), &len_accessionNumber);
+    SQLBindCol(hstmt, 4, SQL_C_CHAR, db_studyDate, sizeof(db_studyDate), &len_studyDate);
+    SQLBindCol(hstmt, 5, SQL_C_CHAR, db_studyTime, sizeof(db_studyTime), &len_studyTime);
+    SQLBindCol(hstmt, 6, SQL_C_CHAR, db_modality, sizeof(db_modality), &len_modality);
+    SQLBindCol(hstmt, 7, SQL_C_CHAR, db_studyDescription, sizeof(db_studyDescription), &len_studyDescription);
+    SQLBindCol(hstmt, 8, SQL_C_CHAR, db_referringPhysicianName, sizeof(db_referringPhysicianName), &len_referringPhysicianName);
+
+    if (SQLFetch(hstmt) == SQL_SUCCESS) {
+        s.studyInstanceUID = (len_studyInstanceUID == SQL_NULL_DATA || len_studyInstanceUID == 0) ? "" : std::string((char*)db_studyInstanceUID, len_studyInstanceUID);
+        s.patientId = (len_patId_fk == SQL_NULL_DATA || len_patId_fk == 0) ? "" : std::string((char*)db_patId_fk, len_patId_fk);
+        s.accessionNumber = (len_accessionNumber == SQL_NULL_DATA || len_accessionNumber == 0) ? "" : std::string((char*)db_accessionNumber, len_accessionNumber);
+        s.studyDate = (len_studyDate == SQL_NULL_DATA || len_studyDate == 0) ? "" : std::string((char*)db_studyDate, len_studyDate);
+        s.studyTime = (len_studyTime == SQL_NULL_DATA || len_studyTime == 0) ? "" : std::string((char*)db_studyTime, len_studyTime);
+        s.modality = (len_modality == SQL_NULL_DATA || len_modality == 0) ? "" : std::string((char*)db_modality, len_modality);
+        s.studyDescription = (len_studyDescription == SQL_NULL_DATA || len_studyDescription == 0) ? "" : std::string((char*)db_studyDescription, len_studyDescription);
+        s.referringPhysicianName = (len_referringPhysicianName == SQL_NULL_DATA || len_referringPhysicianName == 0) ? "" : std::string((char*)db_referringPhysicianName, len_referringPhysicianName);
+
+        if (s.patientId.empty()) {
+            std::cerr << "Warning: Fetched study (UID: " << studyInstanceUid << ") with missing patientId linking field." << std::endl;
+        }
+        std::cout << "Fetched study by UID: " << s.studyInstanceUID << " - " << s.studyDescription << std::endl;
+    } else {
+        std::cout << "Study with UID '" << studyInstanceUid << "' not found." << std::endl;
+    }
+
+    return s;
+}
+
 Patient DatabaseService::getPatientFromDicom(const std::string& dicomFilePath) {
     DicomParser parser;
     if (parser.loadFile(dicomFilePath)) {
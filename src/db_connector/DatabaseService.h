@@ -5,6 +5,7 @@
 #include <vector>
 #include "../models/Patient.h"
 #include "../models/Study.h"
+#include "../data_source/PatientStudySource.h"
 
 // Include ODBC headers
 #include <sql.h>
@@ -13,18 +14,20 @@
 // Include DicomParser header
 #include "dicom_parser/DicomParser.h"
 
-class DatabaseService {
+// PatientStudySource backed by the Patients/Studies tables over ODBC
+class DatabaseService : public PatientStudySource {
 public:
     DatabaseService();
-    ~DatabaseService();
+    ~DatabaseService() override;
 
     bool connect(const std::string& dsn, const std::string& user, const std::string& password);
     void disconnect();
 
-    std::vector<Patient> getAllPatients();
-    std::vector<Patient> searchPatients(const std::string& searchTerm);
-    Patient getPatientById(const std::string& patientId);
-    std::vector<Study> getStudiesForPatient(const std::string& patientId);
+    std::vector<Patient> getAllPatients() override;
+    std::vector<Patient> searchPatients(const std::string& searchTerm) override;
+    Patient getPatientById(const std::string& patientId) override;
+    std::vector<Study> getStudiesForPatient(const std::string& patientId) override;
+    Study getStudyByUid(const std::string& studyInstanceUid) override; // Empty Study if not found
 
     // New methods for DICOM data
     Patient getPatientFromDicom(const std::string& dicomFilePath);
@@ -1,10 +1,14 @@
 #include "DicomParser.h"
+#include "../metrics/Metrics.h"
+#include "../tracing/Tracer.h"
 #include <dicomhero6/dicomhero.h>
 #include <iostream>
 #include <iomanip> // Required for std::hex
 #include <optional> // Required for std::optional
 #include <filesystem>
 #include <vector>
+#include <cmath>
+#include <cstdio>
 #include <string>
 #include "DicomParser.h"
 
@@ -16,6 +20,8 @@ DicomParser::DicomParser() {
 }
 
 bool DicomParser::loadFile(const std::string& filePath) {
+    HL7_TRACE_SCOPE_DETAIL("loadDicomFile", filePath);
+    ScopedTimer timer(Metrics::instance().dicomLoad);
     try {
         dataSet.emplace(dicomhero::CodecFactory::load(filePath));
         return true;
@@ -26,6 +32,18 @@ bool DicomParser::loadFile(const std::string& filePath) {
     }
 }
 
+bool DicomParser::loadHeader(const std::string& filePath) {
+    HL7_TRACE_SCOPE_DETAIL("loadDicomHeader", filePath);
+    try {
+        dataSet.emplace(dicomhero::CodecFactory::load(filePath, 4096));
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading DICOM file with DicomHero6: " << e.what() << " (file: " << filePath << ")" << std::endl;
+        dataSet.reset();
+        return false;
+    }
+}
+
 std::string DicomParser::getString(dicomhero::tagId_t tagValue) const {
     if (!dataSet.has_value()) { // Check if optional has a value
         std::cerr << "Dataset not loaded." << std::endl;
@@ -89,6 +107,252 @@ Study DicomParser::getStudyInfo() const {
     return s;
 }
 
+Series DicomParser::getSeriesInfo() const {
+    Series s;
+    if (!dataSet.has_value()) {
+        std::cerr << "Dataset not loaded when calling getSeriesInfo." << std::endl;
+        return s;
+    }
+    s.seriesInstanceUID = getString(dicomhero::tagId_t::SeriesInstanceUID_0020_000E);
+    s.studyInstanceUID = getString(dicomhero::tagId_t::StudyInstanceUID_0020_000D);
+    s.seriesNumber = getString(dicomhero::tagId_t::SeriesNumber_0020_0011);
+    s.modality = getString(dicomhero::tagId_t::Modality_0008_0060);
+    s.seriesDescription = getString(dicomhero::tagId_t::SeriesDescription_0008_103E);
+    s.seriesDate = getString(dicomhero::tagId_t::SeriesDate_0008_0021);
+    s.seriesTime = getString(dicomhero::tagId_t::SeriesTime_0008_0031);
+    return s;
+}
+
+Instance DicomParser::getInstanceInfo() const {
+    Instance i;
+    if (!dataSet.has_value()) {
+        std::cerr << "Dataset not loaded when calling getInstanceInfo." << std::endl;
+        return i;
+    }
+    i.sopInstanceUID = getString(dicomhero::tagId_t::SOPInstanceUID_0008_0018);
+    i.sopClassUID = getString(dicomhero::tagId_t::SOPClassUID_0008_0016);
+    i.seriesInstanceUID = getString(dicomhero::tagId_t::SeriesInstanceUID_0020_000E);
+    i.instanceNumber = getString(dicomhero::tagId_t::InstanceNumber_0020_0013);
+    i.numberOfFrames = getString(dicomhero::tagId_t::NumberOfFrames_0028_0008);
+    i.contentDate = getString(dicomhero::tagId_t::ContentDate_0008_0023);
+    i.contentTime = getString(dicomhero::tagId_t::ContentTime_0008_0033);
+    return i;
+}
+
+size_t DicomParser::getFrameCount() const {
+    if (!dataSet.has_value()) {
+        return 0;
+    }
+    try {
+        std::int32_t frames = dataSet->getInt32(dicomhero::TagId(dicomhero::tagId_t::NumberOfFrames_0028_0008), 0, 1);
+        return frames > 0 ? static_cast<size_t>(frames) : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading NumberOfFrames: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+namespace {
+
+template <typename T>
+void copySamples(const char* data, size_t count, std::vector<std::int32_t>& samples) {
+    const T* values = reinterpret_cast<const T*>(data);
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = static_cast<std::int32_t>(values[i]);
+    }
+}
+
+template <typename T>
+void roundSamples(const char* data, size_t count, std::vector<std::int32_t>& samples) {
+    const T* values = reinterpret_cast<const T*>(data);
+    for (size_t i = 0; i < count; ++i) {
+        double value = std::round(static_cast<double>(values[i]));
+        samples[i] = value >= 2147483647.0 ? 2147483647 : value <= -2147483648.0 ? -2147483647 - 1 : static_cast<std::int32_t>(value);
+    }
+}
+
+} // namespace
+
+bool DicomParser::getFrame(size_t frameIndex, ImageFrame& frame) const {
+    HL7_TRACE_SCOPE("getDicomFrame");
+    if (!dataSet.has_value()) {
+        std::cerr << "Dataset not loaded when calling getFrame." << std::endl;
+        return false;
+    }
+    try {
+        dicomhero::Image image = dataSet->getImageApplyModalityTransform(frameIndex);
+        frame.width = image.getWidth();
+        frame.height = image.getHeight();
+        frame.channels = image.getChannelsNumber();
+        std::string colorSpace = image.getColorSpace();
+        frame.inverted = colorSpace == "MONOCHROME1";
+        if (frame.channels != 1 && !(frame.channels == 3 && colorSpace == "RGB")) {
+            std::cerr << "Unsupported color space " << colorSpace << " in frame " << frameIndex << "." << std::endl;
+            return false;
+        }
+
+        dicomhero::ReadingDataHandlerNumeric pixels = image.getReadingDataHandler();
+        size_t count = static_cast<size_t>(frame.width) * frame.height * frame.channels;
+        size_t bytes = 0;
+        const char* data = pixels.data(&bytes);
+        size_t unit = pixels.getUnitSize();
+        if (unit == 0 || bytes / unit < count) {
+            std::cerr << "Frame " << frameIndex << " has " << bytes << " bytes of pixel data for " << count << " samples." << std::endl;
+            return false;
+        }
+        frame.samples.resize(count);
+        if (pixels.isFloat()) {
+            if (unit == 8) roundSamples<double>(data, count, frame.samples);
+            else roundSamples<float>(data, count, frame.samples);
+        } else if (pixels.isSigned()) {
+            if (unit == 1) copySamples<std::int8_t>(data, count, frame.samples);
+            else if (unit == 2) copySamples<std::int16_t>(data, count, frame.samples);
+            else copySamples<std::int32_t>(data, count, frame.samples);
+        } else {
+            if (unit == 1) copySamples<std::uint8_t>(data, count, frame.samples);
+            else if (unit == 2) copySamples<std::uint16_t>(data, count, frame.samples);
+            else roundSamples<std::uint32_t>(data, count, frame.samples); // Clamps values above INT32_MAX
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error decoding frame " << frameIndex << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DicomParser::getFrameTiming(FrameTiming& timing) const {
+    timing.startMs.clear();
+    timing.durationMs.clear();
+    if (!dataSet.has_value()) {
+        return false;
+    }
+    const size_t frames = getFrameCount();
+    try {
+        // NM: one item per phase, each with its own frame duration and a delay before it
+        const dicomhero::TagId phases(dicomhero::tagId_t::PhaseInformationSequence_0054_0032);
+        double phaseStart = 0;
+        for (size_t item = 0; timing.startMs.size() < frames; ++item) {
+            dicomhero::DataSet phase = dataSet->getSequenceItem(phases, item);
+            double duration = phase.getDouble(dicomhero::TagId(dicomhero::tagId_t::ActualFrameDuration_0018_1242), 0, 0.0);
+            std::uint32_t count = phase.getUint32(dicomhero::TagId(0x0054, 0x0033), 0, 0); // Number of Frames in Phase
+            phaseStart += phase.getDouble(dicomhero::TagId(0x0054, 0x0036), 0, 0.0);       // Phase Delay
+            if (duration <= 0 || count == 0) {
+                break;
+            }
+            for (std::uint32_t i = 0; i < count && timing.startMs.size() < frames; ++i) {
+                timing.startMs.push_back(phaseStart);
+                timing.durationMs.push_back(duration);
+                phaseStart += duration;
+            }
+        }
+    } catch (const std::exception&) {
+        // No (further) phase items
+    }
+    if (timing.startMs.size() == frames) {
+        return true;
+    }
+    timing.startMs.clear();
+    timing.durationMs.clear();
+
+    try {
+        // Frame Time Vector: the increment from the previous frame, 0 for the first
+        const dicomhero::TagId vectorTag(dicomhero::tagId_t::FrameTimeVector_0018_1065);
+        std::vector<double> increments;
+        for (size_t i = 0; i < frames; ++i) {
+            double increment = dataSet->getDouble(vectorTag, i, -1.0);
+            if (increment < 0) break;
+            increments.push_back(increment);
+        }
+        if (frames > 1 && increments.size() == frames) {
+            double start = 0;
+            for (size_t i = 0; i < frames; ++i) {
+                start += increments[i];
+                timing.startMs.push_back(start);
+                timing.durationMs.push_back(i + 1 < frames ? increments[i + 1] : increments[i]);
+            }
+            return true;
+        }
+
+        double duration = dataSet->getDouble(dicomhero::TagId(dicomhero::tagId_t::FrameTime_0018_1063), 0, 0.0);
+        if (duration <= 0) {
+            duration = dataSet->getDouble(dicomhero::TagId(dicomhero::tagId_t::ActualFrameDuration_0018_1242), 0, 0.0);
+        }
+        if (duration > 0) {
+            for (size_t i = 0; i < frames; ++i) {
+                timing.startMs.push_back(i * duration);
+                timing.durationMs.push_back(duration);
+            }
+            return true;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading frame timing: " << e.what() << std::endl;
+    }
+    timing.startMs.clear();
+    timing.durationMs.clear();
+    return false;
+}
+
+std::vector<std::string> DicomParser::getImageType() const {
+    std::vector<std::string> values;
+    if (!dataSet.has_value()) {
+        return values;
+    }
+    try {
+        dicomhero::TagId tag(dicomhero::tagId_t::ImageType_0008_0008);
+        for (size_t i = 0; i < 16; ++i) {
+            std::string value = dataSet->getString(tag, i, "");
+            if (value.empty()) break;
+            values.push_back(value);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading ImageType: " << e.what() << std::endl;
+    }
+    return values;
+}
+
+std::vector<OverlayPlane> DicomParser::getOverlays() const {
+    std::vector<OverlayPlane> overlays;
+    if (!dataSet.has_value()) {
+        return overlays;
+    }
+    // Up to 16 planes, in the even groups 6000-601E
+    for (std::uint16_t group = 0x6000; group <= 0x601E; group += 2) {
+        try {
+            if (!dataSet->bufferExists(dicomhero::TagId(group, 0x3000), 0)) {
+                continue;
+            }
+            OverlayPlane overlay;
+            overlay.rows = dataSet->getUint32(dicomhero::TagId(group, 0x0010), 0, 0);
+            overlay.columns = dataSet->getUint32(dicomhero::TagId(group, 0x0011), 0, 0);
+            overlay.roi = dataSet->getString(dicomhero::TagId(group, 0x0040), 0, "G") == "R";
+            overlay.originRow = dataSet->getInt32(dicomhero::TagId(group, 0x0050), 0, 1);
+            overlay.originColumn = dataSet->getInt32(dicomhero::TagId(group, 0x0050), 1, 1);
+            overlay.label = dataSet->getString(dicomhero::TagId(group, 0x1500), 0, "");
+            if (overlay.label.empty()) {
+                overlay.label = dataSet->getString(dicomhero::TagId(group, 0x0022), 0, "");
+            }
+            if (overlay.label.empty()) {
+                char name[16];
+                std::snprintf(name, sizeof(name), "Overlay %04X", group);
+                overlay.label = name;
+            }
+            dicomhero::ReadingDataHandlerRaw data = dataSet->getReadingDataHandlerRaw(dicomhero::TagId(group, 0x3000), 0);
+            size_t size = 0;
+            const char* bytes = data.data(&size);
+            size_t needed = (static_cast<size_t>(overlay.rows) * overlay.columns + 7) / 8;
+            if (overlay.rows == 0 || overlay.columns == 0 || size < needed) {
+                std::cerr << "Skipping overlay " << overlay.label << ": " << size << " bytes for " << overlay.rows << "x" << overlay.columns << "." << std::endl;
+                continue;
+            }
+            overlay.bits.assign(bytes, bytes + needed);
+            overlays.push_back(std::move(overlay));
+        } catch (const std::exception& e) {
+            std::cerr << "Error reading overlay group " << std::hex << group << std::dec << ": " << e.what() << std::endl;
+        }
+    }
+    return overlays;
+}
+
 // Rekursywne wczytywanie wszystkich plików z folderu z danymi
 std::vector<std::string> DicomParser::getAllFilesInDirectory(const std::string& rootDir) {
     std::vector<std::string> files;
@@ -4,6 +4,9 @@
 #include <dicomhero6/dicomhero.h> // Changed from dcmtk
 #include "../models/Patient.h"
 #include "../models/Study.h"
+#include "../models/Series.h"
+#include "../models/Instance.h"
+#include "../models/ImageFrame.h"
 #include <string>
 #include <optional> // Required for std::optional
 
@@ -11,8 +14,25 @@ class DicomParser {
 public:
     DicomParser();
     bool loadFile(const std::string& filePath);
+    // Loads the attributes only: values longer than a few kB (pixel data) stay on disk
+    // and are read only if asked for, so scanning a directory does not decode images
+    bool loadHeader(const std::string& filePath);
     Patient getPatientInfo() const;
     Study getStudyInfo() const;
+    Series getSeriesInfo() const;
+    Instance getInstanceInfo() const; // filePath is left to the caller
+    // Number of Frames (0028,0008); 1 for single-frame images, 0 when nothing is loaded
+    size_t getFrameCount() const;
+    // Decodes one frame (0-based) and applies the modality transform
+    bool getFrame(size_t frameIndex, ImageFrame& frame) const;
+    // Frame times from the Phase Information Sequence (NM dynamic), else the Frame Time
+    // Vector, else Frame Time or Actual Frame Duration for every frame. False when the
+    // image has none of them.
+    bool getFrameTiming(FrameTiming& timing) const;
+    // Image Type (0008,0008) values, e.g. ORIGINAL, PRIMARY, STATIC, EMISSION
+    std::vector<std::string> getImageType() const;
+    // Overlay planes stored in Overlay Data (60xx,3000); overlays in unused pixel bits are not read
+    std::vector<OverlayPlane> getOverlays() const;
     void parseDicomDirectory(const std::string& directoryPath);
 
 private:
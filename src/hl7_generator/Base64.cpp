@@ -0,0 +1,173 @@
+#include "Base64.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HL7_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Whole 3-byte groups; returns the characters written
+size_t encodeScalar(const unsigned char* in, size_t size, char* out) {
+    char* start = out;
+    for (size_t i = 0; i + 3 <= size; i += 3) {
+        unsigned group = (unsigned(in[i]) << 16) | (unsigned(in[i + 1]) << 8) | in[i + 2];
+        out[0] = ALPHABET[group >> 18];
+        out[1] = ALPHABET[(group >> 12) & 0x3F];
+        out[2] = ALPHABET[(group >> 6) & 0x3F];
+        out[3] = ALPHABET[group & 0x3F];
+        out += 4;
+    }
+    return static_cast<size_t>(out - start);
+}
+
+#ifdef HL7_BASE64_X86
+
+// The kernels follow Muła and Lemire, "Faster Base64 Encoding and Decoding Using AVX2
+// Instructions" (2018): a byte shuffle spreads each 3-byte group over a 32-bit lane,
+// two multiplies move the four 6-bit fields into separate bytes, and a 16-entry table
+// indexed by a compressed form of each field supplies the offset to its ASCII character.
+
+__attribute__((target("ssse3")))
+size_t encodeSsse3(const unsigned char* in, size_t size, char* out) {
+    const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t done = 0;
+    // Each step reads 16 bytes and uses 12
+    for (; done + 16 <= size; done += 12) {
+        __m128i bytes = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done)), spread);
+        __m128i high = _mm_mulhi_epu16(_mm_and_si128(bytes, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i low = _mm_mullo_epi16(_mm_and_si128(bytes, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i fields = _mm_or_si128(high, low);
+        // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+        __m128i classes = _mm_subs_epu8(fields, _mm_set1_epi8(51));
+        classes = _mm_or_si128(classes, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), fields), _mm_set1_epi8(13)));
+        __m128i chars = _mm_add_epi8(fields, _mm_shuffle_epi8(offsets, classes));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done / 3 * 4), chars);
+    }
+    return done / 3 * 4 + encodeScalar(in + done, size - done, out + done / 3 * 4);
+}
+
+__attribute__((target("avx2")))
+size_t encodeAvx2(const unsigned char* in, size_t size, char* out) {
+    const __m256i spread = _mm256_broadcastsi128_si256(_mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i offsets = _mm256_broadcastsi128_si256(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                                      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                                                      '/' - 63, 'A', 0, 0));
+    size_t done = 0;
+    // Each step reads 12 bytes into each 128-bit lane (28 bytes touched) and uses 24
+    for (; done + 28 <= size; done += 24) {
+        __m256i bytes = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done + 12)), 1);
+        bytes = _mm256_shuffle_epi8(bytes, spread);
+        __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i low = _mm256_mullo_epi16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i fields = _mm256_or_si256(high, low);
+        __m256i classes = _mm256_subs_epu8(fields, _mm256_set1_epi8(51));
+        classes = _mm256_or_si256(classes, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), fields), _mm256_set1_epi8(13)));
+        __m256i chars = _mm256_add_epi8(fields, _mm256_shuffle_epi8(offsets, classes));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done / 3 * 4), chars);
+    }
+    return done / 3 * 4 + encodeSsse3(in + done, size - done, out + done / 3 * 4);
+}
+
+#endif // HL7_BASE64_X86
+
+// `size` is a multiple of 3
+size_t encodeGroups(Base64Kernel kernel, const unsigned char* in, size_t size, char* out) {
+#ifdef HL7_BASE64_X86
+    switch (kernel) {
+        case Base64Kernel::Avx2: return encodeAvx2(in, size, out);
+        case Base64Kernel::Ssse3: return encodeSsse3(in, size, out);
+        case Base64Kernel::Scalar: break;
+    }
+#else
+    (void)kernel;
+#endif
+    return encodeScalar(in, size, out);
+}
+
+} // namespace
+
+bool base64KernelSupported(Base64Kernel kernel) {
+    switch (kernel) {
+        case Base64Kernel::Scalar:
+            return true;
+#ifdef HL7_BASE64_X86
+        case Base64Kernel::Ssse3:
+            return __builtin_cpu_supports("ssse3");
+        case Base64Kernel::Avx2:
+            return __builtin_cpu_supports("avx2");
+#else
+        default:
+            return false;
+#endif
+    }
+    return false;
+}
+
+Base64Kernel bestBase64Kernel() {
+    static const Base64Kernel best = base64KernelSupported(Base64Kernel::Avx2)    ? Base64Kernel::Avx2
+                                     : base64KernelSupported(Base64Kernel::Ssse3) ? Base64Kernel::Ssse3
+                                                                                  : Base64Kernel::Scalar;
+    return best;
+}
+
+const char* base64KernelName(Base64Kernel kernel) {
+    switch (kernel) {
+        case Base64Kernel::Avx2: return "avx2";
+        case Base64Kernel::Ssse3: return "ssse3";
+        case Base64Kernel::Scalar: break;
+    }
+    return "scalar";
+}
+
+Base64Encoder::Base64Encoder(std::string& output, Base64Kernel encoderKernel)
+    : out(output), kernel(base64KernelSupported(encoderKernel) ? encoderKernel : Base64Kernel::Scalar), pendingCount(0), inCount(0) {
+}
+
+void Base64Encoder::write(const unsigned char* data, size_t size) {
+    inCount += size;
+    while (pendingCount > 0 && pendingCount < 3 && size > 0) {
+        pending[pendingCount++] = *data++;
+        --size;
+    }
+    size_t whole = size / 3 * 3;
+    size_t start = out.size();
+    out.resize(start + (pendingCount == 3 ? 4 : 0) + whole / 3 * 4);
+    char* dest = &out[0] + start;
+    if (pendingCount == 3) {
+        dest += encodeScalar(pending, 3, dest);
+        pendingCount = 0;
+    }
+    encodeGroups(kernel, data, whole, dest);
+    for (size_t i = whole; i < size; ++i) {
+        pending[pendingCount++] = data[i];
+    }
+}
+
+void Base64Encoder::finish() {
+    if (pendingCount == 0) {
+        return;
+    }
+    unsigned group = unsigned(pending[0]) << 16;
+    if (pendingCount == 2) {
+        group |= unsigned(pending[1]) << 8;
+    }
+    out += ALPHABET[group >> 18];
+    out += ALPHABET[(group >> 12) & 0x3F];
+    out += pendingCount == 2 ? ALPHABET[(group >> 6) & 0x3F] : '=';
+    out += '=';
+    pendingCount = 0;
+}
+
+void appendBase64(std::string& out, const unsigned char* data, size_t size, Base64Kernel kernel) {
+    out.reserve(out.size() + base64Length(size));
+    Base64Encoder encoder(out, kernel);
+    encoder.write(data, size);
+    encoder.finish();
+}
@@ -0,0 +1,44 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <cstddef>
+#include <string>
+
+// Base64 (RFC 4648 alphabet, padded, no line breaks) for media embedded in documents.
+//
+// Multi-megabyte images made the encoder a visible share of render time, so the bulk of
+// the input goes through a vector kernel: AVX2 (24 bytes per step) or SSSE3 (12), picked
+// once from the CPU the process runs on, with a scalar loop for the rest and for CPUs
+// without either.
+enum class Base64Kernel { Scalar, Ssse3, Avx2 };
+
+// The fastest kernel this CPU supports
+Base64Kernel bestBase64Kernel();
+const char* base64KernelName(Base64Kernel kernel);
+bool base64KernelSupported(Base64Kernel kernel);
+
+inline size_t base64Length(size_t bytes) { return (bytes + 2) / 3 * 4; }
+
+// Encodes a byte stream written in pieces of any size straight onto the end of `out`,
+// so the encoded text is never held anywhere else. Call finish() after the last write.
+class Base64Encoder {
+public:
+    explicit Base64Encoder(std::string& out, Base64Kernel kernel = bestBase64Kernel());
+
+    void write(const unsigned char* data, size_t size);
+    void finish(); // Encodes (and pads) the last one or two bytes
+
+    size_t bytesIn() const { return inCount; }
+
+private:
+    std::string& out;
+    Base64Kernel kernel;
+    unsigned char pending[3]; // Bytes of an incomplete group, carried to the next write
+    size_t pendingCount;
+    size_t inCount;
+};
+
+// One-shot form of Base64Encoder
+void appendBase64(std::string& out, const unsigned char* data, size_t size, Base64Kernel kernel = bestBase64Kernel());
+
+#endif // BASE64_H
@@ -1,4 +1,8 @@
 #include "HL7MessageGenerator.h"
+#include "StudyEntryWriter.h"
+#include "../xsd_validator/PugiTreeInputSource.h"
+#include "../metrics/Metrics.h"
+#include "../tracing/Tracer.h"
 #include <fstream>
 #include <iostream>
 #include <sstream> // For string stream
@@ -6,24 +10,8 @@
 #include <chrono>  // For system_clock
 #include <random>  // For UUID generation
 #include <cstdio>  // For sprintf
-
-// Define some default constants
-const std::string DEFAULT_STRING = "Unknown";
-const std::string DEFAULT_OID_ROOT = "2.25.0.0.0.0"; // Example placeholder OID
-const std::string DEFAULT_CODE = "UNK";
-const std::string DEFAULT_CODESYSTEM_NULLFLAVOR = "2.16.840.1.113883.5.1008"; // HL7 NullFlavor
-const std::string DEFAULT_DISPLAYNAME = "Unknown";
-const std::string FIXED_TYPEID_ROOT = "2.16.840.1.113883.1.3"; // CDA R2 fixed value for typeId/@root
-const std::string DEFAULT_TYPEID_EXTENSION = "POCD_HD000040"; // Common extension for base CDA
-const std::string DEFAULT_LANGUAGE_CODE = "pl-PL";
-const std::string DEFAULT_CONFIDENTIALITY_CODE = "N"; // Normal
-const std::string DEFAULT_CONFIDENTIALITY_CODESYSTEM = "2.16.840.1.113883.5.25"; // HL7 Confidentiality
-const std::string DEFAULT_REALM_CODE = "PL"; // Default realm
-
-// Implementation for missing resetErrors method
-void XSDValidationErrorHandler::resetErrors() {
-    fSawErrors = false;
-}
+#include <cstring>
+#include <sys/stat.h>
 
 // Xerces-C++ specific includes (already in .h but good for context)
 #include <xercesc/parsers/XercesDOMParser.hpp>
@@ -33,35 +21,13 @@ void XSDValidationErrorHandler::resetErrors() {
 #include <xercesc/dom/DOM.hpp>
 #include <xercesc/framework/MemBufInputSource.hpp>
 #include <xercesc/util/OutOfMemoryException.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/util/XMLUni.hpp>
 
 XERCES_CPP_NAMESPACE_USE
 
-void XSDValidationErrorHandler::warning(const SAXParseException& exc) {
-    char* msg = XMLString::transcode(exc.getMessage());
-    std::cerr << "XSD Validation Warning: " << msg
-              << " at line " << exc.getLineNumber()
-              << " column " << exc.getColumnNumber() << std::endl;
-    XMLString::release(&msg);
-}
-
-void XSDValidationErrorHandler::error(const SAXParseException& exc) {
-    fSawErrors = true;
-    char* msg = XMLString::transcode(exc.getMessage());
-    std::cerr << "XSD Validation Error: " << msg
-              << " at line " << exc.getLineNumber()
-              << " column " << exc.getColumnNumber() << std::endl;
-    XMLString::release(&msg);
-}
-
-void XSDValidationErrorHandler::fatalError(const SAXParseException& exc) {
-    fSawErrors = true;
-    char* msg = XMLString::transcode(exc.getMessage());
-    std::cerr << "XSD Validation Fatal Error: " << msg
-              << " at line " << exc.getLineNumber()
-              << " column " << exc.getColumnNumber() << std::endl;
-    XMLString::release(&msg);
-}
-
 void HL7MessageGenerator::initializeXerces() {
     try {
         XMLPlatformUtils::Initialize();
@@ -88,8 +54,10 @@ void HL7MessageGenerator::terminateXerces() {
 
 
 // --- Constructor and Destructor ---
-HL7MessageGenerator::HL7MessageGenerator(const AppConfig& configuration) : config(configuration) {
-    std::cout << "HL7MessageGenerator initialized with AppConfig." << std::endl;
+HL7MessageGenerator::HL7MessageGenerator(const ConfigStore& store)
+    : configStore(store), appliedVersion(0), validationMode(XSDValidationMode::Sax2) {
+    acquireSnapshot();
+    std::cout << "HL7MessageGenerator initialized with config snapshot version " << appliedVersion << "." << std::endl;
 }
 
 // Destructor
@@ -113,10 +81,11 @@ std::string HL7MessageGenerator::getCurrentTimestamp(const char* format) {
 
 std::string HL7MessageGenerator::generateUUID() {
     // Basic UUID-like string generator (not a true UUID v4, but often sufficient for HL7 IDs)
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 15);
-    static std::uniform_int_distribution<> dis2(8, 11);
+    // Per thread: generators run concurrently in server mode
+    thread_local std::random_device rd;
+    thread_local std::mt19937 gen(rd());
+    thread_local std::uniform_int_distribution<> dis(0, 15);
+    thread_local std::uniform_int_distribution<> dis2(8, 11);
 
     std::stringstream ss;
     int i;
@@ -134,12 +103,374 @@ std::string HL7MessageGenerator::generateUUID() {
     return ss.str();
 }
 
+std::shared_ptr<const ConfigSnapshot> HL7MessageGenerator::acquireSnapshot() {
+    std::shared_ptr<const ConfigSnapshot> snapshot = configStore.current();
+    if (snapshot->version != appliedVersion) {
+        const AppConfig& config = snapshot->config;
+        validationMode = parseValidationMode(config.validationMode);
+        // The validator holds the compiled grammar; only rebuild it when its inputs changed
+        if (validator && (config.cdaXsdPath != validatorXsdPath || config.grammarCachePath != validatorGrammarCachePath ||
+                          config.fullValidationSamplePercent != validatorSamplePercent || validationMode != validatorMode)) {
+            finishValidation();
+        }
+        profileHashes.clear(); // Keyed by the old snapshot's profiles
+        contentOptionsHashed = false;
+        appliedVersion = snapshot->version;
+    }
+    return snapshot;
+}
+
+namespace {
+
+const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+// Part of every input hash; bump it when a code change alters the documents generated
+// from the same inputs, so the next batch run regenerates them all
+const char INPUT_HASH_VERSION[] = "cda-input-2";
+
+void fnv1a(std::uint64_t& hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+}
+
+// A field and a separator, so that ("ab", "c") and ("a", "bc") hash differently
+void hashField(std::uint64_t& hash, const std::string& field) {
+    fnv1a(hash, field.data(), field.size());
+    fnv1a(hash, "\x1f", 1);
+}
+
+// An omitted (nullptr) value hashes differently from an empty one
+void hashField(std::uint64_t& hash, const char* field) {
+    if (field) {
+        fnv1a(hash, field, std::strlen(field));
+    } else {
+        fnv1a(hash, "\x1e", 1);
+    }
+    fnv1a(hash, "\x1f", 1);
+}
+
+void hashField(std::uint64_t& hash, std::uint64_t value) {
+    hashField(hash, std::to_string(value));
+}
+
+void hashField(std::uint64_t& hash, double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.17g", value);
+    hashField(hash, std::string(text));
+}
+
+void hashId(std::uint64_t& hash, const ResolvedId& id) {
+    hashField(hash, id.root);
+    hashField(hash, id.extension);
+}
+
+void hashCode(std::uint64_t& hash, const ResolvedCode& code) {
+    hashField(hash, code.code);
+    hashField(hash, code.codeSystem);
+    hashField(hash, code.codeSystemName);
+    hashField(hash, code.displayName);
+}
+
+// Every value of the profile, placeholders included. A field added to ResolvedCdaProfile
+// must be added here too, or changing it will not regenerate unchanged studies.
+std::uint64_t hashProfile(const ResolvedCdaProfile& profile) {
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+    hashField(hash, profile.name);
+    hashField(hash, profile.unknownText);
+    hashField(hash, profile.unknownCode);
+    hashField(hash, profile.unknownDate);
+    hashField(hash, profile.nullFlavorCodeSystem);
+    hashField(hash, profile.schemaLocation);
+    hashField(hash, profile.realmCode);
+    hashId(hash, profile.typeId);
+    hashField(hash, static_cast<std::uint64_t>(profile.templateIds.size()));
+    for (const ResolvedId& templateId : profile.templateIds) {
+        hashId(hash, templateId);
+    }
+    hashField(hash, profile.documentIdRoot);
+    hashCode(hash, profile.documentCode);
+    hashField(hash, profile.documentTitle);
+    hashCode(hash, profile.confidentialityCode);
+    hashField(hash, profile.languageCode);
+    hashField(hash, profile.patientIdRoot);
+    hashField(hash, profile.genderCodeSystem);
+    hashId(hash, profile.authorId);
+    hashField(hash, profile.authorDeviceManufacturer);
+    hashField(hash, profile.authorDeviceSoftwareName);
+    hashId(hash, profile.custodianId);
+    hashField(hash, profile.custodianName);
+    hashField(hash, profile.encounterIdRoot);
+    hashCode(hash, profile.encounterCode);
+    hashId(hash, profile.facilityId);
+    hashField(hash, profile.facilityName);
+    hashCode(hash, profile.reportSectionCode);
+    return hash;
+}
+
+void hashRegions(std::uint64_t& hash, const std::vector<RegionOptions>& regions) {
+    hashField(hash, static_cast<std::uint64_t>(regions.size()));
+    for (const RegionOptions& region : regions) {
+        hashField(hash, region.name);
+        hashField(hash, static_cast<std::uint64_t>(region.ellipse));
+        hashField(hash, region.left);
+        hashField(hash, region.top);
+        hashField(hash, region.width);
+        hashField(hash, region.height);
+    }
+}
+
+// The settings that shape a study's series and instance entries: key images and both
+// analyses. Threads only change how fast the curves are computed, not the curves.
+std::uint64_t hashContentOptions(const AppConfig& config) {
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+    KeyImageOptions keyImages = HL7MessageGenerator::keyImageOptions(config);
+    hashField(hash, static_cast<std::uint64_t>(keyImages.frames.size()));
+    for (int frame : keyImages.frames) {
+        hashField(hash, static_cast<std::uint64_t>(frame));
+    }
+    hashField(hash, static_cast<std::uint64_t>(keyImages.maxDimension));
+    hashField(hash, static_cast<std::uint64_t>(keyImages.maxPerDocument));
+
+    hashField(hash, static_cast<std::uint64_t>(config.countAnalysisEnabled));
+    if (config.countAnalysisEnabled) {
+        CountAnalysisOptions counts = HL7MessageGenerator::countAnalysisOptions(config);
+        hashRegions(hash, counts.regions);
+        hashField(hash, static_cast<std::uint64_t>(counts.ratios.size()));
+        for (const CountAnalysisOptions::Ratio& ratio : counts.ratios) {
+            hashField(hash, ratio.name);
+            hashField(hash, ratio.numerator);
+            hashField(hash, ratio.denominator);
+        }
+        hashField(hash, static_cast<std::uint64_t>(counts.useOverlays));
+        hashField(hash, counts.codeSystem);
+    }
+
+    hashField(hash, static_cast<std::uint64_t>(config.dynamicAnalysisEnabled));
+    if (config.dynamicAnalysisEnabled) {
+        DynamicAnalysisOptions dynamic = HL7MessageGenerator::dynamicAnalysisOptions(config);
+        hashRegions(hash, dynamic.regions);
+        hashField(hash, dynamic.background);
+        hashField(hash, static_cast<std::uint64_t>(dynamic.splits.size()));
+        for (const DynamicAnalysisOptions::Split& split : dynamic.splits) {
+            hashField(hash, split.name);
+            hashField(hash, split.left);
+            hashField(hash, split.right);
+            hashField(hash, split.startSeconds);
+            hashField(hash, split.endSeconds);
+        }
+        hashField(hash, static_cast<std::uint64_t>(dynamic.useOverlays));
+        hashField(hash, dynamic.codeSystem);
+    }
+    return hash;
+}
+
+// Each series and instance the reader yields, and the size and modification time of each
+// instance's file, which key images and analyses are read from
+void hashContent(std::uint64_t& hash, StudyContentReader& content) {
+    Series series;
+    Instance instance;
+    while (content.nextSeries(series)) {
+        hashField(hash, std::string("series"));
+        for (const std::string* field : {&series.seriesInstanceUID, &series.studyInstanceUID, &series.seriesNumber, &series.modality,
+                                         &series.seriesDescription, &series.seriesDate, &series.seriesTime}) {
+            hashField(hash, *field);
+        }
+        while (content.nextInstance(instance)) {
+            hashField(hash, std::string("instance"));
+            for (const std::string* field : {&instance.sopInstanceUID, &instance.sopClassUID, &instance.seriesInstanceUID,
+                                             &instance.instanceNumber, &instance.numberOfFrames, &instance.contentDate,
+                                             &instance.contentTime, &instance.filePath}) {
+                hashField(hash, *field);
+            }
+            struct stat info;
+            if (!instance.filePath.empty() && stat(instance.filePath.c_str(), &info) == 0) {
+                hashField(hash, static_cast<std::uint64_t>(info.st_size));
+                hashField(hash, static_cast<std::uint64_t>(info.st_mtim.tv_sec));
+                hashField(hash, static_cast<std::uint64_t>(info.st_mtim.tv_nsec));
+            } else {
+                hashField(hash, static_cast<const char*>(nullptr));
+            }
+        }
+    }
+}
+
+} // namespace
+
+std::string HL7MessageGenerator::inputHash(const Patient& patient, const Study& study, StudyContentReader* content,
+                                           const std::string& outputKey) {
+    std::shared_ptr<const ConfigSnapshot> snapshot = acquireSnapshot();
+    const ResolvedCdaProfile& profile = snapshot->profiles.select(study);
+    auto cached = profileHashes.find(&profile);
+    if (cached == profileHashes.end()) {
+        cached = profileHashes.emplace(&profile, hashProfile(profile)).first;
+    }
+
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+    hashField(hash, INPUT_HASH_VERSION);
+    hashField(hash, outputKey);
+    hashField(hash, cached->second);
+    for (const std::string* field : {&patient.patientID, &patient.name, &patient.dateOfBirth, &patient.sex, &patient.addressStreet,
+                                     &patient.addressCity, &patient.addressState, &patient.addressZip, &patient.addressCountry,
+                                     &patient.phoneNumber}) {
+        hashField(hash, *field);
+    }
+    for (const std::string* field : {&study.studyInstanceUID, &study.patientId, &study.accessionNumber, &study.studyDate, &study.studyTime,
+                                     &study.modality, &study.studyDescription, &study.referringPhysicianName,
+                                     &study.performingPhysicianName}) {
+        hashField(hash, *field);
+    }
+    // Without series and instances the key image and analysis settings do not reach the document
+    hashField(hash, static_cast<std::uint64_t>(content != nullptr));
+    if (content) {
+        if (!contentOptionsHashed) {
+            contentOptionsHash = hashContentOptions(snapshot->config);
+            contentOptionsHashed = true;
+        }
+        hashField(hash, contentOptionsHash);
+        hashContent(hash, *content);
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
 // Main message generation function using pugixml
-std::string HL7MessageGenerator::generateORUMessage(const Patient& patient, const Study& study) {
+std::string HL7MessageGenerator::generateORUMessage(const Patient& patient, const Study& study, StudyContentReader* content) {
+    HL7_TRACE_SCOPE_DETAIL("generateORUMessage", study.studyInstanceUID);
     std::cout << "Generating ORU message for patient: " << patient.name
               << " and study: " << study.studyDescription << std::endl;
 
+    std::shared_ptr<const ConfigSnapshot> snapshot = acquireSnapshot();
     pugi::xml_document doc;
+    buildDocument(doc, snapshot->profiles.select(study), patient, study, content != nullptr);
+
+    if (content) {
+        std::string message;
+        KeyImageOptions keyImages = keyImageOptions(snapshot->config);
+        CountAnalysisOptions counts = countAnalysisOptions(snapshot->config);
+        DynamicAnalysisOptions dynamic = dynamicAnalysisOptions(snapshot->config);
+        StudyEntryWriter entries(*content, &keyImages, snapshot->config.countAnalysisEnabled ? &counts : nullptr,
+                                 snapshot->config.dynamicAnalysisEnabled ? &dynamic : nullptr);
+        PugiXmlStreamSerializer serializer(doc, message, "  ", &entries);
+        serializer.finish();
+        Metrics::instance().entriesWritten.add(entries.instancesWritten());
+        std::cout << "HL7 CDA message generated with " << entries.seriesWritten() << " series / "
+                  << entries.instancesWritten() << " instance entries, " << entries.keyImagesWritten() << " key images, "
+                  << entries.countAnalysesWritten() << " counted frames, " << entries.curvesWritten() << " time-activity curves." << std::endl;
+        return message;
+    }
+
+    // Convert the XML document to a string
+    std::stringstream ss;
+    doc.save(ss, "  ", pugi::format_default, pugi::encoding_utf8);
+
+    std::cout << "HL7 CDA message generated successfully." << std::endl;
+    return ss.str();
+}
+
+bool HL7MessageGenerator::generateAndValidate(const Patient& patient, const Study& study, std::string& outMessage, StudyContentReader* content) {
+    HL7_TRACE_SCOPE_DETAIL("generateAndValidate", study.studyInstanceUID);
+    std::cout << "Generating and validating ORU message for patient: " << patient.name
+              << " and study: " << study.studyDescription << std::endl;
+
+    std::shared_ptr<const ConfigSnapshot> snapshot = acquireSnapshot();
+    const AppConfig& config = snapshot->config;
+    pugi::xml_document doc;
+    buildDocument(doc, snapshot->profiles.select(study), patient, study, content != nullptr);
+    outMessage.clear();
+    KeyImageOptions keyImages = keyImageOptions(config);
+    CountAnalysisOptions counts = countAnalysisOptions(config);
+    DynamicAnalysisOptions dynamic = dynamicAnalysisOptions(config);
+    std::unique_ptr<StudyEntryWriter> entries(content ? new StudyEntryWriter(*content, &keyImages, config.countAnalysisEnabled ? &counts : nullptr,
+                                                                             config.dynamicAnalysisEnabled ? &dynamic : nullptr)
+                                                      : nullptr);
+
+    if (config.cdaXsdPath.empty()) {
+        std::cout << "XSD validation skipped: No XSD path configured." << std::endl;
+        if (entries) {
+            PugiXmlStreamSerializer serializer(doc, outMessage, "  ", entries.get());
+            serializer.finish();
+            Metrics::instance().entriesWritten.add(entries->instancesWritten());
+        } else {
+            std::stringstream ss;
+            doc.save(ss, "  ", pugi::format_default, pugi::encoding_utf8);
+            outMessage = ss.str();
+        }
+        Metrics::instance().documentsGenerated.add();
+        return true;
+    }
+
+    if (!validator) {
+        validator.reset(new TieredValidator(config.cdaXsdPath, config.grammarCachePath, config.fullValidationSamplePercent,
+                                            validationMode == XSDValidationMode::Dom));
+        validatorXsdPath = config.cdaXsdPath;
+        validatorGrammarCachePath = config.grammarCachePath;
+        validatorSamplePercent = config.fullValidationSamplePercent;
+        validatorMode = validationMode;
+    }
+    bool valid;
+    {
+        ScopedTimer timer(Metrics::instance().xsdValidation);
+        valid = validator->validate(doc, outMessage, entries.get());
+    }
+    if (entries) {
+        Metrics::instance().entriesWritten.add(entries->instancesWritten());
+    }
+    (valid ? Metrics::instance().documentsGenerated : Metrics::instance().documentsInvalid).add();
+    std::cout << "HL7 CDA message generated (" << outMessage.size() << " bytes)." << std::endl;
+    return valid;
+}
+
+KeyImageOptions HL7MessageGenerator::keyImageOptions(const AppConfig& config) {
+    KeyImageOptions options;
+    options.frames = config.keyImageFrames;
+    options.maxDimension = static_cast<unsigned>(config.keyImageMaxDimension);
+    options.maxPerDocument = static_cast<unsigned>(config.keyImageMaxPerDocument);
+    return options;
+}
+
+CountAnalysisOptions HL7MessageGenerator::countAnalysisOptions(const AppConfig& config) {
+    CountAnalysisOptions options;
+    for (const CountRoiConfig& roi : config.countRois) {
+        options.regions.push_back({roi.name, roi.ellipse, roi.x, roi.y, roi.width, roi.height});
+    }
+    for (const CountRatioConfig& ratio : config.countRatios) {
+        options.ratios.push_back({ratio.name, ratio.numerator, ratio.denominator});
+    }
+    options.useOverlays = config.countUseOverlays;
+    options.codeSystem = config.countCodeSystem;
+    return options;
+}
+
+DynamicAnalysisOptions HL7MessageGenerator::dynamicAnalysisOptions(const AppConfig& config) {
+    DynamicAnalysisOptions options;
+    for (const CountRoiConfig& roi : config.dynamicRois) {
+        options.regions.push_back({roi.name, roi.ellipse, roi.x, roi.y, roi.width, roi.height});
+    }
+    options.background = config.dynamicBackgroundRoi;
+    for (const SplitFunctionConfig& split : config.dynamicSplitFunctions) {
+        options.splits.push_back({split.name, split.left, split.right, split.startSeconds, split.endSeconds});
+    }
+    options.useOverlays = config.dynamicUseOverlays;
+    options.threads = static_cast<unsigned>(config.dynamicAnalysisThreads);
+    options.codeSystem = config.dynamicCodeSystem;
+    return options;
+}
+
+void HL7MessageGenerator::finishValidation() {
+    if (validator) {
+        validator->printSummary();
+        validator.reset();
+    }
+}
+
+void HL7MessageGenerator::buildDocument(pugi::xml_document& doc, const ResolvedCdaProfile& profile, const Patient& patient, const Study& study,
+                                        bool streamEntries) {
+    HL7_TRACE_SCOPE("buildDocument");
+    ScopedTimer timer(Metrics::instance().xmlRender);
 
     // Add XML declaration
     pugi::xml_node declarationNode = doc.append_child(pugi::node_declaration);
@@ -150,97 +481,92 @@ std::string HL7MessageGenerator::generateORUMessage(const Patient& patient, cons
     pugi::xml_node clinicalDocument = doc.append_child("ClinicalDocument");
     clinicalDocument.append_attribute("xmlns") = "urn:hl7-org:v3";
     clinicalDocument.append_attribute("xmlns:xsi") = "http://www.w3.org/2001/XMLSchema-instance";
-    if (!config.cdaXsdPath.empty()) {
-         std::string schemaLocationValue = "urn:hl7-org:v3 " + config.cdaXsdPath; 
-         clinicalDocument.append_attribute("xsi:schemaLocation") = schemaLocationValue.c_str();
+    if (profile.schemaLocation) {
+         clinicalDocument.append_attribute("xsi:schemaLocation") = profile.schemaLocation;
     }
 
 
     std::string effectiveTime = getCurrentTimestamp();
-    std::string documentIdExtension = generateUUID(); // Unique ID for this document
+    documentId = generateUUID(); // Unique ID for this document
+
+    // Build various parts of the CDA using the resolved profile
+    addHeader(doc, profile, patient, study, effectiveTime, documentId);
+    addRecordTarget(clinicalDocument, profile, patient);
+    addAuthor(clinicalDocument, profile, effectiveTime);
+    addCustodian(clinicalDocument, profile);
+    addComponentOf(clinicalDocument, profile, study);
+    addStructuredBody(clinicalDocument, profile, study, streamEntries);
+}
 
-    // Build various parts of the CDA using config
-    addHeader(doc, patient, study, effectiveTime, documentIdExtension);
-    addRecordTarget(clinicalDocument, patient);
-    addAuthor(clinicalDocument, effectiveTime);
-    addCustodian(clinicalDocument);
-    addComponentOf(clinicalDocument, study);
-    addStructuredBody(clinicalDocument, study); // Placeholder for actual study content
+namespace {
 
-    // Convert the XML document to a string
-    std::stringstream ss;
-    doc.save(ss, "  ", pugi::format_default, pugi::encoding_utf8);
+void appendId(pugi::xml_node& parentNode, const char* name, const ResolvedId& id) {
+    pugi::xml_node idNode = parentNode.append_child(name);
+    idNode.append_attribute("root") = id.root;
+    if (id.extension) {
+        idNode.append_attribute("extension") = id.extension;
+    }
+}
 
-    std::cout << "HL7 CDA message generated successfully." << std::endl;
-    return ss.str();
+void appendCode(pugi::xml_node& parentNode, const char* name, const ResolvedCode& code) {
+    pugi::xml_node codeNode = parentNode.append_child(name);
+    codeNode.append_attribute("code") = code.code;
+    codeNode.append_attribute("codeSystem") = code.codeSystem;
+    if (code.codeSystemName) {
+        codeNode.append_attribute("codeSystemName") = code.codeSystemName;
+    }
+    if (code.displayName) {
+        codeNode.append_attribute("displayName") = code.displayName;
+    }
 }
 
-void HL7MessageGenerator::addHeader(pugi::xml_document& doc, const Patient& patient, const Study& study,
+} // namespace
+
+void HL7MessageGenerator::addHeader(pugi::xml_document& doc, const ResolvedCdaProfile& profile, const Patient& patient, const Study& study,
                                     const std::string& effectiveTime, const std::string& documentIdExt) {
+    HL7_TRACE_SCOPE("addHeader");
     pugi::xml_node clinicalDocument = doc.child("ClinicalDocument");
     if (!clinicalDocument) return;
 
-    clinicalDocument.append_child("realmCode").append_attribute("code") = config.realmCode.empty() ? DEFAULT_REALM_CODE.c_str() : config.realmCode.c_str();
-    
-    pugi::xml_node typeId = clinicalDocument.append_child("typeId");
-    typeId.append_attribute("root") = FIXED_TYPEID_ROOT.c_str(); // Use #FIXED value
-    typeId.append_attribute("extension") = config.typeIdExtension.empty() ? DEFAULT_TYPEID_EXTENSION.c_str() : config.typeIdExtension.c_str();
-
-    for(const auto& tmplId : config.templateIds) {
-        pugi::xml_node templateIdNode = clinicalDocument.append_child("templateId");
-        templateIdNode.append_attribute("root") = tmplId.root.empty() ? DEFAULT_OID_ROOT.c_str() : tmplId.root.c_str();
-        if (!tmplId.extension.empty()) { // Extension is optional for templateId
-            templateIdNode.append_attribute("extension") = tmplId.extension.c_str();
-        }
+    clinicalDocument.append_child("realmCode").append_attribute("code") = profile.realmCode;
+    appendId(clinicalDocument, "typeId", profile.typeId);
+    for (const auto& templateId : profile.templateIds) {
+        appendId(clinicalDocument, "templateId", templateId);
     }
 
     pugi::xml_node idNode = clinicalDocument.append_child("id");
-    std::string docIdRoot = config.documentIdRootOid.empty() ? (config.organizationOid.empty() ? DEFAULT_OID_ROOT.c_str() : config.organizationOid.c_str()) : config.documentIdRootOid.c_str();
-    idNode.append_attribute("root") = docIdRoot.c_str();
+    idNode.append_attribute("root") = profile.documentIdRoot;
     idNode.append_attribute("extension") = documentIdExt.c_str(); // Should be non-empty (UUID)
 
-    pugi::xml_node codeNode = clinicalDocument.append_child("code");
-    codeNode.append_attribute("code") = config.documentCode.code.empty() ? DEFAULT_CODE.c_str() : config.documentCode.code.c_str();
-    codeNode.append_attribute("codeSystem") = config.documentCode.codeSystem.empty() ? DEFAULT_CODESYSTEM_NULLFLAVOR.c_str() : config.documentCode.codeSystem.c_str();
-    codeNode.append_attribute("codeSystemName") = config.documentCode.codeSystemName.empty() ? DEFAULT_STRING.c_str() : config.documentCode.codeSystemName.c_str();
-    codeNode.append_attribute("displayName") = config.documentCode.displayName.empty() ? DEFAULT_DISPLAYNAME.c_str() : config.documentCode.displayName.c_str();
+    appendCode(clinicalDocument, "code", profile.documentCode);
 
-    clinicalDocument.append_child("title").text().set(config.documentTitle.empty() ? (std::string("Report - ") + (study.studyDescription.empty() ? DEFAULT_STRING : study.studyDescription)).c_str() : config.documentTitle.c_str());
-    clinicalDocument.append_child("effectiveTime").append_attribute("value") = effectiveTime.c_str(); // Should be non-empty
-    
-    pugi::xml_node confidentialityCode = clinicalDocument.append_child("confidentialityCode");
-    std::string confCodeVal = config.confidentialityCode.code.empty() ? DEFAULT_CONFIDENTIALITY_CODE.c_str() : config.confidentialityCode.code.c_str();
-    std::string confCodeSysVal = config.confidentialityCode.codeSystem.empty() ? DEFAULT_CONFIDENTIALITY_CODESYSTEM.c_str() : config.confidentialityCode.codeSystem.c_str();
-    confidentialityCode.append_attribute("code") = confCodeVal.c_str();
-    confidentialityCode.append_attribute("codeSystem") = confCodeSysVal.c_str();
-    
-    if (!config.confidentialityCode.displayName.empty()){
-        confidentialityCode.append_attribute("displayName") = config.confidentialityCode.displayName.c_str();
+    pugi::xml_node title = clinicalDocument.append_child("title");
+    if (profile.documentTitle) {
+        title.text().set(profile.documentTitle);
     } else {
-         if (confCodeSysVal == DEFAULT_CONFIDENTIALITY_CODESYSTEM) {
-            if (confCodeVal == "N") confidentialityCode.append_attribute("displayName") = "Normal";
-            else if (confCodeVal == "R") confidentialityCode.append_attribute("displayName") = "Restricted";
-            else if (confCodeVal == "V") confidentialityCode.append_attribute("displayName") = "Very Restricted";
-         }
+        title.text().set((std::string("Report - ") + (study.studyDescription.empty() ? profile.unknownText : study.studyDescription.c_str())).c_str());
     }
+    clinicalDocument.append_child("effectiveTime").append_attribute("value") = effectiveTime.c_str(); // Should be non-empty
 
-    clinicalDocument.append_child("languageCode").append_attribute("code") = config.languageCode.empty() ? DEFAULT_LANGUAGE_CODE.c_str() : config.languageCode.c_str();
+    appendCode(clinicalDocument, "confidentialityCode", profile.confidentialityCode);
+    clinicalDocument.append_child("languageCode").append_attribute("code") = profile.languageCode;
 }
 
-void HL7MessageGenerator::addRecordTarget(pugi::xml_node& parentNode, const Patient& patient) {
+void HL7MessageGenerator::addRecordTarget(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const Patient& patient) {
+    HL7_TRACE_SCOPE("addRecordTarget");
     pugi::xml_node recordTarget = parentNode.append_child("recordTarget");
     pugi::xml_node patientRole = recordTarget.append_child("patientRole");
     pugi::xml_node idNode = patientRole.append_child("id");
-    idNode.append_attribute("extension") = patient.patientID.empty() ? DEFAULT_STRING.c_str() : patient.patientID.c_str(); 
-    idNode.append_attribute("root") = config.patientIdRootOid.empty() ? DEFAULT_OID_ROOT.c_str() : config.patientIdRootOid.c_str();
+    idNode.append_attribute("extension") = patient.patientID.empty() ? profile.unknownText : patient.patientID.c_str();
+    idNode.append_attribute("root") = profile.patientIdRoot;
 
     pugi::xml_node patientNode = patientRole.append_child("patient");
     pugi::xml_node nameNode = patientNode.append_child("name");
     std::string familyName, givenName;
     
-    if (patient.name.empty() || patient.name == DEFAULT_STRING) {
-        familyName = DEFAULT_STRING; 
-        givenName = DEFAULT_STRING; 
+    if (patient.name.empty() || patient.name == profile.unknownText) {
+        familyName = profile.unknownText;
+        givenName = profile.unknownText;
     } else {
         size_t space_pos = patient.name.find(' ');
         if (space_pos != std::string::npos) {
@@ -248,77 +574,57 @@ void HL7MessageGenerator::addRecordTarget(pugi::xml_node& parentNode, const Pati
             givenName = patient.name.substr(space_pos + 1);
         } else {
             familyName = patient.name; 
-            givenName = DEFAULT_STRING; 
+            givenName = profile.unknownText;
         }
     }
-    nameNode.append_child("given").text().set(givenName.empty() ? DEFAULT_STRING.c_str() : givenName.c_str());
-    nameNode.append_child("family").text().set(familyName.empty() ? DEFAULT_STRING.c_str() : familyName.c_str());
+    nameNode.append_child("given").text().set(givenName.empty() ? profile.unknownText : givenName.c_str());
+    nameNode.append_child("family").text().set(familyName.empty() ? profile.unknownText : familyName.c_str());
 
     pugi::xml_node genderCode = patientNode.append_child("administrativeGenderCode");
-    genderCode.append_attribute("code") = patient.sex.empty() ? DEFAULT_CODE.c_str() : patient.sex.c_str(); 
-    genderCode.append_attribute("codeSystem") = config.genderCodeSystem.empty() ? DEFAULT_CODESYSTEM_NULLFLAVOR.c_str() : config.genderCodeSystem.c_str(); 
+    genderCode.append_attribute("code") = patient.sex.empty() ? profile.unknownCode : patient.sex.c_str();
+    genderCode.append_attribute("codeSystem") = profile.genderCodeSystem;
 
-    patientNode.append_child("birthTime").append_attribute("value") = patient.dateOfBirth.empty() ? "19000101" : patient.dateOfBirth.c_str(); // Default DOB if empty
+    patientNode.append_child("birthTime").append_attribute("value") = patient.dateOfBirth.empty() ? profile.unknownDate : patient.dateOfBirth.c_str(); // Default DOB if empty
 }
 
-void HL7MessageGenerator::addAuthor(pugi::xml_node& parentNode, const std::string& effectiveTime) {
+void HL7MessageGenerator::addAuthor(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const std::string& effectiveTime) {
+    HL7_TRACE_SCOPE("addAuthor");
     pugi::xml_node author = parentNode.append_child("author");
     author.append_child("time").append_attribute("value") = effectiveTime.c_str(); // Should be non-empty
     pugi::xml_node assignedAuthor = author.append_child("assignedAuthor");
-    pugi::xml_node idNode = assignedAuthor.append_child("id");
-    
-    std::string authorRoot = config.authorIdRootOid.empty() ? (config.organizationOid.empty() ? DEFAULT_OID_ROOT.c_str() : config.organizationOid.c_str()) : config.authorIdRootOid.c_str();
-    idNode.append_attribute("root") = authorRoot.c_str();
-    
-    std::string authorExt = config.authorIdExtension.empty() ? (config.defaultSendingApplication.empty() ? DEFAULT_STRING.c_str() : config.defaultSendingApplication.c_str()) : config.authorIdExtension.c_str();
-    idNode.append_attribute("extension") = authorExt.c_str();
+    appendId(assignedAuthor, "id", profile.authorId);
 
     pugi::xml_node assignedAuthoringDevice = assignedAuthor.append_child("assignedAuthoringDevice");
-    assignedAuthoringDevice.append_child("manufacturerModelName").text().set(config.authorDeviceManufacturer.empty() ? DEFAULT_STRING.c_str() : config.authorDeviceManufacturer.c_str());
-    assignedAuthoringDevice.append_child("softwareName").text().set(config.authorDeviceSoftwareName.empty() ? DEFAULT_STRING.c_str() : config.authorDeviceSoftwareName.c_str());
+    assignedAuthoringDevice.append_child("manufacturerModelName").text().set(profile.authorDeviceManufacturer);
+    assignedAuthoringDevice.append_child("softwareName").text().set(profile.authorDeviceSoftwareName);
 }
 
-void HL7MessageGenerator::addCustodian(pugi::xml_node& parentNode) {
+void HL7MessageGenerator::addCustodian(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile) {
+    HL7_TRACE_SCOPE("addCustodian");
     pugi::xml_node custodian = parentNode.append_child("custodian");
     pugi::xml_node assignedCustodian = custodian.append_child("assignedCustodian");
     pugi::xml_node representedCustodianOrg = assignedCustodian.append_child("representedCustodianOrganization");
-    pugi::xml_node idNode = representedCustodianOrg.append_child("id");
-
-    std::string custodianRoot = config.custodianOrgIdRootOid.empty() ? (config.organizationOid.empty() ? DEFAULT_OID_ROOT.c_str() : config.organizationOid.c_str()) : config.custodianOrgIdRootOid.c_str();
-    idNode.append_attribute("root") = custodianRoot.c_str();
-    if (!config.custodianOrgIdExtension.empty()) { // Extension is optional
-         idNode.append_attribute("extension") = config.custodianOrgIdExtension.c_str();
-    } else { // If root is default, provide default extension
-        if (custodianRoot == DEFAULT_OID_ROOT) {
-             idNode.append_attribute("extension") = DEFAULT_STRING.c_str();
-        }
-    }
-    
-    std::string orgName = config.custodianOrgName.empty() ? (config.sendingFacility.empty() ? DEFAULT_STRING.c_str() : config.sendingFacility.c_str()) : config.custodianOrgName.c_str();
-    representedCustodianOrg.append_child("name").text().set(orgName.c_str());
+    appendId(representedCustodianOrg, "id", profile.custodianId);
+    representedCustodianOrg.append_child("name").text().set(profile.custodianName);
 }
 
-void HL7MessageGenerator::addComponentOf(pugi::xml_node& parentNode, const Study& study) {
+void HL7MessageGenerator::addComponentOf(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const Study& study) {
+    HL7_TRACE_SCOPE("addComponentOf");
     pugi::xml_node componentOf = parentNode.append_child("componentOf");
     pugi::xml_node encompassingEncounter = componentOf.append_child("encompassingEncounter");
     
     pugi::xml_node idNode = encompassingEncounter.append_child("id");
-    std::string encounterRoot = config.encounterIdRootOid.empty() ? DEFAULT_OID_ROOT.c_str() : config.encounterIdRootOid.c_str();
-    idNode.append_attribute("root") = encounterRoot.c_str(); 
-    
-    std::string encounterExt = study.accessionNumber.empty() ? (study.studyInstanceUID.empty() ? DEFAULT_STRING.c_str() : study.studyInstanceUID.c_str()) : study.accessionNumber.c_str();
-    idNode.append_attribute("extension") = encounterExt.c_str();
+    idNode.append_attribute("root") = profile.encounterIdRoot;
+    const char* encounterExt = study.accessionNumber.empty() ? (study.studyInstanceUID.empty() ? profile.unknownText : study.studyInstanceUID.c_str()) : study.accessionNumber.c_str();
+    idNode.append_attribute("extension") = encounterExt;
 
-    if (!config.encounterTypeCode.code.empty()) {
-        pugi::xml_node codeNode = encompassingEncounter.append_child("code"); 
-        codeNode.append_attribute("code") = config.encounterTypeCode.code.c_str();
-        codeNode.append_attribute("codeSystem") = config.encounterTypeCode.codeSystem.empty() ? DEFAULT_CODESYSTEM_NULLFLAVOR.c_str() : config.encounterTypeCode.codeSystem.c_str();
-        codeNode.append_attribute("displayName") = config.encounterTypeCode.displayName.empty() ? DEFAULT_DISPLAYNAME.c_str() : config.encounterTypeCode.displayName.c_str();
-    } // If config.encounterTypeCode.code is empty, the entire <code> element is omitted. This is usually fine as it's often optional.
+    if (profile.encounterCode.code) {
+        appendCode(encompassingEncounter, "code", profile.encounterCode);
+    } // Without a configured encounter type code, the entire <code> element is omitted. This is usually fine as it's often optional.
 
     pugi::xml_node effectiveTimeNode = encompassingEncounter.append_child("effectiveTime");
     std::string studyDateTimeLow = study.studyDate; 
-    if (studyDateTimeLow.empty()) studyDateTimeLow = "19000101"; // Default date if empty
+    if (studyDateTimeLow.empty()) studyDateTimeLow = profile.unknownDate; // Default date if empty
     
     if (!study.studyTime.empty() && study.studyTime.length() >= 4) { 
         studyDateTimeLow += study.studyTime.substr(0, 4); // HHMM
@@ -335,60 +641,44 @@ void HL7MessageGenerator::addComponentOf(pugi::xml_node& parentNode, const Study
 
     pugi::xml_node locationNode = encompassingEncounter.append_child("location");
     pugi::xml_node healthCareFacilityNode = locationNode.append_child("healthCareFacility");
-    pugi::xml_node facilityIdNode = healthCareFacilityNode.append_child("id");
-    
-    std::string facilityRoot = config.locationFacilityIdRootOid.empty() ? (config.organizationOid.empty() ? DEFAULT_OID_ROOT.c_str() : config.organizationOid.c_str()) : config.locationFacilityIdRootOid.c_str();
-    facilityIdNode.append_attribute("root") = facilityRoot.c_str();
-    if (!config.locationFacilityIdExtension.empty()) { 
-        facilityIdNode.append_attribute("extension") = config.locationFacilityIdExtension.c_str();
-    } else {
-        if (facilityRoot == DEFAULT_OID_ROOT) { // If root is default, provide default extension
-            facilityIdNode.append_attribute("extension") = DEFAULT_STRING.c_str();
-        }
-    }
+    appendId(healthCareFacilityNode, "id", profile.facilityId);
     pugi::xml_node locationPlaceNode = healthCareFacilityNode.append_child("location"); 
     locationPlaceNode.append_attribute("classCode") = "PLC";
     locationPlaceNode.append_attribute("determinerCode") = "INSTANCE";
-    pugi::xml_node locationNameNode = locationPlaceNode.append_child("name");
-    std::string facilityName = config.locationFacilityName.empty() ? (config.sendingFacility.empty() ? DEFAULT_STRING.c_str() : config.sendingFacility.c_str()) : config.locationFacilityName.c_str();
-    locationNameNode.text().set(facilityName.c_str());
+    locationPlaceNode.append_child("name").text().set(profile.facilityName);
 }
 
-void HL7MessageGenerator::addStructuredBody(pugi::xml_node& parentNode, const Study& study) {
+void HL7MessageGenerator::addStructuredBody(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const Study& study, bool streamEntries) {
+    HL7_TRACE_SCOPE("addStructuredBody");
     pugi::xml_node component = parentNode.append_child("component");
     pugi::xml_node structuredBody = component.append_child("structuredBody");
 
     pugi::xml_node sectionComponent = structuredBody.append_child("component");
     pugi::xml_node section = sectionComponent.append_child("section");
 
-    pugi::xml_node sectionCode = section.append_child("code");
-    std::string rsc_code = config.reportSectionCode.code.empty() ? "18748-4" : config.reportSectionCode.code; // Default LOINC code for Diag Imaging Report
-    std::string rsc_cs = config.reportSectionCode.codeSystem.empty() ? "2.16.840.1.113883.6.1" : config.reportSectionCode.codeSystem; // Default LOINC OID
-    std::string rsc_csn = config.reportSectionCode.codeSystemName.empty() ? "LOINC" : config.reportSectionCode.codeSystemName;
-    std::string rsc_dn = config.reportSectionCode.displayName.empty() ? "Diagnostic Imaging Report Section" : config.reportSectionCode.displayName;
-
-    sectionCode.append_attribute("code") = rsc_code.c_str(); 
-    sectionCode.append_attribute("codeSystem") = rsc_cs.c_str(); 
-    sectionCode.append_attribute("codeSystemName") = rsc_csn.c_str();
-    sectionCode.append_attribute("displayName") = rsc_dn.c_str();
+    appendCode(section, "code", profile.reportSectionCode);
     
-    section.append_child("title").text().set(study.studyDescription.empty() ? DEFAULT_STRING.c_str() : study.studyDescription.c_str());
+    const char* description = study.studyDescription.empty() ? profile.unknownText : study.studyDescription.c_str();
+    section.append_child("title").text().set(description);
 
     pugi::xml_node textNode = section.append_child("text");
-    std::string narrative = std::string("Study Description: ") + (study.studyDescription.empty() ? DEFAULT_STRING : study.studyDescription) +
-                            ". Modality: " + (study.modality.empty() ? DEFAULT_STRING : study.modality) + ".";
-    if (!study.studyInstanceUID.empty()) {
-        narrative += " Study UID: " + study.studyInstanceUID + ".";
-    } else {
-        narrative += " Study UID: " + DEFAULT_STRING + ".";
-    }
+    std::string narrative = std::string("Study Description: ") + description +
+                            ". Modality: " + (study.modality.empty() ? profile.unknownText : study.modality.c_str()) + ".";
+    narrative += std::string(" Study UID: ") + (study.studyInstanceUID.empty() ? profile.unknownText : study.studyInstanceUID.c_str()) + ".";
     
     pugi::xml_node paragraph = textNode.append_child("paragraph");
     paragraph.text().set(narrative.c_str());
+
+    if (streamEntries) {
+        // Series/instance entries are written here by StudyEntryWriter during serialization
+        section.append_child(pugi::node_pi).set_name(STREAMED_CONTENT_PI);
+    }
 }
 
 
 bool HL7MessageGenerator::saveMessageToFile(const std::string& message, const std::string& filePath) {
+    HL7_TRACE_SCOPE_DETAIL("saveMessageToFile", filePath);
+    ScopedTimer timer(Metrics::instance().fileWrite);
     std::ofstream outFile(filePath);
     if (!outFile.is_open()) {
         std::cerr << "Error: Could not open file for saving HL7 message: " << filePath << std::endl;
@@ -396,18 +686,47 @@ bool HL7MessageGenerator::saveMessageToFile(const std::string& message, const st
     }
     outFile << message;
     outFile.close();
+    Metrics::instance().filesWritten.add();
+    Metrics::instance().bytesWritten.add(message.size());
     std::cout << "HL7 message saved to: " << filePath << std::endl;
     return true;
 }
 
 // --- XSD Validation Implementation ---
+XSDValidationMode HL7MessageGenerator::parseValidationMode(const std::string& mode) {
+    if (mode == "dom" || mode == "DOM") {
+        return XSDValidationMode::Dom;
+    }
+    if (!mode.empty() && mode != "sax" && mode != "SAX" && mode != "sax2" && mode != "SAX2") {
+        std::cerr << "Warning: Unknown validation mode '" << mode << "', falling back to SAX2." << std::endl;
+    }
+    return XSDValidationMode::Sax2;
+}
+
 bool HL7MessageGenerator::validateMessageWithXSD(const std::string& xmlMessage) {
+    acquireSnapshot();
+    return validateMessageWithXSD(xmlMessage, validationMode);
+}
+
+bool HL7MessageGenerator::validateMessageWithXSD(const std::string& xmlMessage, XSDValidationMode mode) {
+    HL7_TRACE_SCOPE("validateMessageWithXSD");
+    std::shared_ptr<const ConfigSnapshot> snapshot = configStore.current();
+    const AppConfig& config = snapshot->config;
     if (config.cdaXsdPath.empty()) {
         std::cout << "XSD validation skipped: No XSD path configured." << std::endl;
         return true;
     }
-    std::cout << "Validating message with XSD: " << config.cdaXsdPath << std::endl;
+    std::cout << "Validating message with XSD: " << config.cdaXsdPath
+              << " (" << (mode == XSDValidationMode::Dom ? "DOM" : "SAX2") << ")" << std::endl;
+
+    std::string schemaLocationArg = "urn:hl7-org:v3 " + config.cdaXsdPath;
+    if (mode == XSDValidationMode::Dom) {
+        return validateWithDomParser(xmlMessage, schemaLocationArg);
+    }
+    return validateWithSax2Reader(xmlMessage, schemaLocationArg);
+}
 
+bool HL7MessageGenerator::validateWithDomParser(const std::string& xmlMessage, const std::string& schemaLocationArg) {
     XercesDOMParser* parser = new XercesDOMParser();
     XSDValidationErrorHandler errorHandler;
 
@@ -416,9 +735,6 @@ bool HL7MessageGenerator::validateMessageWithXSD(const std::string& xmlMessage)
     parser->setDoSchema(true);
     parser->setValidationSchemaFullChecking(true);
 
-    std::string actualSchemaPathForParser = config.cdaXsdPath;
-    std::string schemaLocationArg = "urn:hl7-org:v3 " + actualSchemaPathForParser;
-    
     XMLCh* schemaLocation = XMLString::transcode(schemaLocationArg.c_str());
     parser->setExternalSchemaLocation(schemaLocation);
     XMLString::release(&schemaLocation);
@@ -461,3 +777,60 @@ bool HL7MessageGenerator::validateMessageWithXSD(const std::string& xmlMessage)
     delete parser;
     return validationSuccess;
 }
+
+// Streams the document through a validating SAX2 reader. No tree is built, so memory
+// stays bounded by the scanner's buffers regardless of report size.
+bool HL7MessageGenerator::validateWithSax2Reader(const std::string& xmlMessage, const std::string& schemaLocationArg) {
+    SAX2XMLReader* reader = XMLReaderFactory::createXMLReader();
+    XSDValidationErrorHandler errorHandler;
+    DefaultHandler noopContentHandler; // Validation only needs the error callbacks
+
+    reader->setFeature(XMLUni::fgSAX2CoreNameSpaces, true);
+    reader->setFeature(XMLUni::fgSAX2CoreValidation, true);
+    reader->setFeature(XMLUni::fgXercesDynamic, false); // Always validate, like Val_Always
+    reader->setFeature(XMLUni::fgXercesSchema, true);
+    reader->setFeature(XMLUni::fgXercesSchemaFullChecking, true);
+
+    XMLCh* schemaLocation = XMLString::transcode(schemaLocationArg.c_str());
+    reader->setProperty(XMLUni::fgXercesSchemaExternalSchemaLocation, schemaLocation);
+    XMLString::release(&schemaLocation); // The scanner keeps its own copy
+
+    reader->setContentHandler(&noopContentHandler);
+    reader->setErrorHandler(&errorHandler);
+
+    bool validationSuccess = false;
+    try {
+        MemBufInputSource memBufIS(
+            (const XMLByte*)xmlMessage.c_str(),
+            xmlMessage.length(),
+            "InMemoryDocument",
+            false
+        );
+        reader->parse(memBufIS);
+        if (errorHandler.getSawErrors()) {
+            std::cerr << "XSD Validation Failed with errors." << std::endl;
+            validationSuccess = false;
+        } else {
+            std::cout << "XSD Validation Successful: Document is valid." << std::endl;
+            validationSuccess = true;
+        }
+    } catch (const OutOfMemoryException&) {
+        std::cerr << "XSD Validation Error: OutOfMemoryException" << std::endl;
+        validationSuccess = false;
+    } catch (const XMLException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "XSD Validation Error (XMLException): " << message << std::endl;
+        XMLString::release(&message);
+        validationSuccess = false;
+    } catch (const SAXException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "XSD Validation Error (SAXException): " << message << std::endl;
+        XMLString::release(&message);
+        validationSuccess = false;
+    } catch (...) {
+        std::cerr << "XSD Validation Error: An unknown exception occurred." << std::endl;
+        validationSuccess = false;
+    }
+    delete reader;
+    return validationSuccess;
+}
@@ -2,9 +2,17 @@
 #define HL7MESSAGEGENERATOR_H
 
 #include <string>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
 #include "../models/Patient.h"
 #include "../models/Study.h"
 #include "../config_manager/ConfigManager.h" // Include AppConfig
+#include "../config_manager/ConfigSnapshot.h"
+#include "../data_source/StudyContentReader.h"
+#include "StudyEntryWriter.h"
+#include "../xsd_validator/XSDValidator.h"
+#include "../xsd_validator/TieredValidator.h"
 #include "pugixml.hpp"
 
 // Xerces-C++ Includes for XSD validation
@@ -18,15 +26,49 @@
 
 XERCES_CPP_NAMESPACE_USE
 
+// How validateMessageWithXSD and the full tier of TieredValidator drive Xerces-C++
+enum class XSDValidationMode {
+    Dom,  // XercesDOMParser: builds (and discards) a full DOM tree
+    Sax2  // SAX2XMLReader with a no-op content handler: streaming, bounded memory
+};
 
 class HL7MessageGenerator {
 public:
-    HL7MessageGenerator(const AppConfig& configuration);
+    // Each document is built from the snapshot current when it starts, so a config reload
+    // never changes a document half-way. Header values come only from the snapshot's profile.
+    explicit HL7MessageGenerator(const ConfigStore& store);
     ~HL7MessageGenerator(); // Destructor for Xerces-C++ cleanup
 
-    std::string generateORUMessage(const Patient& patient, const Study& study);
+    // With `content`, the report section gets an entry per series and an observation per
+    // instance, streamed from the reader into the output, plus the <KeyImages> frames and
+    // <CountAnalysis> / <DynamicAnalysis> results of instances with a DICOM file (see StudyEntryWriter)
+    std::string generateORUMessage(const Patient& patient, const Study& study, StudyContentReader* content = nullptr);
+    // Builds the CDA tree and validates it while serializing it into outMessage, so the
+    // text is produced once and never re-read. Skips validation when no XSD is configured.
+    bool generateAndValidate(const Patient& patient, const Study& study, std::string& outMessage, StudyContentReader* content = nullptr);
+    // Stable hash (FNV-1a, 16 hex digits) of what the document for this study is generated
+    // from: the patient, the study, every value of the resolved profile selected for it from
+    // the current snapshot, `outputKey` (OutputIndex::outputSettingsKey) and, with `content`,
+    // the key image and analysis settings and each series, instance and instance file (size
+    // and modification time). Reads `content` to the end; open another reader to generate.
+    // The document ID and timestamps are not inputs, so an unchanged study hashes the same
+    // on every run.
+    std::string inputHash(const Patient& patient, const Study& study, StudyContentReader* content, const std::string& outputKey);
+    // Prints the validation summary and releases the validator. Call before terminateXerces().
+    void finishValidation();
     bool saveMessageToFile(const std::string& message, const std::string& filePath);
     bool validateMessageWithXSD(const std::string& xmlMessage);
+    bool validateMessageWithXSD(const std::string& xmlMessage, XSDValidationMode mode);
+
+    // The <KeyImages> settings of a config
+    static KeyImageOptions keyImageOptions(const AppConfig& config);
+    // The <CountAnalysis> settings of a config
+    static CountAnalysisOptions countAnalysisOptions(const AppConfig& config);
+    // The <DynamicAnalysis> settings of a config
+    static DynamicAnalysisOptions dynamicAnalysisOptions(const AppConfig& config);
+
+    // Maps the <Validation><Mode> config value ("dom" / "sax") to a mode; defaults to Sax2
+    static XSDValidationMode parseValidationMode(const std::string& mode);
 
     // Static members for Xerces initialization (call once)
     static bool xercesInitialized;
@@ -35,15 +77,40 @@ public:
 
     std::string getCurrentTimestamp(const char* format = "%Y%m%d%H%M%S%z");
 
-private:
-    const AppConfig& config;
+    // <id extension> of the document built last
+    const std::string& lastDocumentId() const { return documentId; }
 
-    void addHeader(pugi::xml_document& doc, const Patient& patient, const Study& study, const std::string& effectiveTime, const std::string& documentIdExt);
-    void addRecordTarget(pugi::xml_node& parentNode, const Patient& patient);
-    void addAuthor(pugi::xml_node& parentNode, const std::string& effectiveTime);
-    void addCustodian(pugi::xml_node& parentNode);
-    void addComponentOf(pugi::xml_node& parentNode, const Study& study);
-    void addStructuredBody(pugi::xml_node& parentNode, const Study& study);
+private:
+    const ConfigStore& configStore;
+    unsigned long appliedVersion; // Snapshot version validationMode and validator were set up for
+    XSDValidationMode validationMode;
+    std::string documentId;
+    // FNV-1a of each resolved profile, and of the key image and analysis settings, for the
+    // snapshot version last applied
+    std::unordered_map<const ResolvedCdaProfile*, std::uint64_t> profileHashes;
+    std::uint64_t contentOptionsHash = 0;
+    bool contentOptionsHashed = false;
+
+    // Takes the current snapshot and, when it is new, applies its validation settings
+    std::shared_ptr<const ConfigSnapshot> acquireSnapshot();
+
+    bool validateWithDomParser(const std::string& xmlMessage, const std::string& schemaLocationArg);
+    bool validateWithSax2Reader(const std::string& xmlMessage, const std::string& schemaLocationArg);
+
+    std::unique_ptr<TieredValidator> validator; // Created on first generateAndValidate; holds the compiled grammar
+    std::string validatorXsdPath;          // Settings the validator was created with
+    std::string validatorGrammarCachePath;
+    int validatorSamplePercent = 100;
+    XSDValidationMode validatorMode = XSDValidationMode::Sax2;
+    // streamEntries: leave a <?hl7-streamed-content?> marker for the entries after the section narrative
+    void buildDocument(pugi::xml_document& doc, const ResolvedCdaProfile& profile, const Patient& patient, const Study& study, bool streamEntries);
+
+    void addHeader(pugi::xml_document& doc, const ResolvedCdaProfile& profile, const Patient& patient, const Study& study, const std::string& effectiveTime, const std::string& documentIdExt);
+    void addRecordTarget(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const Patient& patient);
+    void addAuthor(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const std::string& effectiveTime);
+    void addCustodian(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile);
+    void addComponentOf(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const Study& study);
+    void addStructuredBody(pugi::xml_node& parentNode, const ResolvedCdaProfile& profile, const Study& study, bool streamEntries);
 
     std::string generateUUID();
     void addPatientRole(pugi::xml_node& recordTargetNode, const Patient& patient);
@@ -53,27 +120,9 @@ private:
     void addEncompassingEncounter(pugi::xml_node& componentOfNode, const Study& study);
     void addLocation(pugi::xml_node& encompassingEncounterNode);
     void addServiceProviderOrganization(pugi::xml_node& locationNode);
-    void addObservation(pugi::xml_node& componentNode, const Study& study);
     void addParticipant(pugi::xml_node& parentNode, const std::string& typeCode, const std::string& roleClassOID, const std::string& roleCode, const std::string& roleCodeSystem, const std::string& roleDisplayName, const std::string& entityName, const std::string& entityIdRoot, const std::string& entityIdExt);
 
 
 };
 
-// Custom Error Handler for Xerces-C++ Validation
-class XSDValidationErrorHandler : public HandlerBase {
-public:
-    XSDValidationErrorHandler() : fSawErrors(false) {}
-    ~XSDValidationErrorHandler() override = default;
-
-    void warning(const SAXParseException& exc) override;
-    void error(const SAXParseException& exc) override;
-    void fatalError(const SAXParseException& exc) override;
-    void resetErrors() override;
-    bool getSawErrors() const { return fSawErrors; }
-
-private:
-    bool fSawErrors;
-};
-
-
 #endif // HL7MESSAGEGENERATOR_H
@@ -0,0 +1,568 @@
+#include "StudyEntryWriter.h"
+#include "Base64.h"
+#include "../dicom_parser/DicomParser.h"
+#include "../imaging/PngEncoder.h"
+#include "../metrics/Metrics.h"
+#include "../xsd_validator/FastCdaChecker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+const char* const DCM_CODE_SYSTEM = "1.2.840.10008.2.16.4";   // DICOM Controlled Terminology
+const char* const DCMUID_CODE_SYSTEM = "1.2.840.10008.2.6.1"; // DICOM UID Registry
+
+void writeIndent(std::string& out, unsigned depth, const char* indent) {
+    for (unsigned i = 0; i < depth; ++i) {
+        out += indent;
+    }
+}
+
+// Used for attribute values and text alike, so whitespace a parser would normalize
+// (tab, newline, CR) and other control characters go out as character references
+void writeEscaped(std::string& out, const std::string& value) {
+    for (char c : value) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 32) {
+                    out += "&#";
+                    out += std::to_string(static_cast<unsigned char>(c));
+                    out += ';';
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
+void writeLine(std::string& out, unsigned depth, const char* indent, const char* text) {
+    writeIndent(out, depth, indent);
+    out += text;
+    out += '\n';
+}
+
+bool isIiRoot(const char* value) {
+    return FastCdaChecker::isOid(value) || FastCdaChecker::isUuid(value) || FastCdaChecker::isRuid(value);
+}
+
+// DICOM DA/TM (YYYYMMDD or YYYY-MM-DD, HHMMSS[.FFFFFF] or HH:MM:SS) as an HL7 TS
+std::string toTs(const std::string& date, const std::string& time) {
+    std::string ts;
+    for (char c : date) {
+        if (c != '-') ts += c;
+    }
+    for (char c : time) {
+        if (c == '.') break;
+        if (c != ':') ts += c;
+    }
+    return ts;
+}
+
+// Image Type (0008,0008) value 3 of images whose frames are not each a planar view
+bool isStaticImage(const std::vector<std::string>& imageType) {
+    if (imageType.size() < 3) {
+        return true;
+    }
+    const std::string& kind = imageType[2];
+    return kind != "DYNAMIC" && kind.find("GATED") == std::string::npos && kind.find("TOMO") == std::string::npos;
+}
+
+bool isDynamicImage(const std::vector<std::string>& imageType) {
+    return imageType.size() >= 3 && imageType[2] == "DYNAMIC";
+}
+
+std::string formatReal(double value, int decimals) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.*f", decimals, value);
+    return text;
+}
+
+Roi rasterise(const RegionOptions& region, std::uint32_t width, std::uint32_t height) {
+    return region.ellipse ? Roi::ellipse(region.name, region.left, region.top, region.width, region.height, width, height)
+                          : Roi::rectangle(region.name, region.left, region.top, region.width, region.height, width, height);
+}
+
+// The image's ROI overlays (Overlay Type R); graphics overlays are annotations, not regions
+void addOverlayRegions(const std::vector<OverlayPlane>& overlays, std::uint32_t width, std::uint32_t height, std::vector<Roi>& regions) {
+    for (const OverlayPlane& overlay : overlays) {
+        if (overlay.roi) {
+            regions.push_back(Roi::fromOverlay(overlay, width, height));
+        }
+    }
+}
+
+} // namespace
+
+StudyEntryWriter::StudyEntryWriter(StudyContentReader& contentReader, const KeyImageOptions* keyImageOptions,
+                                   const CountAnalysisOptions* countAnalysisOptions,
+                                   const DynamicAnalysisOptions* dynamicAnalysisOptions)
+    : reader(contentReader), state(State::BetweenSeries), seriesCount(0), instanceCount(0),
+      keyImages(keyImageOptions && !keyImageOptions->frames.empty() ? keyImageOptions : nullptr), keyImageCount(0),
+      countAnalysis(countAnalysisOptions), countAnalysisCount(0), regionWidth(0), regionHeight(0),
+      dynamicAnalysis(dynamicAnalysisOptions), curveCount(0) {
+}
+
+void StudyEntryWriter::reportProblem(const char* what, const std::string& value) {
+    if (firstProblem.empty()) {
+        firstProblem = std::string("streamed ") + what + ": malformed value '" + value + "'";
+    }
+}
+
+void StudyEntryWriter::writeId(std::string& out, const std::string& uid, const char* what) {
+    if (uid.empty()) {
+        out += "<id nullFlavor=\"UNK\" />\n";
+        return;
+    }
+    if (!isIiRoot(uid.c_str())) {
+        reportProblem(what, uid);
+    }
+    out += "<id root=\"";
+    writeEscaped(out, uid);
+    out += "\" />\n";
+}
+
+void StudyEntryWriter::writeEffectiveTime(std::string& out, unsigned depth, const char* indent,
+                                          const std::string& date, const std::string& time, const char* what) {
+    if (date.empty()) {
+        return;
+    }
+    std::string ts = toTs(date, time);
+    if (!FastCdaChecker::isTs(ts.c_str())) {
+        reportProblem(what, ts);
+    }
+    writeIndent(out, depth, indent);
+    out += "<effectiveTime value=\"";
+    writeEscaped(out, ts);
+    out += "\" />\n";
+}
+
+void StudyEntryWriter::writeSeriesStart(std::string& out, unsigned depth, const char* indent) {
+    writeLine(out, depth, indent, "<entry>");
+    writeLine(out, depth + 1, indent, "<organizer classCode=\"CLUSTER\" moodCode=\"EVN\">");
+    writeIndent(out, depth + 2, indent);
+    writeId(out, series.seriesInstanceUID, "series UID");
+    writeIndent(out, depth + 2, indent);
+    out += "<code code=\"113015\" codeSystem=\"";
+    out += DCM_CODE_SYSTEM;
+    out += "\" codeSystemName=\"DCM\" displayName=\"Series\" />\n";
+    writeLine(out, depth + 2, indent, "<statusCode code=\"completed\" />");
+    writeEffectiveTime(out, depth + 2, indent, series.seriesDate, series.seriesTime, "series date/time");
+
+    if (!series.modality.empty()) {
+        if (!FastCdaChecker::isCs(series.modality.c_str())) {
+            reportProblem("modality", series.modality);
+        }
+        writeLine(out, depth + 2, indent, "<component>");
+        writeLine(out, depth + 3, indent, "<observation classCode=\"OBS\" moodCode=\"EVN\">");
+        writeIndent(out, depth + 4, indent);
+        out += "<code code=\"121139\" codeSystem=\"";
+        out += DCM_CODE_SYSTEM;
+        out += "\" codeSystemName=\"DCM\" displayName=\"Modality\" />\n";
+        writeIndent(out, depth + 4, indent);
+        out += "<value xsi:type=\"CD\" code=\"";
+        writeEscaped(out, series.modality);
+        out += "\" codeSystem=\"";
+        out += DCM_CODE_SYSTEM;
+        out += "\" codeSystemName=\"DCM\" />\n";
+        writeLine(out, depth + 3, indent, "</observation>");
+        writeLine(out, depth + 2, indent, "</component>");
+    }
+}
+
+void StudyEntryWriter::writeInstance(std::string& out, unsigned depth, const char* indent) {
+    writeLine(out, depth + 2, indent, "<component>");
+    writeLine(out, depth + 3, indent, "<observation classCode=\"DGIMG\" moodCode=\"EVN\">");
+    writeIndent(out, depth + 4, indent);
+    writeId(out, instance.sopInstanceUID, "SOP instance UID");
+    writeIndent(out, depth + 4, indent);
+    if (instance.sopClassUID.empty()) {
+        out += "<code nullFlavor=\"UNK\" />\n";
+    } else {
+        if (!FastCdaChecker::isOid(instance.sopClassUID.c_str())) {
+            reportProblem("SOP class UID", instance.sopClassUID);
+        }
+        out += "<code code=\"";
+        writeEscaped(out, instance.sopClassUID);
+        out += "\" codeSystem=\"";
+        out += DCMUID_CODE_SYSTEM;
+        out += "\" codeSystemName=\"DCMUID\" />\n";
+    }
+    writeEffectiveTime(out, depth + 4, indent, instance.contentDate, instance.contentTime, "content date/time");
+    writeLine(out, depth + 3, indent, "</observation>");
+    writeLine(out, depth + 2, indent, "</component>");
+    writeImageContent(out, depth, indent);
+}
+
+void StudyEntryWriter::writeImageContent(std::string& out, unsigned depth, const char* indent) {
+    const bool wantKeyImages = keyImages && keyImageCount < keyImages->maxPerDocument;
+    if ((!wantKeyImages && !countAnalysis && !dynamicAnalysis) || instance.filePath.empty()) {
+        return;
+    }
+    DicomParser parser; // Loaded once for the key images and the analyses
+    if (!parser.loadFile(instance.filePath)) {
+        std::cerr << "Warning: No key images or analysis for instance " << instance.sopInstanceUID << "." << std::endl;
+        return;
+    }
+    if (wantKeyImages) {
+        writeKeyImages(out, depth, indent, parser);
+    }
+    if (countAnalysis) {
+        writeCountAnalysis(out, depth, indent, parser);
+    }
+    if (dynamicAnalysis) {
+        writeTimeActivity(out, depth, indent, parser);
+    }
+}
+
+void StudyEntryWriter::writeKeyImages(std::string& out, unsigned depth, const char* indent, const DicomParser& parser) {
+    const size_t frameCount = parser.getFrameCount();
+    std::vector<size_t> embedded; // "1, last" names one frame twice in a single-frame image
+    for (int configured : keyImages->frames) {
+        size_t number = configured == 0 ? frameCount : static_cast<size_t>(configured);
+        if (keyImageCount >= keyImages->maxPerDocument) {
+            break;
+        }
+        if (number == 0 || number > frameCount || std::find(embedded.begin(), embedded.end(), number) != embedded.end()) {
+            continue;
+        }
+        embedded.push_back(number);
+        if (parser.getFrame(number - 1, frame) && writeKeyImage(out, depth, indent, number)) {
+            ++keyImageCount;
+        }
+    }
+}
+
+bool StudyEntryWriter::writeKeyImage(std::string& out, unsigned depth, const char* indent, size_t frameNumber) {
+    ScopedTimer timer(Metrics::instance().keyImageEncode);
+    renderFrame(frame, keyImages->maxDimension, rendered);
+
+    const size_t start = out.size();
+    writeLine(out, depth + 2, indent, "<component>");
+    writeLine(out, depth + 3, indent, "<observationMedia classCode=\"OBS\" moodCode=\"EVN\">");
+    writeIndent(out, depth + 4, indent);
+    if (instance.sopInstanceUID.empty()) {
+        out += "<id nullFlavor=\"UNK\" />\n";
+    } else {
+        // The image's own identity: its SOP instance and frame
+        out += "<id root=\"";
+        writeEscaped(out, instance.sopInstanceUID);
+        out += "\" extension=\"";
+        out += std::to_string(frameNumber);
+        out += "\" />\n";
+    }
+    writeIndent(out, depth + 4, indent);
+    out += "<value mediaType=\"image/png\" representation=\"B64\">";
+    Base64Encoder base64(out);
+    if (!encodePng(rendered, [&base64](const unsigned char* data, size_t size) { base64.write(data, size); })) {
+        out.resize(start); // Drop the partial component
+        return false;
+    }
+    base64.finish();
+    out += "</value>\n";
+    writeLine(out, depth + 3, indent, "</observationMedia>");
+    writeLine(out, depth + 2, indent, "</component>");
+    Metrics::instance().keyImagesEmbedded.add();
+    Metrics::instance().keyImageBytes.add(base64.bytesIn());
+    return true;
+}
+
+void StudyEntryWriter::writeCountAnalysis(std::string& out, unsigned depth, const char* indent, const DicomParser& parser) {
+    if (!isStaticImage(parser.getImageType())) {
+        return;
+    }
+    std::vector<OverlayPlane> overlays;
+    if (countAnalysis->useOverlays) {
+        overlays = parser.getOverlays();
+    }
+    bool overlaysRasterised = false; // Once per instance, for its matrix size
+    const size_t frameCount = parser.getFrameCount();
+    for (size_t number = 1; number <= frameCount; ++number) {
+        if (!parser.getFrame(number - 1, frame) || frame.channels != 1) {
+            continue;
+        }
+        ScopedTimer timer(Metrics::instance().countAnalysis);
+        if (frame.width != regionWidth || frame.height != regionHeight) {
+            configuredRegions.clear();
+            for (const RegionOptions& region : countAnalysis->regions) {
+                configuredRegions.push_back(rasterise(region, frame.width, frame.height));
+            }
+            regionWidth = frame.width;
+            regionHeight = frame.height;
+        }
+        if (!overlaysRasterised) {
+            overlaysRasterised = true;
+            overlayRegions.clear();
+            addOverlayRegions(overlays, frame.width, frame.height, overlayRegions);
+        }
+        writeFrameCounts(out, depth, indent, number);
+        ++countAnalysisCount;
+        Metrics::instance().framesAnalysed.add();
+    }
+}
+
+void StudyEntryWriter::writeFrameCounts(std::string& out, unsigned depth, const char* indent, size_t frameNumber) {
+    const RegionCounts total = countFrame(frame);
+    writeAnalysisStart(out, depth, indent, frameNumber, "COUNT_ANALYSIS", "Count analysis", countAnalysis->codeSystem);
+    writeMeasurement(out, depth, indent, "TOTAL_COUNTS", "Total counts", nullptr, std::to_string(total.sum), "{counts}", countAnalysis->codeSystem);
+    if (total.pixels > 0) {
+        writeMeasurement(out, depth, indent, "MAX_COUNTS", "Maximum pixel counts", nullptr, std::to_string(total.max), "{counts}", countAnalysis->codeSystem);
+        writeMeasurement(out, depth, indent, "MEAN_COUNTS", "Mean pixel counts", nullptr, formatReal(total.mean(), 3), "{counts}", countAnalysis->codeSystem);
+    }
+
+    // Region counts, kept for the ratios; empty regions (outside this matrix) are left out
+    std::vector<std::pair<const Roi*, RegionCounts>> regionCounts;
+    for (const std::vector<Roi>* regions : {&configuredRegions, &overlayRegions}) {
+        for (const Roi& region : *regions) {
+            RegionCounts counts = countRegion(frame, region);
+            if (counts.pixels == 0) {
+                continue;
+            }
+            regionCounts.emplace_back(&region, counts);
+            writeMeasurement(out, depth, indent, "ROI_COUNTS", "Region counts", &region.name, std::to_string(counts.sum), "{counts}", countAnalysis->codeSystem);
+            writeMeasurement(out, depth, indent, "ROI_MAX", "Region maximum pixel counts", &region.name, std::to_string(counts.max), "{counts}", countAnalysis->codeSystem);
+            writeMeasurement(out, depth, indent, "ROI_MEAN", "Region mean pixel counts", &region.name, formatReal(counts.mean(), 3), "{counts}", countAnalysis->codeSystem);
+        }
+    }
+    for (const CountAnalysisOptions::Ratio& ratio : countAnalysis->ratios) {
+        const RegionCounts* numerator = nullptr;
+        const RegionCounts* denominator = nullptr;
+        for (const auto& entry : regionCounts) {
+            if (entry.first->name == ratio.numerator && !numerator) numerator = &entry.second;
+            if (entry.first->name == ratio.denominator && !denominator) denominator = &entry.second;
+        }
+        if (!numerator || !denominator || denominator->sum == 0) {
+            continue;
+        }
+        double value = static_cast<double>(numerator->sum) / static_cast<double>(denominator->sum);
+        writeMeasurement(out, depth, indent, "COUNT_RATIO", "Count ratio", &ratio.name, formatReal(value, 6), "1", countAnalysis->codeSystem);
+    }
+    writeLine(out, depth + 3, indent, "</organizer>");
+    writeLine(out, depth + 2, indent, "</component>");
+}
+
+void StudyEntryWriter::writeAnalysisStart(std::string& out, unsigned depth, const char* indent, size_t frameNumber,
+                                          const char* code, const char* displayName, const std::string& codeSystem) {
+    if (!FastCdaChecker::isOid(codeSystem.c_str())) {
+        reportProblem("analysis code system", codeSystem);
+    }
+    writeLine(out, depth + 2, indent, "<component>");
+    writeLine(out, depth + 3, indent, "<organizer classCode=\"CLUSTER\" moodCode=\"EVN\">");
+    writeIndent(out, depth + 4, indent);
+    if (instance.sopInstanceUID.empty()) {
+        out += "<id nullFlavor=\"UNK\" />\n";
+    } else {
+        out += "<id root=\"";
+        writeEscaped(out, instance.sopInstanceUID);
+        if (frameNumber > 0) {
+            out += "\" extension=\"";
+            out += std::to_string(frameNumber);
+        }
+        out += "\" />\n";
+    }
+    writeIndent(out, depth + 4, indent);
+    out += "<code code=\"";
+    out += code;
+    out += "\" codeSystem=\"";
+    writeEscaped(out, codeSystem);
+    out += "\" displayName=\"";
+    out += displayName;
+    out += "\" />\n";
+    writeLine(out, depth + 4, indent, "<statusCode code=\"completed\" />");
+}
+
+void StudyEntryWriter::writeMeasurement(std::string& out, unsigned depth, const char* indent, const char* code,
+                                             const char* displayName, const std::string* regionName, const std::string& value, const char* unit,
+                                             const std::string& codeSystem) {
+    writeLine(out, depth + 4, indent, "<component>");
+    writeLine(out, depth + 5, indent, "<observation classCode=\"OBS\" moodCode=\"EVN\">");
+    writeIndent(out, depth + 6, indent);
+    out += "<code code=\"";
+    out += code;
+    out += "\" codeSystem=\"";
+    writeEscaped(out, codeSystem);
+    out += "\" displayName=\"";
+    out += displayName;
+    out += "\" />\n";
+    if (regionName) {
+        writeIndent(out, depth + 6, indent);
+        out += "<text>";
+        writeEscaped(out, *regionName);
+        out += "</text>\n";
+    }
+    writeIndent(out, depth + 6, indent);
+    out += "<value xsi:type=\"PQ\" value=\"";
+    out += value;
+    out += "\" unit=\"";
+    out += unit;
+    out += "\" />\n";
+    writeLine(out, depth + 5, indent, "</observation>");
+    writeLine(out, depth + 4, indent, "</component>");
+}
+
+void StudyEntryWriter::writeTimeActivity(std::string& out, unsigned depth, const char* indent, const DicomParser& parser) {
+    if (!isDynamicImage(parser.getImageType())) {
+        return;
+    }
+    const size_t frameCount = parser.getFrameCount();
+    if (!parser.getFrameTiming(timing)) {
+        std::cerr << "Warning: No frame timing in dynamic instance " << instance.sopInstanceUID << ", no time-activity curves." << std::endl;
+        return;
+    }
+    // The first frame gives the matrix the regions are rasterised for
+    if (!parser.getFrame(0, frame) || frame.channels != 1) {
+        return;
+    }
+    ScopedTimer timer(Metrics::instance().timeActivity);
+    std::vector<Roi> regions;
+    for (const RegionOptions& region : dynamicAnalysis->regions) {
+        regions.push_back(rasterise(region, frame.width, frame.height));
+    }
+    if (dynamicAnalysis->useOverlays) {
+        addOverlayRegions(parser.getOverlays(), frame.width, frame.height, regions);
+    }
+    if (regions.empty()) {
+        return;
+    }
+    // DicomParser decodes lazily and is not thread-safe: the calling thread keeps the loaded
+    // parser, every other thread opens the instance's file itself
+    const std::string& path = instance.filePath;
+    FrameLoaderFactory openLoader = [&parser, &path](unsigned thread) -> FrameLoader {
+        if (thread == 0) {
+            return [&parser](size_t index, ImageFrame& decoded) { return parser.getFrame(index, decoded); };
+        }
+        std::shared_ptr<DicomParser> own = std::make_shared<DicomParser>();
+        if (!own->loadFile(path)) {
+            return FrameLoader();
+        }
+        return [own](size_t index, ImageFrame& decoded) { return own->getFrame(index, decoded); };
+    };
+    if (!computeTimeActivityCurves(openLoader, frameCount, regions, dynamicAnalysis->threads, curves)) {
+        std::cerr << "Warning: No time-activity curves for instance " << instance.sopInstanceUID << "." << std::endl;
+        return;
+    }
+
+    const TimeActivityCurve* background = nullptr;
+    for (const TimeActivityCurve& curve : curves) {
+        if (!dynamicAnalysis->background.empty() && curve.region == dynamicAnalysis->background && curve.pixels > 0) {
+            background = &curve;
+        }
+    }
+    const std::string& codeSystem = dynamicAnalysis->codeSystem;
+    writeAnalysisStart(out, depth, indent, 0, "TIME_ACTIVITY", "Time-activity analysis", codeSystem);
+    std::vector<std::int64_t> digits(frameCount);
+    for (size_t i = 0; i < frameCount; ++i) {
+        digits[i] = static_cast<std::int64_t>(std::llround(timing.startMs[i]));
+    }
+    writeSeriesObservation(out, depth, indent, "FRAME_START", "Frame start times", nullptr, "ms", digits);
+    for (size_t i = 0; i < frameCount; ++i) {
+        digits[i] = static_cast<std::int64_t>(std::llround(timing.durationMs[i]));
+    }
+    writeSeriesObservation(out, depth, indent, "FRAME_DURATION", "Frame durations", nullptr, "ms", digits);
+
+    std::vector<std::vector<double>> rates(curves.size());
+    for (size_t r = 0; r < curves.size(); ++r) {
+        const TimeActivityCurve& curve = curves[r];
+        if (curve.pixels == 0) {
+            continue;
+        }
+        writeSeriesObservation(out, depth, indent, "TAC", "Time-activity curve", &curve.region, "{counts}", curve.counts);
+        ++curveCount;
+        if (&curve == background) {
+            continue;
+        }
+        rates[r] = countRates(curve, timing, background);
+        CurveParameters parameters = curveParameters(rates[r], timing);
+        writeMeasurement(out, depth, indent, "TMAX", "Time to peak", &curve.region, formatReal(parameters.tmaxSeconds, 1), "s", codeSystem);
+        if (parameters.halfTimeReached) {
+            writeMeasurement(out, depth, indent, "T_HALF", "Half-time from peak", &curve.region, formatReal(parameters.halfTimeSeconds, 1), "s", codeSystem);
+        }
+    }
+    for (const DynamicAnalysisOptions::Split& split : dynamicAnalysis->splits) {
+        const std::vector<double>* left = nullptr;
+        const std::vector<double>* right = nullptr;
+        for (size_t r = 0; r < curves.size(); ++r) {
+            if (curves[r].region == split.left && !left && !rates[r].empty()) left = &rates[r];
+            if (curves[r].region == split.right && !right && !rates[r].empty()) right = &rates[r];
+        }
+        double leftPercent = 0;
+        if (left && right && splitFunction(*left, *right, timing, split.startSeconds, split.endSeconds, leftPercent)) {
+            writeMeasurement(out, depth, indent, "SPLIT_FUNCTION", "Split function", &split.name, formatReal(leftPercent, 1), "%", codeSystem);
+        }
+    }
+    writeLine(out, depth + 3, indent, "</organizer>");
+    writeLine(out, depth + 2, indent, "</component>");
+}
+
+void StudyEntryWriter::writeSeriesObservation(std::string& out, unsigned depth, const char* indent, const char* code, const char* displayName,
+                                              const std::string* regionName, const char* unit, const std::vector<std::int64_t>& digits) {
+    writeLine(out, depth + 4, indent, "<component>");
+    writeLine(out, depth + 5, indent, "<observation classCode=\"OBS\" moodCode=\"EVN\">");
+    writeIndent(out, depth + 6, indent);
+    out += "<code code=\"";
+    out += code;
+    out += "\" codeSystem=\"";
+    writeEscaped(out, dynamicAnalysis->codeSystem);
+    out += "\" displayName=\"";
+    out += displayName;
+    out += "\" />\n";
+    if (regionName) {
+        writeIndent(out, depth + 6, indent);
+        out += "<text>";
+        writeEscaped(out, *regionName);
+        out += "</text>\n";
+    }
+    // One value per frame: origin 0, scale 1, so the digits are the values themselves
+    writeLine(out, depth + 6, indent, "<value xsi:type=\"SLIST_PQ\">");
+    writeIndent(out, depth + 7, indent);
+    out += "<origin value=\"0\" unit=\"";
+    out += unit;
+    out += "\" />\n";
+    writeIndent(out, depth + 7, indent);
+    out += "<scale value=\"1\" unit=\"";
+    out += unit;
+    out += "\" />\n";
+    writeIndent(out, depth + 7, indent);
+    out += "<digits>";
+    for (size_t i = 0; i < digits.size(); ++i) {
+        if (i > 0) out += ' ';
+        out += std::to_string(digits[i]);
+    }
+    out += "</digits>\n";
+    writeLine(out, depth + 6, indent, "</value>");
+    writeLine(out, depth + 5, indent, "</observation>");
+    writeLine(out, depth + 4, indent, "</component>");
+}
+
+bool StudyEntryWriter::writeNext(std::string& out, unsigned depth, const char* indent) {
+    switch (state) {
+        case State::BetweenSeries:
+            if (!reader.nextSeries(series)) {
+                state = State::Done;
+                return false;
+            }
+            writeSeriesStart(out, depth, indent);
+            ++seriesCount;
+            state = State::InSeries;
+            return true;
+        case State::InSeries:
+            if (reader.nextInstance(instance)) {
+                writeInstance(out, depth, indent);
+                ++instanceCount;
+                return true;
+            }
+            writeLine(out, depth + 1, indent, "</organizer>");
+            writeLine(out, depth, indent, "</entry>");
+            state = State::BetweenSeries;
+            return true;
+        case State::Done:
+            break;
+    }
+    return false;
+}
@@ -0,0 +1,140 @@
+#ifndef STUDYENTRYWRITER_H
+#define STUDYENTRYWRITER_H
+
+#include <string>
+#include <vector>
+#include "../data_source/StudyContentReader.h"
+#include "../imaging/CountAnalysis.h"
+#include "../imaging/FrameRenderer.h"
+#include "../imaging/TimeActivity.h"
+#include "../models/ImageFrame.h"
+#include "../xsd_validator/PugiTreeInputSource.h"
+
+class DicomParser;
+
+// Key images embedded after each instance that has a DICOM file (<KeyImages> in the config)
+struct KeyImageOptions {
+    std::vector<int> frames;      // 1-based frame numbers; 0 stands for the last frame
+    unsigned maxDimension = 256;  // Longest side of an embedded image; 0: full size
+    unsigned maxPerDocument = 8;
+};
+
+// A configured region, rasterised for each matrix size it is used with
+struct RegionOptions {
+    std::string name;
+    bool ellipse = false;
+    double left = 0, top = 0, width = 1, height = 1; // Fractions of the image size
+};
+
+// Count analysis of static images (<CountAnalysis> in the config)
+struct CountAnalysisOptions {
+    struct Ratio {
+        std::string name;
+        std::string numerator;   // Region names; overlay regions go by their label
+        std::string denominator;
+    };
+    std::vector<RegionOptions> regions;
+    std::vector<Ratio> ratios;
+    bool useOverlays = true;     // Add the image's ROI overlays (Overlay Type R) as regions
+    std::string codeSystem;      // Local code system of the measurement codes
+};
+
+// Time-activity curves of dynamic images (<DynamicAnalysis> in the config)
+struct DynamicAnalysisOptions {
+    struct Split {
+        std::string name;
+        std::string left;        // Region names
+        std::string right;
+        double startSeconds = 60;
+        double endSeconds = 120;
+    };
+    std::vector<RegionOptions> regions;
+    std::string background;      // Region subtracted from the others; empty: none
+    std::vector<Split> splits;
+    bool useOverlays = true;
+    unsigned threads = 0;        // 0: one per core
+    std::string codeSystem;
+};
+
+// Writes the section entries for a study's series and instances, after the imaging
+// object catalog of DICOM PS3.20: one <entry><organizer> per series (DCM 113015 "Series",
+// with its modality) holding one DGIMG <observation> per instance, identified by the SOP
+// Instance UID and coded with the SOP Class UID.
+//
+// Records are pulled from the reader only as the serializer asks for more output and
+// written straight as text, so memory does not grow with the number of instances and
+// time is linear in it.
+//
+// With key images, the configured frames of each instance's DICOM file follow its
+// observation as <observationMedia> components: rendered to 8 bits, PNG-encoded and
+// base64-encoded straight onto the end of the output, one IDAT chunk at a time.
+//
+// With count analysis, each frame of a static (not dynamic, gated or tomographic) image
+// follows as an <organizer> of PQ observations: total, maximum and mean counts of the
+// frame and of every region, and the configured ratios of region counts.
+//
+// With dynamic analysis, a dynamic image follows as one <organizer> holding its frame
+// times and each region's counts per frame (SLIST_PQ), then Tmax and T1/2 of every
+// background-corrected curve and the configured split functions.
+class StudyEntryWriter : public StreamedContent {
+public:
+    // keyImages / countAnalysis / dynamicAnalysis: as configured; nullptr writes none
+    explicit StudyEntryWriter(StudyContentReader& reader, const KeyImageOptions* keyImages = nullptr,
+                              const CountAnalysisOptions* countAnalysis = nullptr,
+                              const DynamicAnalysisOptions* dynamicAnalysis = nullptr);
+
+    bool writeNext(std::string& out, unsigned depth, const char* indent) override;
+    const std::string& problem() const override { return firstProblem; }
+
+    unsigned long seriesWritten() const { return seriesCount; }
+    unsigned long instancesWritten() const { return instanceCount; }
+    unsigned long keyImagesWritten() const { return keyImageCount; }
+    unsigned long countAnalysesWritten() const { return countAnalysisCount; }
+    unsigned long curvesWritten() const { return curveCount; }
+
+private:
+    enum class State { BetweenSeries, InSeries, Done };
+
+    StudyContentReader& reader;
+    State state;
+    Series series;     // Reused for every record
+    Instance instance;
+    unsigned long seriesCount;
+    unsigned long instanceCount;
+    std::string firstProblem;
+    const KeyImageOptions* keyImages;
+    unsigned long keyImageCount;
+    const CountAnalysisOptions* countAnalysis;
+    unsigned long countAnalysisCount;
+    ImageFrame frame;        // Reused for every key image and analysed frame
+    RenderedImage rendered;
+    std::vector<Roi> configuredRegions; // Rasterised for regionWidth x regionHeight
+    std::uint32_t regionWidth;
+    std::uint32_t regionHeight;
+    std::vector<Roi> overlayRegions;    // Of the current instance
+    const DynamicAnalysisOptions* dynamicAnalysis;
+    unsigned long curveCount;
+    std::vector<TimeActivityCurve> curves;
+    FrameTiming timing;
+
+    void writeSeriesStart(std::string& out, unsigned depth, const char* indent);
+    void writeInstance(std::string& out, unsigned depth, const char* indent);
+    void writeImageContent(std::string& out, unsigned depth, const char* indent);
+    void writeKeyImages(std::string& out, unsigned depth, const char* indent, const DicomParser& parser);
+    bool writeKeyImage(std::string& out, unsigned depth, const char* indent, size_t frameNumber);
+    void writeCountAnalysis(std::string& out, unsigned depth, const char* indent, const DicomParser& parser);
+    void writeFrameCounts(std::string& out, unsigned depth, const char* indent, size_t frameNumber);
+    void writeAnalysisStart(std::string& out, unsigned depth, const char* indent, size_t frameNumber,
+                            const char* code, const char* displayName, const std::string& codeSystem);
+    void writeMeasurement(std::string& out, unsigned depth, const char* indent, const char* code,
+                               const char* displayName, const std::string* regionName, const std::string& value, const char* unit,
+                               const std::string& codeSystem);
+    void writeTimeActivity(std::string& out, unsigned depth, const char* indent, const DicomParser& parser);
+    void writeSeriesObservation(std::string& out, unsigned depth, const char* indent, const char* code, const char* displayName,
+                                const std::string* regionName, const char* unit, const std::vector<std::int64_t>& digits);
+    void writeId(std::string& out, const std::string& uid, const char* what);
+    void writeEffectiveTime(std::string& out, unsigned depth, const char* indent, const std::string& date, const std::string& time, const char* what);
+    void reportProblem(const char* what, const std::string& value);
+};
+
+#endif // STUDYENTRYWRITER_H
@@ -0,0 +1,287 @@
+#include "CdaRequestHandler.h"
+#include "../metrics/Metrics.h"
+#include <iostream>
+#include <sstream>
+#include <cctype>
+
+namespace {
+
+HttpResponse jsonError(int status, const std::string& message) {
+    return HttpResponse::json(status, "{\"error\":\"" + message + "\"}");
+}
+
+} // namespace
+
+CdaRequestHandler::CdaRequestHandler(const ConfigStore& store, PatientStudySourceFactory& sourceFactory, size_t workers, size_t maxBatchSize)
+    : configStore(store), sourceFactory(sourceFactory), contexts(workers), maxBatchSize(maxBatchSize), server(nullptr),
+      documentsGenerated(0), documentsInvalid(0), studiesNotFound(0) {
+}
+
+CdaRequestHandler::~CdaRequestHandler() {
+    shutdown();
+}
+
+void CdaRequestHandler::shutdown() {
+    for (auto& context : contexts) {
+        if (context.generator) {
+            context.generator->finishValidation();
+            context.generator.reset();
+        }
+        context.source.reset();
+    }
+}
+
+CdaRequestHandler::WorkerContext* CdaRequestHandler::acquireContext(size_t workerIndex) {
+    if (workerIndex >= contexts.size()) {
+        return nullptr;
+    }
+    WorkerContext& context = contexts[workerIndex];
+    if (!context.source) {
+        // Connection settings are read once; a reload that changes them needs a restart
+        context.source = sourceFactory.create(workerIndex);
+        if (!context.source) {
+            std::cerr << "Error: Worker " << workerIndex << " could not open " << sourceFactory.describe() << std::endl;
+            return nullptr; // Retried on the worker's next request
+        }
+    }
+    if (!context.generator) {
+        context.generator.reset(new HL7MessageGenerator(configStore));
+    }
+    return &context;
+}
+
+HttpResponse CdaRequestHandler::handle(const HttpRequest& request, size_t workerIndex) {
+    const std::string prefix = "/cda/";
+
+    if (request.path == "/health") {
+        return request.method == "GET" ? HttpResponse::text(200, "ok\n") : jsonError(405, "method not allowed");
+    }
+    if (request.path == "/stats") {
+        return request.method == "GET" ? stats() : jsonError(405, "method not allowed");
+    }
+    if (request.path == "/metrics") {
+        if (request.method != "GET") {
+            return jsonError(405, "method not allowed");
+        }
+        HttpResponse response = HttpResponse::text(200, Metrics::instance().prometheusText());
+        response.contentType = "text/plain; version=0.0.4; charset=utf-8";
+        return response;
+    }
+    if (request.path.compare(0, prefix.size(), prefix) != 0 || request.path.size() == prefix.size()) {
+        return jsonError(404, "unknown path");
+    }
+
+    std::string target = request.path.substr(prefix.size());
+    bool batch = target == "batch";
+    if (batch && request.method != "POST") {
+        return jsonError(405, "use POST for /cda/batch");
+    }
+    if (!batch && request.method != "GET") {
+        return jsonError(405, "use GET for /cda/{studyInstanceUid}");
+    }
+    if (!batch && !isValidUid(target)) {
+        return jsonError(400, "invalid study instance UID");
+    }
+
+    WorkerContext* context = acquireContext(workerIndex);
+    if (!context) {
+        HttpResponse unavailable = jsonError(503, "data source unavailable");
+        unavailable.headers.emplace_back("Retry-After", "5");
+        return unavailable;
+    }
+    return batch ? postBatch(*context, request) : getDocument(*context, target);
+}
+
+int CdaRequestHandler::generateForStudy(WorkerContext& context, const std::string& studyUid, std::string& document, std::string& error) {
+    Study study = context.source->getStudyByUid(studyUid);
+    if (study.studyInstanceUID.empty()) {
+        studiesNotFound.fetch_add(1, std::memory_order_relaxed);
+        error = "study not found";
+        return 404;
+    }
+    Patient patient = context.source->getPatientById(study.patientId);
+    if (patient.patientID.empty()) {
+        studiesNotFound.fetch_add(1, std::memory_order_relaxed);
+        error = "patient " + study.patientId + " not found";
+        return 404;
+    }
+
+    std::unique_ptr<StudyContentReader> content = context.source->openStudyContent(study.studyInstanceUID);
+    if (!context.generator->generateAndValidate(patient, study, document, content.get())) {
+        documentsInvalid.fetch_add(1, std::memory_order_relaxed);
+        error = document.empty() ? "generation failed" : "generated document failed validation";
+        document.clear();
+        return 500;
+    }
+    documentsGenerated.fetch_add(1, std::memory_order_relaxed);
+    return 200;
+}
+
+HttpResponse CdaRequestHandler::getDocument(WorkerContext& context, const std::string& studyUid) {
+    std::string document;
+    std::string error;
+    int status = generateForStudy(context, studyUid, document, error);
+    if (status != 200) {
+        return HttpResponse::json(status, "{\"studyUid\":\"" + studyUid + "\",\"error\":\"" + jsonEscape(error) + "\"}");
+    }
+    HttpResponse response;
+    response.contentType = "application/xml; charset=utf-8";
+    response.body = std::move(document);
+    return response;
+}
+
+HttpResponse CdaRequestHandler::postBatch(WorkerContext& context, const HttpRequest& request) {
+    std::vector<std::string> uids;
+    std::string problem;
+    if (!parseUidList(request.body, uids, problem)) {
+        return jsonError(400, jsonEscape(problem));
+    }
+    if (uids.empty()) {
+        return jsonError(400, "no study UIDs given");
+    }
+    if (uids.size() > maxBatchSize) {
+        return jsonError(413, "batch exceeds " + std::to_string(maxBatchSize) + " study UIDs");
+    }
+
+    std::string body;
+    body.reserve(uids.size() * 4096);
+    body += "{\"results\":[";
+    size_t succeeded = 0;
+    for (size_t i = 0; i < uids.size(); ++i) {
+        std::string document;
+        std::string error;
+        int status = generateForStudy(context, uids[i], document, error);
+        if (i > 0) body += ',';
+        body += "{\"studyUid\":\"" + uids[i] + "\",\"status\":" + std::to_string(status);
+        if (status == 200) {
+            ++succeeded;
+            body += ",\"document\":\"";
+            body += jsonEscape(document);
+            body += "\"}";
+        } else {
+            body += ",\"error\":\"" + jsonEscape(error) + "\"}";
+        }
+    }
+    body += "],\"succeeded\":" + std::to_string(succeeded) + ",\"failed\":" + std::to_string(uids.size() - succeeded) + "}";
+    return HttpResponse::json(200, body);
+}
+
+HttpResponse CdaRequestHandler::stats() const {
+    std::ostringstream json;
+    json << "{\"configVersion\":" << configStore.current()->version
+         << ",\"documentsGenerated\":" << documentsGenerated.load(std::memory_order_relaxed)
+         << ",\"documentsInvalid\":" << documentsInvalid.load(std::memory_order_relaxed)
+         << ",\"studiesNotFound\":" << studiesNotFound.load(std::memory_order_relaxed);
+    if (server) {
+        json << ",\"inFlight\":" << server->inFlightRequests()
+             << ",\"rejected\":" << server->rejectedRequests();
+    }
+    const Metrics& metrics = Metrics::instance();
+    json << ",\"latency\":" << metrics.httpRequest.toJson()
+         << ",\"stages\":{\"dbQuery\":" << metrics.dbQuery.toJson()
+         << ",\"xmlRender\":" << metrics.xmlRender.toJson()
+         << ",\"validation\":" << metrics.xsdValidation.toJson() << "}";
+    json << "}";
+    return HttpResponse::json(200, json.str());
+}
+
+bool CdaRequestHandler::isValidUid(const std::string& uid) {
+    // DICOM UIDs are digits and dots (at most 64 characters); letters, '-' and '_' are
+    // also accepted for the locally assigned keys in the sample database (e.g. "S001")
+    if (uid.empty() || uid.size() > 64) {
+        return false;
+    }
+    for (char c : uid) {
+        if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-' || c == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CdaRequestHandler::parseUidList(const std::string& body, std::vector<std::string>& uids, std::string& problem) {
+    size_t start = body.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return true;
+    }
+
+    if (body[start] == '[') {
+        // JSON array of strings; UIDs never need escapes, so none are accepted
+        size_t pos = start + 1;
+        for (;;) {
+            pos = body.find_first_not_of(" \t\r\n", pos);
+            if (pos == std::string::npos) {
+                problem = "unterminated JSON array";
+                return false;
+            }
+            if (body[pos] == ']' && uids.empty()) {
+                break;
+            }
+            if (body[pos] != '"') {
+                problem = "expected a quoted study UID";
+                return false;
+            }
+            size_t end = body.find('"', pos + 1);
+            if (end == std::string::npos) {
+                problem = "unterminated string";
+                return false;
+            }
+            uids.push_back(body.substr(pos + 1, end - pos - 1));
+            pos = body.find_first_not_of(" \t\r\n", end + 1);
+            if (pos != std::string::npos && body[pos] == ',') {
+                ++pos;
+                continue;
+            }
+            if (pos != std::string::npos && body[pos] == ']') {
+                break;
+            }
+            problem = "expected ',' or ']'";
+            return false;
+        }
+    } else {
+        std::string token;
+        for (size_t i = start; i <= body.size(); ++i) {
+            char c = i < body.size() ? body[i] : ' ';
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',') {
+                if (!token.empty()) {
+                    uids.push_back(token);
+                    token.clear();
+                }
+            } else {
+                token += c;
+            }
+        }
+    }
+
+    for (const std::string& uid : uids) {
+        if (!isValidUid(uid)) {
+            problem = "invalid study instance UID: " + uid.substr(0, 64);
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string CdaRequestHandler::jsonEscape(const std::string& value) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(value.size() + value.size() / 16 + 8);
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += HEX[c >> 4];
+                    out += HEX[c & 0xF];
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out;
+}
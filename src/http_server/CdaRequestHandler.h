@@ -0,0 +1,67 @@
+#ifndef CDAREQUESTHANDLER_H
+#define CDAREQUESTHANDLER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "HttpServer.h"
+#include "../config_manager/ConfigSnapshot.h"
+#include "../data_source/PatientStudySourceFactory.h"
+#include "../hl7_generator/HL7MessageGenerator.h"
+
+// Routes for server mode:
+//   GET  /cda/{studyInstanceUid}  -> the validated CDA document (application/xml)
+//   POST /cda/batch               -> JSON results for a list of study UIDs (JSON array of
+//                                    strings, or UIDs separated by whitespace/commas)
+//   GET  /health, GET /stats (JSON), GET /metrics (Prometheus text)
+// Every worker owns a data source (database connection) and a generator (with its
+// compiled XSD grammar), created on its first request, so requests never share ODBC
+// handles or Xerces parsers.
+class CdaRequestHandler {
+public:
+    CdaRequestHandler(const ConfigStore& store, PatientStudySourceFactory& sourceFactory, size_t workers, size_t maxBatchSize);
+    ~CdaRequestHandler();
+
+    CdaRequestHandler(const CdaRequestHandler&) = delete;
+    CdaRequestHandler& operator=(const CdaRequestHandler&) = delete;
+
+    // Used by /stats; the server must outlive the handler's use of it
+    void setServer(const HttpServer* httpServer) { server = httpServer; }
+
+    HttpResponse handle(const HttpRequest& request, size_t workerIndex);
+
+    // Releases validators and data sources (DB connections). Call after the server has stopped and
+    // before HL7MessageGenerator::terminateXerces().
+    void shutdown();
+
+private:
+    struct WorkerContext {
+        std::unique_ptr<PatientStudySource> source;
+        std::unique_ptr<HL7MessageGenerator> generator;
+    };
+
+    const ConfigStore& configStore;
+    PatientStudySourceFactory& sourceFactory;
+    std::vector<WorkerContext> contexts; // Indexed by worker; each slot touched by one thread only
+    size_t maxBatchSize;
+    const HttpServer* server;
+
+    std::atomic<unsigned long> documentsGenerated;
+    std::atomic<unsigned long> documentsInvalid;
+    std::atomic<unsigned long> studiesNotFound;
+
+    WorkerContext* acquireContext(size_t workerIndex);
+    // Returns the HTTP status for this study; on 200 `document` holds the validated CDA
+    int generateForStudy(WorkerContext& context, const std::string& studyUid, std::string& document, std::string& error);
+
+    HttpResponse getDocument(WorkerContext& context, const std::string& studyUid);
+    HttpResponse postBatch(WorkerContext& context, const HttpRequest& request);
+    HttpResponse stats() const;
+
+    static bool isValidUid(const std::string& uid);
+    static bool parseUidList(const std::string& body, std::vector<std::string>& uids, std::string& problem);
+    static std::string jsonEscape(const std::string& value);
+};
+
+#endif // CDAREQUESTHANDLER_H
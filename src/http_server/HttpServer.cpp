@@ -0,0 +1,502 @@
+#include "HttpServer.h"
+#include "../metrics/Metrics.h"
+#include "../tracing/Tracer.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <cctype>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace {
+
+const size_t MAX_HEADER_BYTES = 64 * 1024;
+const size_t RECEIVE_CHUNK = 16 * 1024;
+
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+const char* reasonPhrase(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 422: return "Unprocessable Entity";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        case 505: return "HTTP Version Not Supported";
+        default: return "Unknown";
+    }
+}
+
+std::string toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+std::string trim(const std::string& value) {
+    size_t begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    size_t end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool percentDecode(const std::string& in, std::string& out) {
+    out.clear();
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '%') {
+            if (i + 2 >= in.size()) return false;
+            int hi = hexValue(in[i + 1]);
+            int lo = hexValue(in[i + 2]);
+            if (hi < 0 || lo < 0) return false;
+            out += static_cast<char>(hi * 16 + lo);
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return true;
+}
+
+// Parses the request line and headers (without the terminating blank line).
+// Returns 0 on success or the HTTP status to answer with.
+int parseHead(const std::string& head, HttpRequest& request, size_t& contentLength) {
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+
+    size_t firstSpace = requestLine.find(' ');
+    size_t secondSpace = firstSpace == std::string::npos ? std::string::npos : requestLine.find(' ', firstSpace + 1);
+    if (secondSpace == std::string::npos) return 400;
+    request.method = requestLine.substr(0, firstSpace);
+    std::string target = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+    request.version = requestLine.substr(secondSpace + 1);
+    if (request.version != "HTTP/1.1" && request.version != "HTTP/1.0") return 505;
+
+    size_t queryStart = target.find('?');
+    if (queryStart != std::string::npos) {
+        request.query = target.substr(queryStart + 1);
+        target.erase(queryStart);
+    }
+    if (target.empty() || target[0] != '/' || !percentDecode(target, request.path)) return 400;
+
+    contentLength = 0;
+    bool http11 = request.version == "HTTP/1.1";
+    request.keepAlive = http11;
+    size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+    while (pos < head.size()) {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string::npos) end = head.size();
+        std::string line = head.substr(pos, end - pos);
+        pos = end + 2;
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) return 400;
+        std::string name = toLower(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 1));
+
+        if (name == "content-length") {
+            char* parseEnd = nullptr;
+            unsigned long long length = std::strtoull(value.c_str(), &parseEnd, 10);
+            if (value.empty() || *parseEnd != '\0') return 400;
+            contentLength = static_cast<size_t>(length);
+        } else if (name == "transfer-encoding" && toLower(value) != "identity") {
+            return 501; // Chunked request bodies are not supported; clients send Content-Length
+        } else if (name == "connection") {
+            std::string connection = toLower(value);
+            if (connection.find("close") != std::string::npos) request.keepAlive = false;
+            else if (connection.find("keep-alive") != std::string::npos) request.keepAlive = true;
+        }
+        request.headers.emplace_back(name, value);
+    }
+    return 0;
+}
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = ::send(fd, data, size, SEND_FLAGS);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool sendResponse(int fd, const HttpResponse& response, bool keepAlive) {
+    std::string head;
+    head.reserve(256);
+    head += "HTTP/1.1 ";
+    head += std::to_string(response.status);
+    head += ' ';
+    head += reasonPhrase(response.status);
+    head += "\r\nContent-Type: ";
+    head += response.contentType;
+    head += "\r\nContent-Length: ";
+    head += std::to_string(response.body.size());
+    head += keepAlive ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n";
+    for (const auto& header : response.headers) {
+        head += header.first;
+        head += ": ";
+        head += header.second;
+        head += "\r\n";
+    }
+    head += "\r\n";
+    return sendAll(fd, head.data(), head.size()) && sendAll(fd, response.body.data(), response.body.size());
+}
+
+bool receiveMore(int fd, std::string& buffer) {
+    char chunk[RECEIVE_CHUNK];
+    for (;;) {
+        ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received > 0) {
+            buffer.append(chunk, static_cast<size_t>(received));
+            return true;
+        }
+        if (received < 0 && errno == EINTR) continue;
+        return false; // Closed by the peer, timed out or failed
+    }
+}
+
+void setTimeouts(int fd, int timeoutMs) {
+    timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+} // namespace
+
+const std::string* HttpRequest::header(const std::string& lowerName) const {
+    for (const auto& h : headers) {
+        if (h.first == lowerName) return &h.second;
+    }
+    return nullptr;
+}
+
+HttpResponse HttpResponse::text(int status, const std::string& body) {
+    HttpResponse response;
+    response.status = status;
+    response.body = body;
+    return response;
+}
+
+HttpResponse HttpResponse::json(int status, const std::string& body) {
+    HttpResponse response;
+    response.status = status;
+    response.contentType = "application/json";
+    response.body = body;
+    return response;
+}
+
+HttpServer::HttpServer(const HttpServerOptions& options, Handler handler)
+    : options(options), handler(std::move(handler)), listenFd(-1), running(false), inFlight(0), rejected(0) {
+    wakePipe[0] = wakePipe[1] = -1;
+    if (this->options.workers == 0) this->options.workers = 1;
+    if (this->options.maxInFlight < this->options.workers) this->options.maxInFlight = this->options.workers;
+}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+bool HttpServer::start() {
+    if (running) {
+        return true;
+    }
+
+    listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Error: Could not create server socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.bindAddress.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Error: Invalid server bind address: " << options.bindAddress << std::endl;
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenFd, 128) != 0) {
+        std::cerr << "Error: Could not listen on " << options.bindAddress << ":" << options.port << ": " << std::strerror(errno) << std::endl;
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL, 0) | O_NONBLOCK);
+
+    if (::pipe(wakePipe) != 0) {
+        std::cerr << "Error: Could not create server wake-up pipe: " << std::strerror(errno) << std::endl;
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    fcntl(wakePipe[0], F_SETFL, fcntl(wakePipe[0], F_GETFL, 0) | O_NONBLOCK);
+
+    running = true;
+    for (size_t i = 0; i < options.workers; ++i) {
+        workers.emplace_back(&HttpServer::workerLoop, this, i);
+    }
+    poller = std::thread(&HttpServer::pollLoop, this);
+
+    std::cout << "HTTP server listening on " << options.bindAddress << ":" << options.port << " with "
+              << options.workers << " workers (max " << options.maxInFlight << " requests in flight)." << std::endl;
+    return true;
+}
+
+void HttpServer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    wakePoller();
+    if (poller.joinable()) {
+        poller.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex); // Workers re-check `running` under this lock
+    }
+    queueReady.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+
+    for (Connection* connection : readyQueue) {
+        closeConnection(connection);
+    }
+    readyQueue.clear();
+    for (Connection* connection : returned) {
+        closeConnection(connection);
+    }
+    returned.clear();
+
+    ::close(wakePipe[0]);
+    ::close(wakePipe[1]);
+    wakePipe[0] = wakePipe[1] = -1;
+    std::cout << "HTTP server stopped." << std::endl;
+}
+
+void HttpServer::wakePoller() {
+    char byte = 1;
+    if (wakePipe[1] >= 0) {
+        ssize_t ignored = ::write(wakePipe[1], &byte, 1);
+        (void)ignored;
+    }
+}
+
+void HttpServer::closeConnection(Connection* connection) {
+    ::close(connection->fd);
+    delete connection;
+}
+
+void HttpServer::pollLoop() {
+    HL7_TRACE_THREAD_NAME("http-poller");
+    std::vector<Connection*> idle;
+    std::vector<Connection*> stillIdle;
+    std::vector<pollfd> fds;
+    const std::chrono::milliseconds keepAlive(options.keepAliveTimeoutMs);
+
+    while (running) {
+        fds.clear();
+        fds.push_back({listenFd, POLLIN, 0});
+        fds.push_back({wakePipe[0], POLLIN, 0});
+        for (Connection* connection : idle) {
+            fds.push_back({connection->fd, POLLIN, 0});
+        }
+
+        int ready = ::poll(fds.data(), fds.size(), 500);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: HTTP server poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        auto now = std::chrono::steady_clock::now();
+
+        stillIdle.clear();
+        for (size_t i = 0; i < idle.size(); ++i) {
+            short events = fds[i + 2].revents;
+            if (events & POLLIN) {
+                dispatch(idle[i]);
+            } else if (events & (POLLHUP | POLLERR | POLLNVAL)) {
+                closeConnection(idle[i]);
+            } else if (now - idle[i]->lastActive > keepAlive) {
+                closeConnection(idle[i]);
+            } else {
+                stillIdle.push_back(idle[i]);
+            }
+        }
+        idle.swap(stillIdle);
+
+        if (fds[1].revents & POLLIN) {
+            char drain[64];
+            while (::read(wakePipe[0], drain, sizeof(drain)) > 0) {
+            }
+            std::lock_guard<std::mutex> lock(returnMutex);
+            for (Connection* connection : returned) {
+                connection->lastActive = now;
+                idle.push_back(connection);
+            }
+            returned.clear();
+        }
+
+        if (fds[0].revents & POLLIN) {
+            for (;;) {
+                int fd = ::accept(listenFd, nullptr, nullptr);
+                if (fd < 0) break; // EAGAIN: no more pending connections
+                int noDelay = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                setTimeouts(fd, options.keepAliveTimeoutMs);
+                idle.push_back(new Connection{fd, std::string(), now});
+            }
+        }
+    }
+
+    for (Connection* connection : idle) {
+        closeConnection(connection);
+    }
+    ::close(listenFd);
+    listenFd = -1;
+}
+
+void HttpServer::dispatch(Connection* connection) {
+    if (inFlight.load(std::memory_order_relaxed) >= options.maxInFlight) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        Metrics::instance().httpRejected.add();
+        HttpResponse busy = HttpResponse::text(503, "Server busy, retry later.\n");
+        busy.headers.emplace_back("Retry-After", "1");
+        sendResponse(connection->fd, busy, false);
+        ::shutdown(connection->fd, SHUT_WR);
+        closeConnection(connection);
+        return;
+    }
+    inFlight.fetch_add(1, std::memory_order_relaxed);
+    Metrics::instance().httpInFlight.add(1);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        readyQueue.push_back(connection);
+    }
+    Metrics::instance().httpQueueDepth.add(1);
+    queueReady.notify_one();
+}
+
+void HttpServer::workerLoop(size_t workerIndex) {
+    HL7_TRACE_THREAD_NAME("http-worker-" + std::to_string(workerIndex));
+    for (;;) {
+        Connection* connection = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this] { return !running || !readyQueue.empty(); });
+            if (!running) {
+                return; // stop() closes whatever is still queued
+            }
+            connection = readyQueue.front();
+            readyQueue.pop_front();
+        }
+        Metrics::instance().httpQueueDepth.add(-1);
+
+        bool keepOpen = serveConnection(*connection, workerIndex);
+        inFlight.fetch_sub(1, std::memory_order_relaxed);
+        Metrics::instance().httpInFlight.add(-1);
+        if (keepOpen && running) {
+            {
+                std::lock_guard<std::mutex> lock(returnMutex);
+                returned.push_back(connection);
+            }
+            wakePoller();
+        } else {
+            closeConnection(connection);
+        }
+    }
+}
+
+bool HttpServer::serveConnection(Connection& connection, size_t workerIndex) {
+    for (;;) {
+        size_t headerEnd;
+        while ((headerEnd = connection.buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (connection.buffer.size() > MAX_HEADER_BYTES) {
+                sendResponse(connection.fd, HttpResponse::text(431, "Request headers too large.\n"), false);
+                return false;
+            }
+            if (!receiveMore(connection.fd, connection.buffer)) {
+                return false;
+            }
+        }
+
+        HttpRequest request;
+        size_t contentLength = 0;
+        int errorStatus = parseHead(connection.buffer.substr(0, headerEnd), request, contentLength);
+        if (errorStatus == 0 && contentLength > options.maxRequestBytes) {
+            errorStatus = 413;
+        }
+        if (errorStatus != 0) {
+            sendResponse(connection.fd, HttpResponse::text(errorStatus, std::string(reasonPhrase(errorStatus)) + ".\n"), false);
+            return false;
+        }
+
+        size_t requestEnd = headerEnd + 4 + contentLength;
+        while (connection.buffer.size() < requestEnd) {
+            if (!receiveMore(connection.fd, connection.buffer)) {
+                return false;
+            }
+        }
+        request.body.assign(connection.buffer, headerEnd + 4, contentLength);
+        connection.buffer.erase(0, requestEnd);
+
+        ScopedTimer timer(Metrics::instance().httpRequest);
+        HL7_TRACE_SCOPE_DETAIL("httpRequest", request.method, request.path);
+        HttpResponse response;
+        try {
+            response = handler(request, workerIndex);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Unhandled exception while serving " << request.method << " " << request.path << ": " << e.what() << std::endl;
+            response = HttpResponse::text(500, "Internal server error.\n");
+        }
+
+        bool keepAlive = request.keepAlive && running;
+        if (!sendResponse(connection.fd, response, keepAlive)) {
+            return false;
+        }
+
+        if (!keepAlive) {
+            return false;
+        }
+        if (connection.buffer.empty()) {
+            return true; // Idle until the client sends the next request
+        }
+        // Otherwise a pipelined request is already buffered; serve it right away
+    }
+}
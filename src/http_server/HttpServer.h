@@ -0,0 +1,105 @@
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <utility>
+
+struct HttpRequest {
+    std::string method;
+    std::string path;    // Decoded target without the query string
+    std::string query;   // Raw query string (after '?')
+    std::string version; // e.g. "HTTP/1.1"
+    std::vector<std::pair<std::string, std::string>> headers; // Names lower-cased
+    std::string body;
+    bool keepAlive = true;
+
+    // Returns the header value, or nullptr. `lowerName` must be lower case.
+    const std::string* header(const std::string& lowerName) const;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string contentType = "text/plain; charset=utf-8";
+    std::string body;
+    std::vector<std::pair<std::string, std::string>> headers;
+
+    static HttpResponse text(int status, const std::string& body);
+    static HttpResponse json(int status, const std::string& body);
+};
+
+struct HttpServerOptions {
+    std::string bindAddress = "0.0.0.0";
+    int port = 8080;
+    size_t workers = 4;
+    size_t maxInFlight = 64;          // Requests queued or executing; beyond this new ones get 503
+    int keepAliveTimeoutMs = 5000;    // Idle keep-alive connections are closed after this
+    size_t maxRequestBytes = 8 * 1024 * 1024;
+};
+
+// Small embedded HTTP/1.1 server with keep-alive, built on POSIX sockets.
+// A poller thread accepts connections and waits on idle keep-alive connections with
+// poll(); a connection with data is handed to a fixed pool of workers, which read and
+// answer the request(s) and give the connection back to the poller. A worker therefore
+// only ever blocks on a connection that has a request in progress.
+// The handler is called on worker threads with the worker index (0..workers-1), so it
+// can keep per-worker state (DB connections, validators) without locking.
+// Request latency, rejections and queue depths are recorded in Metrics::instance().
+class HttpServer {
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest&, size_t workerIndex)>;
+
+    HttpServer(const HttpServerOptions& options, Handler handler);
+    ~HttpServer(); // Calls stop()
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    bool start();
+    void stop();
+
+    unsigned long rejectedRequests() const { return rejected.load(std::memory_order_relaxed); }
+    size_t inFlightRequests() const { return inFlight.load(std::memory_order_relaxed); }
+
+private:
+    struct Connection {
+        int fd;
+        std::string buffer; // Bytes received but not yet consumed
+        std::chrono::steady_clock::time_point lastActive;
+    };
+
+    HttpServerOptions options;
+    Handler handler;
+
+    int listenFd;
+    int wakePipe[2];
+    std::atomic<bool> running;
+    std::thread poller;
+    std::vector<std::thread> workers;
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<Connection*> readyQueue;     // Connections with a request to serve
+
+    std::mutex returnMutex;
+    std::vector<Connection*> returned;      // Keep-alive connections handed back to the poller
+
+    std::atomic<size_t> inFlight;
+    std::atomic<unsigned long> rejected;
+
+    void pollLoop();
+    void workerLoop(size_t workerIndex);
+    void dispatch(Connection* connection);
+    bool serveConnection(Connection& connection, size_t workerIndex);
+    void wakePoller();
+    static void closeConnection(Connection* connection);
+};
+
+#endif // HTTPSERVER_H
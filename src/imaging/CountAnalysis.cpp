@@ -0,0 +1,235 @@
+#include "CountAnalysis.h"
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HL7_COUNTS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+std::uint32_t toPixel(double fraction, std::uint32_t size) {
+    double pixel = std::round(fraction * size);
+    return pixel <= 0 ? 0 : pixel >= size ? size : static_cast<std::uint32_t>(pixel);
+}
+
+void accumulateScalar(const std::int32_t* samples, size_t count, RegionCounts& counts) {
+    std::int64_t sum = 0;
+    std::int32_t max = counts.max;
+    for (size_t i = 0; i < count; ++i) {
+        sum += samples[i];
+        max = std::max(max, samples[i]);
+    }
+    counts.sum += sum;
+    counts.max = max;
+    counts.pixels += count;
+}
+
+#ifdef HL7_COUNTS_X86
+
+__attribute__((target("sse2")))
+void accumulateSse2(const std::int32_t* samples, size_t count, RegionCounts& counts) {
+    __m128i sum = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi32(counts.max);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        // Sign-extend to 64 bits by interleaving with the sign mask
+        __m128i sign = _mm_srai_epi32(values, 31);
+        sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(values, sign));
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(values, sign));
+        // No pmaxsd before SSE4.1: select through a compare mask
+        __m128i greater = _mm_cmpgt_epi32(values, max);
+        max = _mm_or_si128(_mm_and_si128(greater, values), _mm_andnot_si128(greater, max));
+    }
+    alignas(16) std::int64_t sums[2];
+    alignas(16) std::int32_t maxima[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxima), max);
+    counts.sum += sums[0] + sums[1];
+    counts.max = std::max(std::max(maxima[0], maxima[1]), std::max(maxima[2], maxima[3]));
+    counts.pixels += i;
+    accumulateScalar(samples + i, count - i, counts);
+}
+
+__attribute__((target("avx2")))
+void accumulateAvx2(const std::int32_t* samples, size_t count, RegionCounts& counts) {
+    // Two accumulators so consecutive adds do not wait on each other
+    __m256i sumLow = _mm256_setzero_si256();
+    __m256i sumHigh = _mm256_setzero_si256();
+    __m256i max = _mm256_set1_epi32(counts.max);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+        sumLow = _mm256_add_epi64(sumLow, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(values)));
+        sumHigh = _mm256_add_epi64(sumHigh, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(values, 1)));
+        max = _mm256_max_epi32(max, values);
+    }
+    alignas(32) std::int64_t sums[4];
+    alignas(32) std::int32_t maxima[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), _mm256_add_epi64(sumLow, sumHigh));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxima), max);
+    counts.sum += sums[0] + sums[1] + sums[2] + sums[3];
+    counts.max = *std::max_element(maxima, maxima + 8);
+    counts.pixels += i;
+    accumulateScalar(samples + i, count - i, counts);
+}
+
+#endif // HL7_COUNTS_X86
+
+} // namespace
+
+Roi Roi::rectangle(const std::string& name, double left, double top, double width, double height,
+                   std::uint32_t imageWidth, std::uint32_t imageHeight) {
+    Roi roi;
+    roi.name = name;
+    std::uint32_t x0 = toPixel(left, imageWidth);
+    std::uint32_t x1 = toPixel(left + width, imageWidth);
+    std::uint32_t y0 = toPixel(top, imageHeight);
+    std::uint32_t y1 = toPixel(top + height, imageHeight);
+    if (x1 > x0) {
+        for (std::uint32_t y = y0; y < y1; ++y) {
+            roi.spans.push_back({y, x0, x1});
+        }
+    }
+    return roi;
+}
+
+Roi Roi::ellipse(const std::string& name, double left, double top, double width, double height,
+                 std::uint32_t imageWidth, std::uint32_t imageHeight) {
+    Roi roi;
+    roi.name = name;
+    const double cx = (left + width / 2) * imageWidth;
+    const double cy = (top + height / 2) * imageHeight;
+    const double rx = width * imageWidth / 2;
+    const double ry = height * imageHeight / 2;
+    if (rx <= 0 || ry <= 0) {
+        return roi;
+    }
+    double firstRow = std::max(0.0, std::floor(cy - ry));
+    double lastRow = std::min(static_cast<double>(imageHeight), std::ceil(cy + ry));
+    for (double y = firstRow; y < lastRow; ++y) {
+        double dy = (y + 0.5 - cy) / ry;
+        if (dy * dy > 1.0) {
+            continue;
+        }
+        double halfWidth = rx * std::sqrt(1.0 - dy * dy);
+        double begin = std::max(0.0, std::ceil(cx - halfWidth - 0.5));
+        double end = std::min(static_cast<double>(imageWidth), std::floor(cx + halfWidth - 0.5) + 1);
+        if (end > begin) {
+            roi.spans.push_back({static_cast<std::uint32_t>(y), static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end)});
+        }
+    }
+    return roi;
+}
+
+Roi Roi::fromOverlay(const OverlayPlane& overlay, std::uint32_t imageWidth, std::uint32_t imageHeight) {
+    Roi roi;
+    roi.name = overlay.label;
+    if (overlay.bits.size() < (static_cast<size_t>(overlay.rows) * overlay.columns + 7) / 8) {
+        return roi;
+    }
+    auto isSet = [&overlay](size_t index) { return (overlay.bits[index >> 3] >> (index & 7)) & 1; };
+    for (std::uint32_t r = 0; r < overlay.rows; ++r) {
+        std::int64_t row = static_cast<std::int64_t>(overlay.originRow) - 1 + r;
+        if (row < 0 || row >= imageHeight) {
+            continue;
+        }
+        size_t rowStart = static_cast<size_t>(r) * overlay.columns;
+        std::uint32_t c = 0;
+        while (c < overlay.columns) {
+            while (c < overlay.columns && !isSet(rowStart + c)) ++c;
+            std::uint32_t runStart = c;
+            while (c < overlay.columns && isSet(rowStart + c)) ++c;
+            if (c == runStart) {
+                break;
+            }
+            std::int64_t begin = std::max<std::int64_t>(0, static_cast<std::int64_t>(overlay.originColumn) - 1 + runStart);
+            std::int64_t end = std::min<std::int64_t>(imageWidth, static_cast<std::int64_t>(overlay.originColumn) - 1 + c);
+            if (end > begin) {
+                roi.spans.push_back({static_cast<std::uint32_t>(row), static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end)});
+            }
+        }
+    }
+    return roi;
+}
+
+std::uint64_t Roi::pixelCount() const {
+    std::uint64_t pixels = 0;
+    for (const RoiSpan& span : spans) {
+        pixels += span.end - span.begin;
+    }
+    return pixels;
+}
+
+bool countKernelSupported(CountKernel kernel) {
+    switch (kernel) {
+        case CountKernel::Scalar:
+            return true;
+#ifdef HL7_COUNTS_X86
+        case CountKernel::Sse2:
+            return __builtin_cpu_supports("sse2");
+        case CountKernel::Avx2:
+            return __builtin_cpu_supports("avx2");
+#else
+        default:
+            return false;
+#endif
+    }
+    return false;
+}
+
+CountKernel bestCountKernel() {
+    static const CountKernel best = countKernelSupported(CountKernel::Avx2)   ? CountKernel::Avx2
+                                    : countKernelSupported(CountKernel::Sse2) ? CountKernel::Sse2
+                                                                              : CountKernel::Scalar;
+    return best;
+}
+
+const char* countKernelName(CountKernel kernel) {
+    switch (kernel) {
+        case CountKernel::Avx2: return "avx2";
+        case CountKernel::Sse2: return "sse2";
+        case CountKernel::Scalar: break;
+    }
+    return "scalar";
+}
+
+void accumulateCounts(const std::int32_t* samples, size_t count, RegionCounts& counts, CountKernel kernel) {
+#ifdef HL7_COUNTS_X86
+    switch (kernel) {
+        case CountKernel::Avx2: accumulateAvx2(samples, count, counts); return;
+        case CountKernel::Sse2: accumulateSse2(samples, count, counts); return;
+        case CountKernel::Scalar: break;
+    }
+#else
+    (void)kernel;
+#endif
+    accumulateScalar(samples, count, counts);
+}
+
+RegionCounts countFrame(const ImageFrame& frame, CountKernel kernel) {
+    RegionCounts counts;
+    size_t pixels = static_cast<size_t>(frame.width) * frame.height;
+    if (frame.channels == 1 && frame.samples.size() >= pixels) {
+        accumulateCounts(frame.samples.data(), pixels, counts, kernel);
+    }
+    return counts;
+}
+
+RegionCounts countRegion(const ImageFrame& frame, const Roi& roi, CountKernel kernel) {
+    RegionCounts counts;
+    if (frame.channels != 1 || frame.samples.size() < static_cast<size_t>(frame.width) * frame.height) {
+        return counts;
+    }
+    for (const RoiSpan& span : roi.spans) {
+        // A region built for another matrix size is clipped to this one
+        if (span.row >= frame.height || span.begin >= frame.width) {
+            continue;
+        }
+        std::uint32_t end = std::min(span.end, frame.width);
+        accumulateCounts(frame.samples.data() + static_cast<size_t>(span.row) * frame.width + span.begin, end - span.begin, counts, kernel);
+    }
+    return counts;
+}
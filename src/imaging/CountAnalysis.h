@@ -0,0 +1,63 @@
+#ifndef COUNTANALYSIS_H
+#define COUNTANALYSIS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../models/ImageFrame.h"
+
+// Quantitative counts for static scintigraphy (bone, thyroid): total counts, per-ROI
+// sums, maximum and mean, over frames decoded by DicomParser::getFrame.
+//
+// A region is kept as runs of pixels along rows, so every sum is a reduction over
+// contiguous samples. The reductions widen to 64 bits (a 1024x1024 frame of 16-bit
+// counts overflows 32) and run 8 samples per step with AVX2 or 4 with SSE2, picked
+// once from the CPU.
+
+// Pixels [begin, end) of one image row
+struct RoiSpan {
+    std::uint32_t row;
+    std::uint32_t begin;
+    std::uint32_t end;
+};
+
+struct Roi {
+    std::string name;
+    std::vector<RoiSpan> spans;
+
+    // Geometry in fractions of the image size (0-1, from the top left corner), so one
+    // definition fits every matrix size. An ellipse is inscribed in the rectangle and
+    // holds the pixels whose centres fall inside it.
+    static Roi rectangle(const std::string& name, double left, double top, double width, double height,
+                         std::uint32_t imageWidth, std::uint32_t imageHeight);
+    static Roi ellipse(const std::string& name, double left, double top, double width, double height,
+                       std::uint32_t imageWidth, std::uint32_t imageHeight);
+    // The set pixels of an overlay plane, clipped to the image
+    static Roi fromOverlay(const OverlayPlane& overlay, std::uint32_t imageWidth, std::uint32_t imageHeight);
+
+    std::uint64_t pixelCount() const;
+};
+
+struct RegionCounts {
+    std::int64_t sum = 0;
+    std::int32_t max = INT32_MIN; // Only meaningful when pixels > 0
+    std::uint64_t pixels = 0;
+
+    double mean() const { return pixels == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(pixels); }
+};
+
+enum class CountKernel { Scalar, Sse2, Avx2 };
+
+CountKernel bestCountKernel();
+const char* countKernelName(CountKernel kernel);
+bool countKernelSupported(CountKernel kernel);
+
+// Adds `count` samples to `counts`
+void accumulateCounts(const std::int32_t* samples, size_t count, RegionCounts& counts, CountKernel kernel = bestCountKernel());
+
+// Whole frame, and one region of it. Only single-channel frames have counts; others give zero pixels.
+RegionCounts countFrame(const ImageFrame& frame, CountKernel kernel = bestCountKernel());
+RegionCounts countRegion(const ImageFrame& frame, const Roi& roi, CountKernel kernel = bestCountKernel());
+
+#endif // COUNTANALYSIS_H
@@ -0,0 +1,58 @@
+#include "FrameRenderer.h"
+#include <algorithm>
+
+void renderFrame(const ImageFrame& frame, unsigned maxDimension, RenderedImage& image) {
+    const std::uint32_t channels = frame.channels;
+    std::uint32_t longest = std::max(frame.width, frame.height);
+    std::uint32_t factor = (maxDimension == 0 || longest <= maxDimension) ? 1 : (longest + maxDimension - 1) / maxDimension;
+    image.width = (frame.width + factor - 1) / factor;
+    image.height = (frame.height + factor - 1) / factor;
+    image.channels = channels;
+    const size_t outputSamples = static_cast<size_t>(image.width) * image.height * channels;
+    image.pixels.assign(outputSamples, 0);
+    if (outputSamples == 0 || frame.samples.size() < static_cast<size_t>(frame.width) * frame.height * channels) {
+        return;
+    }
+
+    // Box filter: sum each factor x factor block (smaller at the right and bottom edges)
+    std::vector<std::int64_t> sums(outputSamples, 0);
+    const std::int32_t* source = frame.samples.data();
+    for (std::uint32_t y = 0; y < frame.height; ++y) {
+        std::int64_t* row = sums.data() + static_cast<size_t>(y / factor) * image.width * channels;
+        for (std::uint32_t x = 0; x < frame.width; ++x) {
+            std::int64_t* pixel = row + static_cast<size_t>(x / factor) * channels;
+            for (std::uint32_t c = 0; c < channels; ++c) {
+                pixel[c] += *source++;
+            }
+        }
+    }
+    std::vector<std::int64_t> averages(outputSamples);
+    for (std::uint32_t y = 0; y < image.height; ++y) {
+        std::int64_t blockHeight = std::min(factor, frame.height - y * factor);
+        for (std::uint32_t x = 0; x < image.width; ++x) {
+            std::int64_t blockSize = blockHeight * std::min(factor, frame.width - x * factor);
+            size_t index = (static_cast<size_t>(y) * image.width + x) * channels;
+            for (std::uint32_t c = 0; c < channels; ++c) {
+                averages[index + c] = sums[index + c] / blockSize;
+            }
+        }
+    }
+
+    auto range = std::minmax_element(averages.begin(), averages.end());
+    std::int64_t low = *range.first;
+    std::int64_t high = *range.second;
+    if (channels == 3) {
+        // Colour: keep 0 as black, scale down only when values exceed 8 bits
+        low = 0;
+        high = std::max<std::int64_t>(high, 255);
+    }
+    if (high <= low) {
+        return; // Flat frame: black
+    }
+    const std::int64_t span = high - low;
+    for (size_t i = 0; i < outputSamples; ++i) {
+        std::int64_t value = std::min(std::max(averages[i], low), high);
+        std::uint8_t level = static_cast<std::uint8_t>(((value - low) * 255 + span / 2) / span);
+        image.pixels[i] = frame.inverted ? static_cast<std::uint8_t>(255 - level) : level;
+    }
+}
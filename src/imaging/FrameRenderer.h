@@ -0,0 +1,23 @@
+#ifndef FRAMERENDERER_H
+#define FRAMERENDERER_H
+
+#include <cstdint>
+#include <vector>
+#include "../models/ImageFrame.h"
+
+// An 8-bit image ready to be encoded for display
+struct RenderedImage {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t channels = 1;         // 1 (grey) or 3 (RGB)
+    std::vector<std::uint8_t> pixels;   // Row-major, channels interleaved
+};
+
+// Turns a frame into a display image no larger than maxDimension on either side
+// (0: full size). Frames are reduced by a whole factor with a box filter, which
+// averages counts rather than dropping them, then monochrome values are windowed from
+// the frame's own minimum to its maximum (NM frames carry no useful VOI window).
+// RGB samples above 255 are scaled down to fit.
+void renderFrame(const ImageFrame& frame, unsigned maxDimension, RenderedImage& image);
+
+#endif // FRAMERENDERER_H
@@ -0,0 +1,114 @@
+#include "PngEncoder.h"
+#include <zlib.h>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const size_t IDAT_CHUNK_SIZE = 32 * 1024;
+
+void putUint32(unsigned char* out, std::uint32_t value) {
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+
+void writeChunk(const ByteSink& sink, const char* type, const unsigned char* data, size_t size) {
+    unsigned char header[8];
+    putUint32(header, static_cast<std::uint32_t>(size));
+    std::memcpy(header + 4, type, 4);
+    uLong crc = crc32(0L, header + 4, 4);
+    if (size > 0) {
+        crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+    unsigned char trailer[4];
+    putUint32(trailer, static_cast<std::uint32_t>(crc));
+    sink(header, sizeof(header));
+    if (size > 0) {
+        sink(data, size);
+    }
+    sink(trailer, sizeof(trailer));
+}
+
+} // namespace
+
+bool encodePng(const RenderedImage& image, const ByteSink& sink, int compressionLevel) {
+    static const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (image.width == 0 || image.height == 0 || (image.channels != 1 && image.channels != 3) ||
+        image.pixels.size() < static_cast<size_t>(image.width) * image.height * image.channels) {
+        std::cerr << "Error: Cannot encode a " << image.width << "x" << image.height << "x" << image.channels << " image as PNG." << std::endl;
+        return false;
+    }
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, compressionLevel) != Z_OK) {
+        std::cerr << "Error: deflateInit failed." << std::endl;
+        return false;
+    }
+
+    sink(SIGNATURE, sizeof(SIGNATURE));
+    unsigned char header[13];
+    putUint32(header, image.width);
+    putUint32(header + 4, image.height);
+    header[8] = 8;                               // Bit depth
+    header[9] = image.channels == 3 ? 2 : 0;     // Colour type: truecolour / greyscale
+    header[10] = header[11] = header[12] = 0;    // Deflate, adaptive filtering, no interlace
+    writeChunk(sink, "IHDR", header, sizeof(header));
+
+    const size_t stride = static_cast<size_t>(image.width) * image.channels;
+    std::vector<unsigned char> row(stride + 1);
+    std::vector<unsigned char> compressed(IDAT_CHUNK_SIZE);
+    stream.next_out = compressed.data();
+    stream.avail_out = static_cast<uInt>(compressed.size());
+
+    bool ok = true;
+    for (std::uint32_t y = 0; y <= image.height && ok; ++y) {
+        int flush = Z_NO_FLUSH;
+        if (y < image.height) {
+            // Filter type 2 (Up): each byte minus the one above it; the first row has none
+            const std::uint8_t* current = image.pixels.data() + y * stride;
+            row[0] = 2;
+            if (y == 0) {
+                std::memcpy(row.data() + 1, current, stride);
+            } else {
+                const std::uint8_t* above = current - stride;
+                for (size_t i = 0; i < stride; ++i) {
+                    row[i + 1] = static_cast<unsigned char>(current[i] - above[i]);
+                }
+            }
+            stream.next_in = row.data();
+            stream.avail_in = static_cast<uInt>(row.size());
+        } else {
+            flush = Z_FINISH;
+        }
+
+        for (;;) {
+            int result = deflate(&stream, flush);
+            if (result == Z_STREAM_ERROR) {
+                std::cerr << "Error: deflate failed while encoding PNG." << std::endl;
+                ok = false;
+                break;
+            }
+            if (stream.avail_out == 0) {
+                writeChunk(sink, "IDAT", compressed.data(), compressed.size());
+                stream.next_out = compressed.data();
+                stream.avail_out = static_cast<uInt>(compressed.size());
+                continue;
+            }
+            if (flush == Z_FINISH ? result == Z_STREAM_END : stream.avail_in == 0) {
+                break;
+            }
+        }
+    }
+    if (ok && stream.avail_out < compressed.size()) {
+        writeChunk(sink, "IDAT", compressed.data(), compressed.size() - stream.avail_out);
+    }
+    deflateEnd(&stream);
+    if (ok) {
+        writeChunk(sink, "IEND", nullptr, 0);
+    }
+    return ok;
+}
@@ -0,0 +1,18 @@
+#ifndef PNGENCODER_H
+#define PNGENCODER_H
+
+#include <cstddef>
+#include <functional>
+#include "FrameRenderer.h"
+
+// Receives encoded bytes as they are produced
+using ByteSink = std::function<void(const unsigned char* data, size_t size)>;
+
+// Encodes an 8-bit grey or RGB image as PNG (zlib deflate, "Up" row filter). The
+// compressed stream is cut into IDAT chunks of at most 32 KiB and each is passed to
+// `sink` as soon as it is complete, so the whole PNG is never held in memory.
+// Returns false (after logging) if zlib fails; the sink may have received part of it.
+// Level 3 is under half the time of zlib's default 6 on NM frames, for about 2% more bytes.
+bool encodePng(const RenderedImage& image, const ByteSink& sink, int compressionLevel = 3);
+
+#endif // PNGENCODER_H
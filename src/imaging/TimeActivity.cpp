@@ -0,0 +1,130 @@
+#include "TimeActivity.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+const size_t FRAMES_PER_CLAIM = 4; // Neighbouring frames stay on one thread, so curves rarely share cache lines
+
+double frameMiddleSeconds(const FrameTiming& timing, size_t frame) {
+    return (timing.startMs[frame] + timing.durationMs[frame] / 2) / 1000.0;
+}
+
+} // namespace
+
+bool computeTimeActivityCurves(const FrameLoaderFactory& openLoader, size_t frameCount, const std::vector<Roi>& regions,
+                               unsigned threads, std::vector<TimeActivityCurve>& curves) {
+    curves.assign(regions.size(), TimeActivityCurve());
+    for (size_t r = 0; r < regions.size(); ++r) {
+        curves[r].region = regions[r].name;
+        curves[r].pixels = regions[r].pixelCount();
+        curves[r].counts.assign(frameCount, 0);
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, (frameCount + FRAMES_PER_CLAIM - 1) / FRAMES_PER_CLAIM));
+
+    std::atomic<size_t> nextFrame(0);
+    std::atomic<bool> failed(false);
+    auto work = [&](unsigned thread) {
+        FrameLoader loadFrame = openLoader(thread);
+        if (!loadFrame) {
+            std::cerr << "Time-activity curves: cannot open the frames for thread " << thread << "." << std::endl;
+            failed = true;
+            return;
+        }
+        ImageFrame frame; // Reused for every frame this thread decodes
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t first = nextFrame.fetch_add(FRAMES_PER_CLAIM, std::memory_order_relaxed);
+            if (first >= frameCount) {
+                return;
+            }
+            size_t last = std::min(frameCount, first + FRAMES_PER_CLAIM);
+            for (size_t i = first; i < last; ++i) {
+                if (!loadFrame(i, frame) || frame.channels != 1) {
+                    std::cerr << "Time-activity curves: cannot read frame " << i + 1 << " as counts." << std::endl;
+                    failed = true;
+                    return;
+                }
+                for (size_t r = 0; r < regions.size(); ++r) {
+                    curves[r].counts[i] = countRegion(frame, regions[r]).sum;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(work, t);
+    }
+    work(0); // The calling thread takes a share too
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return !failed;
+}
+
+std::vector<double> countRates(const TimeActivityCurve& curve, const FrameTiming& timing, const TimeActivityCurve* background) {
+    std::vector<double> rates(curve.counts.size(), 0.0);
+    const double scale = background && background->pixels > 0 ? static_cast<double>(curve.pixels) / background->pixels : 0.0;
+    for (size_t i = 0; i < rates.size() && i < timing.durationMs.size(); ++i) {
+        double counts = static_cast<double>(curve.counts[i]);
+        if (scale > 0) {
+            counts -= scale * background->counts[i];
+        }
+        rates[i] = timing.durationMs[i] > 0 ? counts * 1000.0 / timing.durationMs[i] : 0.0;
+    }
+    return rates;
+}
+
+CurveParameters curveParameters(const std::vector<double>& rates, const FrameTiming& timing) {
+    CurveParameters parameters;
+    if (rates.empty() || timing.startMs.size() < rates.size()) {
+        return parameters;
+    }
+    size_t peak = std::max_element(rates.begin(), rates.end()) - rates.begin();
+    parameters.peakRate = rates[peak];
+    parameters.tmaxSeconds = frameMiddleSeconds(timing, peak);
+    if (parameters.peakRate <= 0) {
+        return parameters;
+    }
+    const double half = parameters.peakRate / 2;
+    for (size_t i = peak + 1; i < rates.size(); ++i) {
+        if (rates[i] <= half) {
+            double before = frameMiddleSeconds(timing, i - 1);
+            double after = frameMiddleSeconds(timing, i);
+            double fraction = (rates[i - 1] - half) / (rates[i - 1] - rates[i]);
+            parameters.halfTimeReached = true;
+            parameters.halfTimeSeconds = before + fraction * (after - before) - parameters.tmaxSeconds;
+            break;
+        }
+    }
+    return parameters;
+}
+
+bool splitFunction(const std::vector<double>& leftRates, const std::vector<double>& rightRates, const FrameTiming& timing,
+                   double startSeconds, double endSeconds, double& leftPercent) {
+    double left = 0;
+    double right = 0;
+    bool anyFrame = false;
+    for (size_t i = 0; i < leftRates.size() && i < rightRates.size() && i < timing.durationMs.size(); ++i) {
+        double middle = frameMiddleSeconds(timing, i);
+        if (middle < startSeconds || middle > endSeconds) {
+            continue;
+        }
+        double seconds = timing.durationMs[i] / 1000.0;
+        left += leftRates[i] * seconds;
+        right += rightRates[i] * seconds;
+        anyFrame = true;
+    }
+    left = std::max(left, 0.0); // Background correction can overshoot a region with no uptake
+    right = std::max(right, 0.0);
+    if (!anyFrame || left + right <= 0) {
+        return false;
+    }
+    leftPercent = 100.0 * left / (left + right);
+    return true;
+}
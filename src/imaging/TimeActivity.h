@@ -0,0 +1,55 @@
+#ifndef TIMEACTIVITY_H
+#define TIMEACTIVITY_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "CountAnalysis.h"
+#include "../models/ImageFrame.h"
+
+// Time-activity curves of dynamic NM studies (renography, gastric emptying): the counts
+// of each region in every frame, and the parameters read off them.
+//
+// Frames are decoded and counted on a small pool of threads, each with its own decoder,
+// taking the next block of frames and summing every region with the SIMD reductions of CountAnalysis. Curves are
+// written per frame index, so the result does not depend on the thread count.
+
+struct TimeActivityCurve {
+    std::string region;
+    std::uint64_t pixels = 0;
+    std::vector<std::int64_t> counts; // One per frame
+};
+
+// Decodes one frame (0-based); only ever called from the thread it was opened for
+using FrameLoader = std::function<bool(size_t frameIndex, ImageFrame& frame)>;
+
+// Opens the frame source for one worker thread (0 is the calling thread), so decoders that
+// are not thread-safe are never shared. An empty FrameLoader when the source cannot be opened.
+using FrameLoaderFactory = std::function<FrameLoader(unsigned thread)>;
+
+// Sums `regions` in frames 0..frameCount-1 into one curve per region. `threads` 0 uses
+// every core. False (with a message on stderr) when a frame cannot be decoded.
+bool computeTimeActivityCurves(const FrameLoaderFactory& openLoader, size_t frameCount, const std::vector<Roi>& regions,
+                               unsigned threads, std::vector<TimeActivityCurve>& curves);
+
+// Counts per second in each frame, with `background` (when given) subtracted after
+// scaling it by the ratio of the regions' pixel counts
+std::vector<double> countRates(const TimeActivityCurve& curve, const FrameTiming& timing, const TimeActivityCurve* background);
+
+struct CurveParameters {
+    double tmaxSeconds = 0;       // Middle of the frame with the highest count rate
+    double peakRate = 0;          // Counts per second at Tmax
+    bool halfTimeReached = false; // The rate fell to half its peak before the last frame
+    double halfTimeSeconds = 0;   // From Tmax to half the peak rate, interpolated between frame middles
+};
+
+CurveParameters curveParameters(const std::vector<double>& rates, const FrameTiming& timing);
+
+// Share of the left region in the summed counts of both, over the frames whose middle lies
+// in [startSeconds, endSeconds] (the uptake phase of a renogram), in percent. False when
+// the window holds no frame or no counts.
+bool splitFunction(const std::vector<double>& leftRates, const std::vector<double>& rightRates, const FrameTiming& timing,
+                   double startSeconds, double endSeconds, double& leftPercent);
+
+#endif // TIMEACTIVITY_H
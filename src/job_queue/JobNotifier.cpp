@@ -0,0 +1,122 @@
+#include "JobNotifier.h"
+#include <chrono>
+#include <iostream>
+#include "../tracing/Tracer.h"
+
+#ifdef HL7_HAVE_LIBPQ
+#include <libpq-fe.h>
+#include <poll.h>
+#endif
+
+JobNotifier::JobNotifier(const std::string& connInfo, int pollIntervalMs)
+    : connInfo(connInfo), pollIntervalMs(pollIntervalMs > 0 ? pollIntervalMs : 1000), notifications(0), stopping(false), connected(false) {
+}
+
+JobNotifier::~JobNotifier() {
+    stop();
+}
+
+void JobNotifier::start() {
+#ifdef HL7_HAVE_LIBPQ
+    if (connInfo.empty()) {
+        std::cout << "Job notifier: no <Jobs><ListenConnInfo>, polling every " << pollIntervalMs << " ms." << std::endl;
+        return;
+    }
+    if (!listener.joinable()) {
+        listener = std::thread(&JobNotifier::run, this);
+    }
+#else
+    std::cout << "Job notifier: built without libpq, polling every " << pollIntervalMs << " ms." << std::endl;
+#endif
+}
+
+void JobNotifier::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    if (listener.joinable()) {
+        listener.join();
+    }
+}
+
+bool JobNotifier::listening() const {
+    return connected;
+}
+
+unsigned long JobNotifier::sequence() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return notifications;
+}
+
+bool JobNotifier::waitForJobs(unsigned long seenSequence) {
+    HL7_TRACE_SCOPE("waitForJobs");
+    std::unique_lock<std::mutex> lock(mutex);
+    wakeUp.wait_for(lock, std::chrono::milliseconds(pollIntervalMs), [this, seenSequence] {
+        return stopping || notifications != seenSequence;
+    });
+    return !stopping;
+}
+
+void JobNotifier::notifyAll() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++notifications;
+    }
+    wakeUp.notify_all();
+}
+
+void JobNotifier::run() {
+#ifdef HL7_HAVE_LIBPQ
+    HL7_TRACE_THREAD_NAME("job-notifier");
+    auto isStopping = [this] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stopping;
+    };
+
+    while (!isStopping()) {
+        PGconn* conn = PQconnectdb(connInfo.c_str());
+        if (PQstatus(conn) != CONNECTION_OK) {
+            std::cerr << "Job notifier: cannot connect (" << PQerrorMessage(conn) << "), polling until it can." << std::endl;
+            PQfinish(conn);
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait_for(lock, std::chrono::milliseconds(pollIntervalMs * 5), [this] { return stopping; });
+            continue;
+        }
+        PGresult* result = PQexec(conn, "LISTEN cda_jobs");
+        bool ok = PQresultStatus(result) == PGRES_COMMAND_OK;
+        PQclear(result);
+        if (!ok) {
+            std::cerr << "Job notifier: LISTEN failed: " << PQerrorMessage(conn) << std::endl;
+            PQfinish(conn);
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait_for(lock, std::chrono::milliseconds(pollIntervalMs * 5), [this] { return stopping; });
+            continue;
+        }
+        connected = true;
+        std::cout << "Job notifier: listening on channel cda_jobs." << std::endl;
+        notifyAll(); // Jobs may have been enqueued while we were not listening
+
+        // Short poll() timeouts so stop() is noticed without a wake-up pipe
+        while (!isStopping()) {
+            pollfd descriptor = {PQsocket(conn), POLLIN, 0};
+            int ready = ::poll(&descriptor, 1, 200);
+            if (ready < 0 || (ready > 0 && !PQconsumeInput(conn))) {
+                std::cerr << "Job notifier: connection lost (" << PQerrorMessage(conn) << "), reconnecting." << std::endl;
+                break;
+            }
+            bool received = false;
+            while (PGnotify* notify = PQnotifies(conn)) {
+                received = true;
+                PQfreemem(notify);
+            }
+            if (received) {
+                notifyAll();
+            }
+        }
+        connected = false;
+        PQfinish(conn);
+    }
+#endif
+}
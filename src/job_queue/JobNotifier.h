@@ -0,0 +1,50 @@
+#ifndef JOBNOTIFIER_H
+#define JOBNOTIFIER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Wakes idle workers when jobs are enqueued. With libpq (HL7_HAVE_LIBPQ) a background
+// thread holds its own connection with LISTEN cda_jobs and bumps a sequence number on
+// every notification; ODBC gives no access to notifications, hence the separate
+// connection. Without libpq, or without a <Jobs><ListenConnInfo>, waitForJobs() is a
+// plain sleep of the poll interval, so workers fall back to polling.
+class JobNotifier {
+public:
+    JobNotifier(const std::string& connInfo, int pollIntervalMs);
+    ~JobNotifier(); // Stops the listener thread
+
+    JobNotifier(const JobNotifier&) = delete;
+    JobNotifier& operator=(const JobNotifier&) = delete;
+
+    void start();
+    void stop(); // Also wakes every waiting worker
+
+    bool listening() const; // False when workers are polling
+
+    // Current sequence number; read it before claiming, then pass it to waitForJobs()
+    // so a notification that arrives in between is not missed
+    unsigned long sequence();
+    // Returns when a notification newer than `seenSequence` arrives, after the poll
+    // interval, or on stop(). Returns false once stopped.
+    bool waitForJobs(unsigned long seenSequence);
+
+private:
+    std::string connInfo;
+    int pollIntervalMs;
+
+    std::thread listener;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    unsigned long notifications;
+    bool stopping;
+    std::atomic<bool> connected;
+
+    void run();
+    void notifyAll();
+};
+
+#endif // JOBNOTIFIER_H
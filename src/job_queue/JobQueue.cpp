@@ -0,0 +1,223 @@
+#include "JobQueue.h"
+#include <iostream>
+#include "../tracing/Tracer.h"
+
+namespace {
+
+const char* const CLAIM_SQL =
+    "UPDATE cda_jobs SET status = 'running', attempts = attempts + 1, lease_owner = ?, "
+    "lease_expires_at = now() + make_interval(secs => ?::double precision), updated_at = now() "
+    "WHERE job_id IN (SELECT job_id FROM cda_jobs WHERE status = 'pending' AND available_at <= now() "
+    "ORDER BY priority DESC, job_id LIMIT ?::int FOR UPDATE SKIP LOCKED) "
+    "RETURNING job_id, study_uid, attempts, max_attempts";
+
+const char* const RENEW_SQL =
+    "UPDATE cda_jobs SET lease_expires_at = now() + make_interval(secs => ?::double precision), updated_at = now() "
+    "WHERE status = 'running' AND lease_owner = ?";
+
+const char* const COMPLETE_SQL =
+    "UPDATE cda_jobs SET status = 'done', output_path = ?, last_error = NULL, lease_owner = NULL, "
+    "lease_expires_at = NULL, updated_at = now(), finished_at = now() "
+    "WHERE job_id = ?::bigint AND status = 'running' AND lease_owner = ?";
+
+const char* const FAIL_SQL =
+    "UPDATE cda_jobs SET status = CASE WHEN attempts >= max_attempts THEN 'failed' ELSE 'pending' END, "
+    "available_at = now() + make_interval(secs => ?::double precision * attempts * attempts), "
+    "last_error = ?, lease_owner = NULL, lease_expires_at = NULL, updated_at = now(), "
+    "finished_at = CASE WHEN attempts >= max_attempts THEN now() END "
+    "WHERE job_id = ?::bigint AND status = 'running' AND lease_owner = ?";
+
+const char* const RELEASE_SQL =
+    "UPDATE cda_jobs SET status = 'pending', attempts = GREATEST(attempts - 1, 0), lease_owner = NULL, "
+    "lease_expires_at = NULL, updated_at = now() "
+    "WHERE status = 'running' AND lease_owner = ?";
+
+const char* const RECLAIM_SQL =
+    "UPDATE cda_jobs SET status = CASE WHEN attempts >= max_attempts THEN 'failed' ELSE 'pending' END, "
+    "last_error = 'lease expired (worker ' || COALESCE(lease_owner, '?') || ')', lease_owner = NULL, "
+    "lease_expires_at = NULL, updated_at = now(), finished_at = CASE WHEN attempts >= max_attempts THEN now() END "
+    "WHERE job_id IN (SELECT job_id FROM cda_jobs WHERE status = 'running' AND lease_expires_at < now() "
+    "FOR UPDATE SKIP LOCKED)";
+
+} // namespace
+
+JobQueue::JobQueue() : henv(SQL_NULL_HENV), hdbc(SQL_NULL_HDBC), connected(false) {
+    SQLRETURN ret = SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &henv);
+    if (!SQL_SUCCEEDED(ret)) {
+        std::cerr << "Error allocating environment handle for the job queue: " << ret << std::endl;
+        henv = SQL_NULL_HENV;
+        return;
+    }
+    SQLSetEnvAttr(henv, SQL_ATTR_ODBC_VERSION, (SQLPOINTER)SQL_OV_ODBC3, 0);
+}
+
+JobQueue::~JobQueue() {
+    disconnect();
+    if (henv != SQL_NULL_HENV) {
+        SQLFreeHandle(SQL_HANDLE_ENV, henv);
+        henv = SQL_NULL_HENV;
+    }
+}
+
+bool JobQueue::connect(const std::string& dsn, const std::string& user, const std::string& password) {
+    if (connected) {
+        return true;
+    }
+    if (henv == SQL_NULL_HENV) {
+        std::cerr << "Job queue: environment handle not initialized." << std::endl;
+        return false;
+    }
+    SQLRETURN ret = SQLAllocHandle(SQL_HANDLE_DBC, henv, &hdbc);
+    if (!SQL_SUCCEEDED(ret)) {
+        handleError(SQL_HANDLE_ENV, henv, "Error allocating connection handle for the job queue");
+        return false;
+    }
+
+    std::string connStr = "DSN=" + dsn + ";";
+    if (!user.empty()) {
+        connStr += "UID=" + user + ";";
+    }
+    if (!password.empty()) {
+        connStr += "PWD=" + password + ";";
+    }
+    ret = SQLDriverConnect(hdbc, NULL, (SQLCHAR*)connStr.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT);
+    if (!SQL_SUCCEEDED(ret)) {
+        handleError(SQL_HANDLE_DBC, hdbc, "Job queue: error connecting to DSN: " + dsn);
+        SQLFreeHandle(SQL_HANDLE_DBC, hdbc);
+        hdbc = SQL_NULL_HDBC;
+        return false;
+    }
+    // Every call must commit on its own; a claim left in an open transaction would hold its row locks
+    SQLSetConnectAttr(hdbc, SQL_ATTR_AUTOCOMMIT, (SQLPOINTER)SQL_AUTOCOMMIT_ON, 0);
+    connected = true;
+    return true;
+}
+
+void JobQueue::disconnect() {
+    if (hdbc != SQL_NULL_HDBC) {
+        SQLDisconnect(hdbc);
+        SQLFreeHandle(SQL_HANDLE_DBC, hdbc);
+        hdbc = SQL_NULL_HDBC;
+    }
+    connected = false;
+}
+
+void JobQueue::handleError(SQLSMALLINT handleType, SQLHANDLE handle, const std::string& message) {
+    std::cerr << "ODBC Error: " << message << std::endl;
+    SQLCHAR sqlState[6];
+    SQLINTEGER nativeError;
+    SQLCHAR messageText[SQL_MAX_MESSAGE_LENGTH];
+    SQLSMALLINT textLength;
+    for (SQLSMALLINT i = 1; SQL_SUCCEEDED(SQLGetDiagRec(handleType, handle, i, sqlState, &nativeError, messageText, sizeof(messageText), &textLength)); ++i) {
+        std::cerr << "  SQLState: " << sqlState << ", NativeError: " << nativeError << ", Message: " << messageText << std::endl;
+    }
+}
+
+bool JobQueue::execute(const char* label, const std::string& sql, const std::vector<std::string>& params,
+                       std::vector<std::vector<std::string>>* rows, long long* affected) {
+    if (!connected) {
+        std::cerr << "Job queue: not connected for " << label << "." << std::endl;
+        return false;
+    }
+    SQLHSTMT hstmt = SQL_NULL_HSTMT;
+    if (!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, hdbc, &hstmt))) {
+        handleError(SQL_HANDLE_DBC, hdbc, std::string("Error allocating statement handle for ") + label);
+        return false;
+    }
+
+    bool ok = SQL_SUCCEEDED(SQLPrepare(hstmt, (SQLCHAR*)sql.c_str(), SQL_NTS));
+    if (!ok) {
+        handleError(SQL_HANDLE_STMT, hstmt, std::string("Error preparing ") + label);
+    }
+    std::vector<SQLLEN> lengths(params.size());
+    for (size_t i = 0; ok && i < params.size(); ++i) {
+        lengths[i] = static_cast<SQLLEN>(params[i].size());
+        ok = SQL_SUCCEEDED(SQLBindParameter(hstmt, static_cast<SQLUSMALLINT>(i + 1), SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR,
+                                            params[i].size() > 0 ? params[i].size() : 1, 0, (SQLPOINTER)params[i].c_str(),
+                                            0, &lengths[i]));
+        if (!ok) {
+            handleError(SQL_HANDLE_STMT, hstmt, std::string("Error binding parameter for ") + label);
+        }
+    }
+    if (ok) {
+        SQLRETURN ret = SQLExecute(hstmt);
+        ok = SQL_SUCCEEDED(ret) || ret == SQL_NO_DATA; // SQL_NO_DATA: an UPDATE that matched no rows
+        if (!ok) {
+            handleError(SQL_HANDLE_STMT, hstmt, std::string("Error executing ") + label);
+        }
+    }
+    if (ok && affected) {
+        SQLLEN count = 0;
+        SQLRowCount(hstmt, &count);
+        *affected = static_cast<long long>(count);
+    }
+    if (ok && rows) {
+        SQLSMALLINT columns = 0;
+        SQLNumResultCols(hstmt, &columns);
+        while (columns > 0 && SQL_SUCCEEDED(SQLFetch(hstmt))) {
+            std::vector<std::string> row;
+            for (SQLUSMALLINT c = 1; c <= static_cast<SQLUSMALLINT>(columns); ++c) {
+                SQLCHAR buffer[512];
+                SQLLEN indicator = 0;
+                if (SQL_SUCCEEDED(SQLGetData(hstmt, c, SQL_C_CHAR, buffer, sizeof(buffer), &indicator)) && indicator != SQL_NULL_DATA) {
+                    row.emplace_back(reinterpret_cast<const char*>(buffer));
+                } else {
+                    row.emplace_back();
+                }
+            }
+            rows->push_back(std::move(row));
+        }
+    }
+    SQLFreeStmt(hstmt, SQL_CLOSE);
+    SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+    return ok;
+}
+
+bool JobQueue::claim(const std::string& owner, int batchSize, int leaseSeconds, std::vector<ClaimedJob>& jobs) {
+    HL7_TRACE_SCOPE("claimJobs");
+    jobs.clear();
+    std::vector<std::vector<std::string>> rows;
+    if (!execute("claim", CLAIM_SQL, {owner, std::to_string(leaseSeconds), std::to_string(batchSize)}, &rows, nullptr)) {
+        return false;
+    }
+    for (const std::vector<std::string>& row : rows) {
+        if (row.size() < 4) {
+            continue;
+        }
+        try {
+            jobs.push_back({std::stoll(row[0]), row[1], std::stoi(row[2]), std::stoi(row[3])});
+        } catch (const std::exception&) {
+            std::cerr << "Job queue: unexpected claim row for job '" << row[0] << "'." << std::endl;
+        }
+    }
+    return true;
+}
+
+int JobQueue::renewLeases(const std::string& owner, int leaseSeconds) {
+    HL7_TRACE_SCOPE("renewLeases");
+    long long affected = 0;
+    return execute("renewLeases", RENEW_SQL, {std::to_string(leaseSeconds), owner}, nullptr, &affected) ? static_cast<int>(affected) : -1;
+}
+
+bool JobQueue::complete(long long jobId, const std::string& owner, const std::string& outputPath) {
+    HL7_TRACE_SCOPE("completeJob");
+    long long affected = 0;
+    return execute("complete", COMPLETE_SQL, {outputPath, std::to_string(jobId), owner}, nullptr, &affected) && affected == 1;
+}
+
+bool JobQueue::fail(long long jobId, const std::string& owner, const std::string& error, int backoffSeconds) {
+    HL7_TRACE_SCOPE("failJob");
+    long long affected = 0;
+    return execute("fail", FAIL_SQL, {std::to_string(backoffSeconds), error, std::to_string(jobId), owner}, nullptr, &affected) && affected == 1;
+}
+
+int JobQueue::release(const std::string& owner) {
+    long long affected = 0;
+    return execute("release", RELEASE_SQL, {owner}, nullptr, &affected) ? static_cast<int>(affected) : -1;
+}
+
+int JobQueue::reclaimExpired() {
+    HL7_TRACE_SCOPE("reclaimExpired");
+    long long affected = 0;
+    return execute("reclaimExpired", RECLAIM_SQL, {}, nullptr, &affected) ? static_cast<int>(affected) : -1;
+}
@@ -0,0 +1,62 @@
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+#include <string>
+#include <vector>
+
+#include <sql.h>
+#include <sqlext.h>
+
+struct ClaimedJob {
+    long long jobId;
+    std::string studyUid;
+    int attempts;     // Including this claim
+    int maxAttempts;
+};
+
+// The cda_jobs table (db/cda_jobs.sql) over its own ODBC connection. Every method is a
+// single autocommitted statement, so a claim, renewal or completion is atomic on its own
+// and workers never hold row locks between calls. Updates to a claimed job are fenced by
+// lease_owner: once a lease has expired and the job was handed to someone else, the old
+// owner's complete()/fail() no longer match and return false.
+// Not thread-safe; use one instance per thread.
+class JobQueue {
+public:
+    JobQueue();
+    ~JobQueue();
+
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    bool connect(const std::string& dsn, const std::string& user, const std::string& password);
+    void disconnect();
+    bool isConnected() const { return connected; }
+
+    // Claims up to batchSize pending jobs (highest priority, then oldest) for `owner`
+    // with FOR UPDATE SKIP LOCKED. `jobs` is empty when there is nothing to do; false on error.
+    bool claim(const std::string& owner, int batchSize, int leaseSeconds, std::vector<ClaimedJob>& jobs);
+    // Extends the lease of every job `owner` is running; returns the number of jobs or -1
+    int renewLeases(const std::string& owner, int leaseSeconds);
+    // Marks the job done; false if the lease was lost (or on error)
+    bool complete(long long jobId, const std::string& owner, const std::string& outputPath);
+    // Back to 'pending' after attempts^2 * backoffSeconds, or 'failed' once attempts are used up
+    bool fail(long long jobId, const std::string& owner, const std::string& error, int backoffSeconds);
+    // Hands back jobs `owner` claimed but did not start (shutdown); the claim is not counted
+    int release(const std::string& owner);
+    // Puts jobs whose lease expired (their worker died or hung) back to 'pending'. Any
+    // worker may call this; returns the number of jobs reset or -1.
+    int reclaimExpired();
+
+private:
+    SQLHENV henv;
+    SQLHDBC hdbc;
+    bool connected;
+
+    // Runs one statement with text parameters (cast in the SQL where needed). Rows of
+    // a result set, if any, are returned as strings; `affected` receives SQLRowCount.
+    bool execute(const char* label, const std::string& sql, const std::vector<std::string>& params,
+                 std::vector<std::vector<std::string>>* rows, long long* affected);
+    void handleError(SQLSMALLINT handleType, SQLHANDLE handle, const std::string& message);
+};
+
+#endif // JOBQUEUE_H
@@ -0,0 +1,285 @@
+#include "JobWorker.h"
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include "JobQueue.h"
+#include "../hl7_generator/HL7MessageGenerator.h"
+#include "../metrics/Metrics.h"
+#include "../output/OutputLayout.h"
+#include "../tracing/Tracer.h"
+
+namespace {
+
+// A job whose document is written (or that failed), waiting to be recorded in cda_jobs
+struct FinishedJob {
+    ClaimedJob job;
+    std::string relativePath;
+    std::string outputPath;
+    std::string inputHash;
+    std::string error; // Empty: done
+};
+
+// Jobs of one worker thread handed back by AsyncWriter completions, which run on the
+// writer's commit thread; the worker thread records them with its own connection.
+class FinishedJobs {
+public:
+    void writeSubmitted() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++writing;
+    }
+    void add(FinishedJob finished, bool fromWrite) {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.push_back(std::move(finished));
+        if (fromWrite) {
+            --writing;
+            writesDone.notify_all();
+        }
+    }
+    void waitForWrites() {
+        std::unique_lock<std::mutex> lock(mutex);
+        writesDone.wait(lock, [this] { return writing == 0; });
+    }
+    std::vector<FinishedJob> take() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<FinishedJob> taken;
+        taken.swap(items);
+        return taken;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable writesDone;
+    std::vector<FinishedJob> items;
+    size_t writing = 0;
+};
+
+// Generates and validates one study's document, compresses it if configured, and works out
+// where it goes. Returns an empty string on success (with the paths and input hash set, and
+// the document, unless the indexed one has the same input hash: `unchanged`), otherwise
+// the error recorded on the job.
+std::string processJob(const ClaimedJob& job, PatientStudySource& source, HL7MessageGenerator& generator,
+                       DocumentCompressor& compressor, OutputIndex& outputIndex, bool force, const AppConfig& config,
+                       std::string& document, FinishedJob& finished, bool& unchanged) {
+    HL7_TRACE_SCOPE_DETAIL("processJob", job.studyUid);
+    Study study = source.getStudyByUid(job.studyUid);
+    if (study.studyInstanceUID.empty()) {
+        return "study not found";
+    }
+    Patient patient = source.getPatientById(study.patientId);
+    if (patient.patientID.empty()) {
+        return "patient " + study.patientId + " not found";
+    }
+    if (config.outputPath.empty()) {
+        return "no output path configured";
+    }
+    std::unique_ptr<StudyContentReader> content = source.openStudyContent(study.studyInstanceUID);
+    finished.inputHash = generator.inputHash(patient, study, content.get(), OutputIndex::outputSettingsKey(config, "files"));
+    std::string indexedHash;
+    if (!force && outputIndex.lookup(job.studyUid, finished.relativePath, &indexedHash) && indexedHash == finished.inputHash) {
+        finished.outputPath = OutputIndex::documentFile(config.outputPath, finished.relativePath);
+        unchanged = !finished.outputPath.empty();
+        if (unchanged) {
+            return "";
+        }
+    }
+    content = source.openStudyContent(study.studyInstanceUID); // The hash read the first one to the end
+    if (!generator.generateAndValidate(patient, study, document, content.get())) {
+        return document.empty() ? "generation failed" : "generated document failed validation";
+    }
+    if (compressor.enabled()) {
+        std::string compressed;
+        if (!compressor.compress(document, compressed)) {
+            return std::string(compressor.formatName()) + " compression failed";
+        }
+        document.swap(compressed);
+    }
+
+    // A fixed name per study, published by AsyncWriter's rename: if a job ever runs
+    // twice (its lease expired mid-way), the second result replaces the first whole.
+    finished.relativePath = OutputLayout(config.outputScheme, config.outputHashLevels).relativePath(patient, study) + compressor.extension();
+    finished.outputPath = OutputLayout::join(config.outputPath, finished.relativePath);
+    if (!OutputLayout::createParentDirectories(config.outputPath, finished.relativePath)) {
+        return "cannot create the directory of " + finished.outputPath;
+    }
+    return "";
+}
+
+// Marks finished jobs done (adding them to the output index) or failed
+void recordFinished(JobQueue& queue, OutputIndex& outputIndex, int retryBackoffSeconds, const std::string& owner,
+                    const std::vector<FinishedJob>& finished) {
+    Metrics& metrics = Metrics::instance();
+    for (const FinishedJob& entry : finished) {
+        const ClaimedJob& job = entry.job;
+        bool recorded;
+        if (entry.error.empty()) {
+            outputIndex.record(job.studyUid, entry.relativePath, entry.inputHash);
+            recorded = queue.complete(job.jobId, owner, entry.outputPath);
+            if (recorded) {
+                metrics.jobsCompleted.add();
+            }
+        } else {
+            metrics.jobsFailed.add();
+            std::cerr << "Job " << job.jobId << " (" << job.studyUid << ") attempt " << job.attempts << "/" << job.maxAttempts
+                      << " failed: " << entry.error << std::endl;
+            recorded = queue.fail(job.jobId, owner, entry.error, retryBackoffSeconds);
+        }
+        if (!recorded) {
+            metrics.jobLeasesLost.add();
+            std::cerr << "Job worker " << owner << ": lease on job " << job.jobId << " was lost; result not recorded." << std::endl;
+        }
+    }
+}
+
+} // namespace
+
+JobWorker::JobWorker(const ConfigStore& store, PatientStudySourceFactory& sourceFactory, JobNotifier& notifier, const JobWorkerOptions& options)
+    : configStore(store), sourceFactory(sourceFactory), notifier(notifier), options(options), outputIndex(options.indexPath),
+      writer(options.writerOptions), stopping(false), activeThreads(0) {
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+    ownerPrefix = std::string(host) + ":" + std::to_string(getpid());
+}
+
+JobWorker::~JobWorker() {
+    stop();
+    join();
+}
+
+void JobWorker::start() {
+    if (!outputIndex.open()) {
+        std::cerr << "Job worker: documents are written without updating the output index." << std::endl;
+    }
+    writer.start();
+    for (int i = 0; i < options.threads; ++i) {
+        activeThreads.fetch_add(1);
+        threads.emplace_back(&JobWorker::run, this, static_cast<size_t>(i));
+    }
+}
+
+void JobWorker::stop() {
+    stopping.store(true);
+}
+
+void JobWorker::join() {
+    for (std::thread& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+    writer.stop();
+    outputIndex.close();
+}
+
+void JobWorker::run(size_t index) {
+    HL7_TRACE_THREAD_NAME("job-worker-" + std::to_string(index));
+    const std::string owner = ownerPrefix + ":" + std::to_string(index);
+    Metrics& metrics = Metrics::instance();
+
+    JobQueue queue;
+    FinishedJobs finishedJobs;
+    std::unique_ptr<PatientStudySource> source;
+    DocumentCompressor compressor(options.compression);
+    if (!compressor.open()) {
+        std::cerr << "Job worker " << owner << ": cannot set up output compression, stopping." << std::endl;
+        activeThreads.fetch_sub(1);
+        return;
+    }
+    std::unique_ptr<HL7MessageGenerator> generator(new HL7MessageGenerator(configStore));
+    const auto leaseDuration = std::chrono::seconds(options.leaseSeconds);
+    auto lastReclaim = std::chrono::steady_clock::time_point();
+
+    while (!stopping.load()) {
+        // (Re)connect; failures back off by one poll interval
+        if (!source) {
+            source = sourceFactory.create(index);
+        }
+        if (!source || !queue.connect(options.odbcDsn, options.dbUser, options.dbPassword)) {
+            std::cerr << "Job worker " << owner << ": cannot reach the database, retrying." << std::endl;
+            notifier.waitForJobs(notifier.sequence());
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReclaim >= leaseDuration / 2) {
+            int reclaimed = queue.reclaimExpired();
+            if (reclaimed > 0) {
+                metrics.jobLeasesExpired.add(static_cast<std::uint64_t>(reclaimed));
+                std::cout << "Job worker " << owner << ": reclaimed " << reclaimed << " jobs with expired leases." << std::endl;
+            }
+            lastReclaim = now;
+        }
+
+        unsigned long seen = notifier.sequence();
+        std::vector<ClaimedJob> jobs;
+        if (!queue.claim(owner, options.batchSize, options.leaseSeconds, jobs)) {
+            queue.disconnect(); // Reconnect on the next round
+            notifier.waitForJobs(seen);
+            continue;
+        }
+        if (jobs.empty()) {
+            if (options.drain) {
+                break;
+            }
+            notifier.waitForJobs(seen);
+            continue;
+        }
+        metrics.jobsClaimed.add(jobs.size());
+
+        auto leaseStart = std::chrono::steady_clock::now();
+        for (const ClaimedJob& job : jobs) {
+            if (stopping.load()) {
+                break;
+            }
+            if (std::chrono::steady_clock::now() - leaseStart >= leaseDuration / 2) {
+                queue.renewLeases(owner, options.leaseSeconds);
+                leaseStart = std::chrono::steady_clock::now();
+            }
+
+            FinishedJob finished{job, "", "", "", ""};
+            std::string document;
+            bool unchanged = false;
+            std::shared_ptr<const ConfigSnapshot> snapshot = configStore.current();
+            finished.error = processJob(job, *source, *generator, compressor, outputIndex, options.force, snapshot->config, document,
+                                        finished, unchanged);
+            if (unchanged) {
+                metrics.documentsUnchanged.add();
+                finishedJobs.add(std::move(finished), false); // Done with the document already there
+            } else if (finished.error.empty()) {
+                // Recorded as done only from the completion, once the document is durable
+                finishedJobs.writeSubmitted();
+                std::string outputPath = finished.outputPath;
+                bool submitted = writer.submit(outputPath, std::move(document), [&finishedJobs, finished](bool durable) mutable {
+                    if (!durable) {
+                        finished.error = "cannot write " + finished.outputPath;
+                    }
+                    finishedJobs.add(std::move(finished), true);
+                });
+                if (!submitted) {
+                    finished.error = "writer stopped";
+                    finishedJobs.add(std::move(finished), true);
+                }
+            } else {
+                finishedJobs.add(std::move(finished), false);
+            }
+            recordFinished(queue, outputIndex, options.retryBackoffSeconds, owner, finishedJobs.take());
+        }
+
+        // The rest of the batch is written while it was generated; wait for its group commit
+        writer.requestCommit();
+        finishedJobs.waitForWrites();
+        recordFinished(queue, outputIndex, options.retryBackoffSeconds, owner, finishedJobs.take());
+    }
+
+    // Jobs claimed but not started go straight back to the queue
+    int released = queue.isConnected() ? queue.release(owner) : 0;
+    if (released > 0) {
+        std::cout << "Job worker " << owner << ": released " << released << " unstarted jobs." << std::endl;
+    }
+    generator->finishValidation();
+    generator.reset();
+    activeThreads.fetch_sub(1);
+}
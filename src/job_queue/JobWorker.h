@@ -0,0 +1,71 @@
+#ifndef JOBWORKER_H
+#define JOBWORKER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "JobNotifier.h"
+#include "../config_manager/ConfigSnapshot.h"
+#include "../data_source/PatientStudySourceFactory.h"
+#include "../output/AsyncWriter.h"
+#include "../output/DocumentCompressor.h"
+#include "../output/OutputIndex.h"
+
+struct JobWorkerOptions {
+    std::string odbcDsn;         // Database holding cda_jobs
+    std::string dbUser;
+    std::string dbPassword;
+    int threads = 2;
+    int batchSize = 10;          // Jobs claimed per round trip
+    int leaseSeconds = 300;      // Renewed while the batch is being worked on
+    int retryBackoffSeconds = 30; // A failed job waits attempts^2 * this before it is retried
+    bool drain = false;          // Exit once no job can be claimed instead of waiting for more
+    bool force = false;          // Regenerate studies whose input hash is unchanged
+    std::string indexPath;       // OutputIndex shared by the threads
+    AsyncWriterOptions writerOptions; // Writer shared by the threads
+    CompressionOptions compression;   // Each thread compresses its own documents
+};
+
+// Worker mode (--worker): claims batches from cda_jobs, generates and validates each
+// study's document, hands it to the AsyncWriter for the output path (placed by
+// OutputLayout, compressed by the thread when configured) and, once the writer reports
+// it durable, records it in the OutputIndex and marks the job done; a batch is generated
+// while its earlier documents are being written. A study indexed with the same input hash (HL7MessageGenerator::inputHash),
+// whose document is still there, is marked done with that document without being
+// generated again, unless forced. Each thread has its own job queue connection, data
+// source and generator.
+// Any number of processes on any number of hosts can run this against the same
+// database; the claim query's SKIP LOCKED keeps them apart, and every worker also
+// reclaims expired leases, so no coordinator is needed.
+class JobWorker {
+public:
+    JobWorker(const ConfigStore& store, PatientStudySourceFactory& sourceFactory, JobNotifier& notifier, const JobWorkerOptions& options);
+    ~JobWorker(); // Stops and joins the threads
+
+    JobWorker(const JobWorker&) = delete;
+    JobWorker& operator=(const JobWorker&) = delete;
+
+    void start();
+    // Asks the threads to finish the job in hand and hand back the rest of their batch
+    void stop();
+    void join();
+    bool running() const { return activeThreads.load() > 0; }
+
+private:
+    const ConfigStore& configStore;
+    PatientStudySourceFactory& sourceFactory;
+    JobNotifier& notifier;
+    JobWorkerOptions options;
+    std::string ownerPrefix; // host:pid
+    OutputIndex outputIndex;
+    AsyncWriter writer;
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping;
+    std::atomic<int> activeThreads;
+
+    void run(size_t index);
+};
+
+#endif // JOBWORKER_H
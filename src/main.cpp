@@ -4,12 +4,31 @@
 #include <limits> // Required for std::numeric_limits
 #include <fstream> // Required for std::ifstream
 
-#include "db_connector/DatabaseService.h"
+#include "batch/BatchRunner.h"
+#include "data_source/PatientStudySourceFactory.h"
 #include "hl7_generator/HL7MessageGenerator.h"
 #include "models/Patient.h"
 #include "models/Study.h"
 #include "ui/ConsoleUI.h"
 #include "config_manager/ConfigManager.h" // Include the new ConfigManager
+#include "config_manager/ConfigSnapshot.h"
+#include "config_manager/ConfigWatcher.h"
+#include "http_server/HttpServer.h"
+#include "http_server/CdaRequestHandler.h"
+#include "job_queue/JobNotifier.h"
+#include "job_queue/JobWorker.h"
+#include "metrics/Metrics.h"
+#include "metrics/MetricsExporter.h"
+#include "output/DocumentCompressor.h"
+#include "output/OutputIndex.h"
+#include "output/OutputLayout.h"
+#include "tracing/Tracer.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <chrono>
 
 #include <sys/stat.h> // For mkdir (Linux/macOS)
 #include <cerrno>     // For errno
@@ -42,6 +61,261 @@ bool createDirectoryIfNotExists(const std::string& path) {
     }
 }
 
+namespace {
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+std::string outputIndexPath(const AppConfig& config) {
+    return !config.outputIndexPath.empty() ? config.outputIndexPath : OutputLayout::join(config.outputPath, "index.tsv");
+}
+
+AsyncWriterOptions writerOptions(const AppConfig& config) {
+    AsyncWriterOptions options;
+    options.threads = static_cast<unsigned>(config.writerThreads);
+    options.queueCapacity = static_cast<size_t>(config.writerQueueCapacity);
+    options.groupSize = static_cast<size_t>(config.writerGroupSize);
+    options.syncIntervalMs = config.writerSyncIntervalMs;
+    options.maxOpenFiles = static_cast<size_t>(config.writerMaxOpenFiles);
+    return options;
+}
+
+CompressionOptions compressionOptions(const AppConfig& config) {
+    CompressionOptions options;
+    options.format = config.compressionFormat;
+    options.level = config.compressionLevel;
+    options.dictionaryPath = config.compressionDictionaryPath;
+    return options;
+}
+
+} // namespace
+
+// Server mode: answers CDA requests over HTTP until SIGINT/SIGTERM. Each worker opens
+// its own data source (database connection), so the interactive one is not used here.
+int runServer(const std::string& configFilePath, ConfigManager& configManager, int port) {
+    const AppConfig& config = configManager.getConfig();
+
+    ConfigStore configStore(configManager.createSnapshot(1));
+    ConfigWatcher configWatcher(configFilePath, configStore, config.configReloadIntervalMs);
+    configWatcher.start();
+
+    HttpServerOptions options;
+    options.bindAddress = config.serverBindAddress;
+    options.port = port;
+    options.workers = static_cast<size_t>(config.serverWorkers);
+    options.maxInFlight = static_cast<size_t>(config.serverMaxInFlight);
+    options.keepAliveTimeoutMs = config.serverKeepAliveTimeoutMs;
+
+    PatientStudySourceFactory sourceFactory(config);
+    std::cout << "Workers read from " << sourceFactory.describe() << std::endl;
+    CdaRequestHandler requestHandler(configStore, sourceFactory, options.workers, static_cast<size_t>(config.serverMaxBatchSize));
+    HttpServer server(options, [&requestHandler](const HttpRequest& request, size_t workerIndex) {
+        return requestHandler.handle(request, workerIndex);
+    });
+    requestHandler.setServer(&server);
+
+    std::signal(SIGPIPE, SIG_IGN); // A client hanging up must not kill the process
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+
+    if (!server.start()) {
+        configWatcher.stop();
+        HL7MessageGenerator::terminateXerces();
+        return 1;
+    }
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    std::cout << "Shutting down HTTP server..." << std::endl;
+    server.stop();
+
+    // Release validators before Xerces goes away
+    requestHandler.shutdown();
+    configWatcher.stop();
+    HL7MessageGenerator::terminateXerces();
+    return 0;
+}
+
+// Worker mode: drains cda_jobs (db/cda_jobs.sql) until SIGINT/SIGTERM, or with --drain
+// until no job can be claimed. Run any number of these against the same database.
+int runWorker(const std::string& configFilePath, ConfigManager& configManager, bool drain, bool force) {
+    const AppConfig& config = configManager.getConfig();
+
+    ConfigStore configStore(configManager.createSnapshot(1));
+    ConfigWatcher configWatcher(configFilePath, configStore, config.configReloadIntervalMs);
+    configWatcher.start();
+
+    PatientStudySourceFactory sourceFactory(config);
+    JobNotifier notifier(config.jobListenConnInfo, config.jobPollIntervalMs);
+    notifier.start();
+
+    JobWorkerOptions options;
+    options.odbcDsn = config.odbcDsn;
+    options.dbUser = config.dbUser;
+    options.dbPassword = config.dbPassword;
+    options.threads = config.jobWorkers;
+    options.batchSize = config.jobBatchSize;
+    options.leaseSeconds = config.jobLeaseSeconds;
+    options.retryBackoffSeconds = config.jobRetryBackoffSeconds;
+    options.drain = drain;
+    options.force = force;
+    options.writerOptions = writerOptions(config);
+    options.compression = compressionOptions(config);
+    options.indexPath = outputIndexPath(config);
+
+    // Every thread opens its own compressor; refuse to start rather than have each one give up
+    DocumentCompressor compressionCheck(options.compression);
+    if (!compressionCheck.open()) {
+        notifier.stop();
+        configWatcher.stop();
+        HL7MessageGenerator::terminateXerces();
+        return 1;
+    }
+
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+
+    std::cout << "Job worker: " << options.threads << " threads reading from " << sourceFactory.describe()
+              << (drain ? ", exiting when the queue is empty." : ".") << std::endl;
+    JobWorker worker(configStore, sourceFactory, notifier, options);
+    worker.start();
+    while (!stopRequested && worker.running()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    if (stopRequested) {
+        std::cout << "Stopping job worker after the jobs in hand..." << std::endl;
+    }
+    worker.stop();
+    notifier.stop(); // Wakes idle threads
+    worker.join();
+
+    configWatcher.stop();
+    HL7MessageGenerator::terminateXerces();
+    return 0;
+}
+
+// Batch mode: generates every study of the data source into the output path once, journaling
+// completed studies so that an interrupted run continues where it stopped with --resume.
+int runBatch(const std::string& configFilePath, ConfigManager& configManager, bool resume, bool force, const std::string& journalPath) {
+    const AppConfig& config = configManager.getConfig();
+
+    ConfigStore configStore(configManager.createSnapshot(1));
+    ConfigWatcher configWatcher(configFilePath, configStore, config.configReloadIntervalMs);
+    configWatcher.start();
+
+    PatientStudySourceFactory sourceFactory(config);
+    std::cout << "Batch run reading from " << sourceFactory.describe() << std::endl;
+    std::unique_ptr<PatientStudySource> source = sourceFactory.create();
+    if (!source) {
+        std::cerr << "FATAL: Failed to open the data source." << std::endl;
+        configWatcher.stop();
+        HL7MessageGenerator::terminateXerces();
+        return 1;
+    }
+
+    BatchOptions options;
+    options.journalPath = !journalPath.empty() ? journalPath
+                        : !config.batchJournalPath.empty() ? config.batchJournalPath
+                        : config.outputPath + "/.checkpoint";
+    options.indexPath = outputIndexPath(config);
+    options.resume = resume;
+    options.force = force;
+    options.journalGroupSize = static_cast<size_t>(config.batchJournalGroupSize);
+    options.journalSyncIntervalMs = config.batchJournalSyncIntervalMs;
+    options.writerOptions = writerOptions(config);
+    options.segments = config.batchSink == "segments";
+    options.segmentOptions.directory = !config.batchSegmentDirectory.empty() ? config.batchSegmentDirectory
+                                     : OutputLayout::join(config.outputPath, "segments");
+    options.segmentOptions.segmentBytes = static_cast<std::uint64_t>(config.batchSegmentSizeMB) << 20;
+    options.segmentOptions.compress = config.batchSegmentCompress;
+    options.compression = compressionOptions(config);
+    options.bundleSize = static_cast<size_t>(config.compressionBundleSize);
+
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+
+    BatchSummary summary;
+    BatchRunner runner(configStore, *source, options);
+    bool completed = runner.run(summary, [] { return stopRequested != 0; });
+    if (completed) {
+        summary.print(std::cout);
+        if (summary.interrupted) {
+            std::cout << "Run again with --resume to continue." << std::endl;
+        }
+    }
+
+    configWatcher.stop();
+    HL7MessageGenerator::terminateXerces();
+    return completed && summary.failed == 0 && summary.journalFailures == 0 && !summary.interrupted ? 0 : 1;
+}
+
+// Dictionary mode: generates <Compression><DictionarySamples> documents from the data source
+// and trains a zstd dictionary on them for <Compression><DictionaryPath>. Retrain when the
+// templates or profiles change; documents compressed with a dictionary need it to be read.
+int runTrainDictionary(ConfigManager& configManager, const std::string& dictionaryPath) {
+    const AppConfig& config = configManager.getConfig();
+    if (!DocumentCompressor::zstdAvailable()) {
+        std::cerr << "Error: This build has no zstd support, so it cannot train dictionaries." << std::endl;
+        return 1;
+    }
+    PatientStudySourceFactory sourceFactory(config);
+    std::unique_ptr<PatientStudySource> source = sourceFactory.create();
+    if (!source) {
+        std::cerr << "FATAL: Failed to open the data source." << std::endl;
+        return 1;
+    }
+
+    ConfigStore configStore(configManager.createSnapshot(1));
+    HL7MessageGenerator generator(configStore);
+    const size_t wanted = static_cast<size_t>(config.compressionDictionarySamples);
+    std::vector<std::string> samples;
+    for (const Patient& patient : source->getAllPatients()) {
+        for (const Study& study : source->getStudiesForPatient(patient.patientID)) {
+            if (samples.size() >= wanted) {
+                break;
+            }
+            std::string document = generator.generateORUMessage(patient, study);
+            if (!document.empty()) {
+                samples.push_back(std::move(document));
+            }
+        }
+        if (samples.size() >= wanted) {
+            break;
+        }
+    }
+    std::cout << "Training a dictionary on " << samples.size() << " documents from " << sourceFactory.describe() << std::endl;
+
+    std::string dictionary;
+    if (!DocumentCompressor::trainDictionary(samples, static_cast<size_t>(config.compressionDictionarySizeKB) * 1024, dictionary)) {
+        return 1;
+    }
+    std::ofstream out(dictionaryPath, std::ios::binary | std::ios::trunc);
+    out.write(dictionary.data(), static_cast<std::streamsize>(dictionary.size()));
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Cannot write dictionary " << dictionaryPath << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote a " << dictionary.size() << " byte dictionary to " << dictionaryPath << std::endl;
+    return 0;
+}
+
+// Lookup mode: prints the document written for a study, found through the output index
+int runLookup(const AppConfig& config, const std::string& studyUid) {
+    OutputIndex index(outputIndexPath(config));
+    std::string relativePath;
+    if (!index.open() || !index.lookup(studyUid, relativePath)) {
+        std::cerr << "No document indexed for study " << studyUid << "." << std::endl;
+        return 1;
+    }
+    std::cout << OutputLayout::join(config.outputPath, relativePath) << std::endl;
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     std::cout << "HL7 Generation Application Starting..." << std::endl;
 
@@ -58,9 +332,50 @@ int main(int argc, char *argv[]) {
     // Construct the path to the config file relative to the executable's directory
     std::string configFilePath = "config/hl7_config.xml"; // Default config file path relative to build directory
 
-    // Override with command line argument if provided
-    if (argc > 1) { // Allow overriding config file path via command line argument
-        configFilePath = argv[1];
+    // Usage: HL7Generator [--server [PORT] | --worker [--drain] [--force] | --batch [--resume] [--force] [--journal FILE]
+    //                      | --lookup STUDY_UID | --train-dictionary FILE] [--trace FILE] [config file]
+    bool serverMode = false;
+    bool workerMode = false;
+    bool drainJobs = false;
+    bool batchMode = false;
+    bool resumeBatch = false;
+    bool forceRegenerate = false; // Ignore unchanged input hashes in the output index
+    std::string journalPath; // Empty: <Batch><JournalPath>
+    std::string traceFilePath;
+    std::string lookupStudyUid;
+    std::string dictionaryPath;
+    int serverPort = 0; // 0: take <Server><Port> from the config
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--server") {
+            serverMode = true;
+            if (i + 1 < argc && std::strspn(argv[i + 1], "0123456789") == std::strlen(argv[i + 1])) {
+                serverPort = std::atoi(argv[++i]);
+            }
+        } else if (arg == "--worker") {
+            workerMode = true;
+        } else if (arg == "--drain") {
+            drainJobs = true;
+        } else if (arg == "--batch") {
+            batchMode = true;
+        } else if (arg == "--resume") {
+            resumeBatch = true;
+        } else if (arg == "--force") {
+            forceRegenerate = true;
+        } else if (arg == "--journal" && i + 1 < argc) {
+            journalPath = argv[++i];
+        } else if (arg == "--lookup" && i + 1 < argc) {
+            lookupStudyUid = argv[++i];
+        } else if (arg == "--train-dictionary" && i + 1 < argc) {
+            dictionaryPath = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceFilePath = argv[++i];
+        } else {
+            configFilePath = arg; // Allow overriding config file path via command line argument
+        }
+    }
+    if (!traceFilePath.empty() && Tracer::enable()) {
+        HL7_TRACE_THREAD_NAME("main");
     }
     std::cout << "Using default configuration file: " << configFilePath << std::endl;
     std::ifstream configFile(configFilePath);
@@ -77,6 +392,16 @@ int main(int argc, char *argv[]) {
     const AppConfig& config = configManager.getConfig();
 
     std::cout << "Configuration loaded. Output path: " << config.outputPath << std::endl;
+    if (!lookupStudyUid.empty()) {
+        int result = runLookup(config, lookupStudyUid);
+        HL7MessageGenerator::terminateXerces();
+        return result;
+    }
+    if (!dictionaryPath.empty()) {
+        int result = runTrainDictionary(configManager, dictionaryPath);
+        HL7MessageGenerator::terminateXerces();
+        return result;
+    }
 
     // Create output directory if it doesn't exist
     if (!config.outputPath.empty()) {
@@ -87,18 +412,53 @@ int main(int argc, char *argv[]) {
         std::cout << "Warning: Output path is not configured. Messages will not be saved to file unless a path is provided interactively or set in config." << std::endl;
     }
 
-    // 1. Initialize DatabaseService
-    DatabaseService dbService;
-    std::cout << "Attempting to connect to DSN: " << config.odbcDsn << std::endl;
-    if (!dbService.connect(config.odbcDsn, config.dbUser, config.dbPassword)) { 
-        std::cerr << "FATAL: Failed to connect to database. Please check DSN configuration and credentials in '" << configFilePath << "'." << std::endl;
-        std::cerr << "Ensure DSN '" << config.odbcDsn << "' is correctly set up in your ODBC administrator." << std::endl;
+    MetricsExporter metricsExporter(config.metricsFilePath, config.metricsExportIntervalMs);
+    metricsExporter.start();
+
+    if (serverMode || workerMode || batchMode) {
+        int result = serverMode ? runServer(configFilePath, configManager, serverPort > 0 ? serverPort : config.serverPort)
+                   : workerMode ? runWorker(configFilePath, configManager, drainJobs, forceRegenerate)
+                                : runBatch(configFilePath, configManager, resumeBatch, forceRegenerate, journalPath);
+        metricsExporter.stop();
+        Metrics::instance().printSummary(std::cout);
+        if (Tracer::enabled()) {
+            Tracer::writeChromeTrace(traceFilePath);
+        }
+        std::cout << "HL7 Generation Application Ended." << std::endl;
+        return result;
+    }
+
+    // 1. Open the patient/study source (the ODBC database unless <DataSource> says otherwise)
+    PatientStudySourceFactory sourceFactory(config);
+    std::cout << "Opening data source: " << sourceFactory.describe() << std::endl;
+    std::unique_ptr<PatientStudySource> dataSource = sourceFactory.create();
+    if (!dataSource) {
+        if (config.dataSourceType == "memory") {
+            std::cerr << "FATAL: Failed to load the patient/study snapshot '" << config.dataSnapshotPath << "'." << std::endl;
+        } else {
+            std::cerr << "FATAL: Failed to connect to database. Please check DSN configuration and credentials in '" << configFilePath << "'." << std::endl;
+            std::cerr << "Ensure DSN '" << config.odbcDsn << "' is correctly set up in your ODBC administrator." << std::endl;
+        }
         return 1;
     }
-    std::cout << "Successfully connected to the database." << std::endl;
+    std::cout << "Data source ready." << std::endl;
 
     // 2. Initialize UI
-    ConsoleUI ui(dbService);
+    ConsoleUI ui(*dataSource);
+
+    // 3. Publish the loaded config as the first snapshot and watch the file for changes.
+    // Edits are picked up by the next generated message without a restart.
+    ConfigStore configStore(configManager.createSnapshot(1));
+    ConfigWatcher configWatcher(configFilePath, configStore, config.configReloadIntervalMs);
+    configWatcher.start();
+
+    // 4. Initialize HL7MessageGenerator. It lives for the whole session so the
+    // compiled XSD grammar is reused across generated messages.
+    HL7MessageGenerator hl7Generator(configStore);
+    OutputIndex outputIndex(outputIndexPath(config));
+    if (!config.outputPath.empty() && !outputIndex.open()) {
+        std::cerr << "Warning: Saved messages will not be added to the output index." << std::endl;
+    }
     Patient selectedPatient;
     Study selectedStudy;
 
@@ -158,26 +518,33 @@ int main(int argc, char *argv[]) {
                 break;
             case 2: // Generate HL7 Message
                 if (patientSelected && studySelected) {
-                    // 3. Initialize HL7MessageGenerator with loaded config
-                    HL7MessageGenerator hl7Generator(config); // Pass the AppConfig object
-
                     std::cout << "Generating HL7 message for " << selectedPatient.name << ", Study: " << selectedStudy.studyDescription << std::endl;
-                    std::string hl7Message = hl7Generator.generateORUMessage(selectedPatient, selectedStudy);
+
+                    // 5. Generate and validate in one pass: the document is validated while it is serialized
+                    std::string hl7Message;
+                    std::unique_ptr<StudyContentReader> content = dataSource->openStudyContent(selectedStudy.studyInstanceUID);
+                    bool isValid = hl7Generator.generateAndValidate(selectedPatient, selectedStudy, hl7Message, content.get());
 
                     if (!hl7Message.empty()) {
                         std::cout << "\n--- Generated HL7 Message ---" << std::endl;
                         std::cout << hl7Message << std::endl;
                         std::cout << "--- End of HL7 Message ---\n" << std::endl;
 
-                        // 4. Validate the generated message
-                        std::cout << "Validating generated HL7 message..." << std::endl;
-                        if (hl7Generator.validateMessageWithXSD(hl7Message)) {
+                        if (isValid) {
                             std::cout << "HL7 message validated successfully against XSD." << std::endl;
 
-                            // 5. Save to file
-                            if (!config.outputPath.empty()) {
-                                std::string filename = config.outputPath + "/ORU_" + selectedPatient.patientID + "_" + selectedStudy.accessionNumber + "_" + hl7Generator.getCurrentTimestamp("%Y%m%d%H%M%S") + ".xml";
-                                if (hl7Generator.saveMessageToFile(hl7Message, filename)) {
+                            // 6. Save to file, using the output path from the current config
+                            std::shared_ptr<const ConfigSnapshot> snapshot = configStore.current();
+                            const std::string& outputPath = snapshot->config.outputPath;
+                            if (!outputPath.empty()) {
+                                createDirectoryIfNotExists(outputPath); // A reload may have pointed it somewhere new
+                                // Flat names keep every generated message; the sharded schemes hold one per study
+                                std::string relativePath = snapshot->config.outputScheme == "flat"
+                                    ? "ORU_" + selectedPatient.patientID + "_" + selectedStudy.accessionNumber + "_" + hl7Generator.getCurrentTimestamp("%Y%m%d%H%M%S") + ".xml"
+                                    : OutputLayout(snapshot->config.outputScheme, snapshot->config.outputHashLevels).relativePath(selectedPatient, selectedStudy);
+                                std::string filename = OutputLayout::join(outputPath, relativePath);
+                                if (OutputLayout::createParentDirectories(outputPath, relativePath) && hl7Generator.saveMessageToFile(hl7Message, filename)) {
+                                    outputIndex.record(selectedStudy.studyInstanceUID, relativePath);
                                     std::cout << "Message saved to " << filename << std::endl;
                                 } else {
                                     std::cerr << "Failed to save message to file." << std::endl;
@@ -204,12 +571,22 @@ int main(int argc, char *argv[]) {
     }
 
     // Cleanup
-    dbService.disconnect();
-    std::cout << "Disconnected from database." << std::endl;
+    outputIndex.close();
+    configWatcher.stop();
+    dataSource.reset(); // Disconnects from the database
+
+    // Release the Xerces-C++ reader and grammar pool before the platform goes away
+    hl7Generator.finishValidation();
 
     // Terminate Xerces-C++
     HL7MessageGenerator::terminateXerces();
 
+    metricsExporter.stop();
+    Metrics::instance().printSummary(std::cout);
+    if (Tracer::enabled()) {
+        Tracer::writeChromeTrace(traceFilePath);
+    }
+
     std::cout << "HL7 Generation Application Ended." << std::endl;
     return 0;
 }
@@ -0,0 +1,140 @@
+#include "Histogram.h"
+#include <sstream>
+#include <iomanip>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+unsigned highestBit(std::uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+std::atomic<unsigned> nextShard(0);
+
+} // namespace
+
+unsigned metricShardIndex() {
+    thread_local unsigned shard = nextShard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+Histogram::Histogram() {
+    for (Shard& shard : shards) {
+        for (auto& count : shard.counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        shard.sum.store(0, std::memory_order_relaxed);
+        shard.max.store(0, std::memory_order_relaxed);
+    }
+}
+
+unsigned Histogram::bucketIndex(std::uint64_t nanos) {
+    if (nanos < SUB_BUCKETS) {
+        return static_cast<unsigned>(nanos);
+    }
+    unsigned magnitude = highestBit(nanos);
+    if (magnitude >= MAX_MAGNITUDE) {
+        return BUCKETS - 1;
+    }
+    unsigned shift = magnitude - SUB_BUCKET_BITS;
+    return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<unsigned>((nanos >> shift) & (SUB_BUCKETS - 1));
+}
+
+std::uint64_t Histogram::bucketUpperBound(unsigned index) {
+    if (index < SUB_BUCKETS) {
+        return index + 1;
+    }
+    unsigned shift = index / SUB_BUCKETS - 1;
+    std::uint64_t sub = SUB_BUCKETS + index % SUB_BUCKETS;
+    return (sub + 1) << shift;
+}
+
+void Histogram::record(std::uint64_t nanos) {
+    Shard& shard = shards[metricShardIndex()];
+    shard.counts[bucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(nanos, std::memory_order_relaxed);
+    std::uint64_t seen = shard.max.load(std::memory_order_relaxed);
+    while (nanos > seen && !shard.max.compare_exchange_weak(seen, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Summary Histogram::summarize() const {
+    Summary summary;
+    summary.counts.assign(BUCKETS, 0);
+    for (const Shard& shard : shards) {
+        for (unsigned i = 0; i < BUCKETS; ++i) {
+            summary.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        summary.sumNanos += shard.sum.load(std::memory_order_relaxed);
+        std::uint64_t max = shard.max.load(std::memory_order_relaxed);
+        if (max > summary.maxNanos) summary.maxNanos = max;
+    }
+    for (std::uint64_t n : summary.counts) {
+        summary.count += n;
+    }
+    return summary;
+}
+
+double Histogram::Summary::meanNanos() const {
+    return count == 0 ? 0.0 : static_cast<double>(sumNanos) / static_cast<double>(count);
+}
+
+std::uint64_t Histogram::Summary::percentileNanos(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(count) + 0.5);
+    if (rank < 1) rank = 1;
+    std::uint64_t seen = 0;
+    for (unsigned i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            std::uint64_t bound = bucketUpperBound(i) - 1;
+            return bound < maxNanos ? bound : maxNanos;
+        }
+    }
+    return maxNanos;
+}
+
+std::uint64_t Histogram::Summary::countAtOrBelow(std::uint64_t nanos) const {
+    std::uint64_t total = 0;
+    for (unsigned i = 0; i < counts.size() && bucketUpperBound(i) - 1 <= nanos; ++i) {
+        total += counts[i];
+    }
+    return total;
+}
+
+void Histogram::printSummary(std::ostream& out, const std::string& label) const {
+    Summary summary = summarize();
+    if (summary.count == 0) {
+        return;
+    }
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3);
+    line << label << ": " << summary.count << " samples, mean " << summary.meanNanos() / 1e6
+         << " ms, p50 " << summary.percentileNanos(50) / 1e6
+         << " ms, p90 " << summary.percentileNanos(90) / 1e6
+         << " ms, p99 " << summary.percentileNanos(99) / 1e6
+         << " ms, max " << summary.maxNanos / 1e6 << " ms";
+    out << line.str() << std::endl;
+}
+
+std::string Histogram::toJson() const {
+    Summary summary = summarize();
+    std::ostringstream json;
+    json << "{\"count\":" << summary.count
+         << ",\"meanUs\":" << static_cast<std::uint64_t>(summary.meanNanos() / 1000)
+         << ",\"p50Us\":" << summary.percentileNanos(50) / 1000
+         << ",\"p90Us\":" << summary.percentileNanos(90) / 1000
+         << ",\"p99Us\":" << summary.percentileNanos(99) / 1000
+         << ",\"maxUs\":" << summary.maxNanos / 1000 << "}";
+    return json.str();
+}
@@ -0,0 +1,64 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+// Number of write shards for counters and histograms. Each thread writes to one shard
+// (assigned round-robin on first use), so concurrent threads do not share cache lines;
+// readers sum all shards.
+const unsigned METRIC_SHARDS = 8;
+unsigned metricShardIndex();
+
+// HDR-style latency histogram in nanoseconds: 16 linear sub-buckets per power of two,
+// so any recorded value is reported within 6.25% of its true value, from 1 ns up to
+// about 73 minutes (larger values land in the last bucket). Recording is lock-free:
+// one relaxed atomic add on the calling thread's shard.
+class Histogram {
+public:
+    static const unsigned SUB_BUCKET_BITS = 4;
+    static const unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static const unsigned MAX_MAGNITUDE = 42; // Values up to 2^42 ns
+    static const unsigned BUCKETS = (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Merged view of all shards at one point in time
+    struct Summary {
+        std::vector<std::uint64_t> counts; // Per bucket
+        std::uint64_t count = 0;
+        std::uint64_t sumNanos = 0;
+        std::uint64_t maxNanos = 0;
+
+        double meanNanos() const;
+        // Highest value equivalent to the given percentile (0-100), at most maxNanos
+        std::uint64_t percentileNanos(double percentile) const;
+        // Number of samples <= the given value (bucket resolution)
+        std::uint64_t countAtOrBelow(std::uint64_t nanos) const;
+    };
+
+    Histogram();
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void record(std::uint64_t nanos);
+    Summary summarize() const;
+
+    // One line: count, mean, p50/p90/p99 and max in milliseconds. Prints nothing when empty.
+    void printSummary(std::ostream& out, const std::string& label) const;
+    std::string toJson() const; // Microseconds
+
+    static unsigned bucketIndex(std::uint64_t nanos);
+    static std::uint64_t bucketUpperBound(unsigned index); // Exclusive
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> counts[BUCKETS];
+        std::atomic<std::uint64_t> sum;
+        std::atomic<std::uint64_t> max;
+    };
+    Shard shards[METRIC_SHARDS];
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,207 @@
+#include "Metrics.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+
+namespace {
+
+struct HistogramEntry {
+    const char* name;
+    const char* help;
+    const Histogram Metrics::* histogram;
+};
+
+struct CounterEntry {
+    const char* name;
+    const char* help;
+    const Counter Metrics::* counter;
+};
+
+struct GaugeEntry {
+    const char* name;
+    const char* help;
+    const Gauge Metrics::* gauge;
+};
+
+const HistogramEntry HISTOGRAMS[] = {
+    {"hl7_db_query_seconds", "DatabaseService query latency", &Metrics::dbQuery},
+    {"hl7_dicom_load_seconds", "DICOM file load latency", &Metrics::dicomLoad},
+    {"hl7_xml_render_seconds", "CDA tree build latency", &Metrics::xmlRender},
+    {"hl7_xsd_validation_seconds", "Validation and serialization latency", &Metrics::xsdValidation},
+    {"hl7_file_write_seconds", "Document file write latency", &Metrics::fileWrite},
+    {"hl7_output_commit_seconds", "Async writer group commit latency", &Metrics::outputCommit},
+    {"hl7_compression_seconds", "Output compression latency per document", &Metrics::compression},
+    {"hl7_http_request_seconds", "HTTP request latency", &Metrics::httpRequest},
+    {"hl7_key_image_encode_seconds", "Key image render and encode latency", &Metrics::keyImageEncode},
+    {"hl7_count_analysis_seconds", "Count analysis latency per frame", &Metrics::countAnalysis},
+    {"hl7_time_activity_seconds", "Time-activity curve latency per dynamic image", &Metrics::timeActivity},
+};
+
+const CounterEntry COUNTERS[] = {
+    {"hl7_documents_generated_total", "Documents generated and validated", &Metrics::documentsGenerated},
+    {"hl7_documents_invalid_total", "Documents that failed validation", &Metrics::documentsInvalid},
+    {"hl7_documents_unchanged_total", "Documents skipped because their inputs had not changed", &Metrics::documentsUnchanged},
+    {"hl7_files_written_total", "Documents written to disk", &Metrics::filesWritten},
+    {"hl7_bytes_written_total", "Bytes written to disk", &Metrics::bytesWritten},
+    {"hl7_compression_input_bytes_total", "Document bytes compressed for output", &Metrics::compressionInputBytes},
+    {"hl7_compression_output_bytes_total", "Compressed bytes produced for output", &Metrics::compressionOutputBytes},
+    {"hl7_fast_check_failures_total", "Documents rejected by the fast structural check", &Metrics::fastCheckFailures},
+    {"hl7_full_validations_total", "Full XSD validations run", &Metrics::fullValidations},
+    {"hl7_entries_written_total", "Instance observations streamed into report sections", &Metrics::entriesWritten},
+    {"hl7_key_images_embedded_total", "Key images embedded as observationMedia", &Metrics::keyImagesEmbedded},
+    {"hl7_key_image_bytes_total", "PNG bytes embedded as key images", &Metrics::keyImageBytes},
+    {"hl7_frames_analysed_total", "Frames with count analysis observations", &Metrics::framesAnalysed},
+    {"hl7_grammar_cache_hits_total", "Compiled grammar loaded from the cache file", &Metrics::grammarCacheHits},
+    {"hl7_grammar_cache_misses_total", "Compiled grammar built from the XSD files", &Metrics::grammarCacheMisses},
+    {"hl7_config_reloads_total", "Configuration reloads published", &Metrics::configReloads},
+    {"hl7_config_reload_failures_total", "Configuration reloads rejected", &Metrics::configReloadFailures},
+    {"hl7_http_rejected_total", "HTTP requests answered with 503", &Metrics::httpRejected},
+    {"hl7_jobs_claimed_total", "Jobs claimed from cda_jobs", &Metrics::jobsClaimed},
+    {"hl7_jobs_completed_total", "Jobs completed", &Metrics::jobsCompleted},
+    {"hl7_jobs_failed_total", "Job attempts that failed", &Metrics::jobsFailed},
+    {"hl7_job_leases_lost_total", "Jobs finished after their lease had expired", &Metrics::jobLeasesLost},
+    {"hl7_job_leases_expired_total", "Expired job leases reclaimed", &Metrics::jobLeasesExpired},
+};
+
+const GaugeEntry GAUGES[] = {
+    {"hl7_http_queue_depth", "Connections waiting for a server worker", &Metrics::httpQueueDepth},
+    {"hl7_http_in_flight", "HTTP requests queued or executing", &Metrics::httpInFlight},
+};
+
+// Bucket bounds exported to Prometheus, in seconds
+const double EXPORTED_BOUNDS[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+} // namespace
+
+Counter::Counter() {
+    for (Shard& shard : shards) {
+        shard.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t Counter::value() const {
+    std::uint64_t total = 0;
+    for (const Shard& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Gauge::add(std::int64_t delta) {
+    std::int64_t now = current.fetch_add(delta, std::memory_order_relaxed) + delta;
+    std::int64_t seen = peak.load(std::memory_order_relaxed);
+    while (now > seen && !peak.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {
+    }
+}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+std::string Metrics::prometheusText() const {
+    std::ostringstream out;
+    out.precision(12); // Sums in seconds keep microsecond resolution
+    for (const HistogramEntry& entry : HISTOGRAMS) {
+        Histogram::Summary summary = (this->*entry.histogram).summarize();
+        out << "# HELP " << entry.name << ' ' << entry.help << '\n';
+        out << "# TYPE " << entry.name << " histogram\n";
+        for (double bound : EXPORTED_BOUNDS) {
+            out << entry.name << "_bucket{le=\"" << bound << "\"} "
+                << summary.countAtOrBelow(static_cast<std::uint64_t>(bound * 1e9)) << '\n';
+        }
+        out << entry.name << "_bucket{le=\"+Inf\"} " << summary.count << '\n';
+        out << entry.name << "_sum " << static_cast<double>(summary.sumNanos) / 1e9 << '\n';
+        out << entry.name << "_count " << summary.count << '\n';
+    }
+    for (const CounterEntry& entry : COUNTERS) {
+        out << "# HELP " << entry.name << ' ' << entry.help << '\n';
+        out << "# TYPE " << entry.name << " counter\n";
+        out << entry.name << ' ' << (this->*entry.counter).value() << '\n';
+    }
+    for (const GaugeEntry& entry : GAUGES) {
+        const Gauge& gauge = this->*entry.gauge;
+        out << "# HELP " << entry.name << ' ' << entry.help << '\n';
+        out << "# TYPE " << entry.name << " gauge\n";
+        out << entry.name << ' ' << gauge.value() << '\n';
+        out << "# TYPE " << entry.name << "_peak gauge\n";
+        out << entry.name << "_peak " << gauge.peakValue() << '\n';
+    }
+    return out.str();
+}
+
+bool Metrics::writePrometheusFile(const std::string& path) const {
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Warning: Could not write metrics file: " << tmpPath << std::endl;
+            return false;
+        }
+        out << prometheusText();
+        if (!out.good()) {
+            std::cerr << "Warning: Could not write metrics file: " << tmpPath << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Warning: Could not replace metrics file: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void Metrics::printSummary(std::ostream& out) const {
+    out << "--- Metrics summary ---" << std::endl;
+    dbQuery.printSummary(out, " DB query");
+    dicomLoad.printSummary(out, " DICOM load");
+    xmlRender.printSummary(out, " XML render");
+    xsdValidation.printSummary(out, " Validation");
+    fileWrite.printSummary(out, " File write");
+    outputCommit.printSummary(out, " Group commit");
+    compression.printSummary(out, " Compression");
+    httpRequest.printSummary(out, " HTTP request");
+    keyImageEncode.printSummary(out, " Key image");
+    countAnalysis.printSummary(out, " Count analysis");
+    timeActivity.printSummary(out, " Time-activity");
+    out << " Documents: " << documentsGenerated.value() << " generated, " << documentsInvalid.value() << " invalid, "
+        << filesWritten.value() << " written (" << bytesWritten.value() << " bytes)";
+    if (documentsUnchanged.value() > 0) {
+        out << ", " << documentsUnchanged.value() << " unchanged";
+    }
+    if (entriesWritten.value() > 0) {
+        out << ", " << entriesWritten.value() << " instance entries";
+    }
+    if (keyImagesEmbedded.value() > 0) {
+        out << ", " << keyImagesEmbedded.value() << " key images (" << keyImageBytes.value() << " PNG bytes)";
+    }
+    if (framesAnalysed.value() > 0) {
+        out << ", " << framesAnalysed.value() << " frames counted";
+    }
+    out << std::endl;
+    if (compressionOutputBytes.value() > 0) {
+        double seconds = compression.summarize().sumNanos / 1e9;
+        out << " Compression: " << compressionInputBytes.value() << " -> " << compressionOutputBytes.value() << " bytes (ratio "
+            << static_cast<double>(compressionInputBytes.value()) / compressionOutputBytes.value();
+        if (seconds > 0) {
+            out << ", " << compressionInputBytes.value() / (1024.0 * 1024.0) / seconds << " MB/s";
+        }
+        out << ")" << std::endl;
+    }
+    out << " Validation: " << fullValidations.value() << " full XSD runs, " << fastCheckFailures.value()
+        << " fast check failures; grammar cache " << grammarCacheHits.value() << " hits, "
+        << grammarCacheMisses.value() << " misses" << std::endl;
+    if (configReloads.value() + configReloadFailures.value() > 0) {
+        out << " Config reloads: " << configReloads.value() << " published, " << configReloadFailures.value() << " rejected" << std::endl;
+    }
+    if (httpRequest.summarize().count > 0) {
+        out << " HTTP: " << httpRejected.value() << " rejected, peak queue depth " << httpQueueDepth.peakValue()
+            << ", peak in flight " << httpInFlight.peakValue() << std::endl;
+    }
+    if (jobsClaimed.value() > 0) {
+        out << " Jobs: " << jobsClaimed.value() << " claimed, " << jobsCompleted.value() << " completed, " << jobsFailed.value()
+            << " failed attempts, " << jobLeasesLost.value() << " leases lost, " << jobLeasesExpired.value() << " expired leases reclaimed" << std::endl;
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include "Histogram.h"
+
+// Monotonic counter, sharded per thread like Histogram
+class Counter {
+public:
+    Counter();
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void add(std::uint64_t n = 1) { shards[metricShardIndex()].value.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value;
+    };
+    Shard shards[METRIC_SHARDS];
+};
+
+// Current level of something (e.g. a queue depth) and the highest level seen
+class Gauge {
+public:
+    Gauge() : current(0), peak(0) {}
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void add(std::int64_t delta);
+    std::int64_t value() const { return current.load(std::memory_order_relaxed); }
+    std::int64_t peakValue() const { return peak.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> current;
+    std::atomic<std::int64_t> peak;
+};
+
+// Process-wide metrics, one fixed member per instrumented stage so the hot path is a
+// plain member access. Exposed as Prometheus text (MetricsExporter, GET /metrics) and
+// as a summary printed at exit.
+class Metrics {
+public:
+    static Metrics& instance();
+
+    // Stage latencies
+    Histogram dbQuery;        // One DatabaseService query, including fetching the rows
+    Histogram dicomLoad;      // Reading and parsing one DICOM file
+    Histogram xmlRender;      // Building the CDA tree
+    Histogram xsdValidation;  // Fast check plus (sampled) XSD validation, including serialization
+    Histogram fileWrite;      // Writing one document to disk
+    Histogram outputCommit;   // One AsyncWriter group: fsyncs, renames and directory fsyncs
+    Histogram compression;    // Compressing one document (or bundle entry) for output
+    Histogram httpRequest;    // Server mode: complete request to written response
+    Histogram keyImageEncode; // Rendering, PNG- and base64-encoding one key image
+    Histogram countAnalysis;  // Counting one frame's regions and writing its observations
+    Histogram timeActivity;   // Decoding and counting every frame of one dynamic image
+
+    // Throughput
+    Counter documentsGenerated;
+    Counter documentsInvalid;
+    Counter documentsUnchanged; // Not regenerated: same input hash as the indexed document
+    Counter filesWritten;
+    Counter bytesWritten;
+    Counter compressionInputBytes;  // Document bytes before and after <Compression>
+    Counter compressionOutputBytes;
+    Counter fastCheckFailures;
+    Counter fullValidations;
+    Counter entriesWritten;      // Instance observations streamed into report sections
+    Counter keyImagesEmbedded;   // observationMedia key images
+    Counter keyImageBytes;       // PNG bytes embedded (before base64)
+    Counter framesAnalysed;      // Frames with count analysis observations
+    Counter grammarCacheHits;    // Compiled grammar loaded from <GrammarCachePath>
+    Counter grammarCacheMisses;  // Grammar compiled from the XSD files
+    Counter configReloads;
+    Counter configReloadFailures;
+    Counter httpRejected;        // Requests answered with 503
+    Counter jobsClaimed;         // Worker mode (cda_jobs)
+    Counter jobsCompleted;
+    Counter jobsFailed;          // Failed attempts, including ones that will be retried
+    Counter jobLeasesLost;       // Finished after the lease had expired; the result was not recorded
+    Counter jobLeasesExpired;    // Reclaimed from a dead or stuck worker
+
+    // Queues
+    Gauge httpQueueDepth;        // Connections waiting for a server worker
+    Gauge httpInFlight;          // Requests queued or executing
+
+    std::string prometheusText() const;
+    // Writes via a temporary file and rename, so a scraper never reads a partial file
+    bool writePrometheusFile(const std::string& path) const;
+    void printSummary(std::ostream& out) const;
+
+private:
+    Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+};
+
+// Records the time from construction to destruction into a histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        histogram.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,44 @@
+#include "MetricsExporter.h"
+#include "Metrics.h"
+#include <iostream>
+
+MetricsExporter::MetricsExporter(const std::string& filePath, int intervalMs)
+    : filePath(filePath), interval(intervalMs > 0 ? intervalMs : 10000), stopping(false) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+void MetricsExporter::start() {
+    if (worker.joinable() || filePath.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+    worker = std::thread(&MetricsExporter::run, this);
+    std::cout << "Writing metrics to '" << filePath << "' every " << interval.count() << " ms." << std::endl;
+}
+
+void MetricsExporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+        Metrics::instance().writePrometheusFile(filePath); // Final values
+    }
+}
+
+void MetricsExporter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wakeUp.wait_for(lock, interval, [this] { return stopping; })) {
+        lock.unlock();
+        Metrics::instance().writePrometheusFile(filePath);
+        lock.lock();
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Periodically rewrites a Prometheus text file (e.g. for node_exporter's textfile
+// collector) from Metrics::instance(). The file is written once more on stop().
+class MetricsExporter {
+public:
+    MetricsExporter(const std::string& filePath, int intervalMs);
+    ~MetricsExporter(); // Stops the exporter thread
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void start(); // Does nothing when no file is configured
+    void stop();
+
+private:
+    std::string filePath;
+    std::chrono::milliseconds interval;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    void run();
+};
+
+#endif // METRICSEXPORTER_H
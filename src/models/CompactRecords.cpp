@@ -0,0 +1,287 @@
+#include "CompactRecords.h"
+#include <cstring>
+
+namespace {
+
+const std::uint32_t TAG_SHIFT = 27;
+const std::uint32_t VALUE_MASK = (1u << TAG_SHIFT) - 1;
+const std::uint32_t TAG_PLAIN = 1;    // YYYYMMDD, HHMMSS
+const std::uint32_t TAG_COLONS = 2;   // YYYY-MM-DD, HH:MM:SS
+const std::uint32_t TAG_INTERNED = 3;
+
+// Reads the digits of `text` at the positions where `pattern` has '9' and requires the
+// other characters to match exactly
+bool parseDigits(std::string_view text, const char* pattern, std::uint32_t& value) {
+    size_t length = std::strlen(pattern);
+    if (text.size() != length) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (pattern[i] == '9') {
+            if (text[i] < '0' || text[i] > '9') return false;
+            value = value * 10 + static_cast<std::uint32_t>(text[i] - '0');
+        } else if (text[i] != pattern[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// UIDs (digits and dots only, per DICOM PS3.5 9.1) take a nibble per character: '0'-'9'
+// are 1-10, '.' is 11, and 0 pads an odd length. Other text is stored after a 0 byte, which
+// no packed UID starts with, so the two kinds of key never collide (raw "AB" and packed
+// "3031" have the same bytes otherwise). The flag in ArenaRef::length tells them apart.
+const std::uint32_t UID_PACKED = 1u << 31;
+const char UID_TEXT_TAG = '\0';
+
+const size_t MAX_UID_LENGTH = 64;
+
+// `packed` must hold (uid.size() + 1) / 2 bytes
+bool packUid(std::string_view uid, char* packed) {
+    std::memset(packed, 0, (uid.size() + 1) / 2);
+    for (size_t i = 0; i < uid.size(); ++i) {
+        char c = uid[i];
+        unsigned nibble = (c >= '0' && c <= '9') ? static_cast<unsigned>(c - '0' + 1) : c == '.' ? 11u : 0u;
+        if (nibble == 0) {
+            return false;
+        }
+        packed[i / 2] = static_cast<char>(packed[i / 2] | (i % 2 == 0 ? nibble << 4 : nibble));
+    }
+    return true;
+}
+
+std::string formatDigits(std::uint32_t value, const char* pattern) {
+    std::string text(pattern);
+    for (size_t i = text.size(); i-- > 0;) {
+        if (text[i] == '9') {
+            text[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+    return text;
+}
+
+} // namespace
+
+ArenaRef StringArena::add(std::string_view text) {
+    ArenaRef ref;
+    if (text.empty()) {
+        return ref;
+    }
+    if (text.size() > CHUNK_SIZE - used) {
+        size_t chunkSize = text.size() > CHUNK_SIZE ? text.size() : CHUNK_SIZE;
+        chunks.emplace_back(new char[chunkSize]);
+        capacity += chunkSize;
+        used = 0;
+    }
+    char* chunk = chunks.back().get();
+    std::memcpy(chunk + used, text.data(), text.size());
+    ref.offset = static_cast<std::uint32_t>((chunks.size() - 1) << CHUNK_BITS) | used;
+    ref.length = static_cast<std::uint32_t>(text.size());
+    // An oversized value fills its chunk; the next add starts a new one
+    used = text.size() >= CHUNK_SIZE - used ? CHUNK_SIZE : used + static_cast<std::uint32_t>(text.size());
+    return ref;
+}
+
+Symbol SymbolTable::intern(std::string_view value) {
+    if (value.empty()) {
+        return 0;
+    }
+    Symbol symbol = 0;
+    auto keyOf = [this](std::uint32_t number) { return arena.view(texts[number]); };
+    if (index.find(value, keyOf, symbol)) {
+        return symbol + 1;
+    }
+    texts.push_back(arena.add(value));
+    index.insert(static_cast<std::uint32_t>(texts.size() - 1), value, keyOf);
+    return static_cast<Symbol>(texts.size());
+}
+
+bool SymbolTable::find(std::string_view value, Symbol& symbol) const {
+    if (value.empty()) {
+        symbol = 0;
+        return true;
+    }
+    std::uint32_t number = 0;
+    if (!index.find(value, [this](std::uint32_t n) { return arena.view(texts[n]); }, number)) {
+        return false;
+    }
+    symbol = number + 1;
+    return true;
+}
+
+size_t SymbolTable::memoryBytes() const {
+    return arena.memoryBytes() + texts.capacity() * sizeof(ArenaRef) + index.memoryBytes();
+}
+
+PackedDate CompactRecordBatch::packDate(std::string_view text) {
+    std::uint32_t value = 0;
+    if (text.empty()) {
+        return 0;
+    }
+    if (parseDigits(text, "99999999", value)) {
+        return TAG_PLAIN << TAG_SHIFT | value;
+    }
+    if (parseDigits(text, "9999-99-99", value)) {
+        return TAG_COLONS << TAG_SHIFT | value;
+    }
+    return TAG_INTERNED << TAG_SHIFT | (symbols.intern(text) & VALUE_MASK);
+}
+
+PackedTime CompactRecordBatch::packTime(std::string_view text) {
+    std::uint32_t value = 0;
+    if (text.empty()) {
+        return 0;
+    }
+    if (parseDigits(text, "999999", value)) {
+        return TAG_PLAIN << TAG_SHIFT | value;
+    }
+    if (parseDigits(text, "99:99:99", value)) {
+        return TAG_COLONS << TAG_SHIFT | value;
+    }
+    return TAG_INTERNED << TAG_SHIFT | (symbols.intern(text) & VALUE_MASK);
+}
+
+std::string CompactRecordBatch::date(PackedDate date) const {
+    switch (date >> TAG_SHIFT) {
+    case TAG_PLAIN: return formatDigits(date & VALUE_MASK, "99999999");
+    case TAG_COLONS: return formatDigits(date & VALUE_MASK, "9999-99-99");
+    case TAG_INTERNED: return std::string(symbols.text(date & VALUE_MASK));
+    default: return std::string();
+    }
+}
+
+std::string CompactRecordBatch::time(PackedTime time) const {
+    switch (time >> TAG_SHIFT) {
+    case TAG_PLAIN: return formatDigits(time & VALUE_MASK, "999999");
+    case TAG_COLONS: return formatDigits(time & VALUE_MASK, "99:99:99");
+    case TAG_INTERNED: return std::string(symbols.text(time & VALUE_MASK));
+    default: return std::string();
+    }
+}
+
+ArenaRef CompactRecordBatch::addUid(std::string_view uid) {
+    char packed[MAX_UID_LENGTH / 2];
+    if (uid.empty()) {
+        return ArenaRef();
+    }
+    if (uid.size() > MAX_UID_LENGTH || !packUid(uid, packed)) {
+        std::string tagged(1, UID_TEXT_TAG);
+        tagged.append(uid.data(), uid.size());
+        return arena.add(tagged);
+    }
+    ArenaRef ref = arena.add(std::string_view(packed, (uid.size() + 1) / 2));
+    ref.length = UID_PACKED | static_cast<std::uint32_t>(uid.size());
+    return ref;
+}
+
+std::string_view CompactRecordBatch::uidKey(ArenaRef ref) const {
+    if (ref.length & UID_PACKED) {
+        ref.length = ((ref.length & ~UID_PACKED) + 1) / 2;
+    }
+    return arena.view(ref);
+}
+
+std::string_view CompactRecordBatch::uidKey(std::string_view uid, std::string& buffer) {
+    if (uid.empty()) {
+        return std::string_view();
+    }
+    buffer.resize((uid.size() + 1) / 2);
+    if (uid.size() > MAX_UID_LENGTH || !packUid(uid, &buffer[0])) {
+        buffer.assign(1, UID_TEXT_TAG);
+        buffer.append(uid.data(), uid.size());
+    }
+    return buffer;
+}
+
+std::string CompactRecordBatch::uid(ArenaRef ref) const {
+    if (!(ref.length & UID_PACKED)) {
+        std::string_view tagged = arena.view(ref);
+        return tagged.empty() ? std::string() : std::string(tagged.substr(1));
+    }
+    size_t length = ref.length & ~UID_PACKED;
+    std::string_view packed = uidKey(ref);
+    std::string text(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char byte = static_cast<unsigned char>(packed[i / 2]);
+        unsigned nibble = i % 2 == 0 ? byte >> 4 : byte & 0x0F;
+        text[i] = nibble == 11 ? '.' : static_cast<char>('0' + nibble - 1);
+    }
+    return text;
+}
+
+size_t CompactRecordBatch::add(const Patient& patient) {
+    CompactPatient record;
+    record.patientID = symbols.intern(patient.patientID);
+    record.name = arena.add(patient.name);
+    record.dateOfBirth = packDate(patient.dateOfBirth);
+    record.sex = symbols.intern(patient.sex);
+    record.addressStreet = arena.add(patient.addressStreet);
+    record.addressCity = symbols.intern(patient.addressCity);
+    record.addressState = symbols.intern(patient.addressState);
+    record.addressZip = symbols.intern(patient.addressZip);
+    record.addressCountry = symbols.intern(patient.addressCountry);
+    record.phoneNumber = arena.add(patient.phoneNumber);
+    patientRecords.push_back(record);
+    return patientRecords.size() - 1;
+}
+
+size_t CompactRecordBatch::add(const Study& study) {
+    CompactStudy record;
+    record.studyInstanceUID = addUid(study.studyInstanceUID);
+    record.accessionNumber = arena.add(study.accessionNumber);
+    record.patientId = symbols.intern(study.patientId);
+    record.studyDate = packDate(study.studyDate);
+    record.studyTime = packTime(study.studyTime);
+    record.modality = symbols.intern(study.modality);
+    record.studyDescription = symbols.intern(study.studyDescription);
+    record.referringPhysicianName = symbols.intern(study.referringPhysicianName);
+    record.performingPhysicianName = symbols.intern(study.performingPhysicianName);
+    studyRecords.push_back(record);
+    return studyRecords.size() - 1;
+}
+
+Patient CompactRecordBatch::toPatient(const CompactPatient& record) const {
+    Patient patient;
+    patient.patientID = std::string(text(record.patientID));
+    patient.name = std::string(text(record.name));
+    patient.dateOfBirth = date(record.dateOfBirth);
+    patient.sex = std::string(text(record.sex));
+    patient.addressStreet = std::string(text(record.addressStreet));
+    patient.addressCity = std::string(text(record.addressCity));
+    patient.addressState = std::string(text(record.addressState));
+    patient.addressZip = std::string(text(record.addressZip));
+    patient.addressCountry = std::string(text(record.addressCountry));
+    patient.phoneNumber = std::string(text(record.phoneNumber));
+    return patient;
+}
+
+Study CompactRecordBatch::toStudy(const CompactStudy& record) const {
+    Study study;
+    study.studyInstanceUID = uid(record.studyInstanceUID);
+    study.patientId = std::string(text(record.patientId));
+    study.accessionNumber = std::string(text(record.accessionNumber));
+    study.studyDate = date(record.studyDate);
+    study.studyTime = time(record.studyTime);
+    study.modality = std::string(text(record.modality));
+    study.studyDescription = std::string(text(record.studyDescription));
+    study.referringPhysicianName = std::string(text(record.referringPhysicianName));
+    study.performingPhysicianName = std::string(text(record.performingPhysicianName));
+    return study;
+}
+
+void CompactRecordBatch::reserve(size_t patientCount, size_t studyCount) {
+    patientRecords.reserve(patientCount);
+    studyRecords.reserve(studyCount);
+}
+
+void CompactRecordBatch::shrinkToFit() {
+    patientRecords.shrink_to_fit();
+    studyRecords.shrink_to_fit();
+}
+
+size_t CompactRecordBatch::memoryBytes() const {
+    return arena.memoryBytes() + symbols.memoryBytes() + patientRecords.capacity() * sizeof(CompactPatient) +
+           studyRecords.capacity() * sizeof(CompactStudy);
+}
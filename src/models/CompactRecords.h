@@ -0,0 +1,213 @@
+#ifndef COMPACTRECORDS_H
+#define COMPACTRECORDS_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Patient.h"
+#include "Study.h"
+
+// Compact, read-mostly form of Patient and Study for holding millions of rows.
+//
+// A Patient is 10 std::strings (320 bytes before any heap block), a Study 9 (288 bytes),
+// and most of their values are short or come from small domains. CompactRecordBatch
+// stores instead
+//   - unique text (names, UIDs, accession numbers, streets, phones) once in an arena,
+//     referenced by 8-byte ArenaRefs; study UIDs, being digits and dots, two characters
+//     to a byte,
+//   - low-cardinality values (sex, modality, descriptions, physicians, cities, and patient
+//     IDs, which every study repeats) as 4-byte interned Symbols,
+//   - dates and times packed into 32 bits.
+// Every value converts back to exactly the text it was added with.
+
+// Text in a StringArena: chunk index << 20 | position in the chunk, and length
+struct ArenaRef {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+};
+
+// Append-only text storage in 1 MiB chunks that never move, so views stay valid for the
+// arena's lifetime. Holds up to 4 GiB; longer values get a chunk of their own.
+class StringArena {
+public:
+    ArenaRef add(std::string_view text);
+    std::string_view view(ArenaRef ref) const {
+        return ref.length == 0 ? std::string_view()
+                               : std::string_view(chunks[ref.offset >> CHUNK_BITS].get() + (ref.offset & CHUNK_MASK), ref.length);
+    }
+    size_t memoryBytes() const { return capacity + chunks.capacity() * sizeof(chunks[0]); }
+
+private:
+    static const unsigned CHUNK_BITS = 20;
+    static const std::uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    static const std::uint32_t CHUNK_MASK = CHUNK_SIZE - 1;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    std::uint32_t used = CHUNK_SIZE; // In the last chunk; full until the first add
+    size_t capacity = 0;
+};
+
+// Open-addressing hash index of 32-bit record numbers. Keys are not stored: `keyOf` maps a
+// number back to its key, so an entry costs 4 bytes (at most 8 after growth).
+class CompactHashIndex {
+public:
+    // Returns false, leaving the index unchanged, when the key is already present
+    template <typename KeyOf>
+    bool insert(std::uint32_t number, std::string_view key, const KeyOf& keyOf) {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            grow(keyOf);
+        }
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i] == 0) {
+                slots[i] = number + 1;
+                ++count;
+                return true;
+            }
+            if (keyOf(slots[i] - 1) == key) {
+                return false;
+            }
+        }
+    }
+
+    template <typename KeyOf>
+    bool find(std::string_view key, const KeyOf& keyOf, std::uint32_t& number) const {
+        if (slots.empty()) {
+            return false;
+        }
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(key) & mask; slots[i] != 0; i = (i + 1) & mask) {
+            if (keyOf(slots[i] - 1) == key) {
+                number = slots[i] - 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return count; }
+    size_t memoryBytes() const { return slots.capacity() * sizeof(std::uint32_t); }
+
+private:
+    std::vector<std::uint32_t> slots; // Number + 1; 0 is empty. Size is a power of two.
+    size_t count = 0;
+
+    static size_t hash(std::string_view key) { return std::hash<std::string_view>()(key); }
+
+    template <typename KeyOf>
+    void grow(const KeyOf& keyOf) {
+        std::vector<std::uint32_t> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, 0);
+        size_t mask = slots.size() - 1;
+        for (std::uint32_t slot : old) {
+            if (slot != 0) {
+                size_t i = hash(keyOf(slot - 1)) & mask;
+                while (slots[i] != 0) i = (i + 1) & mask;
+                slots[i] = slot;
+            }
+        }
+    }
+};
+
+// Interned strings. Symbol 0 is the empty string.
+using Symbol = std::uint32_t;
+
+class SymbolTable {
+public:
+    Symbol intern(std::string_view text);
+    bool find(std::string_view text, Symbol& symbol) const;
+    std::string_view text(Symbol symbol) const { return symbol == 0 ? std::string_view() : arena.view(texts[symbol - 1]); }
+    size_t size() const { return texts.size() + 1; } // Including the empty string
+    size_t memoryBytes() const;
+
+private:
+    StringArena arena;
+    std::vector<ArenaRef> texts;
+    CompactHashIndex index;
+};
+
+// YYYYMMDD or YYYY-MM-DD (kept apart so each converts back to its own form) in the low
+// 27 bits, with a 2-bit form tag; anything else is interned. 0 is the empty date.
+using PackedDate = std::uint32_t;
+// HHMMSS or HH:MM:SS the same way
+using PackedTime = std::uint32_t;
+
+struct CompactPatient {                 // 52 bytes
+    Symbol patientID;
+    ArenaRef name;
+    PackedDate dateOfBirth;
+    Symbol sex;
+    ArenaRef addressStreet;
+    Symbol addressCity;
+    Symbol addressState;
+    Symbol addressZip;
+    Symbol addressCountry;
+    ArenaRef phoneNumber;
+};
+
+struct CompactStudy {                   // 44 bytes
+    ArenaRef studyInstanceUID;          // Read with uid() / uidKey(), not text()
+    ArenaRef accessionNumber;
+    Symbol patientId;                   // Same symbol as the patient's patientID
+    PackedDate studyDate;
+    PackedTime studyTime;
+    Symbol modality;
+    Symbol studyDescription;
+    Symbol referringPhysicianName;
+    Symbol performingPhysicianName;
+};
+
+// One load's worth of compact records and the storage their references point into.
+// Not thread-safe while adding; const access is safe from any number of threads.
+class CompactRecordBatch {
+public:
+    CompactRecordBatch() = default;
+    CompactRecordBatch(CompactRecordBatch&&) = default;
+    CompactRecordBatch& operator=(CompactRecordBatch&&) = default;
+    CompactRecordBatch(const CompactRecordBatch&) = delete;
+    CompactRecordBatch& operator=(const CompactRecordBatch&) = delete;
+
+    // Return the index of the new record
+    size_t add(const Patient& patient);
+    size_t add(const Study& study);
+
+    Patient toPatient(const CompactPatient& patient) const;
+    Study toStudy(const CompactStudy& study) const;
+
+    const std::vector<CompactPatient>& patients() const { return patientRecords; }
+    const std::vector<CompactStudy>& studies() const { return studyRecords; }
+
+    std::string_view text(ArenaRef ref) const { return arena.view(ref); }
+    std::string_view text(Symbol symbol) const { return symbols.text(symbol); }
+    bool findSymbol(std::string_view text, Symbol& symbol) const { return symbols.find(text, symbol); }
+    size_t symbolCount() const { return symbols.size(); }
+    std::string date(PackedDate date) const;
+    std::string time(PackedTime time) const;
+    std::string uid(ArenaRef ref) const;
+    // The stored bytes of a UID, which identify it as uniquely as its text: packed and
+    // unpacked UIDs never share a key
+    std::string_view uidKey(ArenaRef ref) const;
+    // The same key for a UID given as text (encoded into `buffer`), to look up stored ones
+    static std::string_view uidKey(std::string_view uid, std::string& buffer);
+
+    void reserve(size_t patientCount, size_t studyCount);
+    void shrinkToFit(); // Drops the spare capacity of the record vectors once loading is done
+    // Bytes held by the records, arena and symbol table, capacity included
+    size_t memoryBytes() const;
+
+private:
+    StringArena arena;
+    SymbolTable symbols;
+    std::vector<CompactPatient> patientRecords;
+    std::vector<CompactStudy> studyRecords;
+
+    PackedDate packDate(std::string_view text);
+    PackedTime packTime(std::string_view text);
+    ArenaRef addUid(std::string_view uid);
+};
+
+#endif // COMPACTRECORDS_H
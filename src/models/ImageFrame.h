@@ -0,0 +1,34 @@
+#ifndef IMAGEFRAME_H
+#define IMAGEFRAME_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One frame of a DICOM image, after the modality LUT (so NM pixels are counts)
+struct ImageFrame {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t channels = 1;         // 1 (monochrome) or 3 (RGB)
+    bool inverted = false;              // MONOCHROME1: the lowest value displays as white
+    std::vector<std::int32_t> samples;  // Row-major, channels interleaved
+};
+
+// A DICOM overlay plane (60xx group), e.g. an ROI drawn on the acquisition workstation
+struct OverlayPlane {
+    std::string label;          // Overlay Label, else Overlay Description, else "Overlay 60xx"
+    bool roi = false;           // Overlay Type R (region of interest) rather than G (graphics)
+    std::uint32_t rows = 0;
+    std::uint32_t columns = 0;
+    std::int32_t originRow = 1; // 1-based position of the overlay's first pixel in the image
+    std::int32_t originColumn = 1;
+    std::vector<std::uint8_t> bits; // Overlay Data as stored: row-major, 8 pixels per byte, low bit first
+};
+
+// When each frame of a dynamic image was acquired, relative to the start of the acquisition
+struct FrameTiming {
+    std::vector<double> startMs;    // One per frame
+    std::vector<double> durationMs;
+};
+
+#endif // IMAGEFRAME_H
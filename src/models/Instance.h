@@ -0,0 +1,17 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <string>
+
+struct Instance {
+    std::string sopInstanceUID;    // DICOM Unique Identifier for the image/object
+    std::string sopClassUID;       // e.g., 1.2.840.10008.5.1.4.1.1.20 (NM Image Storage)
+    std::string seriesInstanceUID; // Foreign key to Series
+    std::string instanceNumber;
+    std::string numberOfFrames;    // Empty for single-frame objects
+    std::string contentDate;       // YYYYMMDD
+    std::string contentTime;       // HHMMSS
+    std::string filePath;          // Local DICOM file (set by DicomStudyCatalog); key images and analyses are read from it
+};
+
+#endif // INSTANCE_H
@@ -0,0 +1,16 @@
+#ifndef SERIES_H
+#define SERIES_H
+
+#include <string>
+
+struct Series {
+    std::string seriesInstanceUID; // DICOM Unique Identifier for the Series
+    std::string studyInstanceUID;  // Foreign key to Study
+    std::string seriesNumber;
+    std::string modality;          // e.g., NM; may differ from the study's (PT/CT hybrids)
+    std::string seriesDescription;
+    std::string seriesDate;        // YYYYMMDD
+    std::string seriesTime;        // HHMMSS
+};
+
+#endif // SERIES_H
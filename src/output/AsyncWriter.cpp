@@ -0,0 +1,257 @@
+#include "AsyncWriter.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../metrics/Metrics.h"
+#include "../tracing/Tracer.h"
+
+namespace {
+
+bool writeAll(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+std::string parentDirectory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+} // namespace
+
+AsyncWriter::AsyncWriter(const AsyncWriterOptions& options)
+    : options(options), outstanding(0), openFiles(0), tempSequence(0), commitRequested(false), started(false), stopping(false),
+      ioFinished(false) {
+    if (this->options.threads == 0) this->options.threads = 1;
+    if (this->options.queueCapacity == 0) this->options.queueCapacity = 1;
+    if (this->options.groupSize == 0) this->options.groupSize = 1;
+    if (this->options.maxOpenFiles == 0) this->options.maxOpenFiles = 1;
+    if (this->options.syncIntervalMs < 0) this->options.syncIntervalMs = 0;
+}
+
+AsyncWriter::~AsyncWriter() {
+    stop();
+}
+
+void AsyncWriter::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (started) {
+        return;
+    }
+    started = true;
+    for (unsigned i = 0; i < options.threads; ++i) {
+        ioThreads.emplace_back(&AsyncWriter::ioLoop, this);
+    }
+    commitThread = std::thread(&AsyncWriter::commitLoop, this);
+}
+
+bool AsyncWriter::submit(const std::string& path, std::string content, WriteCompletion done) {
+    std::unique_lock<std::mutex> lock(mutex);
+    queueNotFull.wait(lock, [this] { return stopping || queue.size() < options.queueCapacity; });
+    if (stopping || !started) {
+        return false;
+    }
+    queue.push_back(Request{path, std::move(content), std::move(done)});
+    ++outstanding;
+    queueNotEmpty.notify_one();
+    return true;
+}
+
+void AsyncWriter::requestCommit() {
+    std::lock_guard<std::mutex> lock(mutex);
+    commitRequested = true;
+    commitWanted.notify_one();
+}
+
+void AsyncWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (outstanding > 0 && started) {
+        // Again after every group: files still being written when the last one was taken
+        commitRequested = true;
+        commitWanted.notify_one();
+        allCompleted.wait(lock);
+    }
+}
+
+void AsyncWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!started || stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    queueNotFull.notify_all();
+    queueNotEmpty.notify_all();
+    for (std::thread& thread : ioThreads) {
+        thread.join(); // They empty the queue first
+    }
+    ioThreads.clear();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ioFinished = true;
+    }
+    commitWanted.notify_one();
+    commitThread.join();
+}
+
+void AsyncWriter::ioLoop() {
+    HL7_TRACE_THREAD_NAME("async-writer-io");
+    Metrics& metrics = Metrics::instance();
+    for (;;) {
+        Request request;
+        unsigned long sequence;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                if (!queue.empty() && openFiles < options.maxOpenFiles) {
+                    break;
+                }
+                if (queue.empty() && stopping) {
+                    return;
+                }
+                if (!queue.empty()) {
+                    // Out of descriptors: commit what is written rather than wait for the group or the interval
+                    commitRequested = true;
+                    commitWanted.notify_one();
+                }
+                queueNotEmpty.wait(lock);
+            }
+            request = std::move(queue.front());
+            queue.pop_front();
+            sequence = ++tempSequence;
+            ++openFiles;
+            queueNotFull.notify_one();
+        }
+
+        // Unique per process and request, so concurrent writers of one path never share a temporary file
+        std::string tempPath = request.path + ".tmp" + std::to_string(getpid()) + "." + std::to_string(sequence);
+        int fd;
+        bool ok;
+        {
+            HL7_TRACE_SCOPE_DETAIL("asyncWrite", request.path);
+            ScopedTimer timer(metrics.fileWrite);
+            fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            ok = fd >= 0 && writeAll(fd, request.content);
+        }
+        if (!ok) {
+            std::cerr << "Error: Cannot write " << tempPath << ": " << std::strerror(errno) << std::endl;
+            if (fd >= 0) {
+                ::close(fd);
+                std::remove(tempPath.c_str());
+            }
+            if (request.done) {
+                request.done(false);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            --outstanding;
+            --openFiles;
+            allCompleted.notify_all();
+            queueNotEmpty.notify_one();
+            continue;
+        }
+        metrics.bytesWritten.add(request.content.size());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        written.push_back(WrittenFile{request.path, tempPath, fd, std::move(request.done)});
+        if (openFiles >= options.maxOpenFiles) {
+            commitRequested = true;
+        }
+        if (commitRequested || written.size() >= options.groupSize) {
+            commitWanted.notify_one();
+        }
+    }
+}
+
+void AsyncWriter::commitLoop() {
+    HL7_TRACE_THREAD_NAME("async-writer-commit");
+    const auto interval = std::chrono::milliseconds(options.syncIntervalMs);
+    auto lastCommit = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    auto commitDue = [this] { return ioFinished || commitRequested || written.size() >= options.groupSize; };
+    for (;;) {
+        if (options.syncIntervalMs > 0) {
+            commitWanted.wait_until(lock, lastCommit + interval, commitDue);
+        } else {
+            commitWanted.wait(lock, commitDue); // No interval: only full groups, flush() and requestCommit()
+        }
+        if (written.empty()) {
+            commitRequested = false;
+            allCompleted.notify_all(); // A flush() may be waiting on a failed write
+            if (ioFinished) {
+                return;
+            }
+            lastCommit = std::chrono::steady_clock::now();
+            continue;
+        }
+        std::vector<WrittenFile> group;
+        group.swap(written);
+        commitRequested = false;
+        lock.unlock();
+
+        commitGroup(group);
+        lastCommit = std::chrono::steady_clock::now();
+
+        lock.lock();
+        outstanding -= group.size();
+        openFiles -= group.size();
+        allCompleted.notify_all();
+        queueNotEmpty.notify_all(); // I/O threads may be waiting for descriptors
+    }
+}
+
+void AsyncWriter::commitGroup(std::vector<WrittenFile>& group) {
+    HL7_TRACE_SCOPE("asyncWriterCommit");
+    Metrics& metrics = Metrics::instance();
+    ScopedTimer timer(metrics.outputCommit);
+
+    // Contents first, then the renames, then the directory entries the renames changed
+    std::vector<bool> published(group.size(), false);
+    std::set<std::string> directories;
+    for (size_t i = 0; i < group.size(); ++i) {
+        WrittenFile& file = group[i];
+        bool synced = ::fdatasync(file.fd) == 0;
+        int syncError = errno;
+        ::close(file.fd);
+        if (!synced) {
+            std::cerr << "Error: Cannot fsync " << file.tempPath << ": " << std::strerror(syncError) << std::endl;
+        } else if (std::rename(file.tempPath.c_str(), file.path.c_str()) != 0) {
+            std::cerr << "Error: Cannot rename " << file.tempPath << " to " << file.path << ": " << std::strerror(errno) << std::endl;
+        } else {
+            published[i] = true;
+            directories.insert(parentDirectory(file.path));
+            continue;
+        }
+        std::remove(file.tempPath.c_str());
+    }
+    for (const std::string& directory : directories) {
+        int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0 || ::fsync(fd) != 0) {
+            std::cerr << "Warning: Could not fsync directory " << directory << ": " << std::strerror(errno) << std::endl;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    for (size_t i = 0; i < group.size(); ++i) {
+        if (published[i]) {
+            metrics.filesWritten.add();
+        }
+        if (group[i].done) {
+            group[i].done(published[i]);
+        }
+    }
+}
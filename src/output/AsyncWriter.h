@@ -0,0 +1,92 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AsyncWriterOptions {
+    unsigned threads = 2;       // I/O threads writing temporary files
+    size_t queueCapacity = 256; // Documents waiting for an I/O thread; submit() blocks beyond this
+    size_t groupSize = 64;      // Written files per group fsync
+    int syncIntervalMs = 200;   // Longest a written file waits for its group fsync; 0: no limit
+    size_t maxOpenFiles = 256;  // Files written or being written but not yet committed, each an open
+                                // descriptor; the I/O threads wait beyond this
+};
+
+// Called once per submitted document, from the commit thread. durable: the document is
+// in place under its final name and fsynced along with its directory. Otherwise nothing
+// was published and the temporary file is gone.
+using WriteCompletion = std::function<void(bool durable)>;
+
+// Writes documents off the generating threads. submit() hands a document to a bounded
+// queue and returns; a small pool of I/O threads writes each one to a temporary file next
+// to its destination. A commit thread then takes the written files in groups (every
+// `groupSize` files, every `syncIntervalMs`, on flush(), or when `maxOpenFiles` files are
+// open and the I/O threads wait for descriptors): it fdatasyncs them, renames
+// each into place, fsyncs the directories involved once per group, and only then runs
+// the completions. A document is thus never visible half-written, and a caller that marks
+// its work done from the completion never loses a document it reported.
+//
+// Completions run on the commit thread, one at a time; they must be quick and must not
+// call back into the writer.
+class AsyncWriter {
+public:
+    explicit AsyncWriter(const AsyncWriterOptions& options);
+    ~AsyncWriter(); // stop()
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    void start();
+    // Blocks while the queue is full. False once stop() has begun; `done` is not called then.
+    bool submit(const std::string& path, std::string content, WriteCompletion done);
+    // Commits what is written without waiting for the group to fill or the interval
+    void requestCommit();
+    // Waits until every document submitted so far has completed
+    void flush();
+    // Writes and commits everything submitted, then joins the threads
+    void stop();
+
+private:
+    struct Request {
+        std::string path;
+        std::string content;
+        WriteCompletion done;
+    };
+    struct WrittenFile {
+        std::string path;
+        std::string tempPath;
+        int fd;
+        WriteCompletion done;
+    };
+
+    AsyncWriterOptions options;
+    std::mutex mutex;
+    std::condition_variable queueNotFull;
+    std::condition_variable queueNotEmpty;
+    std::condition_variable commitWanted;
+    std::condition_variable allCompleted;
+    std::deque<Request> queue;
+    std::vector<WrittenFile> written; // Waiting for the next group commit
+    size_t outstanding;               // Submitted and not yet completed
+    size_t openFiles;                 // Temporary files open in the I/O threads, `written` or a committing group
+    unsigned long tempSequence;
+    bool commitRequested;             // Commit what is written without waiting
+    bool started;
+    bool stopping;
+    bool ioFinished;
+    std::vector<std::thread> ioThreads;
+    std::thread commitThread;
+
+    void ioLoop();
+    void commitLoop();
+    void commitGroup(std::vector<WrittenFile>& group);
+};
+
+#endif // ASYNCWRITER_H
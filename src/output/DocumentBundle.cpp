@@ -0,0 +1,92 @@
+#include "DocumentBundle.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace {
+
+const size_t BLOCK_SIZE = 512;
+
+// Writes `value` as a zero-padded octal field of `width` bytes, NUL-terminated
+void putOctal(char* field, size_t width, unsigned long long value) {
+    std::snprintf(field, width, "%0*llo", static_cast<int>(width - 1), value);
+}
+
+// Splits `name` into the ustar name (100 bytes) and prefix (155 bytes) fields at a '/'
+bool splitName(const std::string& name, std::string& prefix, std::string& base) {
+    if (name.size() <= 100) {
+        prefix.clear();
+        base = name;
+        return true;
+    }
+    size_t slash = name.find('/', name.size() - 101);
+    if (slash == std::string::npos || slash > 155 || name.size() - slash - 1 == 0) {
+        return false;
+    }
+    prefix = name.substr(0, slash);
+    base = name.substr(slash + 1);
+    return true;
+}
+
+} // namespace
+
+DocumentBundle::DocumentBundle(DocumentCompressor& compressor) : compressor(compressor), count(0) {
+}
+
+bool DocumentBundle::add(const std::string& name, const std::string& content) {
+    std::string prefix, base;
+    if (!splitName(name, prefix, base)) {
+        std::cerr << "Error: Bundle entry name too long: " << name << std::endl;
+        return false;
+    }
+
+    char header[BLOCK_SIZE];
+    std::memset(header, 0, sizeof(header));
+    std::memcpy(header, base.data(), base.size());
+    putOctal(header + 100, 8, 0644);                               // mode
+    putOctal(header + 108, 8, 0);                                  // uid
+    putOctal(header + 116, 8, 0);                                  // gid
+    putOctal(header + 124, 12, content.size());                    // size
+    putOctal(header + 136, 12, static_cast<unsigned long long>(std::time(nullptr))); // mtime
+    header[156] = '0';                                             // regular file
+    std::memcpy(header + 257, "ustar\0" "00", 8);                  // magic and version
+    std::memcpy(header + 345, prefix.data(), prefix.size());
+    // The checksum is computed with its own field read as spaces
+    std::memset(header + 148, ' ', 8);
+    unsigned long checksum = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        checksum += static_cast<unsigned char>(header[i]);
+    }
+    std::snprintf(header + 148, 8, "%06lo", checksum);
+    header[155] = ' ';
+
+    entry.assign(header, BLOCK_SIZE);
+    entry += content;
+    entry.append((BLOCK_SIZE - content.size() % BLOCK_SIZE) % BLOCK_SIZE, '\0');
+    if (count == 0 && !compressor.beginStream()) {
+        return false;
+    }
+    if (!compressor.appendStream(entry.data(), entry.size(), bytes)) {
+        return false;
+    }
+    ++count;
+    return true;
+}
+
+bool DocumentBundle::finish() {
+    if (count == 0 && !compressor.beginStream()) {
+        return false;
+    }
+    entry.assign(2 * BLOCK_SIZE, '\0');
+    return compressor.endStream(entry.data(), entry.size(), bytes);
+}
+
+std::string DocumentBundle::extension() const {
+    return std::string(".tar") + compressor.extension();
+}
+
+void DocumentBundle::clear() {
+    bytes.clear();
+    count = 0;
+}
@@ -0,0 +1,39 @@
+#ifndef DOCUMENTBUNDLE_H
+#define DOCUMENTBUNDLE_H
+
+#include <string>
+#include "DocumentCompressor.h"
+
+// Builds a tar archive (ustar) of documents in memory, for batch runs that write bundles
+// of documents instead of a file per document. The whole archive is one compressor stream
+// (a single gzip member or zstd frame), so every document is compressed with the context
+// of the ones before it and the headers they share cost little after the first. The
+// result is a regular .tar.gz / .tar.zst that `tar -xf` reads, except a zstd bundle
+// compressed with a <DictionaryPath> dictionary, which needs `zstd -d -D <dictionary>`
+// piped into `tar -x`. Reading one entry means decompressing the bundle up to it.
+class DocumentBundle {
+public:
+    explicit DocumentBundle(DocumentCompressor& compressor);
+
+    // Appends `content` as regular file `name` (a relative path); false (after logging)
+    // if the name does not fit a ustar header or compression fails
+    bool add(const std::string& name, const std::string& content);
+    // Appends the end-of-archive blocks; the bundle is then ready to be written
+    bool finish();
+
+    size_t entries() const { return count; }
+    bool empty() const { return count == 0; }
+    std::string& data() { return bytes; }
+    // ".tar" plus the compressor's extension
+    std::string extension() const;
+    // Starts the next bundle
+    void clear();
+
+private:
+    DocumentCompressor& compressor;
+    std::string bytes;
+    std::string entry;      // Uncompressed header and data of the entry being added
+    size_t count;
+};
+
+#endif // DOCUMENTBUNDLE_H
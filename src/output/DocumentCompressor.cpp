@@ -0,0 +1,259 @@
+#include "DocumentCompressor.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <zlib.h>
+#include "../metrics/Metrics.h"
+
+#ifdef HL7_HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
+namespace {
+
+const int GZIP_DEFAULT_LEVEL = 6;
+const int ZSTD_DEFAULT_LEVEL = 3;
+const int GZIP_WINDOW_BITS = 15 + 16; // +16: gzip wrapper instead of zlib's
+const size_t STREAM_CHUNK = 64 * 1024; // Output space added per step of a stream
+
+} // namespace
+
+DocumentCompressor::DocumentCompressor(const CompressionOptions& options)
+    : options(options), format(Format::None), zstdContext(nullptr), zstdDictionary(nullptr) {
+}
+
+DocumentCompressor::~DocumentCompressor() {
+    if (deflater) {
+        deflateEnd(deflater.get());
+    }
+#ifdef HL7_HAVE_ZSTD
+    ZSTD_freeCDict(zstdDictionary);
+    ZSTD_freeCCtx(zstdContext);
+#endif
+}
+
+bool DocumentCompressor::zstdAvailable() {
+#ifdef HL7_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool DocumentCompressor::open() {
+    if (options.format == "none") {
+        format = Format::None;
+        return true;
+    }
+    if (options.format == "gzip") {
+        int level = options.level > 0 ? options.level : GZIP_DEFAULT_LEVEL;
+        std::unique_ptr<z_stream> stream(new z_stream());
+        if (deflateInit2(stream.get(), level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            std::cerr << "Error: Cannot set up gzip compression." << std::endl;
+            return false;
+        }
+        deflater = std::move(stream);
+        format = Format::Gzip;
+        return true;
+    }
+    if (options.format != "zstd") {
+        std::cerr << "Error: Unknown compression format '" << options.format << "'." << std::endl;
+        return false;
+    }
+#ifdef HL7_HAVE_ZSTD
+    int level = options.level > 0 ? options.level : ZSTD_DEFAULT_LEVEL;
+    zstdContext = ZSTD_createCCtx();
+    if (!zstdContext) {
+        std::cerr << "Error: Cannot set up zstd compression." << std::endl;
+        return false;
+    }
+    if (!options.dictionaryPath.empty()) {
+        std::ifstream in(options.dictionaryPath, std::ios::binary);
+        std::string dictionary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (!in.good() && !in.eof()) {
+            dictionary.clear();
+        }
+        zstdDictionary = dictionary.empty() ? nullptr : ZSTD_createCDict(dictionary.data(), dictionary.size(), level);
+        if (!zstdDictionary || ZSTD_isError(ZSTD_CCtx_refCDict(zstdContext, zstdDictionary))) {
+            std::cerr << "Error: Cannot load the zstd dictionary " << options.dictionaryPath << "." << std::endl;
+            return false;
+        }
+    } else {
+        ZSTD_CCtx_setParameter(zstdContext, ZSTD_c_compressionLevel, level);
+    }
+    format = Format::Zstd;
+    return true;
+#else
+    std::cerr << "Error: This build has no zstd support; use gzip." << std::endl;
+    return false;
+#endif
+}
+
+const char* DocumentCompressor::extension() const {
+    switch (format) {
+        case Format::Gzip: return ".gz";
+        case Format::Zstd: return ".zst";
+        case Format::None: break;
+    }
+    return "";
+}
+
+const char* DocumentCompressor::formatName() const {
+    switch (format) {
+        case Format::Gzip: return "gzip";
+        case Format::Zstd: return "zstd";
+        case Format::None: break;
+    }
+    return "none";
+}
+
+bool DocumentCompressor::compress(const char* data, size_t size, std::string& out) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    if (format == Format::Gzip) {
+        z_stream& stream = *deflater;
+        out.resize(deflateBound(&stream, static_cast<uLong>(size)));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(size);
+        stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        stream.avail_out = static_cast<uInt>(out.size());
+        ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        out.resize(ok ? stream.total_out : 0);
+        deflateReset(&stream); // Keeps the allocated window for the next document
+    }
+#ifdef HL7_HAVE_ZSTD
+    else if (format == Format::Zstd) {
+        out.resize(ZSTD_compressBound(size));
+        size_t written = zstdDictionary ? ZSTD_compress_usingCDict(zstdContext, &out[0], out.size(), data, size, zstdDictionary)
+                                        : ZSTD_compress2(zstdContext, &out[0], out.size(), data, size);
+        ok = !ZSTD_isError(written);
+        out.resize(ok ? written : 0);
+    }
+#endif
+    else {
+        out.assign(data, size);
+        return true;
+    }
+    if (!ok) {
+        std::cerr << "Error: " << formatName() << " compression failed." << std::endl;
+        return false;
+    }
+
+    count(size, out.size(), std::chrono::steady_clock::now() - start, true);
+    return true;
+}
+
+bool DocumentCompressor::beginStream() {
+    if (format == Format::Gzip) {
+        return deflateReset(deflater.get()) == Z_OK;
+    }
+#ifdef HL7_HAVE_ZSTD
+    if (format == Format::Zstd) {
+        return !ZSTD_isError(ZSTD_CCtx_reset(zstdContext, ZSTD_reset_session_only)); // Keeps the level and dictionary
+    }
+#endif
+    return true;
+}
+
+bool DocumentCompressor::appendStream(const char* data, size_t size, std::string& out) {
+    auto start = std::chrono::steady_clock::now();
+    size_t before = out.size();
+    if (!streamInto(data, size, false, out)) {
+        return false;
+    }
+    count(size, out.size() - before, std::chrono::steady_clock::now() - start, true);
+    return true;
+}
+
+bool DocumentCompressor::endStream(const char* data, size_t size, std::string& out) {
+    auto start = std::chrono::steady_clock::now();
+    size_t before = out.size();
+    if (!streamInto(data, size, true, out)) {
+        return false;
+    }
+    count(size, out.size() - before, std::chrono::steady_clock::now() - start, false);
+    return true;
+}
+
+bool DocumentCompressor::streamInto(const char* data, size_t size, bool last, std::string& out) {
+    bool ok = false;
+    if (format == Format::Gzip) {
+        z_stream& stream = *deflater;
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(size);
+        const int flush = last ? Z_FINISH : Z_NO_FLUSH;
+        int result;
+        do {
+            size_t used = out.size();
+            out.resize(used + STREAM_CHUNK);
+            stream.next_out = reinterpret_cast<Bytef*>(&out[used]);
+            stream.avail_out = static_cast<uInt>(STREAM_CHUNK);
+            result = deflate(&stream, flush);
+            out.resize(used + STREAM_CHUNK - stream.avail_out);
+        } while (result != Z_STREAM_ERROR && (stream.avail_out == 0 || (last && result != Z_STREAM_END)));
+        ok = last ? result == Z_STREAM_END : result != Z_STREAM_ERROR;
+    }
+#ifdef HL7_HAVE_ZSTD
+    else if (format == Format::Zstd) {
+        ZSTD_inBuffer input = {data, size, 0};
+        size_t remaining;
+        do {
+            size_t used = out.size();
+            out.resize(used + STREAM_CHUNK);
+            ZSTD_outBuffer output = {&out[used], STREAM_CHUNK, 0};
+            remaining = ZSTD_compressStream2(zstdContext, &output, &input, last ? ZSTD_e_end : ZSTD_e_continue);
+            out.resize(used + output.pos);
+        } while (!ZSTD_isError(remaining) && (last ? remaining != 0 : input.pos < input.size));
+        ok = !ZSTD_isError(remaining);
+    }
+#endif
+    else {
+        out.append(data, size);
+        return true;
+    }
+    if (!ok) {
+        std::cerr << "Error: " << formatName() << " compression failed." << std::endl;
+    }
+    return ok;
+}
+
+void DocumentCompressor::count(size_t inputBytes, size_t outputBytes, std::chrono::steady_clock::duration elapsed, bool document) {
+    counters.documents += document ? 1 : 0;
+    counters.inputBytes += inputBytes;
+    counters.outputBytes += outputBytes;
+    counters.seconds += std::chrono::duration<double>(elapsed).count();
+    Metrics& metrics = Metrics::instance();
+    if (document) {
+        metrics.compression.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+    metrics.compressionInputBytes.add(inputBytes);
+    metrics.compressionOutputBytes.add(outputBytes);
+}
+
+bool DocumentCompressor::trainDictionary(const std::vector<std::string>& samples, size_t dictionaryBytes, std::string& dictionary) {
+#ifdef HL7_HAVE_ZSTD
+    std::string joined;
+    std::vector<size_t> sizes;
+    for (const std::string& sample : samples) {
+        joined += sample;
+        sizes.push_back(sample.size());
+    }
+    dictionary.resize(dictionaryBytes);
+    size_t size = ZDICT_trainFromBuffer(&dictionary[0], dictionary.size(), joined.data(), sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size)) {
+        std::cerr << "Error: Dictionary training failed: " << ZDICT_getErrorName(size) << std::endl;
+        dictionary.clear();
+        return false;
+    }
+    dictionary.resize(size);
+    return true;
+#else
+    (void)samples;
+    (void)dictionaryBytes;
+    dictionary.clear();
+    std::cerr << "Error: This build has no zstd support, so it cannot train dictionaries." << std::endl;
+    return false;
+#endif
+}
@@ -0,0 +1,87 @@
+#ifndef DOCUMENTCOMPRESSOR_H
+#define DOCUMENTCOMPRESSOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct z_stream_s;
+struct ZSTD_CCtx_s;
+struct ZSTD_CDict_s;
+
+struct CompressionOptions {
+    std::string format = "none"; // none, gzip or zstd (zstd needs a build with HL7_HAVE_ZSTD)
+    int level = 0;                // 0: the format's default (gzip 6, zstd 3)
+    std::string dictionaryPath;   // zstd only: dictionary from --train-dictionary
+};
+
+struct CompressionStats {
+    unsigned long documents = 0;
+    std::uint64_t inputBytes = 0;
+    std::uint64_t outputBytes = 0;
+    double seconds = 0.0;
+
+    double ratio() const { return outputBytes == 0 ? 0.0 : static_cast<double>(inputBytes) / outputBytes; }
+    double megabytesPerSecond() const { return seconds <= 0 ? 0.0 : inputBytes / (1024.0 * 1024.0) / seconds; }
+};
+
+// Compresses documents on the thread that generated them, before they are handed to the
+// writer. compress() produces one complete gzip member or zstd frame per document. A
+// stream (beginStream / appendStream / endStream) compresses several documents as one
+// member or frame, so each document is compressed with the context of those before it;
+// DocumentBundle uses it. CDA headers repeat almost verbatim from document to document,
+// which a zstd dictionary trained on sample documents captures even for the first bytes
+// of each one.
+//
+// Keeps its compression context between documents; use one per thread.
+class DocumentCompressor {
+public:
+    explicit DocumentCompressor(const CompressionOptions& options);
+    ~DocumentCompressor();
+
+    DocumentCompressor(const DocumentCompressor&) = delete;
+    DocumentCompressor& operator=(const DocumentCompressor&) = delete;
+
+    // Sets up the context and loads the dictionary; false (after logging) if the format
+    // is unavailable or the dictionary cannot be read
+    bool open();
+
+    bool enabled() const { return format != Format::None; }
+    const char* extension() const; // ".gz", ".zst" or ""
+    const char* formatName() const;
+
+    // Replaces `out` with the compressed form of data[0, size)
+    bool compress(const char* data, size_t size, std::string& out);
+    bool compress(const std::string& document, std::string& out) { return compress(document.data(), document.size(), out); }
+
+    // Starts a new gzip member or zstd frame, dropping any stream left unfinished
+    bool beginStream();
+    // Compresses data[0, size) as one document of the stream, appending to `out` what the
+    // compressor releases so far
+    bool appendStream(const char* data, size_t size, std::string& out);
+    // Compresses the trailing data[0, size) (not counted as a document) and ends the stream
+    bool endStream(const char* data, size_t size, std::string& out);
+
+    const CompressionStats& stats() const { return counters; }
+
+    // Trains a zstd dictionary of at most `dictionaryBytes` from sample documents
+    static bool trainDictionary(const std::vector<std::string>& samples, size_t dictionaryBytes, std::string& dictionary);
+    static bool zstdAvailable();
+
+private:
+    enum class Format { None, Gzip, Zstd };
+
+    CompressionOptions options;
+    Format format;
+    std::unique_ptr<z_stream_s> deflater; // Set once deflateInit2 succeeded
+    ZSTD_CCtx_s* zstdContext;
+    ZSTD_CDict_s* zstdDictionary;
+    CompressionStats counters;
+
+    bool streamInto(const char* data, size_t size, bool last, std::string& out);
+    void count(size_t inputBytes, size_t outputBytes, std::chrono::steady_clock::duration elapsed, bool document);
+};
+
+#endif // DOCUMENTCOMPRESSOR_H
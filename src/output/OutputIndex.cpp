@@ -0,0 +1,216 @@
+#include "OutputIndex.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "OutputLayout.h"
+#include "../config_manager/ConfigManager.h"
+
+namespace {
+
+const char INDEX_HEADER[] = "# HL7Generator output index v1\n";
+
+bool writeAll(int fd, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t written = ::write(fd, data.data() + offset, data.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+OutputIndex::OutputIndex(const std::string& path) : path(path), fd(-1), loadedSize(0) {
+}
+
+OutputIndex::~OutputIndex() {
+    close();
+}
+
+bool OutputIndex::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) {
+        return true;
+    }
+    entries.clear();
+    loadedSize = 0;
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open output index " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::cerr << "Error: Cannot read output index " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // Drop a torn last line (crash in the middle of an append). Only done on open: a
+    // partial line seen later may still be in the middle of another process's write.
+    if (info.st_size > 0) {
+        char last = 0;
+        if (pread(fd, &last, 1, info.st_size - 1) == 1 && last != '\n') {
+            off_t keep = info.st_size - 1;
+            char c = 0;
+            while (keep > 0 && pread(fd, &c, 1, keep - 1) == 1 && c != '\n') {
+                --keep;
+            }
+            std::cerr << "Warning: Discarding an incomplete last entry in " << path << "." << std::endl;
+            if (ftruncate(fd, keep) != 0) {
+                std::cerr << "Error: Cannot truncate " << path << ": " << std::strerror(errno) << std::endl;
+                ::close(fd);
+                fd = -1;
+                return false;
+            }
+            info.st_size = keep;
+        }
+    }
+    if (info.st_size == 0 && (!writeAll(fd, INDEX_HEADER) || ::fdatasync(fd) != 0)) {
+        std::cerr << "Error: Cannot write output index " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    readNewLines();
+    std::cout << "Output index " << path << ": " << entries.size() << " studies." << std::endl;
+    return true;
+}
+
+void OutputIndex::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) {
+        ::fdatasync(fd);
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void OutputIndex::readNewLines() {
+    if (fd < 0) {
+        return;
+    }
+    std::string contents;
+    char buffer[65536];
+    off_t offset = loadedSize;
+    for (;;) {
+        ssize_t got = pread(fd, buffer, sizeof(buffer), offset);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Warning: Cannot read output index " << path << ": " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        contents.append(buffer, static_cast<size_t>(got));
+        offset += got;
+    }
+
+    // Whole lines only; a partial one is picked up once its writer has finished it
+    size_t end = contents.find_last_of('\n');
+    if (end == std::string::npos) {
+        return;
+    }
+    size_t start = 0;
+    while (start <= end) {
+        size_t newline = contents.find('\n', start);
+        if (newline > start && contents[start] != '#') {
+            size_t tab = contents.find('\t', start);
+            if (tab != std::string::npos && tab > start && tab < newline) {
+                Entry& entry = entries[contents.substr(start, tab - start)];
+                size_t hashTab = contents.find('\t', tab + 1);
+                if (hashTab < newline) {
+                    entry.relativePath = contents.substr(tab + 1, hashTab - tab - 1);
+                    entry.contentHash = contents.substr(hashTab + 1, newline - hashTab - 1);
+                } else {
+                    entry.relativePath = contents.substr(tab + 1, newline - tab - 1);
+                    entry.contentHash.clear();
+                }
+            }
+        }
+        start = newline + 1;
+    }
+    loadedSize += static_cast<off_t>(end + 1);
+}
+
+bool OutputIndex::lookup(const std::string& studyUid, std::string& relativePath, std::string* contentHash) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(studyUid);
+    if (it == entries.end()) {
+        readNewLines();
+        it = entries.find(studyUid);
+        if (it == entries.end()) {
+            return false;
+        }
+    }
+    relativePath = it->second.relativePath;
+    if (contentHash) {
+        *contentHash = it->second.contentHash;
+    }
+    return true;
+}
+
+bool OutputIndex::record(const std::string& studyUid, const std::string& relativePath, const std::string& contentHash) {
+    if (studyUid.empty() || studyUid.find_first_of("\t\n") != std::string::npos || relativePath.find_first_of("\t\n") != std::string::npos ||
+        contentHash.find_first_of("\t\n") != std::string::npos) {
+        std::cerr << "Warning: Not indexing study " << studyUid << ": empty UID, or tab or newline in the UID or path." << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) {
+        return false;
+    }
+    auto it = entries.find(studyUid);
+    if (it != entries.end() && it->second.relativePath == relativePath && it->second.contentHash == contentHash) {
+        return true;
+    }
+    // One write per line: O_APPEND keeps lines from different processes whole
+    std::string line = studyUid + "\t" + relativePath;
+    if (!contentHash.empty()) {
+        line += "\t" + contentHash;
+    }
+    if (!writeAll(fd, line + "\n")) {
+        std::cerr << "Error: Cannot append to output index " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    entries[studyUid] = Entry{relativePath, contentHash};
+    return true;
+}
+
+std::string OutputIndex::documentFile(const std::string& root, const std::string& relativePath) {
+    struct stat info;
+    std::string file = OutputLayout::join(root, relativePath);
+    if (stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+        return file;
+    }
+    // Segment and bundle names have no '#', so the first one separates the record
+    size_t hash = relativePath.find('#');
+    if (hash == std::string::npos) {
+        return "";
+    }
+    file = OutputLayout::join(root, relativePath.substr(0, hash));
+    return stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode) ? file : "";
+}
+
+std::string OutputIndex::outputSettingsKey(const AppConfig& config, const std::string& sink) {
+    std::string key = sink + ";" + config.outputScheme + ";" + std::to_string(config.outputHashLevels);
+    if (sink == "segments") {
+        return key + ";" + (config.batchSegmentCompress ? "zlib" : "none");
+    }
+    return key + ";" + config.compressionFormat + ";" + std::to_string(config.compressionLevel) + ";" + config.compressionDictionaryPath;
+}
+
+size_t OutputIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
@@ -0,0 +1,75 @@
+#ifndef OUTPUTINDEX_H
+#define OUTPUTINDEX_H
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <sys/types.h>
+
+struct AppConfig;
+
+// Append-only map from study UID to the document written for it, one
+// "<study UID>\t<path relative to the output path>[\t<content hash>]" line each, kept next
+// to the documents (<OutputPath>/index.tsv by default). Finding a study's report is a hash
+// lookup instead of a scan of the output tree, whatever OutputLayout scheme wrote it.
+// Documents in batch output segments are indexed as "<segment>#<record offset>"
+// (SegmentWriter), bundled ones as "bundles/<bundle>#<entry>" (DocumentBundle).
+//
+// The content hash (HL7MessageGenerator::inputHash) identifies the inputs the document was
+// generated from; worker and batch mode skip a study whose inputs hash the same and whose
+// document is still there. Lines without one (interactive saves) never match.
+//
+// Lines are appended with O_APPEND after the document has been renamed into place, so
+// every path in the index names a complete document, and batch runs, job workers and the
+// interactive mode of any number of processes can share one index. The last line for a
+// study wins; a study written again to the same path adds no line. Lines are not fsynced
+// one by one: a crash can lose the last few, which only means those studies are not
+// found until they are written again. A torn last line is discarded on open.
+//
+// All methods are thread-safe.
+class OutputIndex {
+public:
+    explicit OutputIndex(const std::string& path);
+    ~OutputIndex();
+
+    OutputIndex(const OutputIndex&) = delete;
+    OutputIndex& operator=(const OutputIndex&) = delete;
+
+    // Loads the existing entries and opens the file for appending (creating it)
+    bool open();
+    void close(); // fdatasyncs first
+
+    // Path recorded for the study, relative to the output path, and its content hash
+    // (empty if none was recorded). A miss first reads the lines other processes have
+    // appended since the last look.
+    bool lookup(const std::string& studyUid, std::string& relativePath, std::string* contentHash = nullptr);
+
+    // Call after the document is in place
+    bool record(const std::string& studyUid, const std::string& relativePath, const std::string& contentHash = "");
+
+    // The file holding an indexed document below `root` (a segment or bundle for a
+    // "...#..." entry), or an empty string if it does not exist
+    static std::string documentFile(const std::string& root, const std::string& relativePath);
+
+    // The settings that decide how and where a document is written, for the content hash:
+    // a document written differently is not reused. `sink` is "files", "bundles" or "segments".
+    static std::string outputSettingsKey(const AppConfig& config, const std::string& sink);
+
+    size_t size() const;
+    const std::string& getPath() const { return path; }
+
+private:
+    std::string path;
+    int fd;
+    off_t loadedSize; // Bytes of the file already parsed into `entries`
+    mutable std::mutex mutex;
+    struct Entry {
+        std::string relativePath;
+        std::string contentHash;
+    };
+    std::unordered_map<std::string, Entry> entries;
+
+    void readNewLines(); // Caller holds `mutex`
+};
+
+#endif // OUTPUTINDEX_H
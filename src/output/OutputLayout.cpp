@@ -0,0 +1,106 @@
+#include "OutputLayout.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+
+const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+// Stable across builds and platforms, unlike std::hash: the layout of an existing tree
+// must not change with the compiler
+std::uint64_t fnv1a(const std::string& text) {
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// UIDs are digits and dots; anything else a source might hold must not reach the file system
+std::string fileNameComponent(const std::string& text) {
+    std::string name = text;
+    for (char& c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+    if (name.find_first_not_of('.') == std::string::npos) {
+        name.insert(0, "_"); // Never "." or ".."
+    }
+    return name;
+}
+
+std::string flatName(const Patient& patient, const Study& study) {
+    return "ORU_" + patient.patientID + "_" + study.accessionNumber + ".xml";
+}
+
+} // namespace
+
+OutputLayout::OutputLayout(const std::string& scheme, int hashLevels)
+    : scheme(scheme == "hash" || scheme == "date" ? scheme : "flat"), hashLevels(std::min(4, std::max(1, hashLevels))) {
+}
+
+std::string OutputLayout::relativePath(const Patient& patient, const Study& study) const {
+    if (scheme == "flat" || study.studyInstanceUID.empty()) {
+        return flatName(patient, study);
+    }
+    std::string fileName = fileNameComponent(study.studyInstanceUID) + ".xml";
+    if (scheme == "hash") {
+        static const char HEX[] = "0123456789abcdef";
+        std::uint64_t hash = fnv1a(study.studyInstanceUID);
+        std::string path;
+        for (int level = 0; level < hashLevels; ++level) {
+            path += HEX[(hash >> 60) & 0xF];
+            path += HEX[(hash >> 56) & 0xF];
+            path += '/';
+            hash <<= 8;
+        }
+        return path + fileName;
+    }
+    const std::string& date = study.studyDate;
+    if (date.size() >= 8 && std::all_of(date.begin(), date.begin() + 8, [](char c) { return c >= '0' && c <= '9'; })) {
+        return date.substr(0, 4) + "/" + date.substr(4, 2) + "/" + date.substr(6, 2) + "/" + fileName;
+    }
+    return "undated/" + fileName;
+}
+
+bool OutputLayout::createParentDirectories(const std::string& root, const std::string& relativePath) {
+    // Consecutive documents mostly land in a directory this thread has already made
+    thread_local std::string lastCreated;
+    size_t slash = relativePath.find_last_of('/');
+    if (slash == std::string::npos) {
+        return true;
+    }
+    std::string directory = join(root, relativePath.substr(0, slash));
+    if (directory == lastCreated) {
+        return true;
+    }
+    size_t position = root.size();
+    while (position != std::string::npos) {
+        position = directory.find('/', position + 1);
+        std::string prefix = directory.substr(0, position);
+        if (prefix.empty() || prefix.back() == '/') {
+            continue;
+        }
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            std::cerr << "Error: Cannot create output directory " << prefix << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    lastCreated = directory;
+    return true;
+}
+
+std::string OutputLayout::join(const std::string& root, const std::string& relativePath) {
+    if (root.empty() || (!relativePath.empty() && relativePath[0] == '/')) {
+        return relativePath;
+    }
+    return root.back() == '/' ? root + relativePath : root + "/" + relativePath;
+}
@@ -0,0 +1,40 @@
+#ifndef OUTPUTLAYOUT_H
+#define OUTPUTLAYOUT_H
+
+#include <string>
+#include "../models/Patient.h"
+#include "../models/Study.h"
+
+// Where a study's document goes under the output path (<GeneralSettings><OutputPath>).
+//
+//   flat  ORU_<patient ID>_<accession number>.xml, all in one directory
+//   hash  ab/cd/<study UID>.xml, the directories taken from an FNV-1a hash of the UID, so
+//         every directory stays small however many studies there are
+//   date  YYYY/MM/DD/<study UID>.xml from the study date (undated/<study UID>.xml without one)
+//
+// Paths are relative to the output path, so OutputIndex entries stay valid when the tree
+// is moved. A study without a UID falls back to its flat name in every scheme.
+class OutputLayout {
+public:
+    // `scheme` is one of the names above (anything else is flat); `hashLevels` is the
+    // number of two-hex-digit directories of the hash scheme (1-4)
+    OutputLayout(const std::string& scheme, int hashLevels);
+
+    std::string relativePath(const Patient& patient, const Study& study) const;
+
+    const std::string& getScheme() const { return scheme; }
+
+    // Creates the directories of `relativePath` below `root` (mkdir -p). Safe to call from
+    // several threads or processes at once.
+    static bool createParentDirectories(const std::string& root, const std::string& relativePath);
+
+    // root + "/" + relativePath, without doubling a trailing slash of the root; an absolute
+    // relativePath is returned as it is
+    static std::string join(const std::string& root, const std::string& relativePath);
+
+private:
+    std::string scheme;
+    int hashLevels;
+};
+
+#endif // OUTPUTLAYOUT_H
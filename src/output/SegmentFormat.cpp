@@ -0,0 +1,62 @@
+#include "SegmentFormat.h"
+#include <cstdio>
+
+namespace {
+
+void putLittle(unsigned char* out, std::uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+std::uint64_t getLittle(const unsigned char* in, size_t bytes) {
+    std::uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+void encodeSegmentRecordHeader(const SegmentRecordHeader& header, unsigned char* out) {
+    putLittle(out, SEGMENT_RECORD_MAGIC, 4);
+    putLittle(out + 4, header.flags, 2);
+    putLittle(out + 6, header.studyUidLength, 2);
+    putLittle(out + 8, header.documentIdLength, 2);
+    putLittle(out + 10, 0, 2);
+    putLittle(out + 12, header.crc, 4);
+    putLittle(out + 16, header.storedLength, 8);
+    putLittle(out + 24, header.originalLength, 8);
+}
+
+bool decodeSegmentRecordHeader(const unsigned char* in, SegmentRecordHeader& header) {
+    if (getLittle(in, 4) != SEGMENT_RECORD_MAGIC) {
+        return false;
+    }
+    header.flags = static_cast<std::uint16_t>(getLittle(in + 4, 2));
+    header.studyUidLength = static_cast<std::uint16_t>(getLittle(in + 6, 2));
+    header.documentIdLength = static_cast<std::uint16_t>(getLittle(in + 8, 2));
+    header.crc = static_cast<std::uint32_t>(getLittle(in + 12, 4));
+    header.storedLength = getLittle(in + 16, 8);
+    header.originalLength = getLittle(in + 24, 8);
+    return true;
+}
+
+std::string segmentFileName(const std::string& directory, unsigned number, const char* extension) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%06u.%s", number, extension);
+    if (directory.empty()) {
+        return name;
+    }
+    return directory.back() == '/' ? directory + name : directory + "/" + name;
+}
+
+std::string segmentIndexPath(const std::string& segmentPath) {
+    size_t dot = segmentPath.find_last_of('.');
+    size_t slash = segmentPath.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return segmentPath + ".idx";
+    }
+    return segmentPath.substr(0, dot) + ".idx";
+}
@@ -0,0 +1,46 @@
+#ifndef SEGMENTFORMAT_H
+#define SEGMENTFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk layout of the segment files written by SegmentWriter and read by SegmentReader.
+// All integers are little-endian.
+//
+//   segment-000001.seg   16-byte file header ("HL7SEG", version, zero padding), then records:
+//     u32 magic "HREC" | u16 flags | u16 study UID length | u16 document ID length | u16 0
+//     u32 CRC-32 of the stored payload | u64 stored length | u64 original length   (32 bytes)
+//     study UID | document ID | payload (zlib-compressed when flags has SEGMENT_ZLIB)
+//   segment-000001.idx   "<study UID>\t<document ID>\t<offset>\t<record length>" per line,
+//     offsets of record headers; a line is only written once its record has been fsynced
+//
+// The keys are in the records too, so a segment whose sidecar was lost can still be scanned.
+
+const char SEGMENT_FILE_MAGIC[8] = {'H', 'L', '7', 'S', 'E', 'G', '\0', '\1'};
+const size_t SEGMENT_FILE_HEADER_SIZE = 16;
+const std::uint32_t SEGMENT_RECORD_MAGIC = 0x43455248; // "HREC"
+const size_t SEGMENT_RECORD_HEADER_SIZE = 32;
+const std::uint16_t SEGMENT_ZLIB = 1;
+
+struct SegmentRecordHeader {
+    std::uint16_t flags = 0;
+    std::uint16_t studyUidLength = 0;
+    std::uint16_t documentIdLength = 0;
+    std::uint32_t crc = 0;
+    std::uint64_t storedLength = 0;
+    std::uint64_t originalLength = 0;
+
+    std::uint64_t recordLength() const { return SEGMENT_RECORD_HEADER_SIZE + studyUidLength + documentIdLength + storedLength; }
+};
+
+void encodeSegmentRecordHeader(const SegmentRecordHeader& header, unsigned char* out);
+// False when the magic does not match
+bool decodeSegmentRecordHeader(const unsigned char* in, SegmentRecordHeader& header);
+
+// segment-<number>.seg / .idx in `directory`
+std::string segmentFileName(const std::string& directory, unsigned number, const char* extension);
+// The sidecar index of a segment path
+std::string segmentIndexPath(const std::string& segmentPath);
+
+#endif // SEGMENTFORMAT_H
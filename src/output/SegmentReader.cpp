@@ -0,0 +1,141 @@
+#include "SegmentReader.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+SegmentReader::SegmentReader(const std::string& segmentPath) : path(segmentPath), mapped(nullptr), mappedSize(0) {
+}
+
+SegmentReader::~SegmentReader() {
+    if (mapped) {
+        munmap(const_cast<unsigned char*>(mapped), mappedSize);
+    }
+}
+
+bool SegmentReader::open() {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open segment " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < SEGMENT_FILE_HEADER_SIZE) {
+        std::cerr << "Error: " << path << " is not a segment file." << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping keeps the file open
+    if (address == MAP_FAILED) {
+        std::cerr << "Error: Cannot map segment " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    mapped = static_cast<const unsigned char*>(address);
+    mappedSize = static_cast<std::uint64_t>(info.st_size);
+    if (std::memcmp(mapped, SEGMENT_FILE_MAGIC, sizeof(SEGMENT_FILE_MAGIC)) != 0) {
+        std::cerr << "Error: " << path << " is not a segment file." << std::endl;
+        return false;
+    }
+    // Extractions jump around the file; readahead of neighbouring records is wasted
+    madvise(address, static_cast<size_t>(mappedSize), MADV_RANDOM);
+    return true;
+}
+
+bool SegmentReader::loadIndex() {
+    std::string indexPath = segmentIndexPath(path);
+    std::ifstream in(indexPath);
+    if (!in.is_open()) {
+        std::cerr << "Error: Cannot open segment index " << indexPath << "." << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t first = line.find('\t');
+        size_t second = first == std::string::npos ? first : line.find('\t', first + 1);
+        if (second == std::string::npos) {
+            continue;
+        }
+        std::uint64_t offset = std::strtoull(line.c_str() + second + 1, nullptr, 10);
+        offsets[line.substr(0, first)] = offset;
+        if (second > first + 1) {
+            offsets[line.substr(first + 1, second - first - 1)] = offset;
+        }
+    }
+    return true;
+}
+
+bool SegmentReader::find(const std::string& key, std::uint64_t& offset) const {
+    auto it = offsets.find(key);
+    if (it == offsets.end()) {
+        return false;
+    }
+    offset = it->second;
+    return true;
+}
+
+bool SegmentReader::readRecord(std::uint64_t offset, SegmentRecord& record) const {
+    SegmentRecordHeader header;
+    if (!mapped || offset < SEGMENT_FILE_HEADER_SIZE || offset > mappedSize || mappedSize - offset < SEGMENT_RECORD_HEADER_SIZE ||
+        !decodeSegmentRecordHeader(mapped + offset, header) || header.storedLength > mappedSize ||
+        header.recordLength() > mappedSize - offset) {
+        return false;
+    }
+    const char* keys = reinterpret_cast<const char*>(mapped + offset + SEGMENT_RECORD_HEADER_SIZE);
+    record.studyUid.assign(keys, header.studyUidLength);
+    record.documentId.assign(keys + header.studyUidLength, header.documentIdLength);
+    record.offset = offset;
+    record.length = header.recordLength();
+    record.storedLength = header.storedLength;
+    record.originalLength = header.originalLength;
+    record.crc = header.crc;
+    record.compressed = (header.flags & SEGMENT_ZLIB) != 0;
+    return true;
+}
+
+bool SegmentReader::read(std::uint64_t offset, SegmentRecord& record, std::string& document) const {
+    if (!readRecord(offset, record)) {
+        std::cerr << "Error: No record at offset " << offset << " of " << path << "." << std::endl;
+        return false;
+    }
+    const unsigned char* payload = mapped + offset + record.length - record.storedLength;
+    if (crc32(0L, payload, static_cast<uInt>(record.storedLength)) != record.crc) {
+        std::cerr << "Error: Checksum mismatch in the record at offset " << offset << " of " << path << "." << std::endl;
+        return false;
+    }
+    if (!record.compressed) {
+        document.assign(reinterpret_cast<const char*>(payload), record.storedLength);
+        return true;
+    }
+    document.resize(record.originalLength);
+    uLongf size = static_cast<uLongf>(record.originalLength);
+    if (uncompress(reinterpret_cast<Bytef*>(&document[0]), &size, payload, static_cast<uLong>(record.storedLength)) != Z_OK ||
+        size != record.originalLength) {
+        std::cerr << "Error: Cannot inflate the record at offset " << offset << " of " << path << "." << std::endl;
+        document.clear();
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t SegmentReader::scan(const std::function<void(const SegmentRecord& record)>& visit) const {
+    std::uint64_t offset = SEGMENT_FILE_HEADER_SIZE;
+    SegmentRecord record;
+    while (offset < mappedSize && readRecord(offset, record)) {
+        const unsigned char* payload = mapped + offset + record.length - record.storedLength;
+        if (crc32(0L, payload, static_cast<uInt>(record.storedLength)) != record.crc) {
+            break;
+        }
+        visit(record);
+        offset += record.length;
+    }
+    return offset;
+}
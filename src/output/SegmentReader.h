@@ -0,0 +1,58 @@
+#ifndef SEGMENTREADER_H
+#define SEGMENTREADER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include "SegmentFormat.h"
+
+struct SegmentRecord {
+    std::string studyUid;
+    std::string documentId;
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;         // Whole record
+    std::uint64_t storedLength = 0;
+    std::uint64_t originalLength = 0;
+    std::uint32_t crc = 0;
+    bool compressed = false;
+};
+
+// Read side of SegmentWriter: maps a segment file and extracts records from it. Reading
+// one record at a known offset touches only that record's pages, so it costs the same
+// in a 1 GB segment as in a small one; the offset comes from the sidecar index (loadIndex,
+// then find) or from the OutputIndex entry written for the study ("<segment>#<offset>").
+class SegmentReader {
+public:
+    explicit SegmentReader(const std::string& segmentPath);
+    ~SegmentReader();
+
+    SegmentReader(const SegmentReader&) = delete;
+    SegmentReader& operator=(const SegmentReader&) = delete;
+
+    bool open(); // mmaps the segment
+    // Loads the sidecar index, keyed by both study UID and document ID
+    bool loadIndex();
+    bool find(const std::string& key, std::uint64_t& offset) const;
+
+    // Decodes the record at `offset`, checks its CRC and inflates it into `document`
+    bool read(std::uint64_t offset, SegmentRecord& record, std::string& document) const;
+    // Header and keys only
+    bool readRecord(std::uint64_t offset, SegmentRecord& record) const;
+
+    // Walks the records from the start without the sidecar, stopping at the end or at the
+    // first record that is cut off or corrupt (the uncommitted tail after a crash).
+    // Returns the offset where the walk stopped.
+    std::uint64_t scan(const std::function<void(const SegmentRecord& record)>& visit) const;
+
+    std::uint64_t size() const { return mappedSize; }
+    const std::string& getPath() const { return path; }
+
+private:
+    std::string path;
+    const unsigned char* mapped;
+    std::uint64_t mappedSize;
+    std::unordered_map<std::string, std::uint64_t> offsets; // Study UID and document ID -> record offset
+};
+
+#endif // SEGMENTREADER_H
@@ -0,0 +1,236 @@
+#include "SegmentWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "../tracing/Tracer.h"
+
+namespace {
+
+const char INDEX_HEADER[] = "# HL7Generator segment index v1\n";
+const size_t WRITE_BUFFER_SIZE = 4 << 20;
+const int COMPRESSION_LEVEL = 6; // Documents are written once and read rarely
+
+bool writeAll(int fd, const char* data, size_t size) {
+    size_t offset = 0;
+    while (offset < size) {
+        ssize_t written = ::write(fd, data + offset, size - offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Highest N of the segment-N.seg files in `directory`, 0 if none
+unsigned lastSegmentNumber(const std::string& directory) {
+    unsigned last = 0;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return 0;
+    }
+    while (dirent* entry = readdir(dir)) {
+        unsigned number = 0;
+        char extension[4] = {0};
+        if (std::sscanf(entry->d_name, "segment-%u.%3s", &number, extension) == 2 && std::strcmp(extension, "seg") == 0) {
+            last = std::max(last, number);
+        }
+    }
+    closedir(dir);
+    return last;
+}
+
+} // namespace
+
+SegmentWriter::SegmentWriter(const SegmentWriterOptions& options, DurableCallback onDurable)
+    : options(options), onDurable(std::move(onDurable)), segmentNumber(0), segmentFd(-1), indexFd(-1), segmentSize(0),
+      segmentEntrySynced(false) {
+    if (this->options.groupSize == 0) {
+        this->options.groupSize = 1;
+    }
+}
+
+SegmentWriter::~SegmentWriter() {
+    close();
+}
+
+bool SegmentWriter::open() {
+    close();
+    if (mkdir(options.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Error: Cannot create segment directory " << options.directory << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    segmentNumber = lastSegmentNumber(options.directory);
+    buffer.reserve(WRITE_BUFFER_SIZE);
+    lastCommit = std::chrono::steady_clock::now();
+    return startSegment();
+}
+
+void SegmentWriter::close() {
+    if (segmentFd >= 0) {
+        commit();
+        closeSegment();
+    }
+}
+
+bool SegmentWriter::startSegment() {
+    ++segmentNumber;
+    segmentPath = segmentFileName(options.directory, segmentNumber, "seg");
+    std::string indexPath = segmentIndexPath(segmentPath);
+    // O_EXCL: a second writer on the same directory fails here instead of interleaving
+    segmentFd = ::open(segmentPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (segmentFd < 0) {
+        std::cerr << "Error: Cannot create segment " << segmentPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    indexFd = ::open(indexPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (indexFd < 0) {
+        std::cerr << "Error: Cannot create segment index " << indexPath << ": " << std::strerror(errno) << std::endl;
+        ::close(segmentFd);
+        segmentFd = -1;
+        return false;
+    }
+    buffer.assign(SEGMENT_FILE_MAGIC, sizeof(SEGMENT_FILE_MAGIC));
+    buffer.append(SEGMENT_FILE_HEADER_SIZE - sizeof(SEGMENT_FILE_MAGIC), '\0');
+    segmentSize = buffer.size();
+    if (!writeAll(indexFd, INDEX_HEADER, sizeof(INDEX_HEADER) - 1)) {
+        std::cerr << "Error: Cannot write segment index " << indexPath << ": " << std::strerror(errno) << std::endl;
+        closeSegment();
+        return false;
+    }
+    segmentEntrySynced = false;
+    ++counters.segments;
+    std::cout << "Segment writer: writing " << segmentPath << std::endl;
+    return true;
+}
+
+void SegmentWriter::closeSegment() {
+    if (segmentFd >= 0) {
+        ::close(segmentFd);
+        segmentFd = -1;
+    }
+    if (indexFd >= 0) {
+        ::close(indexFd);
+        indexFd = -1;
+    }
+}
+
+bool SegmentWriter::flushBuffer() {
+    if (!buffer.empty() && !writeAll(segmentFd, buffer.data(), buffer.size())) {
+        std::cerr << "Error: Cannot write segment " << segmentPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    buffer.clear();
+    return true;
+}
+
+bool SegmentWriter::append(const std::string& studyUid, const std::string& documentId, const std::string& document) {
+    if (segmentFd < 0) {
+        return false;
+    }
+    if (studyUid.size() > 0xFFFF || documentId.size() > 0xFFFF || studyUid.find_first_of("\t\n") != std::string::npos ||
+        documentId.find_first_of("\t\n") != std::string::npos) {
+        std::cerr << "Warning: Not writing study " << studyUid << " to a segment: UID or document ID unusable as a key." << std::endl;
+        return false;
+    }
+
+    SegmentRecordHeader header;
+    header.studyUidLength = static_cast<std::uint16_t>(studyUid.size());
+    header.documentIdLength = static_cast<std::uint16_t>(documentId.size());
+    header.originalLength = document.size();
+    const unsigned char* payload = reinterpret_cast<const unsigned char*>(document.data());
+    header.storedLength = document.size();
+    if (options.compress) {
+        uLongf size = compressBound(static_cast<uLong>(document.size()));
+        compressed.resize(size);
+        if (compress2(compressed.data(), &size, payload, static_cast<uLong>(document.size()), COMPRESSION_LEVEL) == Z_OK &&
+            size < document.size()) {
+            header.flags |= SEGMENT_ZLIB;
+            header.storedLength = size;
+            payload = compressed.data();
+        }
+    }
+    header.crc = static_cast<std::uint32_t>(crc32(0L, payload, static_cast<uInt>(header.storedLength)));
+
+    // Rotate before a record that would cross the limit, unless the segment has none yet
+    if (segmentSize + header.recordLength() > options.segmentBytes && segmentSize > SEGMENT_FILE_HEADER_SIZE) {
+        if (!commit()) {
+            return false;
+        }
+        closeSegment();
+        if (!startSegment()) {
+            return false;
+        }
+    }
+
+    unsigned char encoded[SEGMENT_RECORD_HEADER_SIZE];
+    encodeSegmentRecordHeader(header, encoded);
+    std::uint64_t offset = segmentSize;
+    buffer.append(reinterpret_cast<const char*>(encoded), sizeof(encoded));
+    buffer += studyUid;
+    buffer += documentId;
+    buffer.append(reinterpret_cast<const char*>(payload), header.storedLength);
+    segmentSize += header.recordLength();
+    if (buffer.size() >= WRITE_BUFFER_SIZE && !flushBuffer()) {
+        return false;
+    }
+
+    pending.push_back({studyUid, documentId, offset, header.recordLength()});
+    ++counters.records;
+    counters.originalBytes += header.originalLength;
+    counters.storedBytes += header.storedLength;
+    if (pending.size() >= options.groupSize ||
+        std::chrono::steady_clock::now() - lastCommit >= std::chrono::milliseconds(options.syncIntervalMs)) {
+        return commit();
+    }
+    return true;
+}
+
+bool SegmentWriter::commit() {
+    lastCommit = std::chrono::steady_clock::now();
+    if (segmentFd < 0) {
+        return false;
+    }
+    if (pending.empty()) {
+        return true;
+    }
+    HL7_TRACE_SCOPE("segmentCommit");
+
+    // Records first, then the index lines that point to them
+    if (!flushBuffer() || ::fdatasync(segmentFd) != 0) {
+        std::cerr << "Error: Cannot sync segment " << segmentPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (!segmentEntrySynced) {
+        // The new segment and sidecar must survive a crash along with their first records
+        int dirFd = ::open(options.directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        segmentEntrySynced = dirFd >= 0 && ::fsync(dirFd) == 0;
+        if (dirFd >= 0) {
+            ::close(dirFd);
+        }
+    }
+    std::string lines;
+    for (const PendingRecord& record : pending) {
+        lines += record.studyUid + "\t" + record.documentId + "\t" + std::to_string(record.offset) + "\t" + std::to_string(record.length) + "\n";
+    }
+    if (!writeAll(indexFd, lines.data(), lines.size()) || ::fdatasync(indexFd) != 0) {
+        std::cerr << "Error: Cannot append to segment index of " << segmentPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ++counters.syncs;
+    if (onDurable) {
+        for (const PendingRecord& record : pending) {
+            onDurable(record.studyUid, SegmentLocation{segmentPath, record.offset});
+        }
+    }
+    pending.clear();
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef SEGMENTWRITER_H
+#define SEGMENTWRITER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "SegmentFormat.h"
+
+struct SegmentWriterOptions {
+    std::string directory;
+    std::uint64_t segmentBytes = 1ULL << 30; // A record that would cross this starts the next segment
+    bool compress = false;                   // zlib per record, kept only when it saves space
+    size_t groupSize = 64;                   // Records per fsync
+    int syncIntervalMs = 1000;               // Longest a record waits for its fsync
+};
+
+// Where a record went: the segment and the offset of its header there
+struct SegmentLocation {
+    std::string segmentPath;
+    std::uint64_t offset = 0;
+};
+
+struct SegmentWriterStats {
+    unsigned long records = 0;
+    unsigned long segments = 0;
+    unsigned long syncs = 0;
+    std::uint64_t originalBytes = 0;
+    std::uint64_t storedBytes = 0; // Payloads as written, after compression
+};
+
+// Bulk output sink: appends documents as length-prefixed records to large segment files
+// (SegmentFormat.h) instead of writing a file per document, so a run of millions of
+// studies leaves a few files behind rather than millions.
+//
+// Writes are strictly sequential and buffered. Records are group-committed like the
+// checkpoint journal: every `groupSize` records (or `syncIntervalMs`) the segment is
+// fdatasynced, then the records' lines are appended to the sidecar index and it is
+// fdatasynced too, and only then is `onDurable` called for each of them. A crash loses at
+// most the uncommitted group; the tail it leaves in the segment is never indexed. Every
+// open() starts a new segment after the highest-numbered one in the directory, so earlier
+// segments are never modified.
+//
+// Not thread-safe; one writer per directory.
+class SegmentWriter {
+public:
+    using DurableCallback = std::function<void(const std::string& studyUid, const SegmentLocation& location)>;
+
+    SegmentWriter(const SegmentWriterOptions& options, DurableCallback onDurable);
+    ~SegmentWriter(); // Commits pending records
+
+    SegmentWriter(const SegmentWriter&) = delete;
+    SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+    bool open();
+    void close();
+
+    bool append(const std::string& studyUid, const std::string& documentId, const std::string& document);
+    bool commit();
+
+    const SegmentWriterStats& stats() const { return counters; }
+
+private:
+    struct PendingRecord {
+        std::string studyUid;
+        std::string documentId;
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+
+    SegmentWriterOptions options;
+    DurableCallback onDurable;
+    unsigned segmentNumber;
+    std::string segmentPath;
+    int segmentFd;
+    int indexFd;
+    std::uint64_t segmentSize; // Including buffered bytes
+    bool segmentEntrySynced;   // The directory has been fsynced since the segment was created
+    std::string buffer;        // Record bytes not yet written
+    std::vector<unsigned char> compressed;
+    std::vector<PendingRecord> pending;
+    std::chrono::steady_clock::time_point lastCommit;
+    SegmentWriterStats counters;
+
+    bool startSegment();
+    void closeSegment();
+    bool flushBuffer();
+};
+
+#endif // SEGMENTWRITER_H
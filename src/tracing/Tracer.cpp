@@ -0,0 +1,218 @@
+#include "Tracer.h"
+#include <iostream>
+
+#ifdef HL7_ENABLE_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    std::uint64_t startNanos;
+    std::uint64_t durationNanos;
+    char detail[80]; // Truncated between UTF-8 characters, NUL-terminated
+};
+
+// Written only by its own thread; read by writeChromeTrace
+struct ThreadTraceBuffer {
+    unsigned tid;
+    std::string threadName; // Guarded by registryMutex
+    std::vector<TraceEvent> events;
+    std::atomic<std::uint64_t> written{0};
+};
+
+std::atomic<bool> tracingEnabled(false);
+size_t eventsPerThread = Tracer::DEFAULT_EVENTS_PER_THREAD;
+const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadTraceBuffer>> registry; // Kept after threads exit, until written
+unsigned nextTid = 1;
+
+std::uint64_t nowNanos() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - traceEpoch).count());
+}
+
+ThreadTraceBuffer& localBuffer() {
+    thread_local std::shared_ptr<ThreadTraceBuffer> buffer;
+    if (!buffer) {
+        auto created = std::make_shared<ThreadTraceBuffer>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        created->tid = nextTid++;
+        created->threadName = "thread-" + std::to_string(created->tid);
+        created->events.resize(eventsPerThread);
+        registry.push_back(created);
+        buffer = created;
+    }
+    return *buffer;
+}
+
+void record(const char* name, std::uint64_t startNanos, const std::string& detail) {
+    ThreadTraceBuffer& buffer = localBuffer();
+    std::uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer.events[index % buffer.events.size()];
+    event.name = name;
+    event.startNanos = startNanos;
+    event.durationNanos = nowNanos() - startNanos;
+    size_t length = detail.size() < sizeof(event.detail) - 1 ? detail.size() : sizeof(event.detail) - 1;
+    while (length > 0 && length < detail.size() && (static_cast<unsigned char>(detail[length]) & 0xC0) == 0x80) {
+        --length; // Not in the middle of a multi-byte character
+    }
+    std::memcpy(event.detail, detail.data(), length);
+    event.detail[length] = '\0';
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void writeJsonString(std::ostream& out, const char* value) {
+    out << '"';
+    for (const char* p = value; *p; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\') out << '\\' << *p;
+        else if (c < 0x20) out << ' ';
+        else out << *p;
+    }
+    out << '"';
+}
+
+} // namespace
+
+bool Tracer::compiledIn() {
+    return true;
+}
+
+bool Tracer::enable(size_t eventsPerThreadLimit) {
+    eventsPerThread = eventsPerThreadLimit > 0 ? eventsPerThreadLimit : DEFAULT_EVENTS_PER_THREAD;
+    tracingEnabled.store(true, std::memory_order_relaxed);
+    std::cout << "Tracing enabled (" << eventsPerThread << " spans per thread)." << std::endl;
+    return true;
+}
+
+bool Tracer::enabled() {
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(const std::string& name) {
+    if (!enabled()) {
+        return;
+    }
+    ThreadTraceBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.threadName = name;
+}
+
+bool Tracer::writeChromeTrace(const std::string& filePath) {
+    std::ofstream out(filePath, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open trace file for writing: " << filePath << std::endl;
+        return false;
+    }
+    out.setf(std::ios::fixed);
+    out.precision(3);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::uint64_t spans = 0;
+    std::uint64_t dropped = 0;
+    bool first = true;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for (const auto& buffer : registry) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, buffer->threadName.c_str());
+        out << "}}";
+        first = false;
+
+        std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+        std::uint64_t capacity = buffer->events.size();
+        std::uint64_t begin = written > capacity ? written - capacity : 0;
+        dropped += begin;
+        for (std::uint64_t i = begin; i < written; ++i) {
+            const TraceEvent& event = buffer->events[i % capacity];
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"hl7\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << event.startNanos / 1000.0 << ",\"dur\":" << event.durationNanos / 1000.0;
+            if (event.detail[0] != '\0') {
+                out << ",\"args\":{\"detail\":";
+                writeJsonString(out, event.detail);
+                out << '}';
+            }
+            out << '}';
+            ++spans;
+        }
+    }
+    out << "\n]}\n";
+    if (!out.good()) {
+        std::cerr << "Error: Failed writing trace file: " << filePath << std::endl;
+        return false;
+    }
+    std::cout << "Trace written to " << filePath << " (" << spans << " spans";
+    if (dropped > 0) {
+        std::cout << ", " << dropped << " oldest spans overwritten";
+    }
+    std::cout << ")." << std::endl;
+    return true;
+}
+
+TraceSpan::TraceSpan(const char* name) : name(nullptr), startNanos(0) {
+    if (tracingEnabled.load(std::memory_order_relaxed)) {
+        this->name = name;
+        startNanos = nowNanos();
+    }
+}
+
+TraceSpan::TraceSpan(const char* name, const std::string& detail) : name(nullptr), startNanos(0) {
+    if (tracingEnabled.load(std::memory_order_relaxed)) {
+        this->name = name;
+        this->detail = detail;
+        startNanos = nowNanos();
+    }
+}
+
+TraceSpan::TraceSpan(const char* name, const std::string& detail, const std::string& more) : name(nullptr), startNanos(0) {
+    if (tracingEnabled.load(std::memory_order_relaxed)) {
+        this->name = name;
+        this->detail.reserve(detail.size() + 1 + more.size());
+        this->detail += detail;
+        this->detail += ' ';
+        this->detail += more;
+        startNanos = nowNanos();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (name) {
+        record(name, startNanos, detail);
+    }
+}
+
+#else // Tracing compiled out
+
+bool Tracer::compiledIn() {
+    return false;
+}
+
+bool Tracer::enable(size_t) {
+    std::cerr << "Warning: Tracing is not compiled in; rebuild with -DHL7_ENABLE_TRACING=ON to use --trace." << std::endl;
+    return false;
+}
+
+bool Tracer::enabled() {
+    return false;
+}
+
+void Tracer::setThreadName(const std::string&) {
+}
+
+bool Tracer::writeChromeTrace(const std::string&) {
+    return false;
+}
+
+#endif // HL7_ENABLE_TRACING
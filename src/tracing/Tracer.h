@@ -0,0 +1,71 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Opt-in timeline tracer. Scoped spans are recorded into per-thread ring buffers and
+// written as Chrome trace-event JSON (open in https://ui.perfetto.dev or chrome://tracing).
+//
+// Tracing is compiled in only with -DHL7_ENABLE_TRACING=ON; otherwise the HL7_TRACE_*
+// macros expand to nothing and their arguments are never evaluated. When compiled in,
+// a span costs one relaxed atomic load until --trace enables it at run time.
+//
+//   HL7_TRACE_SCOPE("addHeader");                          // Span for the enclosing scope
+//   HL7_TRACE_SCOPE_DETAIL("generate", study.studyInstanceUID); // Detail shown as an arg
+//   HL7_TRACE_SCOPE_DETAIL("httpRequest", request.method, request.path); // Joined with a space
+//   HL7_TRACE_THREAD_NAME("http-worker");
+//
+// Span names must be string literals; they are stored by pointer. Pass the parts of a
+// detail separately rather than concatenating them, so nothing is built while tracing is
+// off. Details are kept up to 79 bytes (a 64-character UID fits), cut between UTF-8 characters.
+class Tracer {
+public:
+    static const size_t DEFAULT_EVENTS_PER_THREAD = 16384;
+
+    static bool compiledIn();
+    // Starts recording; each thread keeps its newest `eventsPerThread` spans.
+    // Returns false (and says so) when tracing was not compiled in.
+    static bool enable(size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+    static bool enabled();
+    static void setThreadName(const std::string& name);
+
+    // Writes everything recorded so far. Call once the traced work has finished:
+    // buffers of threads that are still recording may be read mid-write.
+    static bool writeChromeTrace(const std::string& filePath);
+};
+
+#ifdef HL7_ENABLE_TRACING
+
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name);
+    TraceSpan(const char* name, const std::string& detail);
+    TraceSpan(const char* name, const std::string& detail, const std::string& more);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name; // nullptr when tracing is off
+    std::uint64_t startNanos;
+    std::string detail;
+};
+
+#define HL7_TRACE_CONCAT_INNER(a, b) a##b
+#define HL7_TRACE_CONCAT(a, b) HL7_TRACE_CONCAT_INNER(a, b)
+#define HL7_TRACE_SCOPE(name) TraceSpan HL7_TRACE_CONCAT(hl7TraceSpan, __LINE__)(name)
+#define HL7_TRACE_SCOPE_DETAIL(name, ...) TraceSpan HL7_TRACE_CONCAT(hl7TraceSpan, __LINE__)(name, __VA_ARGS__)
+#define HL7_TRACE_THREAD_NAME(name) Tracer::setThreadName(name)
+
+#else
+
+#define HL7_TRACE_SCOPE(name) ((void)0)
+#define HL7_TRACE_SCOPE_DETAIL(name, ...) ((void)0)
+#define HL7_TRACE_THREAD_NAME(name) ((void)0)
+
+#endif // HL7_ENABLE_TRACING
+
+#endif // TRACER_H
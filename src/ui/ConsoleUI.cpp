@@ -3,7 +3,7 @@
 #include <limits> // Required for std::numeric_limits
 #include <string> // Required for std::string, std::getline
 
-ConsoleUI::ConsoleUI(DatabaseService& service) : dbService(service) {}
+ConsoleUI::ConsoleUI(PatientStudySource& source) : dataSource(source) {}
 
 void ConsoleUI::displayMainMenu() {
     std::cout << "\nConsoleUI::displayMainMenu() called (Note: Main loop is in main.cpp)\n";
@@ -66,9 +66,9 @@ void ConsoleUI::displayPatientSearch() {
 
     std::vector<Patient> patients;
     if (searchTerm.empty() || searchTerm == "all") {
-        patients = dbService.getAllPatients();
+        patients = dataSource.getAllPatients();
     } else {
-        patients = dbService.searchPatients(searchTerm);
+        patients = dataSource.searchPatients(searchTerm);
     }
 
     if (patients.empty()) {
@@ -133,7 +133,7 @@ Study ConsoleUI::getSelectedStudy(const std::string& patientId) {
         return currentSelectedStudy;
     }
 
-    std::vector<Study> studies = dbService.getStudiesForPatient(patientId);
+    std::vector<Study> studies = dataSource.getStudiesForPatient(patientId);
 
     if (studies.empty()) {
         std::cout << "No studies found for patient ID: " << patientId << ".\n";
@@ -1,7 +1,7 @@
 #ifndef CONSOLEUI_H
 #define CONSOLEUI_H
 
-#include "../db_connector/DatabaseService.h"
+#include "../data_source/PatientStudySource.h"
 #include "../models/Patient.h"
 #include "../models/Study.h"
 #include <string>
@@ -9,7 +9,7 @@
 
 class ConsoleUI {
 public:
-    ConsoleUI(DatabaseService& dbService);
+    ConsoleUI(PatientStudySource& dataSource);
 
     void displayMainMenu();
     void displayPatientSearch();
@@ -22,7 +22,7 @@ public:
     Study getSelectedStudy(const std::string& patientId); 
 
 private:
-    DatabaseService& dbService;
+    PatientStudySource& dataSource;
     Patient currentSelectedPatient;
     Study currentSelectedStudy;
 
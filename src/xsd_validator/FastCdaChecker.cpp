@@ -0,0 +1,494 @@
+#include "FastCdaChecker.h"
+#include <cstring>
+
+namespace {
+
+const char* const NULLFLAVOR_CODESYSTEM = "2.16.840.1.113883.5.1008";
+const char* const CDA_TYPEID_ROOT = "2.16.840.1.113883.1.3";
+const char* const HL7_V3_NAMESPACE = "urn:hl7-org:v3";
+const char* const XSI_NAMESPACE = "http://www.w3.org/2001/XMLSchema-instance";
+const size_t MAX_CHILD_RULES = 32;
+
+#define RULES(table) table, sizeof(table) / sizeof(table[0])
+#define NO_RULES nullptr, 0
+const unsigned UNBOUNDED = ~0u;
+
+// --- Attribute rules (datatypes-base.xsd) ---
+const AttributeRule II_ATTRS[] = {
+    {"root", ValueFormat::Uid, true, nullptr},
+    {"extension", ValueFormat::Any, false, nullptr},
+};
+const AttributeRule TYPEID_ATTRS[] = {
+    {"root", ValueFormat::Fixed, true, CDA_TYPEID_ROOT},
+    {"extension", ValueFormat::Any, true, nullptr},
+};
+const AttributeRule CS_ATTRS[] = {
+    {"code", ValueFormat::Cs, true, nullptr},
+};
+const AttributeRule CE_ATTRS[] = {
+    {"code", ValueFormat::Cs, true, nullptr},
+    {"codeSystem", ValueFormat::Uid, true, nullptr},
+    {"codeSystemName", ValueFormat::Any, false, nullptr},
+    {"displayName", ValueFormat::Any, false, nullptr},
+};
+const AttributeRule TS_ATTRS[] = {
+    {"value", ValueFormat::Ts, true, nullptr},
+};
+const AttributeRule PLACE_ATTRS[] = {
+    {"classCode", ValueFormat::Fixed, false, "PLC"},
+    {"determinerCode", ValueFormat::Fixed, false, "INSTANCE"},
+};
+const AttributeRule ACT_ATTRS[] = { // Organizer / observation
+    {"classCode", ValueFormat::Cs, true, nullptr},
+    {"moodCode", ValueFormat::Fixed, true, "EVN"},
+};
+const AttributeRule CD_VALUE_ATTRS[] = {
+    {"xsi:type", ValueFormat::Fixed, true, "CD"},
+    {"code", ValueFormat::Cs, true, nullptr},
+    {"codeSystem", ValueFormat::Uid, true, nullptr},
+    {"codeSystemName", ValueFormat::Any, false, nullptr},
+    {"displayName", ValueFormat::Any, false, nullptr},
+};
+const AttributeRule MEASUREMENT_VALUE_ATTRS[] = { // Count and time-activity analysis: PQ or SLIST_PQ
+    {"xsi:type", ValueFormat::Cs, true, nullptr},
+    {"value", ValueFormat::Any, false, nullptr},
+    {"unit", ValueFormat::Cs, false, nullptr},
+};
+const AttributeRule PQ_ATTRS[] = {
+    {"value", ValueFormat::Any, true, nullptr},
+    {"unit", ValueFormat::Cs, false, nullptr},
+};
+const AttributeRule ED_MEDIA_ATTRS[] = { // Embedded key image
+    {"mediaType", ValueFormat::Cs, true, nullptr},
+    {"representation", ValueFormat::Fixed, true, "B64"},
+};
+const AttributeRule CLINICAL_DOCUMENT_ATTRS[] = {
+    {"xmlns", ValueFormat::Fixed, true, HL7_V3_NAMESPACE},
+    {"xmlns:xsi", ValueFormat::Fixed, false, XSI_NAMESPACE},
+    {"xsi:schemaLocation", ValueFormat::Any, false, nullptr},
+};
+
+// --- Element rules: the POCD_MT000040 subset produced by HL7MessageGenerator ---
+const ElementRule NAME_PARTS[] = {
+    {"given", 0, UNBOUNDED, NO_RULES, NO_RULES, ContentModel::Text},
+    {"family", 0, UNBOUNDED, NO_RULES, NO_RULES, ContentModel::Text},
+};
+const ElementRule PATIENT[] = {
+    {"name", 0, UNBOUNDED, NO_RULES, RULES(NAME_PARTS), ContentModel::Unordered},
+    {"administrativeGenderCode", 0, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"birthTime", 0, 1, RULES(TS_ATTRS), NO_RULES, ContentModel::Sequence},
+};
+const ElementRule PATIENT_ROLE[] = {
+    {"id", 1, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"patient", 0, 1, NO_RULES, RULES(PATIENT), ContentModel::Sequence},
+};
+const ElementRule RECORD_TARGET[] = {
+    {"patientRole", 1, 1, NO_RULES, RULES(PATIENT_ROLE), ContentModel::Sequence},
+};
+const ElementRule AUTHORING_DEVICE[] = {
+    {"manufacturerModelName", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+    {"softwareName", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+};
+const ElementRule ASSIGNED_AUTHOR[] = {
+    {"id", 1, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"assignedAuthoringDevice", 0, 1, NO_RULES, RULES(AUTHORING_DEVICE), ContentModel::Sequence},
+};
+const ElementRule AUTHOR[] = {
+    {"time", 1, 1, RULES(TS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"assignedAuthor", 1, 1, NO_RULES, RULES(ASSIGNED_AUTHOR), ContentModel::Sequence},
+};
+const ElementRule CUSTODIAN_ORGANIZATION[] = {
+    {"id", 1, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"name", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+};
+const ElementRule ASSIGNED_CUSTODIAN[] = {
+    {"representedCustodianOrganization", 1, 1, NO_RULES, RULES(CUSTODIAN_ORGANIZATION), ContentModel::Sequence},
+};
+const ElementRule CUSTODIAN[] = {
+    {"assignedCustodian", 1, 1, NO_RULES, RULES(ASSIGNED_CUSTODIAN), ContentModel::Sequence},
+};
+const ElementRule IVL_TS[] = {
+    {"low", 0, 1, RULES(TS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"high", 0, 1, RULES(TS_ATTRS), NO_RULES, ContentModel::Sequence},
+};
+const ElementRule PLACE[] = {
+    {"name", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+};
+const ElementRule HEALTH_CARE_FACILITY[] = {
+    {"id", 0, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"location", 0, 1, RULES(PLACE_ATTRS), RULES(PLACE), ContentModel::Sequence},
+};
+const ElementRule LOCATION[] = {
+    {"healthCareFacility", 1, 1, NO_RULES, RULES(HEALTH_CARE_FACILITY), ContentModel::Sequence},
+};
+const ElementRule ENCOMPASSING_ENCOUNTER[] = {
+    {"id", 0, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"code", 0, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"effectiveTime", 1, 1, NO_RULES, RULES(IVL_TS), ContentModel::Sequence},
+    {"location", 0, 1, NO_RULES, RULES(LOCATION), ContentModel::Sequence},
+};
+const ElementRule COMPONENT_OF[] = {
+    {"encompassingEncounter", 1, 1, NO_RULES, RULES(ENCOMPASSING_ENCOUNTER), ContentModel::Sequence},
+};
+// Series/instance entries (StudyEntryWriter). Streamed entries never reach this table,
+// which covers the same shapes for documents checked after the fact.
+const ElementRule OBSERVATION[] = {
+    {"id", 0, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"code", 1, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"effectiveTime", 0, 1, RULES(TS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"value", 0, UNBOUNDED, RULES(CD_VALUE_ATTRS), NO_RULES, ContentModel::Sequence},
+};
+const ElementRule OBSERVATION_MEDIA[] = {
+    {"id", 0, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"value", 1, 1, RULES(ED_MEDIA_ATTRS), NO_RULES, ContentModel::Text},
+};
+const ElementRule SLIST_PQ[] = { // Empty for a PQ value
+    {"origin", 0, 1, RULES(PQ_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"scale", 0, 1, RULES(PQ_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"digits", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+};
+const ElementRule MEASUREMENT_OBSERVATION[] = {
+    {"code", 1, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"text", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+    {"value", 1, 1, RULES(MEASUREMENT_VALUE_ATTRS), RULES(SLIST_PQ), ContentModel::Sequence},
+};
+const ElementRule MEASUREMENT_COMPONENT[] = {
+    {"observation", 1, 1, RULES(ACT_ATTRS), RULES(MEASUREMENT_OBSERVATION), ContentModel::Sequence},
+};
+const ElementRule ANALYSIS_ORGANIZER[] = { // One analysed frame, or one dynamic image
+    {"id", 0, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"code", 1, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"statusCode", 1, 1, RULES(CS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"component", 1, UNBOUNDED, NO_RULES, RULES(MEASUREMENT_COMPONENT), ContentModel::Sequence},
+};
+const ElementRule ORGANIZER_COMPONENT[] = { // A choice, like ENTRY
+    {"observation", 1, 1, RULES(ACT_ATTRS), RULES(OBSERVATION), ContentModel::Sequence},
+    {"observationMedia", 1, 1, RULES(ACT_ATTRS), RULES(OBSERVATION_MEDIA), ContentModel::Sequence},
+    {"organizer", 1, 1, RULES(ACT_ATTRS), RULES(ANALYSIS_ORGANIZER), ContentModel::Sequence},
+};
+const ElementRule ORGANIZER[] = {
+    {"id", 0, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"code", 0, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"statusCode", 1, 1, RULES(CS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"effectiveTime", 0, 1, RULES(TS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"component", 0, UNBOUNDED, NO_RULES, RULES(ORGANIZER_COMPONENT), ContentModel::Choice},
+};
+const ElementRule ENTRY[] = { // A choice in the schema: exactly one of these
+    {"observation", 1, 1, RULES(ACT_ATTRS), RULES(OBSERVATION), ContentModel::Sequence},
+    {"organizer", 1, 1, RULES(ACT_ATTRS), RULES(ORGANIZER), ContentModel::Sequence},
+};
+const ElementRule SECTION[] = {
+    {"code", 0, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"title", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+    {"text", 0, 1, NO_RULES, NO_RULES, ContentModel::Lax},
+    {"entry", 0, UNBOUNDED, NO_RULES, RULES(ENTRY), ContentModel::Choice},
+};
+const ElementRule SECTION_COMPONENT[] = {
+    {"section", 1, 1, NO_RULES, RULES(SECTION), ContentModel::Sequence},
+};
+const ElementRule STRUCTURED_BODY[] = {
+    {"component", 1, UNBOUNDED, NO_RULES, RULES(SECTION_COMPONENT), ContentModel::Sequence},
+};
+const ElementRule BODY_COMPONENT[] = {
+    {"structuredBody", 1, 1, NO_RULES, RULES(STRUCTURED_BODY), ContentModel::Sequence},
+};
+const ElementRule CLINICAL_DOCUMENT[] = {
+    {"realmCode", 0, UNBOUNDED, RULES(CS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"typeId", 1, 1, RULES(TYPEID_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"templateId", 0, UNBOUNDED, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"id", 1, 1, RULES(II_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"code", 1, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"title", 0, 1, NO_RULES, NO_RULES, ContentModel::Text},
+    {"effectiveTime", 1, 1, RULES(TS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"confidentialityCode", 1, 1, RULES(CE_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"languageCode", 0, 1, RULES(CS_ATTRS), NO_RULES, ContentModel::Sequence},
+    {"recordTarget", 1, UNBOUNDED, NO_RULES, RULES(RECORD_TARGET), ContentModel::Sequence},
+    {"author", 1, UNBOUNDED, NO_RULES, RULES(AUTHOR), ContentModel::Sequence},
+    {"custodian", 1, 1, NO_RULES, RULES(CUSTODIAN), ContentModel::Sequence},
+    {"componentOf", 0, 1, NO_RULES, RULES(COMPONENT_OF), ContentModel::Sequence},
+    {"component", 1, 1, NO_RULES, RULES(BODY_COMPONENT), ContentModel::Sequence},
+};
+const ElementRule ROOT_RULE = {
+    "ClinicalDocument", 1, 1, RULES(CLINICAL_DOCUMENT_ATTRS), RULES(CLINICAL_DOCUMENT), ContentModel::Sequence
+};
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+bool isAlnum(char c) { return isDigit(c) || isAlpha(c); }
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+bool isWhitespaceOnly(const char* text) {
+    for (const char* p = text; *p; ++p) {
+        if (!isSpace(*p)) return false;
+    }
+    return true;
+}
+
+void setFailure(std::string* failure, const char* where, const char* what, const char* detail) {
+    if (failure) {
+        *failure = std::string(where) + ": " + what + (detail ? std::string(" ") + detail : std::string());
+    }
+}
+
+} // namespace
+
+bool FastCdaChecker::isOid(const char* value) {
+    // [0-2](\.(0|[1-9][0-9]*))*
+    const char* p = value;
+    if (*p < '0' || *p > '2') return false;
+    ++p;
+    while (*p) {
+        if (*p != '.') return false;
+        ++p;
+        if (!isDigit(*p)) return false;
+        if (*p == '0') {
+            ++p;
+            if (isDigit(*p)) return false; // No leading zeros
+        } else {
+            while (isDigit(*p)) ++p;
+        }
+    }
+    return true;
+}
+
+bool FastCdaChecker::isUuid(const char* value) {
+    // [0-9a-zA-Z]{8}-[0-9a-zA-Z]{4}-[0-9a-zA-Z]{4}-[0-9a-zA-Z]{4}-[0-9a-zA-Z]{12}
+    static const int groups[] = {8, 4, 4, 4, 12};
+    const char* p = value;
+    for (int g = 0; g < 5; ++g) {
+        for (int i = 0; i < groups[g]; ++i, ++p) {
+            if (!isAlnum(*p)) return false;
+        }
+        if (g < 4 && *p++ != '-') return false;
+    }
+    return *p == '\0';
+}
+
+bool FastCdaChecker::isRuid(const char* value) {
+    // [A-Za-z][A-Za-z0-9\-]*
+    if (!isAlpha(*value)) return false;
+    for (const char* p = value + 1; *p; ++p) {
+        if (!isAlnum(*p) && *p != '-') return false;
+    }
+    return true;
+}
+
+bool FastCdaChecker::isTs(const char* value) {
+    // [0-9]{1,8}|([0-9]{9,14}|[0-9]{14}\.[0-9]+)([+\-][0-9]{1,4})?
+    const char* p = value;
+    size_t digits = 0;
+    while (isDigit(*p)) { ++p; ++digits; }
+    if (digits == 0 || digits > 14) return false;
+    if (*p == '\0') return true;
+    if (digits <= 8) return false; // Short dates may not carry a fraction or zone
+    if (*p == '.') {
+        if (digits != 14) return false;
+        ++p;
+        if (!isDigit(*p)) return false;
+        while (isDigit(*p)) ++p;
+        if (*p == '\0') return true;
+    }
+    if (*p != '+' && *p != '-') return false;
+    ++p;
+    size_t zoneDigits = 0;
+    while (isDigit(*p)) { ++p; ++zoneDigits; }
+    return zoneDigits >= 1 && zoneDigits <= 4 && *p == '\0';
+}
+
+bool FastCdaChecker::isCs(const char* value) {
+    // [^\s]+
+    if (*value == '\0') return false;
+    for (const char* p = value; *p; ++p) {
+        if (isSpace(*p)) return false;
+    }
+    return true;
+}
+
+bool FastCdaChecker::isNullFlavor(const char* value) {
+    static const char* const NULL_FLAVORS[] = {
+        "NI", "INV", "DER", "OTH", "PINF", "NINF", "UNC", "MSK", "NA", "UNK", "ASKU", "NAV", "NASK", "QS", "TRC", "NP"
+    };
+    for (const char* flavor : NULL_FLAVORS) {
+        if (std::strcmp(value, flavor) == 0) return true;
+    }
+    return false;
+}
+
+bool FastCdaChecker::check(const pugi::xml_document& doc, std::string* failure) const {
+    pugi::xml_node root = doc.document_element();
+    if (!root || std::strcmp(root.name(), ROOT_RULE.name) != 0) {
+        setFailure(failure, "document", "root element is not", ROOT_RULE.name);
+        return false;
+    }
+    return checkElement(root, ROOT_RULE, failure);
+}
+
+bool FastCdaChecker::checkElement(const pugi::xml_node& node, const ElementRule& rule, std::string* failure) const {
+    return checkAttributes(node, rule, failure) && checkChildren(node, rule, failure);
+}
+
+bool FastCdaChecker::checkAttributes(const pugi::xml_node& node, const ElementRule& rule, std::string* failure) const {
+    pugi::xml_attribute nullFlavor = node.attribute("nullFlavor");
+    if (nullFlavor && !isNullFlavor(nullFlavor.value())) {
+        setFailure(failure, node.name(), "invalid nullFlavor", nullFlavor.value());
+        return false;
+    }
+
+    for (size_t i = 0; i < rule.attributeCount; ++i) {
+        const AttributeRule& attrRule = rule.attributes[i];
+        pugi::xml_attribute attr = node.attribute(attrRule.name);
+        if (!attr) {
+            if (attrRule.required && !nullFlavor) { // A nullFlavor stands in for required values
+                setFailure(failure, node.name(), "missing required attribute", attrRule.name);
+                return false;
+            }
+            continue;
+        }
+        const char* value = attr.value();
+        bool ok = true;
+        switch (attrRule.format) {
+            case ValueFormat::Any: ok = true; break;
+            case ValueFormat::Oid: ok = isOid(value); break;
+            case ValueFormat::Uid: ok = isOid(value) || isUuid(value) || isRuid(value); break;
+            case ValueFormat::Ts: ok = isTs(value); break;
+            case ValueFormat::Cs: ok = isCs(value); break;
+            case ValueFormat::NullFlavor: ok = isNullFlavor(value); break;
+            case ValueFormat::Fixed: ok = std::strcmp(value, attrRule.fixedValue) == 0; break;
+        }
+        if (!ok) {
+            setFailure(failure, node.name(), "malformed attribute", attrRule.name);
+            return false;
+        }
+    }
+
+    // Anything the rule does not list is outside the subset (nullFlavor was checked above)
+    for (pugi::xml_attribute attr = node.first_attribute(); attr; attr = attr.next_attribute()) {
+        if (std::strcmp(attr.name(), "nullFlavor") == 0) continue;
+        size_t i = 0;
+        while (i < rule.attributeCount && std::strcmp(rule.attributes[i].name, attr.name()) != 0) ++i;
+        if (i == rule.attributeCount) {
+            setFailure(failure, node.name(), "unexpected attribute", attr.name());
+            return false;
+        }
+    }
+
+    // A code drawn from the NullFlavor code system must itself be a NullFlavor
+    pugi::xml_attribute codeSystem = node.attribute("codeSystem");
+    if (codeSystem && std::strcmp(codeSystem.value(), NULLFLAVOR_CODESYSTEM) == 0) {
+        pugi::xml_attribute code = node.attribute("code");
+        if (code && !isNullFlavor(code.value())) {
+            setFailure(failure, node.name(), "code is not a NullFlavor value:", code.value());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FastCdaChecker::checkChildren(const pugi::xml_node& node, const ElementRule& rule, std::string* failure) const {
+    if (rule.content == ContentModel::Lax) {
+        return true;
+    }
+
+    if (rule.content == ContentModel::Text) {
+        for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+            if (child.type() == pugi::node_element) {
+                setFailure(failure, node.name(), "unexpected element", child.name());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (rule.content == ContentModel::Unordered) {
+        unsigned counts[MAX_CHILD_RULES] = {0};
+        for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+            if (child.type() == pugi::node_pcdata && !isWhitespaceOnly(child.value())) {
+                setFailure(failure, node.name(), "unexpected text content", nullptr);
+                return false;
+            }
+            if (child.type() != pugi::node_element) continue;
+            size_t i = 0;
+            while (i < rule.childCount && std::strcmp(rule.children[i].name, child.name()) != 0) ++i;
+            if (i == rule.childCount) {
+                setFailure(failure, node.name(), "unexpected element", child.name());
+                return false;
+            }
+            if (++counts[i] > rule.children[i].maxOccurs) {
+                setFailure(failure, node.name(), "too many occurrences of", child.name());
+                return false;
+            }
+            if (!checkElement(child, rule.children[i], failure)) return false;
+        }
+        for (size_t i = 0; i < rule.childCount; ++i) {
+            if (counts[i] < rule.children[i].minOccurs) {
+                setFailure(failure, node.name(), "missing required element", rule.children[i].name);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (rule.content == ContentModel::Choice) {
+        pugi::xml_node chosen;
+        for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+            if (child.type() == pugi::node_pcdata && !isWhitespaceOnly(child.value())) {
+                setFailure(failure, node.name(), "unexpected text content", nullptr);
+                return false;
+            }
+            if (child.type() != pugi::node_element) continue;
+            if (chosen) {
+                setFailure(failure, node.name(), "more than one choice element:", child.name());
+                return false;
+            }
+            size_t i = 0;
+            while (i < rule.childCount && std::strcmp(rule.children[i].name, child.name()) != 0) ++i;
+            if (i == rule.childCount) {
+                setFailure(failure, node.name(), "unexpected element", child.name());
+                return false;
+            }
+            if (!checkElement(child, rule.children[i], failure)) return false;
+            chosen = child;
+        }
+        if (!chosen) {
+            setFailure(failure, node.name(), "missing its choice element", nullptr);
+            return false;
+        }
+        return true;
+    }
+
+    // Sequence: walk the declared particles in order alongside the actual children
+    size_t ruleIndex = 0;
+    unsigned count = 0;
+    for (pugi::xml_node child = node.first_child(); child; child = child.next_sibling()) {
+        if (child.type() == pugi::node_pcdata && !isWhitespaceOnly(child.value())) {
+            setFailure(failure, node.name(), "unexpected text content", nullptr);
+            return false;
+        }
+        if (child.type() != pugi::node_element) continue;
+
+        while (ruleIndex < rule.childCount && std::strcmp(rule.children[ruleIndex].name, child.name()) != 0) {
+            if (count < rule.children[ruleIndex].minOccurs) {
+                setFailure(failure, node.name(), "missing required element", rule.children[ruleIndex].name);
+                return false;
+            }
+            ++ruleIndex;
+            count = 0;
+        }
+        if (ruleIndex == rule.childCount) {
+            setFailure(failure, node.name(), "unexpected or out-of-order element", child.name());
+            return false;
+        }
+        if (++count > rule.children[ruleIndex].maxOccurs) {
+            setFailure(failure, node.name(), "too many occurrences of", child.name());
+            return false;
+        }
+        if (!checkElement(child, rule.children[ruleIndex], failure)) return false;
+    }
+    for (; ruleIndex < rule.childCount; ++ruleIndex, count = 0) {
+        if (count < rule.children[ruleIndex].minOccurs) {
+            setFailure(failure, node.name(), "missing required element", rule.children[ruleIndex].name);
+            return false;
+        }
+    }
+    return true;
+}
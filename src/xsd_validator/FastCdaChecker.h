@@ -0,0 +1,70 @@
+#ifndef FASTCDACHECKER_H
+#define FASTCDACHECKER_H
+
+#include <string>
+#include <cstddef>
+#include "pugixml.hpp"
+
+// Value formats checked by the fast path (mirroring the simple types in datatypes-base.xsd)
+enum class ValueFormat {
+    Any,        // st: any string
+    Oid,        // [0-2](\.(0|[1-9][0-9]*))*
+    Uid,        // oid | uuid | ruid (II/@root)
+    Ts,         // [0-9]{1,8}|([0-9]{9,14}|[0-9]{14}\.[0-9]+)([+\-][0-9]{1,4})?
+    Cs,         // [^\s]+
+    NullFlavor, // NullFlavor vocabulary (voc.xsd)
+    Fixed       // Must equal AttributeRule::fixedValue
+};
+
+struct AttributeRule {
+    const char* name;
+    ValueFormat format;
+    bool required;          // Required unless the element carries @nullFlavor
+    const char* fixedValue; // Only for ValueFormat::Fixed
+};
+
+enum class ContentModel {
+    Sequence,  // Child elements in the declared order
+    Unordered, // Child elements in any order (e.g. PN name parts)
+    Choice,    // Exactly one child element, any one of the declared ones
+    Text,      // Character data only
+    Lax        // Mixed / narrative content: not inspected
+};
+
+struct ElementRule {
+    const char* name;
+    unsigned minOccurs;
+    unsigned maxOccurs;
+    const AttributeRule* attributes;
+    size_t attributeCount;
+    const ElementRule* children;
+    size_t childCount;
+    ContentModel content;
+};
+
+// Structural checker for the subset of POCD_MT000040 that HL7MessageGenerator emits.
+// The content model is a static rule table (FastCdaChecker.cpp), so a check is a single
+// walk of the pugixml tree with no parsing, allocation or regex evaluation.
+// It checks required elements and their order, II/TS/CS/OID formats and the nullFlavor
+// rules; anything outside the known subset, including an element or attribute the table
+// does not list, is reported as a failure so the caller can fall back to full XSD validation.
+class FastCdaChecker {
+public:
+    // Returns true when the document matches the generator's subset.
+    // On failure, `failure` (if given) receives a short description of the first problem.
+    bool check(const pugi::xml_document& doc, std::string* failure = nullptr) const;
+
+    static bool isOid(const char* value);
+    static bool isUuid(const char* value);
+    static bool isRuid(const char* value);
+    static bool isTs(const char* value);
+    static bool isCs(const char* value);
+    static bool isNullFlavor(const char* value);
+
+private:
+    bool checkElement(const pugi::xml_node& node, const ElementRule& rule, std::string* failure) const;
+    bool checkAttributes(const pugi::xml_node& node, const ElementRule& rule, std::string* failure) const;
+    bool checkChildren(const pugi::xml_node& node, const ElementRule& rule, std::string* failure) const;
+};
+
+#endif // FASTCDACHECKER_H
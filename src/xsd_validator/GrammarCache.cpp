@@ -0,0 +1,167 @@
+#include "GrammarCache.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <thread>
+#include <functional>
+#include "pugixml.hpp"
+
+#include <xercesc/util/XercesVersion.hpp>
+#include <xercesc/util/XMLString.hpp>
+#include <xercesc/util/BinFileInputStream.hpp>
+#include <xercesc/internal/BinFileOutputStream.hpp>
+#include <xercesc/util/XMLException.hpp>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+void fnv1a(uint64_t& hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+}
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+GrammarCache::GrammarCache(const std::string& cacheFile, const std::string& rootXsdPath)
+    : cacheFilePath(cacheFile) {
+    collectSchemaFiles(rootXsdPath);
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    std::string version = XERCES_FULLVERSIONDOT;
+    fnv1a(hash, version.data(), version.size());
+    for (const auto& file : schemaFiles) { // std::set order in collectSchemaFiles keeps this stable
+        fnv1a(hash, file.data(), file.size());
+        std::ifstream in(file, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        fnv1a(hash, contents.data(), contents.size());
+    }
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    fingerprint = ss.str();
+}
+
+// Follows xs:include / xs:import / xs:redefine schemaLocation references from the root XSD
+void GrammarCache::collectSchemaFiles(const std::string& rootXsdPath) {
+    std::set<std::string> visited;
+    std::vector<std::string> pending;
+    std::error_code ec;
+    fs::path root = fs::weakly_canonical(rootXsdPath, ec);
+    pending.push_back(ec ? rootXsdPath : root.string());
+
+    while (!pending.empty()) {
+        std::string current = pending.back();
+        pending.pop_back();
+        if (!visited.insert(current).second) {
+            continue;
+        }
+        pugi::xml_document doc;
+        if (!doc.load_file(current.c_str())) {
+            std::cerr << "Warning: Could not read schema file for grammar cache fingerprint: " << current << std::endl;
+            continue;
+        }
+        fs::path baseDir = fs::path(current).parent_path();
+        for (pugi::xml_node child : doc.document_element().children()) {
+            std::string name = child.name();
+            if (!endsWith(name, "include") && !endsWith(name, "import") && !endsWith(name, "redefine")) {
+                continue;
+            }
+            std::string location = child.attribute("schemaLocation").value();
+            if (location.empty()) {
+                continue;
+            }
+            fs::path resolved = fs::weakly_canonical(baseDir / location, ec);
+            pending.push_back(ec ? (baseDir / location).string() : resolved.string());
+        }
+    }
+    schemaFiles.assign(visited.begin(), visited.end());
+}
+
+std::string GrammarCache::readStoredFingerprint() const {
+    std::ifstream in(cacheFilePath + ".hash");
+    std::string stored;
+    std::getline(in, stored);
+    return stored;
+}
+
+bool GrammarCache::load(XMLGrammarPool& pool) const {
+    if (cacheFilePath.empty() || !fs::exists(cacheFilePath)) {
+        return false;
+    }
+    if (readStoredFingerprint() != fingerprint) {
+        std::cout << "Grammar cache " << cacheFilePath << " is stale (schema files changed); rebuilding." << std::endl;
+        return false;
+    }
+    try {
+        BinFileInputStream in(cacheFilePath.c_str());
+        if (!in.getIsOpen()) {
+            return false;
+        }
+        pool.deserializeGrammars(&in);
+        return true;
+    } catch (const XMLException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "Warning: Could not deserialize grammar cache " << cacheFilePath << ": " << message << std::endl;
+        XMLString::release(&message);
+    } catch (...) {
+        std::cerr << "Warning: Could not deserialize grammar cache " << cacheFilePath << "." << std::endl;
+    }
+    return false;
+}
+
+bool GrammarCache::store(XMLGrammarPool& pool) const {
+    if (cacheFilePath.empty()) {
+        return false;
+    }
+    std::error_code ec;
+    fs::path parent = fs::path(cacheFilePath).parent_path();
+    if (!parent.empty()) {
+        fs::create_directories(parent, ec);
+    }
+
+    // Unique per thread so concurrent generators never write the same temporary file
+    std::string tmpPath = cacheFilePath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    try {
+        {
+            BinFileOutputStream out(tmpPath.c_str());
+            if (!out.getIsOpen()) {
+                std::cerr << "Warning: Could not open grammar cache file for writing: " << tmpPath << std::endl;
+                return false;
+            }
+            pool.serializeGrammars(&out);
+        }
+        // Cache first, fingerprint second: an interrupted write leaves a mismatching fingerprint, never a stale match
+        if (std::rename(tmpPath.c_str(), cacheFilePath.c_str()) != 0) {
+            std::cerr << "Warning: Could not move grammar cache into place: " << cacheFilePath << std::endl;
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        std::ofstream hashOut(cacheFilePath + ".hash", std::ios::trunc);
+        hashOut << fingerprint << std::endl;
+        hashOut.close();
+        std::cout << "Grammar cache written to " << cacheFilePath << " (" << schemaFiles.size() << " schema files)." << std::endl;
+        return true;
+    } catch (const XMLException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "Warning: Could not serialize grammar cache: " << message << std::endl;
+        XMLString::release(&message);
+    } catch (...) {
+        std::cerr << "Warning: Could not serialize grammar cache." << std::endl;
+    }
+    std::remove(tmpPath.c_str());
+    return false;
+}
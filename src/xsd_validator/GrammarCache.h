@@ -0,0 +1,40 @@
+#ifndef GRAMMARCACHE_H
+#define GRAMMARCACHE_H
+
+#include <string>
+#include <vector>
+
+#include <xercesc/framework/XMLGrammarPool.hpp>
+
+XERCES_CPP_NAMESPACE_USE
+
+// On-disk cache of a compiled (serialized) Xerces grammar pool.
+// The cache file is written with XMLGrammarPool::serializeGrammars next to a
+// "<cache>.hash" sidecar holding the fingerprint of the schema set it was built
+// from; a cache whose fingerprint no longer matches the schema files is ignored.
+class GrammarCache {
+public:
+    GrammarCache(const std::string& cacheFilePath, const std::string& rootXsdPath);
+
+    // Fingerprint of the root XSD and every schema it includes/imports (FNV-1a over
+    // path and contents, plus the Xerces version since the binary format is version specific)
+    const std::string& getFingerprint() const { return fingerprint; }
+    const std::vector<std::string>& getSchemaFiles() const { return schemaFiles; }
+
+    // Deserializes the cached grammars into an empty, unlocked pool.
+    // Returns false (leaving the pool empty) when the cache is missing or stale.
+    bool load(XMLGrammarPool& pool) const;
+
+    // Serializes the pool's grammars to the cache file (written to a temp file, then renamed)
+    bool store(XMLGrammarPool& pool) const;
+
+private:
+    std::string cacheFilePath;
+    std::string fingerprint;
+    std::vector<std::string> schemaFiles;
+
+    void collectSchemaFiles(const std::string& xsdPath);
+    std::string readStoredFingerprint() const;
+};
+
+#endif // GRAMMARCACHE_H
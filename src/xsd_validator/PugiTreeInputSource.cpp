@@ -0,0 +1,219 @@
+#include "PugiTreeInputSource.h"
+#include <cstring>
+
+namespace {
+
+class PugiTreeBinInputStream : public BinInputStream {
+public:
+    explicit PugiTreeBinInputStream(PugiXmlStreamSerializer& source) : serializer(source), position(0) {}
+
+    XMLFilePos curPos() const override { return position; }
+
+    XMLSize_t readBytes(XMLByte* const toFill, const XMLSize_t maxToRead) override {
+        size_t count = serializer.read(reinterpret_cast<char*>(toFill), maxToRead);
+        position += count;
+        return count;
+    }
+
+    const XMLCh* getContentType() const override { return nullptr; }
+
+private:
+    PugiXmlStreamSerializer& serializer;
+    XMLFilePos position;
+};
+
+} // namespace
+
+PugiXmlStreamSerializer::PugiXmlStreamSerializer(const pugi::xml_document& doc, std::string& output, const char* indentString,
+                                                 StreamedContent* streamedContent)
+    : out(output), indent(indentString), streamed(streamedContent), readPos(output.size()) {
+    if (doc.first_child()) {
+        stack.push_back({doc.first_child(), 0, false});
+    }
+}
+
+size_t PugiXmlStreamSerializer::read(char* buffer, size_t maxBytes) {
+    while (out.size() - readPos < maxBytes && step()) {
+    }
+    size_t available = out.size() - readPos;
+    size_t count = available < maxBytes ? available : maxBytes;
+    if (count > 0) {
+        std::memcpy(buffer, out.data() + readPos, count);
+        readPos += count;
+    }
+    return count;
+}
+
+void PugiXmlStreamSerializer::finish() {
+    while (step()) {
+    }
+    readPos = out.size();
+}
+
+bool PugiXmlStreamSerializer::hasSingleTextChild(const pugi::xml_node& node) {
+    pugi::xml_node first = node.first_child();
+    return first && !first.next_sibling() &&
+           (first.type() == pugi::node_pcdata || first.type() == pugi::node_cdata);
+}
+
+// The node on top of the stack is fully written: move on to its next sibling,
+// or return to the (already opened) parent so it gets closed
+void PugiXmlStreamSerializer::advance() {
+    pugi::xml_node next = stack.back().node.next_sibling();
+    if (next) {
+        stack.back().node = next;
+        stack.back().opened = false;
+    } else {
+        stack.pop_back();
+    }
+}
+
+void PugiXmlStreamSerializer::writeIndent(unsigned depth) {
+    for (unsigned i = 0; i < depth; ++i) {
+        out += indent;
+    }
+}
+
+// Same rules as pugi's own save: a raw CR (and, in attributes, tab and newline) would be
+// normalized away by the parser, so it goes out as a character reference
+void PugiXmlStreamSerializer::writeEscaped(const char* text, bool isAttribute) {
+    for (const char* p = text; *p; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"':
+                if (isAttribute) out += "&quot;";
+                else out += '"';
+                break;
+            case '\t':
+            case '\n':
+                if (isAttribute) out += c == '\t' ? "&#9;" : "&#10;";
+                else out += *p;
+                break;
+            default:
+                if (c < 32) {
+                    out += "&#";
+                    out += std::to_string(c);
+                    out += ';';
+                } else {
+                    out += *p;
+                }
+        }
+    }
+}
+
+void PugiXmlStreamSerializer::writeStartTag(const pugi::xml_node& node, unsigned depth) {
+    writeIndent(depth);
+    out += '<';
+    out += node.name();
+    for (pugi::xml_attribute attr = node.first_attribute(); attr; attr = attr.next_attribute()) {
+        out += ' ';
+        out += attr.name();
+        out += "=\"";
+        writeEscaped(attr.value(), true);
+        out += '"';
+    }
+}
+
+bool PugiXmlStreamSerializer::step() {
+    if (stack.empty()) {
+        return false;
+    }
+    Frame& frame = stack.back();
+    pugi::xml_node node = frame.node;
+    unsigned depth = frame.depth;
+
+    switch (node.type()) {
+        case pugi::node_declaration:
+            out += "<?";
+            out += node.name();
+            for (pugi::xml_attribute attr = node.first_attribute(); attr; attr = attr.next_attribute()) {
+                out += ' ';
+                out += attr.name();
+                out += "=\"";
+                writeEscaped(attr.value(), true);
+                out += '"';
+            }
+            out += "?>\n";
+            advance();
+            return true;
+        case pugi::node_comment:
+            writeIndent(depth);
+            out += "<!--";
+            out += node.value();
+            out += "-->\n";
+            advance();
+            return true;
+        case pugi::node_pcdata:
+            writeIndent(depth);
+            writeEscaped(node.value(), false);
+            out += '\n';
+            advance();
+            return true;
+        case pugi::node_cdata:
+            writeIndent(depth);
+            out += "<![CDATA[";
+            out += node.value();
+            out += "]]>\n";
+            advance();
+            return true;
+        case pugi::node_element:
+            break;
+        case pugi::node_pi:
+            // One piece per step, so a reader pulling bytes never waits for all of it
+            if (streamed && std::strcmp(node.name(), STREAMED_CONTENT_PI) == 0 && streamed->writeNext(out, depth, indent)) {
+                return true;
+            }
+            advance();
+            return true;
+        default: // Doctype is never produced by the generator
+            advance();
+            return true;
+    }
+
+    if (frame.opened) { // All children written; close the element
+        writeIndent(depth);
+        out += "</";
+        out += node.name();
+        out += ">\n";
+        advance();
+        return true;
+    }
+
+    writeStartTag(node, depth);
+    if (!node.first_child()) {
+        out += " />\n";
+        advance();
+        return true;
+    }
+    if (hasSingleTextChild(node)) {
+        out += '>';
+        pugi::xml_node text = node.first_child();
+        if (text.type() == pugi::node_cdata) {
+            out += "<![CDATA[";
+            out += text.value();
+            out += "]]>";
+        } else {
+            writeEscaped(text.value(), false);
+        }
+        out += "</";
+        out += node.name();
+        out += ">\n";
+        advance();
+        return true;
+    }
+
+    out += ">\n";
+    frame.opened = true;
+    stack.push_back({node.first_child(), depth + 1, false}); // Invalidates `frame`
+    return true;
+}
+
+PugiTreeInputSource::PugiTreeInputSource(PugiXmlStreamSerializer& source)
+    : InputSource("InMemoryDocument"), serializer(source) {}
+
+BinInputStream* PugiTreeInputSource::makeStream() const {
+    return new PugiTreeBinInputStream(serializer);
+}
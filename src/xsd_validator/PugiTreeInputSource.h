@@ -0,0 +1,77 @@
+#ifndef PUGITREEINPUTSOURCE_H
+#define PUGITREEINPUTSOURCE_H
+
+#include <string>
+#include <vector>
+#include "pugixml.hpp"
+
+#include <xercesc/sax/InputSource.hpp>
+#include <xercesc/util/BinInputStream.hpp>
+
+XERCES_CPP_NAMESPACE_USE
+
+// Target of the processing instruction that marks where streamed content goes
+#define STREAMED_CONTENT_PI "hl7-streamed-content"
+
+// Text written in place of a <?hl7-streamed-content?> node by PugiXmlStreamSerializer,
+// so large repetitive parts of a document (e.g. thousands of entries) never become tree
+// nodes. FastCdaChecker cannot see it, so it checks its own values as it writes them.
+class StreamedContent {
+public:
+    virtual ~StreamedContent() = default;
+
+    // Appends the next piece, indented for `depth`; false once everything is written
+    virtual bool writeNext(std::string& out, unsigned depth, const char* indent) = 0;
+    // First value written that FastCdaChecker would have rejected; empty if none
+    virtual const std::string& problem() const = 0;
+};
+
+// Incrementally serializes a pugixml tree, producing the same layout as
+// pugi::xml_document::save with an indent string and format_default.
+// Text is appended to the caller-owned output buffer only as the reader asks for
+// more bytes, so the validator consumes the document while it is being written.
+// A <?hl7-streamed-content?> node is replaced by `streamed` (and dropped without it).
+class PugiXmlStreamSerializer {
+public:
+    PugiXmlStreamSerializer(const pugi::xml_document& doc, std::string& output, const char* indent = "  ",
+                            StreamedContent* streamed = nullptr);
+
+    // Copies up to maxBytes of not-yet-consumed output into buffer, serializing
+    // more of the tree as needed. Returns 0 once the whole tree has been read.
+    size_t read(char* buffer, size_t maxBytes);
+
+    // Serializes whatever is left without handing it to a reader (e.g. after a fatal parse error)
+    void finish();
+
+private:
+    struct Frame {
+        pugi::xml_node node;
+        unsigned depth;
+        bool opened;
+    };
+
+    std::string& out;
+    const char* indent;
+    StreamedContent* streamed;
+    std::vector<Frame> stack;
+    size_t readPos;
+
+    bool step(); // Emits the next start/end/text token; false when done
+    void advance();
+    void writeIndent(unsigned depth);
+    void writeStartTag(const pugi::xml_node& node, unsigned depth);
+    void writeEscaped(const char* text, bool isAttribute);
+    static bool hasSingleTextChild(const pugi::xml_node& node);
+};
+
+// Xerces input source that pulls bytes straight from a PugiXmlStreamSerializer
+class PugiTreeInputSource : public InputSource {
+public:
+    explicit PugiTreeInputSource(PugiXmlStreamSerializer& serializer);
+    BinInputStream* makeStream() const override;
+
+private:
+    PugiXmlStreamSerializer& serializer;
+};
+
+#endif // PUGITREEINPUTSOURCE_H
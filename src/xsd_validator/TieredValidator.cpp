@@ -0,0 +1,119 @@
+#include "TieredValidator.h"
+#include "PugiTreeInputSource.h"
+#include "../metrics/Metrics.h"
+#include "../tracing/Tracer.h"
+#include <iostream>
+
+TieredValidator::TieredValidator(const std::string& xsdPath, const std::string& grammarCachePath, int fullSamplePercent, bool buildDom)
+    : xsdPath(xsdPath), grammarCachePath(grammarCachePath),
+      fullSamplePercent(fullSamplePercent < 0 ? 0 : (fullSamplePercent > 100 ? 100 : fullSamplePercent)),
+      buildDom(buildDom), sampleAccumulator(0) {
+}
+
+bool TieredValidator::shouldSample() {
+    // Deterministic spread: with 10% every tenth passing document is fully validated
+    sampleAccumulator += fullSamplePercent;
+    if (sampleAccumulator >= 100) {
+        sampleAccumulator -= 100;
+        return true;
+    }
+    return false;
+}
+
+bool TieredValidator::runFull(const pugi::xml_document& doc, std::string& serializedOut, StreamedContent* streamed) {
+    HL7_TRACE_SCOPE("fullXsdValidation");
+    if (!fullValidator) {
+        fullValidator.reset(new XSDValidator(xsdPath, grammarCachePath, buildDom));
+    }
+    ++stats.fullRuns;
+    Metrics::instance().fullValidations.add();
+    bool valid = fullValidator->validate(doc, serializedOut, streamed);
+    if (valid) {
+        ++stats.fullPass;
+    } else {
+        ++stats.fullFail;
+    }
+    return valid;
+}
+
+bool TieredValidator::runFull(const std::string& serialized) {
+    HL7_TRACE_SCOPE("fullXsdValidation");
+    if (!fullValidator) {
+        fullValidator.reset(new XSDValidator(xsdPath, grammarCachePath, buildDom));
+    }
+    ++stats.fullRuns;
+    Metrics::instance().fullValidations.add();
+    bool valid = fullValidator->validate(serialized);
+    if (valid) {
+        ++stats.fullPass;
+    } else {
+        ++stats.fullFail;
+    }
+    return valid;
+}
+
+bool TieredValidator::validate(const pugi::xml_document& doc, std::string& serializedOut, StreamedContent* streamed) {
+    ++stats.documents;
+
+    std::string failure;
+    bool fastValid;
+    {
+        HL7_TRACE_SCOPE("fastCdaCheck");
+        fastValid = fastChecker.check(doc, &failure);
+    }
+    if (fastValid) {
+        ++stats.fastPass;
+    } else {
+        ++stats.fastFail;
+        Metrics::instance().fastCheckFailures.add();
+        std::cout << "Fast CDA check failed (" << failure << "); running full XSD validation." << std::endl;
+    }
+
+    if (fastValid && !shouldSample()) {
+        size_t start = serializedOut.size();
+        {
+            HL7_TRACE_SCOPE("serialize");
+            PugiXmlStreamSerializer serializer(doc, serializedOut, "  ", streamed);
+            serializer.finish();
+        }
+        if (!streamed || streamed->problem().empty()) {
+            return true;
+        }
+        // The streamed part failed its own checks: let the schema decide, as for the tree
+        --stats.fastPass;
+        ++stats.fastFail;
+        Metrics::instance().fastCheckFailures.add();
+        std::cout << "Fast CDA check failed (" << streamed->problem() << "); running full XSD validation." << std::endl;
+        bool fullValid = runFull(start == 0 ? serializedOut : serializedOut.substr(start));
+        if (fullValid) {
+            ++stats.fastFailFullPass;
+        }
+        return fullValid;
+    }
+
+    bool fullValid = runFull(doc, serializedOut, streamed);
+    if (fastValid && !fullValid) {
+        ++stats.fastPassFullFail;
+        std::cerr << "Warning: Fast CDA check passed a document that failed XSD validation. "
+                  << "The fast-path rule table no longer matches the schema; "
+                  << "set <FullValidationSamplePercent> to 100 until it is updated." << std::endl;
+    } else if (!fastValid && fullValid) {
+        ++stats.fastFailFullPass;
+        std::cout << "Note: Fast CDA check rejected a schema-valid document (" << failure << ")." << std::endl;
+    }
+    return fullValid;
+}
+
+void TieredValidator::printSummary() const {
+    if (stats.documents == 0) {
+        return;
+    }
+    std::cout << "--- Validation summary ---" << std::endl;
+    std::cout << " Documents: " << stats.documents
+              << " (fast pass " << stats.fastPass << ", fast fail " << stats.fastFail << ")" << std::endl;
+    std::cout << " Full XSD runs: " << stats.fullRuns
+              << " (pass " << stats.fullPass << ", fail " << stats.fullFail << ")"
+              << ", sample rate " << fullSamplePercent << "%" << std::endl;
+    std::cout << " Disagreements: fast pass/full fail " << stats.fastPassFullFail
+              << ", fast fail/full pass " << stats.fastFailFullPass << std::endl;
+}
@@ -0,0 +1,59 @@
+#ifndef TIEREDVALIDATOR_H
+#define TIEREDVALIDATOR_H
+
+#include <string>
+#include <memory>
+#include "pugixml.hpp"
+#include "FastCdaChecker.h"
+#include "XSDValidator.h"
+
+// Counters kept by TieredValidator
+struct TieredValidationStats {
+    unsigned long documents = 0;
+    unsigned long fastPass = 0;
+    unsigned long fastFail = 0;
+    unsigned long fullRuns = 0;
+    unsigned long fullPass = 0;
+    unsigned long fullFail = 0;
+    unsigned long fastPassFullFail = 0; // Fast path too lenient: the rule table has drifted from the XSD
+    unsigned long fastFailFullPass = 0; // Fast path too strict: harmless, but costs a full run
+};
+
+// Two-tier CDA validation. Every document goes through FastCdaChecker; the full XSD
+// validator runs when the fast check fails (its verdict is authoritative) and on a
+// sample of documents that passed, so disagreements between the two are noticed.
+// With a sample of 100% every document is fully validated, as before.
+// `buildDom` makes the full tier parse into a DOM tree instead of streaming (see XSDValidator).
+// Not thread-safe: use one instance per thread.
+class TieredValidator {
+public:
+    TieredValidator(const std::string& xsdPath, const std::string& grammarCachePath, int fullSamplePercent, bool buildDom = false);
+
+    TieredValidator(const TieredValidator&) = delete;
+    TieredValidator& operator=(const TieredValidator&) = delete;
+
+    // Serializes `doc` into `serializedOut` (appending) and returns the validation verdict.
+    // `streamed` fills the document's <?hl7-streamed-content?> node; if it reports a
+    // problem, the serialized text is fully validated.
+    bool validate(const pugi::xml_document& doc, std::string& serializedOut, StreamedContent* streamed = nullptr);
+
+    const TieredValidationStats& getStats() const { return stats; }
+    void printSummary() const;
+
+private:
+    std::string xsdPath;
+    std::string grammarCachePath;
+    int fullSamplePercent;
+    bool buildDom;
+    int sampleAccumulator;
+
+    FastCdaChecker fastChecker;
+    std::unique_ptr<XSDValidator> fullValidator; // Created on first full run
+    TieredValidationStats stats;
+
+    bool shouldSample();
+    bool runFull(const pugi::xml_document& doc, std::string& serializedOut, StreamedContent* streamed);
+    bool runFull(const std::string& serialized);
+};
+
+#endif // TIEREDVALIDATOR_H
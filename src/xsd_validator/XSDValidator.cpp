@@ -0,0 +1,211 @@
+#include "XSDValidator.h"
+#include "PugiTreeInputSource.h"
+#include "GrammarCache.h"
+#include "../metrics/Metrics.h"
+#include <iostream>
+#include <chrono>
+#include <atomic>
+
+#include <xercesc/util/XMLString.hpp>
+#include <xercesc/util/XMLUni.hpp>
+#include <xercesc/util/OutOfMemoryException.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/validators/common/Grammar.hpp>
+#include <xercesc/framework/XMLGrammarPoolImpl.hpp>
+#include <xercesc/util/PlatformUtils.hpp>
+
+XERCES_CPP_NAMESPACE_USE
+
+namespace {
+// Captured during static initialization, i.e. (close to) process start
+const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+std::atomic<bool> firstValidDocumentReported(false);
+}
+
+// Implementation for missing resetErrors method
+void XSDValidationErrorHandler::resetErrors() {
+    fSawErrors = false;
+}
+
+void XSDValidationErrorHandler::warning(const SAXParseException& exc) {
+    char* msg = XMLString::transcode(exc.getMessage());
+    std::cerr << "XSD Validation Warning: " << msg
+              << " at line " << exc.getLineNumber()
+              << " column " << exc.getColumnNumber() << std::endl;
+    XMLString::release(&msg);
+}
+
+void XSDValidationErrorHandler::error(const SAXParseException& exc) {
+    fSawErrors = true;
+    char* msg = XMLString::transcode(exc.getMessage());
+    std::cerr << "XSD Validation Error: " << msg
+              << " at line " << exc.getLineNumber()
+              << " column " << exc.getColumnNumber() << std::endl;
+    XMLString::release(&msg);
+}
+
+void XSDValidationErrorHandler::fatalError(const SAXParseException& exc) {
+    fSawErrors = true;
+    char* msg = XMLString::transcode(exc.getMessage());
+    std::cerr << "XSD Validation Fatal Error: " << msg
+              << " at line " << exc.getLineNumber()
+              << " column " << exc.getColumnNumber() << std::endl;
+    XMLString::release(&msg);
+}
+
+XSDValidator::XSDValidator(const std::string& xsdPath, const std::string& grammarCachePath, bool buildDom)
+    : grammarPool(nullptr), reader(nullptr), domParser(nullptr), ready(false) {
+    try {
+        grammarPool = new XMLGrammarPoolImpl(XMLPlatformUtils::fgMemoryManager);
+        loadGrammar(xsdPath, grammarCachePath, buildDom);
+    } catch (const XMLException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "Error loading XSD grammar (XMLException): " << message << std::endl;
+        XMLString::release(&message);
+    } catch (const SAXException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "Error loading XSD grammar (SAXException): " << message << std::endl;
+        XMLString::release(&message);
+    } catch (...) {
+        std::cerr << "Error loading XSD grammar: An unknown exception occurred." << std::endl;
+    }
+}
+
+void XSDValidator::loadGrammar(const std::string& xsdPath, const std::string& grammarCachePath, bool buildDom) {
+    auto start = std::chrono::steady_clock::now();
+
+    // A warm cache must be deserialized into the empty pool before any reader uses it
+    GrammarCache cache(grammarCachePath, xsdPath);
+    bool fromCache = !grammarCachePath.empty() && cache.load(*grammarPool);
+    (fromCache ? Metrics::instance().grammarCacheHits : Metrics::instance().grammarCacheMisses).add();
+
+    reader = XMLReaderFactory::createXMLReader(XMLPlatformUtils::fgMemoryManager, grammarPool);
+    reader->setFeature(XMLUni::fgSAX2CoreNameSpaces, true);
+    reader->setFeature(XMLUni::fgSAX2CoreValidation, true);
+    reader->setFeature(XMLUni::fgXercesDynamic, false);
+    reader->setFeature(XMLUni::fgXercesSchema, true);
+    reader->setFeature(XMLUni::fgXercesSchemaFullChecking, true);
+    reader->setFeature(XMLUni::fgXercesHandleMultipleImports, true);
+    reader->setFeature(XMLUni::fgXercesUseCachedGrammarInParse, true); // Never recompile per document
+    reader->setFeature(XMLUni::fgXercesCacheGrammarFromParse, false);
+
+    std::string schemaLocationArg = "urn:hl7-org:v3 " + xsdPath;
+    XMLCh* schemaLocation = XMLString::transcode(schemaLocationArg.c_str());
+    reader->setProperty(XMLUni::fgXercesSchemaExternalSchemaLocation, schemaLocation);
+    XMLString::release(&schemaLocation);
+
+    reader->setContentHandler(&noopContentHandler);
+    reader->setErrorHandler(&errorHandler);
+
+    if (buildDom) {
+        domParser = new XercesDOMParser(nullptr, XMLPlatformUtils::fgMemoryManager, grammarPool);
+        domParser->setValidationScheme(XercesDOMParser::Val_Always);
+        domParser->setDoNamespaces(true);
+        domParser->setDoSchema(true);
+        domParser->setValidationSchemaFullChecking(true);
+        domParser->setHandleMultipleImports(true);
+        domParser->useCachedGrammarInParse(true);
+        domParser->cacheGrammarFromParse(false);
+        XMLCh* domSchemaLocation = XMLString::transcode(schemaLocationArg.c_str());
+        domParser->setExternalSchemaLocation(domSchemaLocation);
+        XMLString::release(&domSchemaLocation);
+        domParser->setErrorHandler(&errorHandler);
+    }
+
+    if (!fromCache) {
+        if (reader->loadGrammar(xsdPath.c_str(), Grammar::SchemaGrammarType, true) == nullptr ||
+            errorHandler.getSawErrors()) {
+            std::cerr << "Error: Could not compile XSD grammar from " << xsdPath << std::endl;
+            return;
+        }
+        if (!grammarCachePath.empty()) {
+            grammarPool->lockPool();
+            cache.store(*grammarPool);
+            grammarPool->unlockPool();
+        }
+    }
+    ready = true;
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "XSD grammar " << (fromCache ? "loaded from cache " + grammarCachePath : "compiled from " + xsdPath)
+              << " in " << elapsedMs << " ms (schema fingerprint " << cache.getFingerprint() << ", "
+              << (domParser ? "DOM" : "SAX2") << " validation)." << std::endl;
+}
+
+XSDValidator::~XSDValidator() {
+    delete domParser;
+    delete reader;
+    delete grammarPool;
+}
+
+void XSDValidator::reportFirstValidDocument() {
+    if (firstValidDocumentReported.exchange(true)) {
+        return;
+    }
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+    std::cout << "Startup to first valid document: " << elapsedMs << " ms." << std::endl;
+}
+
+bool XSDValidator::validate(const std::string& xmlMessage) {
+    if (!ready) {
+        return false;
+    }
+    MemBufInputSource memBufIS(
+        (const XMLByte*)xmlMessage.c_str(),
+        xmlMessage.length(),
+        "InMemoryDocument",
+        false
+    );
+    return parseAndCheck(memBufIS);
+}
+
+bool XSDValidator::validate(const pugi::xml_document& doc, std::string& serializedOut, StreamedContent* streamed) {
+    PugiXmlStreamSerializer serializer(doc, serializedOut, "  ", streamed);
+    if (!ready) {
+        serializer.finish();
+        return false;
+    }
+    PugiTreeInputSource treeSource(serializer);
+    bool validationSuccess = parseAndCheck(treeSource);
+    serializer.finish(); // A fatal error stops the scanner early; the output must still be complete
+    return validationSuccess;
+}
+
+bool XSDValidator::parseAndCheck(const InputSource& source) {
+    errorHandler.resetErrors();
+    bool validationSuccess = false;
+    try {
+        if (domParser) {
+            domParser->parse(source);
+            domParser->resetDocumentPool(); // The tree is only built to be discarded
+        } else {
+            reader->parse(source);
+        }
+        if (errorHandler.getSawErrors()) {
+            std::cerr << "XSD Validation Failed with errors." << std::endl;
+            validationSuccess = false;
+        } else {
+            std::cout << "XSD Validation Successful: Document is valid." << std::endl;
+            validationSuccess = true;
+            reportFirstValidDocument();
+        }
+    } catch (const OutOfMemoryException&) {
+        std::cerr << "XSD Validation Error: OutOfMemoryException" << std::endl;
+        validationSuccess = false;
+    } catch (const XMLException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "XSD Validation Error (XMLException): " << message << std::endl;
+        XMLString::release(&message);
+        validationSuccess = false;
+    } catch (const SAXException& toCatch) {
+        char* message = XMLString::transcode(toCatch.getMessage());
+        std::cerr << "XSD Validation Error (SAXException): " << message << std::endl;
+        XMLString::release(&message);
+        validationSuccess = false;
+    } catch (...) {
+        std::cerr << "XSD Validation Error: An unknown exception occurred." << std::endl;
+        validationSuccess = false;
+    }
+    return validationSuccess;
+}
@@ -0,0 +1,73 @@
+#ifndef XSDVALIDATOR_H
+#define XSDVALIDATOR_H
+
+#include <string>
+#include "pugixml.hpp"
+
+#include <xercesc/sax/HandlerBase.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax/InputSource.hpp>
+#include <xercesc/framework/XMLGrammarPool.hpp>
+#include <xercesc/parsers/XercesDOMParser.hpp>
+
+XERCES_CPP_NAMESPACE_USE
+
+class StreamedContent;
+
+// Custom Error Handler for Xerces-C++ Validation
+class XSDValidationErrorHandler : public HandlerBase {
+public:
+    XSDValidationErrorHandler() : fSawErrors(false) {}
+    ~XSDValidationErrorHandler() override = default;
+
+    void warning(const SAXParseException& exc) override;
+    void error(const SAXParseException& exc) override;
+    void fatalError(const SAXParseException& exc) override;
+    void resetErrors() override;
+    bool getSawErrors() const { return fSawErrors; }
+
+private:
+    bool fSawErrors;
+};
+
+// Long-lived SAX2 schema validator. The CDA grammar is compiled once when the
+// validator is created and reused for every document, and documents can be
+// validated straight from a pugixml tree while it is being serialized.
+// With a grammar cache path, the compiled grammar pool is deserialized from disk
+// instead of being rebuilt from the schema files (see GrammarCache).
+// With `buildDom` (<Validation><Mode>dom), documents go through a XercesDOMParser on
+// the same grammar pool instead, which builds and discards a DOM tree per document.
+// Not thread-safe: use one instance per thread.
+class XSDValidator {
+public:
+    explicit XSDValidator(const std::string& xsdPath, const std::string& grammarCachePath = "", bool buildDom = false);
+    ~XSDValidator();
+
+    XSDValidator(const XSDValidator&) = delete;
+    XSDValidator& operator=(const XSDValidator&) = delete;
+
+    // True when the reader was created and the schema grammar compiled
+    bool isReady() const { return ready; }
+
+    // Validates an already serialized document
+    bool validate(const std::string& xmlMessage);
+
+    // Serializes `doc` into `serializedOut` (appending) and validates the bytes as they
+    // are produced. The output is complete even when validation fails.
+    bool validate(const pugi::xml_document& doc, std::string& serializedOut, StreamedContent* streamed = nullptr);
+
+private:
+    XMLGrammarPool* grammarPool; // Must outlive the reader
+    SAX2XMLReader* reader;
+    XercesDOMParser* domParser; // Only in DOM mode; parses instead of `reader`
+    XSDValidationErrorHandler errorHandler;
+    DefaultHandler noopContentHandler;
+    bool ready;
+
+    bool parseAndCheck(const InputSource& source);
+    void loadGrammar(const std::string& xsdPath, const std::string& grammarCachePath, bool buildDom);
+    static void reportFirstValidDocument();
+};
+
+#endif // XSDVALIDATOR_H
@@ -0,0 +1,302 @@
+// hl7_datagen: reproducible synthetic load for the database and the DICOM import path.
+//
+// Usage: hl7_datagen [--seed N] [--patients N] [--studies-per-patient MEAN] [--max-studies N]
+//                    [--from YYYYMMDD] [--to YYYYMMDD] [--sql FILE|-] [--truncate] [--csv DIR]
+//                    [--dicom-dir DIR] [--dicom-patients N] [--matrix N] [--frames N] [--instances N]
+//   --sql           write a psql script that bulk-loads Patients and Studies with COPY
+//   --truncate      empty both tables first (otherwise ids must not collide with existing rows)
+//   --csv           write DIR/Patients.csv and DIR/Studies.csv, the snapshot format read by
+//                   <DataSource><Type>memory</Type> (no database needed)
+//   --dicom-dir     write NM DICOM files for the NM studies of the first --dicom-patients
+//                   patients (default 100) as DIR/<patient id>/<accession>/IM000001.dcm
+//   --matrix/--frames/--instances control the file size: matrix^2 * frames * 2 bytes each
+// The same seed always gives the same rows and files, and the DICOM files describe the
+// same patients and studies as the SQL, so either import path can be exercised.
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "DicomWriter.h"
+#include "SyntheticData.h"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: hl7_datagen [--seed N] [--patients N] [--studies-per-patient MEAN] [--max-studies N]\n"
+                 "                   [--from YYYYMMDD] [--to YYYYMMDD] [--sql FILE|-] [--truncate] [--csv DIR]\n"
+                 "                   [--dicom-dir DIR] [--dicom-patients N] [--matrix N] [--frames N] [--instances N]"
+              << std::endl;
+}
+
+bool parseDate(const std::string& text, int& day) {
+    int year = 0, month = 0, dayOfMonth = 0;
+    if (text.size() != 8 || std::sscanf(text.c_str(), "%4d%2d%2d", &year, &month, &dayOfMonth) != 3 ||
+        month < 1 || month > 12 || dayOfMonth < 1 || dayOfMonth > 31) {
+        return false;
+    }
+    day = SyntheticPopulation::dayFromDate(year, month, dayOfMonth);
+    return true;
+}
+
+// COPY text format: backslash, tab, newline and carriage return must be escaped
+void appendCopyField(std::string& line, const std::string& value) {
+    for (char c : value) {
+        switch (c) {
+            case '\\': line += "\\\\"; break;
+            case '\t': line += "\\t"; break;
+            case '\n': line += "\\n"; break;
+            case '\r': line += "\\r"; break;
+            default: line += c;
+        }
+    }
+}
+
+void appendCopyRow(std::string& buffer, std::initializer_list<const std::string*> fields) {
+    bool first = true;
+    for (const std::string* field : fields) {
+        if (!first) buffer += '\t';
+        appendCopyField(buffer, *field);
+        first = false;
+    }
+    buffer += '\n';
+}
+
+// RFC 4180: quote fields holding a separator, quote or line break
+void appendCsvRow(std::string& buffer, std::initializer_list<const std::string*> fields) {
+    bool first = true;
+    for (const std::string* field : fields) {
+        if (!first) buffer += ',';
+        first = false;
+        if (field->find_first_of(",\"\r\n") == std::string::npos) {
+            buffer += *field;
+            continue;
+        }
+        buffer += '"';
+        for (char c : *field) {
+            if (c == '"') buffer += '"';
+            buffer += c;
+        }
+        buffer += '"';
+    }
+    buffer += '\n';
+}
+
+bool writeCsv(const std::string& directory, const SyntheticPopulation& population, size_t& studyCount) {
+    std::ofstream patientsOut(directory + "/Patients.csv", std::ios::binary | std::ios::trunc);
+    std::ofstream studiesOut(directory + "/Studies.csv", std::ios::binary | std::ios::trunc);
+    if (!patientsOut.is_open() || !studiesOut.is_open()) {
+        std::cerr << "Error: Cannot write CSV files in " << directory << std::endl;
+        return false;
+    }
+    patientsOut << "pat_id,pat_name,pat_birth_dt,pat_gender_code\n";
+    studiesOut << "study_uid,pat_id,acc_num,study_dt,study_tm,mod,study_desc,ref_phys_name\n";
+
+    const size_t flushSize = 1 << 20;
+    std::string patientRows;
+    std::string studyRows;
+    studyCount = 0;
+    for (size_t i = 0; i < population.settings().patients; ++i) {
+        SyntheticPatient p = population.patient(i);
+        std::string name = p.displayName();
+        appendCsvRow(patientRows, {&p.id, &name, &p.birthDate, &p.sex});
+        for (const SyntheticStudy& s : population.studies(p)) {
+            appendCsvRow(studyRows, {&s.uid, &p.id, &s.accessionNumber, &s.date, &s.time, &s.modality, &s.description, &s.referringPhysician});
+            ++studyCount;
+        }
+        if (patientRows.size() >= flushSize || studyRows.size() >= flushSize) {
+            patientsOut << patientRows;
+            studiesOut << studyRows;
+            patientRows.clear();
+            studyRows.clear();
+        }
+    }
+    patientsOut << patientRows;
+    studiesOut << studyRows;
+    patientsOut.flush();
+    studiesOut.flush();
+    return static_cast<bool>(patientsOut) && static_cast<bool>(studiesOut);
+}
+
+// Patients are streamed first and studies second (they reference patients), so the
+// population is walked twice rather than held in memory; both passes are deterministic.
+bool writeSql(std::ostream& out, const SyntheticPopulation& population, bool truncate, size_t& studyCount) {
+    const size_t patients = population.settings().patients;
+    const size_t flushSize = 1 << 20;
+    std::string buffer;
+    buffer.reserve(flushSize + 4096);
+
+    out << "-- Generated by hl7_datagen --seed " << population.settings().seed << " --patients " << patients << "\n"
+        << "SET client_encoding = 'UTF8';\n"
+        << "BEGIN;\n";
+    if (truncate) {
+        out << "TRUNCATE Studies, Patients;\n";
+    }
+
+    out << "COPY Patients (pat_id, pat_name, pat_birth_dt, pat_gender_code) FROM STDIN;\n";
+    for (size_t i = 0; i < patients; ++i) {
+        SyntheticPatient p = population.patient(i);
+        std::string name = p.displayName();
+        appendCopyRow(buffer, {&p.id, &name, &p.birthDate, &p.sex});
+        if (buffer.size() >= flushSize) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+    out << "\\.\n";
+
+    studyCount = 0;
+    out << "COPY Studies (study_uid, pat_id, acc_num, study_dt, study_tm, mod, study_desc, ref_phys_name) FROM STDIN;\n";
+    for (size_t i = 0; i < patients; ++i) {
+        SyntheticPatient p = population.patient(i);
+        for (const SyntheticStudy& s : population.studies(p)) {
+            appendCopyRow(buffer, {&s.uid, &p.id, &s.accessionNumber, &s.date, &s.time, &s.modality, &s.description, &s.referringPhysician});
+            ++studyCount;
+        }
+        if (buffer.size() >= flushSize) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out << "\\.\n"
+        << "COMMIT;\n"
+        << "ANALYZE Patients;\n"
+        << "ANALYZE Studies;\n";
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    SyntheticPopulation::Options populationOptions;
+    DicomWriter::Options dicomOptions;
+    std::string sqlPath;
+    std::string csvDir;
+    std::string dicomDir;
+    size_t dicomPatients = 100;
+    bool truncate = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--seed" && hasValue) {
+                populationOptions.seed = std::stoull(argv[++i]);
+            } else if (arg == "--patients" && hasValue) {
+                populationOptions.patients = std::stoull(argv[++i]);
+            } else if (arg == "--studies-per-patient" && hasValue) {
+                populationOptions.meanStudiesPerPatient = std::stod(argv[++i]);
+            } else if (arg == "--max-studies" && hasValue) {
+                populationOptions.maxStudiesPerPatient = std::stoi(argv[++i]);
+            } else if (arg == "--from" && hasValue) {
+                if (!parseDate(argv[++i], populationOptions.firstStudyDay)) throw std::invalid_argument(arg);
+            } else if (arg == "--to" && hasValue) {
+                if (!parseDate(argv[++i], populationOptions.lastStudyDay)) throw std::invalid_argument(arg);
+            } else if (arg == "--sql" && hasValue) {
+                sqlPath = argv[++i];
+            } else if (arg == "--csv" && hasValue) {
+                csvDir = argv[++i];
+            } else if (arg == "--truncate") {
+                truncate = true;
+            } else if (arg == "--dicom-dir" && hasValue) {
+                dicomDir = argv[++i];
+            } else if (arg == "--dicom-patients" && hasValue) {
+                dicomPatients = std::stoull(argv[++i]);
+            } else if (arg == "--matrix" && hasValue) {
+                dicomOptions.rows = dicomOptions.columns = std::stoi(argv[++i]);
+            } else if (arg == "--frames" && hasValue) {
+                dicomOptions.frames = std::stoi(argv[++i]);
+            } else if (arg == "--instances" && hasValue) {
+                dicomOptions.instancesPerStudy = std::stoi(argv[++i]);
+            } else {
+                printUsage();
+                return 1;
+            }
+        }
+    } catch (const std::exception&) {
+        printUsage();
+        return 1;
+    }
+
+    if (sqlPath.empty() && csvDir.empty() && dicomDir.empty()) {
+        std::cerr << "Nothing to do: pass --sql, --csv and/or --dicom-dir." << std::endl;
+        printUsage();
+        return 1;
+    }
+    if (populationOptions.meanStudiesPerPatient < 1.0 || populationOptions.maxStudiesPerPatient < 1 ||
+        populationOptions.firstStudyDay > populationOptions.lastStudyDay) {
+        std::cerr << "Error: Invalid study distribution or date range." << std::endl;
+        return 1;
+    }
+    // Pixel data length is a 32-bit field and US limits rows/columns
+    const unsigned long long pixelBytes = 2ull * dicomOptions.rows * dicomOptions.columns * dicomOptions.frames;
+    if (dicomOptions.rows < 1 || dicomOptions.rows > 4096 || dicomOptions.frames < 1 || dicomOptions.instancesPerStudy < 1 ||
+        pixelBytes > 0xFFFFFFF0ull) {
+        std::cerr << "Error: Invalid DICOM size (matrix 1-4096, frames >= 1, under 4 GiB per file)." << std::endl;
+        return 1;
+    }
+
+    SyntheticPopulation population(populationOptions);
+    auto start = std::chrono::steady_clock::now();
+
+    if (!sqlPath.empty()) {
+        size_t studyCount = 0;
+        bool ok;
+        if (sqlPath == "-") {
+            std::ios::sync_with_stdio(false);
+            ok = writeSql(std::cout, population, truncate, studyCount);
+        } else {
+            std::ofstream out(sqlPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                std::cerr << "Error: Cannot open " << sqlPath << " for writing." << std::endl;
+                return 1;
+            }
+            ok = writeSql(out, population, truncate, studyCount);
+        }
+        if (!ok) {
+            std::cerr << "Error: Failed writing SQL output." << std::endl;
+            return 1;
+        }
+        std::cerr << "SQL: " << populationOptions.patients << " patients, " << studyCount << " studies" << std::endl;
+    }
+
+    if (!csvDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(csvDir, ec);
+        size_t studyCount = 0;
+        if (ec || !writeCsv(csvDir, population, studyCount)) {
+            std::cerr << "Error: Failed writing CSV output to " << csvDir << std::endl;
+            return 1;
+        }
+        std::cerr << "CSV: " << populationOptions.patients << " patients, " << studyCount << " studies in " << csvDir << std::endl;
+    }
+
+    if (!dicomDir.empty()) {
+        size_t count = std::min(dicomPatients, populationOptions.patients);
+        size_t files = 0;
+        long long bytes = 0;
+        DicomWriter writer(dicomOptions);
+        for (size_t i = 0; i < count; ++i) {
+            SyntheticPatient p = population.patient(i);
+            for (const SyntheticStudy& s : population.studies(p)) {
+                if (s.modality != "NM") continue;
+                long long written = writer.writeStudy(dicomDir, p, s);
+                if (written < 0) return 1;
+                bytes += written;
+                files += static_cast<size_t>(dicomOptions.instancesPerStudy);
+            }
+        }
+        std::cerr << "DICOM: " << files << " files, " << bytes / (1024 * 1024) << " MiB under " << dicomDir << std::endl;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Done in " << seconds << " s" << std::endl;
+    return 0;
+}
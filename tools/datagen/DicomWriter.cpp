@@ -0,0 +1,219 @@
+#include "DicomWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const char* const NM_IMAGE_STORAGE = "1.2.840.10008.5.1.4.1.1.20";
+const char* const EXPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2.1";
+const char* const IMPLEMENTATION_CLASS_UID = "2.25.203856094217334866711305939516842905174";
+const char* const IMPLEMENTATION_VERSION = "HL7GEN_DATAGEN";
+
+// Little-endian element encoder; elements must be appended in ascending tag order
+class ElementBuffer {
+public:
+    std::string bytes;
+
+    void u16(std::uint16_t value) {
+        bytes.push_back(static_cast<char>(value & 0xFF));
+        bytes.push_back(static_cast<char>(value >> 8));
+    }
+
+    void u32(std::uint32_t value) {
+        u16(static_cast<std::uint16_t>(value & 0xFFFF));
+        u16(static_cast<std::uint16_t>(value >> 16));
+    }
+
+    void header(std::uint16_t group, std::uint16_t element, const char* vr, std::uint32_t length) {
+        u16(group);
+        u16(element);
+        bytes.append(vr, 2);
+        std::string v(vr);
+        if (v == "OB" || v == "OW" || v == "SQ" || v == "UN" || v == "UT") {
+            u16(0);
+            u32(length);
+        } else {
+            u16(static_cast<std::uint16_t>(length));
+        }
+    }
+
+    // Text VRs pad with a space, UI with a NUL, to an even length
+    void text(std::uint16_t group, std::uint16_t element, const char* vr, std::string value) {
+        if (value.size() % 2 != 0) {
+            value.push_back(std::string(vr) == "UI" ? '\0' : ' ');
+        }
+        header(group, element, vr, static_cast<std::uint32_t>(value.size()));
+        bytes += value;
+    }
+
+    void us(std::uint16_t group, std::uint16_t element, const std::vector<std::uint16_t>& values) {
+        header(group, element, "US", static_cast<std::uint32_t>(values.size() * 2));
+        for (std::uint16_t value : values) u16(value);
+    }
+
+    void ul(std::uint16_t group, std::uint16_t element, std::uint32_t value) {
+        header(group, element, "UL", 4);
+        u32(value);
+    }
+
+    void at(std::uint16_t group, std::uint16_t element, const std::vector<std::pair<std::uint16_t, std::uint16_t>>& tags) {
+        header(group, element, "AT", static_cast<std::uint32_t>(tags.size() * 4));
+        for (const auto& tag : tags) {
+            u16(tag.first);
+            u16(tag.second);
+        }
+    }
+};
+
+} // namespace
+
+DicomWriter::DicomWriter(const Options& options) : options(options) {
+}
+
+std::string DicomWriter::toPersonName(const std::string& displayName) {
+    std::istringstream stream(displayName);
+    std::vector<std::string> words;
+    std::string word;
+    while (stream >> word) words.push_back(word);
+    if (words.empty()) return "";
+
+    std::string prefix;
+    if (words.size() > 2 && words.front().back() == '.') { // Title such as "lek." or "dr"
+        prefix = words.front();
+        words.erase(words.begin());
+    }
+    std::string family = words.back();
+    words.pop_back();
+    std::string given;
+    for (const std::string& w : words) given += (given.empty() ? "" : " ") + w;
+
+    std::string result = family + "^" + given;
+    if (!prefix.empty()) result += "^^" + prefix;
+    return result;
+}
+
+std::string DicomWriter::buildInstance(const SyntheticPatient& patient, const SyntheticStudy& study, int instanceNumber,
+                                       const std::string& seriesUid, const std::string& sopInstanceUid) const {
+    const int rows = options.rows;
+    const int columns = options.columns;
+    const int frames = options.frames;
+
+    ElementBuffer data;
+    data.text(0x0008, 0x0005, "CS", "ISO_IR 192"); // UTF-8, for the Polish diacritics
+    data.text(0x0008, 0x0008, "CS", frames > 1 ? "ORIGINAL\\PRIMARY\\DYNAMIC\\EMISSION" : "ORIGINAL\\PRIMARY\\STATIC\\EMISSION");
+    data.text(0x0008, 0x0016, "UI", NM_IMAGE_STORAGE);
+    data.text(0x0008, 0x0018, "UI", sopInstanceUid);
+    data.text(0x0008, 0x0020, "DA", study.date);
+    data.text(0x0008, 0x0030, "TM", study.time);
+    data.text(0x0008, 0x0050, "SH", study.accessionNumber);
+    data.text(0x0008, 0x0060, "CS", "NM");
+    data.text(0x0008, 0x0070, "LO", "SYNTHETIC");
+    data.text(0x0008, 0x0090, "PN", toPersonName(study.referringPhysician));
+    data.text(0x0008, 0x1030, "LO", study.description);
+    data.text(0x0010, 0x0010, "PN", patient.dicomName());
+    data.text(0x0010, 0x0020, "LO", patient.id);
+    data.text(0x0010, 0x0030, "DA", patient.birthDate);
+    data.text(0x0010, 0x0040, "CS", patient.sex);
+    data.text(0x0018, 0x1242, "IS", std::to_string(options.frameDurationMs));
+    data.text(0x0020, 0x000D, "UI", study.uid);
+    data.text(0x0020, 0x000E, "UI", seriesUid);
+    data.text(0x0020, 0x0010, "SH", study.accessionNumber.substr(study.accessionNumber.size() > 16 ? study.accessionNumber.size() - 16 : 0));
+    data.text(0x0020, 0x0011, "IS", "1");
+    data.text(0x0020, 0x0013, "IS", std::to_string(instanceNumber));
+    data.us(0x0028, 0x0002, {1});
+    data.text(0x0028, 0x0004, "CS", "MONOCHROME2");
+    data.text(0x0028, 0x0008, "IS", std::to_string(frames));
+    data.at(0x0028, 0x0009, {{0x0054, 0x0010}, {0x0054, 0x0020}});
+    data.us(0x0028, 0x0010, {static_cast<std::uint16_t>(rows)});
+    data.us(0x0028, 0x0011, {static_cast<std::uint16_t>(columns)});
+    data.us(0x0028, 0x0100, {16});
+    data.us(0x0028, 0x0101, {16});
+    data.us(0x0028, 0x0102, {15});
+    data.us(0x0028, 0x0103, {0});
+    data.us(0x0054, 0x0010, std::vector<std::uint16_t>(frames, 1)); // Energy Window Vector
+    data.us(0x0054, 0x0011, {1});
+    data.us(0x0054, 0x0020, std::vector<std::uint16_t>(frames, 1)); // Detector Vector
+    data.us(0x0054, 0x0021, {1});
+
+    // Pixel data: a Gaussian hot spot over a flat background with Gaussian-approximated
+    // counting noise. Across frames the spot follows a gamma-variate uptake/washout curve.
+    SyntheticRng rng(SyntheticRng::mix(study.key, static_cast<std::uint64_t>(instanceNumber)));
+    const double spotRow = rows * (0.3 + 0.4 * rng.uniform());
+    const double spotColumn = columns * (0.3 + 0.4 * rng.uniform());
+    const double spotSigma = std::max(2.0, std::min(rows, columns) * (0.04 + 0.06 * rng.uniform()));
+    const double background = 20.0 + 30.0 * rng.uniform();
+    const double peak = 400.0 + 1600.0 * rng.uniform();
+    const double peakFrame = std::max(1.0, frames * (0.2 + 0.2 * rng.uniform()));
+
+    const std::uint64_t pixelBytes = static_cast<std::uint64_t>(rows) * columns * frames * 2;
+    data.header(0x7FE0, 0x0010, "OW", static_cast<std::uint32_t>(pixelBytes));
+    data.bytes.reserve(data.bytes.size() + pixelBytes);
+    for (int f = 0; f < frames; ++f) {
+        double t = (f + 0.5) / peakFrame;
+        double activity = frames > 1 ? t * std::exp(1.0 - t) : 1.0;
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                double dr = r - spotRow;
+                double dc = c - spotColumn;
+                double mean = background + peak * activity * std::exp(-(dr * dr + dc * dc) / (2 * spotSigma * spotSigma));
+                double counts = rng.normal(mean, std::sqrt(mean));
+                data.u16(static_cast<std::uint16_t>(std::min(32767.0, std::max(0.0, std::round(counts)))));
+            }
+        }
+    }
+
+    ElementBuffer meta;
+    meta.header(0x0002, 0x0001, "OB", 2);
+    meta.bytes.push_back('\0');
+    meta.bytes.push_back('\1');
+    meta.text(0x0002, 0x0002, "UI", NM_IMAGE_STORAGE);
+    meta.text(0x0002, 0x0003, "UI", sopInstanceUid);
+    meta.text(0x0002, 0x0010, "UI", EXPLICIT_VR_LITTLE_ENDIAN);
+    meta.text(0x0002, 0x0012, "UI", IMPLEMENTATION_CLASS_UID);
+    meta.text(0x0002, 0x0013, "SH", IMPLEMENTATION_VERSION);
+
+    ElementBuffer file;
+    file.bytes.assign(128, '\0');
+    file.bytes += "DICM";
+    file.ul(0x0002, 0x0000, static_cast<std::uint32_t>(meta.bytes.size()));
+    file.bytes += meta.bytes;
+    file.bytes += data.bytes;
+    return file.bytes;
+}
+
+long long DicomWriter::writeStudy(const std::string& root, const SyntheticPatient& patient, const SyntheticStudy& study) const {
+    std::filesystem::path directory = std::filesystem::path(root) / patient.id / study.accessionNumber;
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        std::cerr << "Error: Cannot create directory " << directory.string() << ": " << ec.message() << std::endl;
+        return -1;
+    }
+
+    SyntheticRng uidRng(SyntheticRng::mix(study.key, 0x53455249ull)); // "SERI"
+    std::string seriesUid = SyntheticPopulation::uidFromKey(uidRng.next(), uidRng.next());
+
+    long long total = 0;
+    for (int i = 1; i <= options.instancesPerStudy; ++i) {
+        std::string sopInstanceUid = SyntheticPopulation::uidFromKey(uidRng.next(), uidRng.next());
+        std::string bytes = buildInstance(patient, study, i, seriesUid, sopInstanceUid);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "IM%06d.dcm", i);
+        std::filesystem::path path = directory / name;
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+            std::cerr << "Error: Cannot write " << path.string() << std::endl;
+            return -1;
+        }
+        total += static_cast<long long>(bytes.size());
+    }
+    return total;
+}
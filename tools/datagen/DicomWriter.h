@@ -0,0 +1,36 @@
+#ifndef DICOMWRITER_H
+#define DICOMWRITER_H
+
+#include "SyntheticData.h"
+#include <string>
+
+// Writes minimal but well-formed NM Image Storage files (explicit VR little endian,
+// Part 10) carrying the patient/study attributes DicomParser reads, plus a synthetic
+// multi-frame image. Enough for DicomHero to load, not a conformance test object.
+class DicomWriter {
+public:
+    struct Options {
+        int rows = 128;
+        int columns = 128;
+        int frames = 1;           // > 1 gives a dynamic acquisition with a rising/falling hot spot
+        int frameDurationMs = 10000;
+        int instancesPerStudy = 1;
+    };
+
+    explicit DicomWriter(const Options& options);
+
+    // Writes every instance of the study under <root>/<patient id>/<accession>/
+    // and returns the number of bytes written, or -1 on error.
+    long long writeStudy(const std::string& root, const SyntheticPatient& patient, const SyntheticStudy& study) const;
+
+    // "Given Family" / "lek. Given Family" -> "Family^Given" / "Family^Given^^lek."
+    static std::string toPersonName(const std::string& displayName);
+
+private:
+    Options options;
+
+    std::string buildInstance(const SyntheticPatient& patient, const SyntheticStudy& study, int instanceNumber,
+                              const std::string& seriesUid, const std::string& sopInstanceUid) const;
+};
+
+#endif // DICOMWRITER_H
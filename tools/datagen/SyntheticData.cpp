@@ -0,0 +1,328 @@
+#include "SyntheticData.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Most frequent Polish given names and surnames, in rough frequency order
+const char* const FEMALE_NAMES[] = {
+    "Anna", "Maria", "Katarzyna", "Małgorzata", "Agnieszka", "Barbara", "Ewa", "Krystyna",
+    "Elżbieta", "Magdalena", "Joanna", "Zofia", "Monika", "Teresa", "Danuta", "Natalia",
+    "Aleksandra", "Julia", "Karolina", "Marta", "Beata", "Dorota", "Jadwiga", "Halina",
+    "Janina", "Irena", "Grażyna", "Bożena", "Urszula", "Jolanta", "Iwona", "Renata",
+    "Paulina", "Justyna", "Agata", "Sylwia", "Wiesława", "Stanisława", "Łucja", "Jagoda",
+    "Bogumiła", "Lidia", "Żaneta", "Weronika", "Wiktoria", "Gabriela", "Hanna", "Ilona"};
+
+const char* const MALE_NAMES[] = {
+    "Piotr", "Krzysztof", "Andrzej", "Tomasz", "Jan", "Paweł", "Michał", "Marcin",
+    "Stanisław", "Jakub", "Adam", "Marek", "Łukasz", "Grzegorz", "Mateusz", "Wojciech",
+    "Mariusz", "Dariusz", "Zbigniew", "Jerzy", "Maciej", "Józef", "Ryszard", "Tadeusz",
+    "Janusz", "Kazimierz", "Rafał", "Robert", "Kamil", "Sławomir", "Jacek", "Bartłomiej",
+    "Mirosław", "Przemysław", "Zdzisław", "Bogdan", "Henryk", "Czesław", "Wiesław", "Leszek",
+    "Szymon", "Damian", "Artur", "Radosław", "Edward", "Bolesław", "Witold", "Zenon"};
+
+// Masculine forms; -ski/-cki/-dzki become -ska/-cka/-dzka for women
+const char* const SURNAMES[] = {
+    "Nowak", "Kowalski", "Wiśniewski", "Wójcik", "Kowalczyk", "Kamiński", "Lewandowski", "Zieliński",
+    "Szymański", "Woźniak", "Dąbrowski", "Kozłowski", "Jankowski", "Mazur", "Wojciechowski", "Kwiatkowski",
+    "Krawczyk", "Kaczmarek", "Piotrowski", "Grabowski", "Zając", "Pawłowski", "Michalski", "Król",
+    "Wieczorek", "Jabłoński", "Wróbel", "Nowakowski", "Majewski", "Olszewski", "Stępień", "Malinowski",
+    "Jaworski", "Adamczyk", "Dudek", "Nowicki", "Pawlak", "Górski", "Witkowski", "Walczak",
+    "Sikora", "Baran", "Rutkowski", "Michalak", "Szewczyk", "Ostrowski", "Tomaszewski", "Pietrzak",
+    "Marciniak", "Wróblewski", "Zalewski", "Jakubowski", "Jasiński", "Zawadzki", "Sadowski", "Bąk",
+    "Chmielewski", "Włodarczyk", "Borkowski", "Czarnecki", "Sawicki", "Sokołowski", "Urbański", "Kubiak",
+    "Maciejewski", "Szczepański", "Kucharski", "Wilk", "Kalinowski", "Lis", "Mazurek", "Wysocki",
+    "Adamski", "Kaźmierczak", "Wasilewski", "Sobczak", "Czerwiński", "Andrzejewski", "Cieślak", "Głowacki",
+    "Zakrzewski", "Kołodziej", "Sikorski", "Krajewski", "Gajewski", "Szymczak", "Szulc", "Baranowski",
+    "Laskowski", "Brzeziński", "Makowski", "Ziółkowski", "Przybylski", "Domański", "Nowacki", "Borowski",
+    "Błaszczyk", "Chojnacki", "Ciesielski", "Mróz", "Szczepaniak", "Wesołowski", "Górecki", "Krupa",
+    "Kaczmarczyk", "Leszczyński", "Lipiński", "Kowalewski", "Urbaniak", "Kozak", "Kania", "Mikołajczyk",
+    "Czajkowski", "Mucha", "Tomczak", "Kozieł", "Markowski", "Kowalik", "Nawrocki", "Brzozowski",
+    "Janik", "Musiał", "Wawrzyniak", "Markiewicz", "Orłowski", "Tomczyk", "Jarosz", "Kołodziejczyk",
+    "Kurek", "Kopeć", "Żak", "Wolski", "Łuczak", "Dziedzic", "Kot", "Stasiak", "Stankiewicz",
+    "Piątek", "Jóźwiak", "Urban", "Dobrowolski", "Pawlik", "Kruk", "Domagała", "Piasecki", "Wierzbicki",
+    "Karpiński", "Jastrzębski", "Polak", "Zięba", "Janicki", "Wójtowicz", "Stefański", "Sosnowski",
+    "Bednarek", "Majchrzak", "Bielecki", "Małecki", "Maj", "Sowa", "Milewski", "Gołębiowski", "Gójski"};
+
+struct ModalityProfile {
+    const char* modality;
+    double weight;
+    const char* const* descriptions;
+    size_t descriptionCount;
+};
+
+const char* const NM_DESCRIPTIONS[] = {
+    "Scyntygrafia kości całego ciała", "Scyntygrafia tarczycy", "Scyntygrafia nerek dynamiczna",
+    "SPECT perfuzji mięśnia sercowego", "Scyntygrafia przytarczyc", "Scyntygrafia perfuzyjna płuc",
+    "Scyntygrafia wentylacyjna płuc", "Limfoscyntygrafia węzła wartowniczego", "Scyntygrafia ślinianek",
+    "Scyntygrafia receptorowa (Tektrotyd)", "Renoscyntygrafia statyczna DMSA", "Bone scan"};
+const char* const CT_DESCRIPTIONS[] = {"TK głowy bez kontrastu", "TK klatki piersiowej", "TK jamy brzusznej z kontrastem", "Head CT"};
+const char* const MR_DESCRIPTIONS[] = {"MR głowy", "MR kręgosłupa lędźwiowego", "MR kolana"};
+const char* const PT_DESCRIPTIONS[] = {"PET/CT FDG całego ciała", "PET/CT PSMA", "PET/CT FDG mózgu"};
+const char* const CR_DESCRIPTIONS[] = {"RTG klatki piersiowej PA", "RTG stawu kolanowego"};
+const char* const US_DESCRIPTIONS[] = {"USG jamy brzusznej", "USG tarczycy"};
+
+#define DESCRIPTIONS(list) list, sizeof(list) / sizeof(list[0])
+// This is a nuclear medicine department: mostly NM, with the other studies its patients have
+const ModalityProfile MODALITIES[] = {
+    {"NM", 0.70, DESCRIPTIONS(NM_DESCRIPTIONS)},
+    {"PT", 0.08, DESCRIPTIONS(PT_DESCRIPTIONS)},
+    {"CT", 0.10, DESCRIPTIONS(CT_DESCRIPTIONS)},
+    {"MR", 0.04, DESCRIPTIONS(MR_DESCRIPTIONS)},
+    {"CR", 0.05, DESCRIPTIONS(CR_DESCRIPTIONS)},
+    {"US", 0.03, DESCRIPTIONS(US_DESCRIPTIONS)},
+};
+#undef DESCRIPTIONS
+
+template <typename T, size_t N>
+size_t countOf(const T (&)[N]) {
+    return N;
+}
+
+std::string feminineSurname(const std::string& surname) {
+    const std::string suffixes[] = {"ski", "cki", "dzki"};
+    for (const std::string& suffix : suffixes) {
+        if (surname.size() > suffix.size() && surname.compare(surname.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            return surname.substr(0, surname.size() - 1) + "a";
+        }
+    }
+    return surname;
+}
+
+std::vector<double> zipfCdf(size_t count, double exponent) {
+    std::vector<double> cdf(count);
+    double total = 0.0;
+    for (size_t k = 0; k < count; ++k) {
+        total += 1.0 / std::pow(static_cast<double>(k + 1), exponent);
+        cdf[k] = total;
+    }
+    for (double& value : cdf) value /= total;
+    return cdf;
+}
+
+double zipfMean(size_t count, double exponent) {
+    double weighted = 0.0;
+    double total = 0.0;
+    for (size_t k = 1; k <= count; ++k) {
+        double p = 1.0 / std::pow(static_cast<double>(k), exponent);
+        weighted += p * static_cast<double>(k);
+        total += p;
+    }
+    return weighted / total;
+}
+
+const std::uint64_t STUDY_SALT = 0x5354554459ull;   // "STUDY"
+const std::uint64_t PHYSICIAN_SALT = 0x50485953ull; // "PHYS"
+
+} // namespace
+
+// --- SyntheticRng ---
+
+SyntheticRng::SyntheticRng(std::uint64_t seed) {
+    // splitmix64 to spread the seed over the state
+    for (std::uint64_t& word : state) {
+        seed += 0x9E3779B97F4A7C15ull;
+        std::uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        word = z ^ (z >> 31);
+    }
+}
+
+std::uint64_t SyntheticRng::next() {
+    const std::uint64_t result = ((state[1] * 5) << 7 | (state[1] * 5) >> 57) * 9;
+    const std::uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = (state[3] << 45) | (state[3] >> 19);
+    return result;
+}
+
+double SyntheticRng::uniform() {
+    return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::uint32_t SyntheticRng::below(std::uint32_t n) {
+    return static_cast<std::uint32_t>((static_cast<std::uint64_t>(next() >> 32) * n) >> 32);
+}
+
+double SyntheticRng::normal(double mean, double stddev) {
+    // Box-Muller; one value per call keeps the stream position predictable
+    double u1 = uniform();
+    double u2 = uniform();
+    if (u1 < 1e-300) u1 = 1e-300;
+    return mean + stddev * std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+}
+
+std::uint64_t SyntheticRng::mix(std::uint64_t seed, std::uint64_t a, std::uint64_t b) {
+    SyntheticRng rng(seed ^ (a * 0xD6E8FEB86659FD93ull) ^ (b * 0xA0761D6478BD642Full));
+    return rng.next();
+}
+
+// --- SyntheticPopulation ---
+
+SyntheticPopulation::Options::Options()
+    : firstStudyDay(SyntheticPopulation::dayFromDate(2015, 1, 1)),
+      lastStudyDay(SyntheticPopulation::dayFromDate(2025, 12, 31)) {
+}
+
+SyntheticPopulation::SyntheticPopulation(const Options& options) : options(options) {
+    // Pick the Zipf exponent whose mean matches the requested studies per patient
+    size_t maxCount = static_cast<size_t>(std::max(1, options.maxStudiesPerPatient));
+    double low = 0.0;
+    double high = 8.0;
+    for (int i = 0; i < 60; ++i) {
+        double mid = (low + high) / 2;
+        if (zipfMean(maxCount, mid) > options.meanStudiesPerPatient) low = mid;
+        else high = mid;
+    }
+    studyCountCdf = zipfCdf(maxCount, (low + high) / 2);
+    surnameCdf = zipfCdf(countOf(SURNAMES), 0.9);
+
+    SyntheticRng rng(SyntheticRng::mix(options.seed, PHYSICIAN_SALT));
+    for (int i = 0; i < 400; ++i) {
+        bool female = rng.uniform() < 0.6;
+        std::string surname = SURNAMES[rng.below(static_cast<std::uint32_t>(countOf(SURNAMES)))];
+        std::string given = female ? FEMALE_NAMES[rng.below(static_cast<std::uint32_t>(countOf(FEMALE_NAMES)))]
+                                   : MALE_NAMES[rng.below(static_cast<std::uint32_t>(countOf(MALE_NAMES)))];
+        physicians.push_back("lek. " + given + " " + (female ? feminineSurname(surname) : surname));
+    }
+}
+
+size_t SyntheticPopulation::pick(const std::vector<double>& cdf, SyntheticRng& rng) const {
+    double u = rng.uniform();
+    size_t index = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+    return index < cdf.size() ? index : cdf.size() - 1;
+}
+
+SyntheticPatient SyntheticPopulation::patient(size_t index) const {
+    SyntheticRng rng(SyntheticRng::mix(options.seed, index));
+    SyntheticPatient p;
+    p.index = index;
+    char id[32];
+    std::snprintf(id, sizeof(id), "SYN%09zu", index);
+    p.id = id;
+
+    bool female = rng.uniform() < 0.52;
+    p.sex = female ? "F" : "M";
+    p.givenName = female ? FEMALE_NAMES[rng.below(static_cast<std::uint32_t>(countOf(FEMALE_NAMES)))]
+                         : MALE_NAMES[rng.below(static_cast<std::uint32_t>(countOf(MALE_NAMES)))];
+    std::string surname = SURNAMES[pick(surnameCdf, rng)];
+    p.familyName = female ? feminineSurname(surname) : surname;
+    if (rng.uniform() < 0.03) { // Double-barrelled surnames
+        std::string second = SURNAMES[pick(surnameCdf, rng)];
+        p.familyName += "-" + (female ? feminineSurname(second) : second);
+    }
+
+    // Nuclear medicine patients skew old: age at the end of the study window
+    double age = rng.uniform() < 0.08 ? rng.uniform() * 18.0 : std::min(98.0, std::max(18.0, rng.normal(61.0, 15.0)));
+    // Born at least a day before the window ends, so there is a day left for a study
+    p.birthDay = std::min(options.lastStudyDay - 1,
+                          options.lastStudyDay - static_cast<int>(age * 365.25) - static_cast<int>(rng.below(365)));
+    p.birthDate = dateFromDay(p.birthDay);
+    return p;
+}
+
+std::vector<SyntheticStudy> SyntheticPopulation::studies(const SyntheticPatient& patient) const {
+    SyntheticRng rng(SyntheticRng::mix(options.seed, patient.index, STUDY_SALT));
+    size_t count = pick(studyCountCdf, rng) + 1;
+
+    int firstDay = std::max(options.firstStudyDay, patient.birthDay + 1);
+    int span = std::max(1, options.lastStudyDay - firstDay + 1);
+
+    std::vector<int> days;
+    days.reserve(count);
+    while (days.size() < count) {
+        int day = firstDay + static_cast<int>(rng.below(static_cast<std::uint32_t>(span)));
+        int weekday = ((day % 7) + 7 + 3) % 7; // 0 = Monday (1970-01-01 was a Thursday)
+        if (weekday >= 5 && rng.uniform() < 0.9) {
+            continue; // Few weekend studies
+        }
+        days.push_back(day);
+    }
+    std::sort(days.begin(), days.end());
+
+    double modalityTotal = 0.0;
+    for (const ModalityProfile& m : MODALITIES) modalityTotal += m.weight;
+
+    std::vector<SyntheticStudy> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        SyntheticStudy s;
+        s.key = rng.next();
+        s.uid = uidFromKey(s.key, rng.next());
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "A%09zu%03zu", patient.index, i);
+        s.accessionNumber = buffer;
+        s.date = dateFromDay(days[i]);
+
+        // Scheduled through the working day, centred on late morning
+        double minutes = std::min(19.0 * 60, std::max(7.0 * 60, rng.normal(11.0 * 60, 120.0)));
+        int totalSeconds = static_cast<int>(minutes * 60) + static_cast<int>(rng.below(60));
+        std::snprintf(buffer, sizeof(buffer), "%02d%02d%02d", totalSeconds / 3600, (totalSeconds / 60) % 60, totalSeconds % 60);
+        s.time = buffer;
+
+        double u = rng.uniform() * modalityTotal;
+        const ModalityProfile* modality = &MODALITIES[0];
+        for (const ModalityProfile& m : MODALITIES) {
+            modality = &m;
+            if (u < m.weight) break;
+            u -= m.weight;
+        }
+        s.modality = modality->modality;
+        s.description = modality->descriptions[rng.below(static_cast<std::uint32_t>(modality->descriptionCount))];
+        s.referringPhysician = physicians[pick(surnameCdf, rng) % physicians.size()];
+        result.push_back(s);
+    }
+    return result;
+}
+
+std::string SyntheticPopulation::uidFromKey(std::uint64_t high, std::uint64_t low) {
+    // 128-bit to decimal by repeated division of four 32-bit limbs
+    std::uint32_t limbs[4] = {static_cast<std::uint32_t>(high >> 32), static_cast<std::uint32_t>(high),
+                              static_cast<std::uint32_t>(low >> 32), static_cast<std::uint32_t>(low)};
+    std::string digits;
+    bool nonZero = true;
+    while (nonZero) {
+        std::uint64_t remainder = 0;
+        nonZero = false;
+        for (std::uint32_t& limb : limbs) {
+            std::uint64_t value = (remainder << 32) | limb;
+            limb = static_cast<std::uint32_t>(value / 10);
+            remainder = value % 10;
+            nonZero = nonZero || limb != 0;
+        }
+        digits += static_cast<char>('0' + remainder);
+    }
+    std::reverse(digits.begin(), digits.end());
+    return "2.25." + digits;
+}
+
+int SyntheticPopulation::dayFromDate(int year, int month, int day) {
+    // Days from civil date (proleptic Gregorian), H. Hinnant's algorithm
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int yoe = year - era * 400;
+    const int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+std::string SyntheticPopulation::dateFromDay(int days) {
+    days += 719468;
+    const int era = (days >= 0 ? days : days - 146096) / 146097;
+    const int doe = days - era * 146097;
+    const int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int mp = (5 * doy + 2) / 153;
+    const int day = doy - (153 * mp + 2) / 5 + 1;
+    const int month = mp + (mp < 10 ? 3 : -9);
+    const int year = yoe + era * 400 + (month <= 2);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d%02d%02d", year, month, day);
+    return buffer;
+}
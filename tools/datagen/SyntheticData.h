@@ -0,0 +1,85 @@
+#ifndef SYNTHETICDATA_H
+#define SYNTHETICDATA_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Small, fast PRNG (xoshiro256**) with its own distributions. The std:: distributions
+// are implementation-defined, so they would give different data on different standard
+// libraries; everything here is reproducible from the seed alone.
+class SyntheticRng {
+public:
+    explicit SyntheticRng(std::uint64_t seed);
+
+    std::uint64_t next();
+    double uniform();                       // [0, 1)
+    std::uint32_t below(std::uint32_t n);   // [0, n)
+    double normal(double mean, double stddev);
+
+    // Derives an independent stream key from a seed and up to two indices
+    static std::uint64_t mix(std::uint64_t seed, std::uint64_t a, std::uint64_t b = 0);
+
+private:
+    std::uint64_t state[4];
+};
+
+struct SyntheticPatient {
+    size_t index;
+    std::string id;          // SYN000000042
+    std::string givenName;
+    std::string familyName;
+    std::string birthDate;   // YYYYMMDD
+    std::string sex;         // M / F
+    int birthDay;            // Days since 1970-01-01
+
+    std::string displayName() const { return givenName + " " + familyName; } // Patients.pat_name
+    std::string dicomName() const { return familyName + "^" + givenName; }   // PN
+};
+
+struct SyntheticStudy {
+    std::string uid;         // 2.25.<decimal>
+    std::string accessionNumber;
+    std::string date;        // YYYYMMDD
+    std::string time;        // HHMMSS
+    std::string modality;
+    std::string description;
+    std::string referringPhysician;
+    std::uint64_t key;       // Seeds the series/instance UIDs and pixel data
+};
+
+// A deterministic population: patient i and its studies depend only on (seed, i), so
+// any slice can be generated independently and the SQL and DICOM outputs agree.
+class SyntheticPopulation {
+public:
+    struct Options {
+        std::uint64_t seed = 1;
+        size_t patients = 1000;
+        double meanStudiesPerPatient = 4.0; // Zipf-like: most patients have 1-2, a few have dozens
+        int maxStudiesPerPatient = 200;
+        int firstStudyDay;                  // Days since 1970-01-01
+        int lastStudyDay;
+        Options();
+    };
+
+    explicit SyntheticPopulation(const Options& options);
+
+    const Options& settings() const { return options; }
+    SyntheticPatient patient(size_t index) const;
+    std::vector<SyntheticStudy> studies(const SyntheticPatient& patient) const; // Chronological
+
+    // "2.25." + the 128-bit value in decimal (ISO/IEC 9834-8 UUID-derived UID)
+    static std::string uidFromKey(std::uint64_t high, std::uint64_t low);
+    static int dayFromDate(int year, int month, int day);
+    static std::string dateFromDay(int day); // YYYYMMDD
+
+private:
+    Options options;
+    std::vector<double> studyCountCdf;   // P(count <= k+1)
+    std::vector<double> surnameCdf;
+    std::vector<std::string> physicians; // Referring physician pool
+
+    size_t pick(const std::vector<double>& cdf, SyntheticRng& rng) const;
+};
+
+#endif // SYNTHETICDATA_H
@@ -0,0 +1,127 @@
+// hl7_segment: reads the segment files written by batch runs with <Batch><Sink>segments</Sink>.
+//
+// Usage: hl7_segment get SEGMENT KEY [OUTPUT]   document of a study UID or document ID (sidecar index)
+//        hl7_segment get SEGMENT#OFFSET [OUTPUT] document at an offset, as printed by HL7Generator --lookup
+//        hl7_segment list SEGMENT                 one line per record: offset, sizes, study UID, document ID
+//        hl7_segment verify SEGMENT               checks every record against its CRC and the sidecar index
+// Documents go to stdout unless OUTPUT is given. The segment is memory-mapped, so `get`
+// reads only the pages of the record it extracts.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "../../src/output/SegmentReader.h"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: hl7_segment get SEGMENT KEY [OUTPUT]\n"
+                 "       hl7_segment get SEGMENT#OFFSET [OUTPUT]\n"
+                 "       hl7_segment list SEGMENT\n"
+                 "       hl7_segment verify SEGMENT"
+              << std::endl;
+}
+
+int get(int argc, char* argv[]) {
+    std::string segmentPath = argv[2];
+    std::string key;
+    int outputArg = 3;
+    std::uint64_t offset = 0;
+    size_t hash = segmentPath.find_last_of('#');
+    bool atOffset = hash != std::string::npos;
+    if (atOffset) {
+        offset = std::strtoull(segmentPath.c_str() + hash + 1, nullptr, 10);
+        segmentPath.resize(hash);
+    } else if (argc > 3) {
+        key = argv[3];
+        outputArg = 4;
+    } else {
+        printUsage();
+        return 2;
+    }
+
+    SegmentReader reader(segmentPath);
+    if (!reader.open()) {
+        return 1;
+    }
+    if (!atOffset && (!reader.loadIndex() || !reader.find(key, offset))) {
+        std::cerr << "No record for " << key << " in " << segmentPath << "." << std::endl;
+        return 1;
+    }
+    SegmentRecord record;
+    std::string document;
+    if (!reader.read(offset, record, document)) {
+        return 1;
+    }
+    if (argc > outputArg) {
+        std::ofstream out(argv[outputArg], std::ios::binary);
+        if (!out.write(document.data(), static_cast<std::streamsize>(document.size()))) {
+            std::cerr << "Cannot write " << argv[outputArg] << "." << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout.write(document.data(), static_cast<std::streamsize>(document.size()));
+    }
+    return 0;
+}
+
+int list(const std::string& segmentPath) {
+    SegmentReader reader(segmentPath);
+    if (!reader.open()) {
+        return 1;
+    }
+    std::uint64_t end = reader.scan([](const SegmentRecord& record) {
+        std::cout << record.offset << '\t' << record.originalLength << '\t' << record.storedLength << (record.compressed ? "z" : "")
+                  << '\t' << record.studyUid << '\t' << record.documentId << '\n';
+    });
+    if (end != reader.size()) {
+        std::cerr << "Records end at offset " << end << " of " << reader.size() << " (uncommitted or damaged tail)." << std::endl;
+    }
+    return 0;
+}
+
+int verify(const std::string& segmentPath) {
+    SegmentReader reader(segmentPath);
+    if (!reader.open() || !reader.loadIndex()) {
+        return 1;
+    }
+    unsigned long records = 0;
+    unsigned long unindexed = 0;
+    std::uint64_t end = reader.scan([&](const SegmentRecord& record) {
+        std::uint64_t offset = 0;
+        ++records;
+        if (!reader.find(record.documentId.empty() ? record.studyUid : record.documentId, offset) || offset != record.offset) {
+            ++unindexed;
+        }
+    });
+    std::cout << records << " records, " << unindexed << " not in the sidecar index";
+    if (end != reader.size()) {
+        std::cout << ", " << reader.size() - end << " bytes of uncommitted or damaged tail at offset " << end;
+    }
+    std::cout << "." << std::endl;
+    return end == reader.size() ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return 2;
+    }
+    std::string command = argv[1];
+    if (command == "get") {
+        return get(argc, argv);
+    }
+    if (command == "list") {
+        return list(argv[2]);
+    }
+    if (command == "verify") {
+        return verify(argv[2]);
+    }
+    printUsage();
+    return 2;
+}